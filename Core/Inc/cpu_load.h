@@ -0,0 +1,95 @@
+/**
+ * @file cpu_load.h
+ * @brief 按任务统计 CPU 占用
+ *
+ * FreeRTOS 运行时间统计（configGENERATE_RUN_TIME_STATS）以 TIM2 微秒计数为时钟，
+ * 采样任务每 CPU_LOAD_PERIOD_MS 取一次各任务的累计运行时间，得到本周期占用率和滑动平均。
+ * 总占用率为 100% 减去空闲任务的占用率。中断的执行时间计入被打断的任务。
+ *
+ * 查看方式：
+ *   - 串口命令 "cpu"：打印各任务占用；"cpu log <秒>"：周期输出到日志（0 关闭）；
+ *     "cpu overlay on|off"：显示/隐藏屏幕左上角的占用率浮层（默认显示）；
+ *   - 诊断盘 stats.txt 的任务表。
+ */
+
+#ifndef __CPU_LOAD_H
+#define __CPU_LOAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 采样周期（毫秒） */
+#ifndef CPU_LOAD_PERIOD_MS
+#define CPU_LOAD_PERIOD_MS      1000U
+#endif
+
+/* 滑动平均：每个周期向新值靠近 1/2^CPU_LOAD_AVG_SHIFT（3 约为最近 8 个周期） */
+#ifndef CPU_LOAD_AVG_SHIFT
+#define CPU_LOAD_AVG_SHIFT      3U
+#endif
+
+/* 统计的最大任务数 */
+#ifndef CPU_LOAD_MAX_TASKS
+#define CPU_LOAD_MAX_TASKS      24U
+#endif
+
+/* 默认日志输出间隔（秒，0 不输出） */
+#ifndef CPU_LOAD_LOG_PERIOD_S
+#define CPU_LOAD_LOG_PERIOD_S   10U
+#endif
+
+#define CPU_LOAD_NAME_LEN       16U
+
+/* 单个任务的占用（千分比） */
+typedef struct {
+    char name[CPU_LOAD_NAME_LEN];
+    uint16_t number;            /* 任务编号（uxTCBNumber） */
+    uint16_t load;              /* 最近一个周期 */
+    uint16_t avg;               /* 滑动平均 */
+    uint8_t priority;
+    bool idle;                  /* 空闲任务 */
+} cpu_load_task_t;
+
+/**
+ * @brief 创建采样任务（调度器启动前调用一次）
+ */
+void cpu_load_init(void);
+
+/**
+ * @brief 总占用率（千分比）
+ * @param avg 非空时返回滑动平均
+ * @return 最近一个周期的占用率
+ */
+uint16_t cpu_load_total(uint16_t *avg);
+
+/**
+ * @brief 按滑动平均从大到小取第 index 个任务
+ * @retval true 成功；false 没有这一项
+ */
+bool cpu_load_get(uint32_t index, cpu_load_task_t *out);
+
+/**
+ * @brief 按任务编号查找
+ */
+bool cpu_load_find(uint16_t number, cpu_load_task_t *out);
+
+/**
+ * @brief 屏幕浮层是否打开（由 LVGL 任务轮询）
+ */
+bool cpu_load_overlay_enabled(void);
+
+/**
+ * @brief 串口命令 "cpu ..."
+ * @return 1 已处理；0 不是本模块的命令
+ */
+int cpu_load_command(const char *line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CPU_LOAD_H */
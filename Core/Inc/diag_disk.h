@@ -0,0 +1,69 @@
+/**
+ * @file diag_disk.h
+ * @brief 只读诊断盘：按扇区即时合成的 FAT16 镜像（USB MSC 第二个 LUN）
+ *
+ * 镜像不占存储空间，引导扇区、FAT、根目录和文件数据都在主机读扇区时生成：
+ *   - 每个文件登记时按 max_size 预留一段连续的簇，FAT 链的长度随快照长度；
+ *   - 介质装入（USB 配置完成、主机弹出后重新装入）后的第一次读取时，依次调用各文件的
+ *     update() 生成快照并得到文件长度，写入根目录；之后到下次装入前长度不变，
+ *     主机看到的是同一时刻的一组文件；
+ *   - 文件数据由 read() 按偏移提供，超出文件长度的部分补零。
+ * 所有读取在同一个任务中进行（MSC 工作任务），update()/read() 不需要可重入。
+ */
+
+#ifndef __DIAG_DISK_H
+#define __DIAG_DISK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 卷大小（扇区），FAT16 要求簇数不少于 4085 */
+#ifndef DIAG_DISK_SECTORS
+#define DIAG_DISK_SECTORS       8192U
+#endif
+
+/* 最多登记的文件数 */
+#ifndef DIAG_DISK_MAX_FILES
+#define DIAG_DISK_MAX_FILES     8U
+#endif
+
+#define DIAG_DISK_SECTOR_SIZE   512U
+
+/* 诊断文件 */
+typedef struct {
+    const char *name;                                           /* 8.3 文件名，如 "stats.txt" */
+    uint32_t max_size;                                          /* 最大长度（字节），决定预留的簇数 */
+    uint32_t (*update)(void);                                   /* 生成快照，返回文件长度（不超过 max_size），NULL 表示固定为 max_size */
+    void (*read)(uint32_t offset, uint8_t *buf, uint32_t len);  /* 读取快照内容，offset + len 不超过文件长度 */
+} diag_file_t;
+
+/**
+ * @brief 登记文件（主机下次装入介质时出现）
+ * @param file 文件描述，需长期有效
+ * @retval false 文件表已满、卷空间不足或文件名无效
+ */
+bool diag_disk_register(const diag_file_t *file);
+
+/**
+ * @brief 介质重新装入：下次读取前重新生成快照（中断中可调用）
+ */
+void diag_disk_reload(void);
+
+/**
+ * @brief 读扇区
+ * @param buf 目标缓冲区
+ * @param sector 起始扇区
+ * @param count 扇区数
+ * @retval 0 成功；-1 超出卷范围
+ */
+int diag_disk_read(uint8_t *buf, uint32_t sector, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DIAG_DISK_H */
@@ -0,0 +1,57 @@
+/**
+ * @file diag_files.h
+ * @brief 诊断盘上的固件状态文件
+ *
+ *   stats.txt  运行时间、FreeRTOS 堆、外部 SRAM 占用、卷所有者、sd_io 与记录器统计、串口日志与 USB 事件队列、任务列表
+ *   heap.bin   外部 SRAM 分配器（mymalloc）的分配表，格式见 diag_heap_header_t
+ *   log.txt    最近 LOG_HISTORY_SIZE 字节的日志（令牌化日志时为 log.bin，用 tools/log_decode.py 解码）
+ *   trace.bin  FreeRTOS 调度跟踪（rtos_trace.h），用 tools/trace_export.py 转换
+ * 其他模块可以直接调用 diag_disk_register() 添加自己的文件。
+ */
+
+#ifndef __DIAG_FILES_H
+#define __DIAG_FILES_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* stats.txt 最大长度 */
+#ifndef DIAG_STATS_MAX
+#define DIAG_STATS_MAX          4096U
+#endif
+
+#define DIAG_HEAP_MAGIC         0x50414548U     /* "HEAP" */
+#define DIAG_HEAP_VERSION       1U
+
+/*
+ * heap.bin（小端）：文件头之后紧跟 table_entries 个 table_entry_size 字节的分配表项，
+ * 第 i 项对应外部 SRAM 的第 i 个块（地址 pool_base + i * block_size），
+ * 非零表示已分配，值为该次分配占用的块数。文件头是装入时的快照，分配表是读取时的实时内容。
+ */
+typedef struct {
+    uint32_t magic;             /* DIAG_HEAP_MAGIC */
+    uint16_t version;           /* DIAG_HEAP_VERSION */
+    uint16_t header_size;       /* sizeof(diag_heap_header_t) */
+    uint32_t rtos_heap_size;    /* FreeRTOS 堆总大小 */
+    uint32_t rtos_heap_free;    /* FreeRTOS 堆当前空闲 */
+    uint32_t rtos_heap_min;     /* FreeRTOS 堆历史最小空闲 */
+    uint32_t pool_base;         /* 外部 SRAM 内存池地址 */
+    uint32_t block_size;        /* 分配块大小 */
+    uint32_t table_entries;     /* 分配表项数 */
+    uint16_t table_entry_size;  /* 分配表项字节数 */
+    uint16_t reserved;
+} diag_heap_header_t;
+
+/**
+ * @brief 登记诊断文件，USB 启动前调用一次
+ */
+void diag_files_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __DIAG_FILES_H */
@@ -1,6 +1,18 @@
 /**
  * @file high_res_timer.h
- * @brief 高精度定时器头文件
+ * @brief 高精度时间基准头文件
+ *
+ * - HighResTimer_GetUs64()：64 位微秒时钟（TIM2 + 溢出中断），不回绕，任何上下文可调用
+ * - HighResTimer_GetUs()：32 位微秒计数，只读一次寄存器，适合测量 71 分钟以内的间隔
+ * - HighResTimer_GetCycles()：DWT 内核时钟周期计数（168MHz 下约 25 秒回绕），适合测量短代码段
+ *
+ * 代码段计时：
+ *   static TIME_STAT_DEFINE(flush_stat, "lcd flush");
+ *   {
+ *       TIME_SCOPE(flush_stat);     // 到所在代码块结束（包括 return/break）为止的耗时计入 flush_stat
+ *       ...
+ *   }
+ * 统计项第一次使用时登记，诊断盘 stats.txt 中列出。
  */
 
 #ifndef __HIGH_RES_TIMER_H
@@ -12,10 +24,55 @@
 extern "C" {
 #endif
 
+/* 耗时统计项 */
+typedef struct time_stat {
+    const char *name;
+    uint32_t count;             /* 次数 */
+    uint32_t min_cycles;        /* 最短（周期） */
+    uint32_t max_cycles;        /* 最长（周期） */
+    uint64_t total_cycles;      /* 累计（周期） */
+    struct time_stat *next;
+    uint8_t registered;
+} time_stat_t;
+
+#define TIME_STAT_DEFINE(var, stat_name)    time_stat_t var = { .name = (stat_name) }
+
+/* 计时作用域：记录开始周期数，离开代码块时由 cleanup 计入统计项 */
+typedef struct {
+    time_stat_t *stat;
+    uint32_t start;
+} time_scope_t;
+
+#define TIME_SCOPE_CAT_(a, b)   a##b
+#define TIME_SCOPE_CAT(a, b)    TIME_SCOPE_CAT_(a, b)
+#define TIME_SCOPE(stat) \
+    time_scope_t TIME_SCOPE_CAT(time_scope_, __LINE__) __attribute__((cleanup(TimeScope_End))) = \
+        { &(stat), HighResTimer_GetCycles() }
+
 /* 函数声明 */
 void HighResTimer_Init(void);
+void HighResTimer_IRQHandler(void);
 uint32_t HighResTimer_GetMs(void);
 uint32_t HighResTimer_GetUs(void);
+uint64_t HighResTimer_GetUs64(void);
+uint32_t HighResTimer_CyclesToNs(uint32_t cycles);
+
+void TimeStat_Add(time_stat_t *stat, uint32_t cycles);
+uint8_t TimeStat_Get(uint32_t index, time_stat_t *out);
+void TimeStat_ResetAll(void);
+
+/**
+ * @brief 获取 DWT 周期计数
+ */
+static inline uint32_t HighResTimer_GetCycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+static inline void TimeScope_End(time_scope_t *scope)
+{
+    TimeStat_Add(scope->stat, HighResTimer_GetCycles() - scope->start);
+}
 
 #ifdef __cplusplus
 }
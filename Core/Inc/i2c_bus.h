@@ -0,0 +1,89 @@
+/**
+ * @file i2c_bus.h
+ * @brief I2C1 总线驱动（硬件 I2C，400kHz Fast-mode）
+ *
+ * 总线上的器件（AT24CXX 等）都通过本模块访问，不再各自软件模拟时序：
+ *   - 一次寄存器读写为一个事务，持有总线互斥量期间完成。等待总线的任务按优先级排队，
+ *     互斥量带优先级继承，低优先级任务占用总线时不会让高优先级任务无限等待。
+ *   - 多字节（>= I2C_BUS_DMA_MIN）读写用 DMA，单字节用中断；调用的任务阻塞到完成中断，不占 CPU。
+ *   - 超时或总线卡死（从机拉低 SDA）时补发时钟并重新初始化外设。
+ *   - 调度器启动前按 HAL 轮询方式传输，初始化阶段也可以使用。
+ * 缓冲区需 DMA 可访问，不能放在 CCM。不能在中断中调用。
+ *
+ * 诊断盘 stats.txt 列出事务数、错误/超时/复位次数，以及最长排队时间和传输时间。
+ */
+
+#ifndef __I2C_BUS_H
+#define __I2C_BUS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 不小于此长度的读写使用 DMA */
+#ifndef I2C_BUS_DMA_MIN
+#define I2C_BUS_DMA_MIN         2U
+#endif
+
+/* 等待总线空闲的最长时间（毫秒），应大于最长事务（AT24C256 整页写约 2ms） */
+#ifndef I2C_BUS_LOCK_MS
+#define I2C_BUS_LOCK_MS         100U
+#endif
+
+/* 寄存器地址长度 */
+#define I2C_BUS_REG_8BIT        1U
+#define I2C_BUS_REG_16BIT       2U
+
+typedef struct {
+    uint32_t transfers;         /* 完成的事务数 */
+    uint32_t dma_transfers;     /* 其中使用 DMA 的 */
+    uint32_t bytes;             /* 读写的数据字节数（不含器件地址和寄存器地址） */
+    uint32_t errors;            /* NACK、仲裁丢失等错误次数 */
+    uint32_t timeouts;          /* 事务超时次数 */
+    uint32_t lock_timeouts;     /* 等待总线超时次数 */
+    uint32_t resets;            /* 重新初始化外设次数 */
+    uint32_t lock_wait_max_us;  /* 最长排队时间 */
+    uint32_t xfer_max_us;       /* 最长传输时间 */
+} i2c_bus_stats_t;
+
+/**
+ * @brief 创建总线互斥量（MX_I2C1_Init 之后、使用总线之前调用一次）
+ */
+void i2c_bus_init(void);
+
+/**
+ * @brief 读器件寄存器（随机读：写寄存器地址后重复起始读出）
+ * @param dev_addr 8 位器件地址（写地址，最低位为 0）
+ * @param reg 寄存器地址
+ * @param reg_size I2C_BUS_REG_8BIT / I2C_BUS_REG_16BIT
+ * @param buf 接收缓冲区
+ * @param len 长度
+ * @param timeout_ms 传输超时（毫秒）
+ * @retval 0 成功；-1 失败（NACK、超时或总线忙）
+ */
+int i2c_bus_mem_read(uint16_t dev_addr, uint16_t reg, uint16_t reg_size,
+                     uint8_t *buf, uint16_t len, uint32_t timeout_ms);
+
+/**
+ * @brief 写器件寄存器
+ * @retval 0 成功；-1 失败
+ */
+int i2c_bus_mem_write(uint16_t dev_addr, uint16_t reg, uint16_t reg_size,
+                      const uint8_t *buf, uint16_t len, uint32_t timeout_ms);
+
+/**
+ * @brief 等待器件应答（如 EEPROM 内部写周期结束），两次探测之间释放总线
+ * @param timeout_ms 最长等待时间（毫秒）
+ * @retval 0 器件已应答；-1 超时
+ */
+int i2c_bus_wait_ready(uint16_t dev_addr, uint32_t timeout_ms);
+
+void i2c_bus_get_stats(i2c_bus_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __I2C_BUS_H */
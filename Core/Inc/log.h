@@ -20,26 +20,154 @@ typedef enum {
     LOG_LEVEL_NONE          // 不输出任何日志
 } LogLevel;
 
+/* 日志模块，每个模块有独立的运行时级别 */
+typedef enum {
+    LOG_MOD_APP = 0,        // 未指定模块的代码
+    LOG_MOD_DISPLAY,        // LCD 与 LVGL 显示接口
+    LOG_MOD_SD,             // SD 卡、FatFs 与记录器
+    LOG_MOD_USB,            // USB 设备
+    LOG_MOD_TOUCH,          // 触摸屏
+    LOG_MOD_SCENE,          // 场景管理
+    LOG_MOD_CPU,            // CPU 占用统计
+    LOG_MOD_I2C,            // I2C 总线
+    LOG_MOD_COUNT
+} LogModule;
+
+/*
+ * 源文件所属的模块：在包含 log.h 之前定义，例如
+ *   #define LOG_MODULE LOG_MOD_SD
+ *   #include "log.h"
+ */
+#ifndef LOG_MODULE
+#define LOG_MODULE          LOG_MOD_APP
+#endif
+
+/*
+ * 编译时最低级别（数值同 LogLevel：0 调试，1 信息，2 警告，3 错误，4 关闭）。
+ * 低于它的 LOG_xxx 调用在预处理时去掉，格式串和参数都不进入固件；运行时级别只能在此之上调整。
+ */
+#ifndef LOG_LEVEL_MIN
+#define LOG_LEVEL_MIN       0
+#endif
+
+/* 单条日志的最大长度（含前缀和换行），超出部分截断 */
+#ifndef LOG_LINE_MAX
+#define LOG_LINE_MAX    256
+#endif
+
+/* 保留在 RAM 中的最近日志字节数（诊断盘 log.txt / log.bin），0 表示不保留 */
+#ifndef LOG_HISTORY_SIZE
+#define LOG_HISTORY_SIZE    4096
+#endif
+
+/*
+ * 每行日志的时间戳是上电以来的微秒数（TIM2，HighResTimer_GetUs64），不读 RTC。
+ * RTC 墙上时间只在第一条日志前和之后每隔 LOG_ANCHOR_INTERVAL_S 秒作为一行锚点输出：
+ *   [    12.345678][T] rtc 08:30:15.250
+ * 主机用最近的锚点把单调时间换算成墙上时间。
+ */
+#ifndef LOG_ANCHOR_INTERVAL_S
+#define LOG_ANCHOR_INTERVAL_S   60U
+#endif
+
+/*
+ * 令牌化日志：1 时调用处不做格式化，只写入二进制记录，主机用 tools/log_decode.py 和固件 ELF 还原文本。
+ * 级别、文件、行号和格式串在编译时放入 .log_dict 段（链接脚本），记录中的 ID 是条目在段内的偏移。
+ * 记录格式（小端）：
+ *   uint8  LOG_TOKEN_SYNC
+ *   uint8  记录总长度（含这两个字节）
+ *   uint16 ID
+ *   uint32 时间戳（微秒，低 32 位，主机按回绕补齐）
+ *   参数：整数 4 字节，long long 8 字节，浮点数按 double 8 字节，字符串为 1 字节长度 + 内容（不含结尾 0）
+ * ID 为 LOG_TOKEN_ANCHOR_ID 的记录是时间锚点，参数为 uint32 时间戳高 32 位和 RTC 时间字符串。
+ * 参数类型由 _Generic 在编译时得到，记录装不下时其余参数被截断。函数名不进入字典。
+ */
+#ifndef LOG_TOKENIZED
+#define LOG_TOKENIZED       0
+#endif
+
+#define LOG_TOKEN_SYNC      0xA5U
+#define LOG_TOKEN_ANCHOR_ID 0xFFFFU
+
+/* 单条令牌化记录的最大长度（字节，不超过 255） */
+#ifndef LOG_TOKEN_MAX
+#define LOG_TOKEN_MAX       128
+#endif
+
+/* 令牌化日志最多支持的参数个数 */
+#define LOG_TOKEN_MAX_ARGS  8
+
+/* 参数类型码（每个参数 4 位，第一个参数在最低位） */
+#define LOG_ARG_INT         1U
+#define LOG_ARG_INT64       2U
+#define LOG_ARG_DOUBLE      3U
+#define LOG_ARG_STRING      4U
+
+/**
+ * @brief 日志输出钩子
+ * @param line 完整的一行日志（以 "\r\n" 结尾）
+ * @param len 长度
+ * @return 1 已由钩子输出；0 未处理，继续从串口输出
+ */
+typedef uint8_t (*log_sink_t)(const char* line, size_t len);
+
 /* 日志级别字符串 */
 extern const char LOG_LEVEL_STR[];
 
-/* 当前日志级别 */
-extern LogLevel current_log_level;
+/* 各模块的运行时级别（LogLevel 值，每个模块 1 字节），日志宏直接读取 */
+extern volatile uint8_t log_module_level[LOG_MOD_COUNT];
 
 /**
- * @brief 设置日志级别
+ * @brief 设置所有模块的日志级别
  * @param level 日志级别
  */
 void log_set_level(LogLevel level);
 
 /**
- * @brief 获取当前日志级别
+ * @brief 获取日志级别（LOG_MOD_APP 模块）
  * @return 当前日志级别
  */
 LogLevel log_get_level(void);
 
 /**
- * @brief 获取当前系统时间戳（毫秒）
+ * @brief 设置单个模块的日志级别
+ * @param module 模块
+ * @param level 日志级别
+ */
+void log_set_module_level(LogModule module, LogLevel level);
+
+/**
+ * @brief 获取单个模块的日志级别
+ * @param module 模块
+ * @return 日志级别
+ */
+LogLevel log_get_module_level(LogModule module);
+
+/**
+ * @brief 处理一行日志命令（串口命令行调用）
+ *   log                    列出各模块级别
+ *   log <模块|all> <级别>   设置级别，模块为 app/display/sd/usb/touch/scene/cpu/i2c，级别为 debug/info/warning/error/none（可只写首字母）
+ * @param line 一行命令（不含换行）
+ * @return 1 是日志命令（已处理或已输出错误提示）；0 不是日志命令
+ */
+int log_command(const char* line);
+
+/**
+ * @brief 设置日志输出钩子（如 USB 虚拟串口），NULL 表示只用串口
+ * @param sink 输出钩子
+ */
+void log_set_sink(log_sink_t sink);
+
+/**
+ * @brief 复制最近的日志（从最早的完整一行开始）
+ * @param dst 目标缓冲区
+ * @param size 缓冲区大小
+ * @return 复制的字节数
+ */
+size_t log_history_copy(char* dst, size_t size);
+
+/**
+ * @brief 获取 RTC 墙上时间（HH:MM:SS.mmm，日志行本身只带微秒时间戳）
  * @param time_str 存储时间字符串的缓冲区
  * @param buf_size 缓冲区大小
  */
@@ -56,13 +184,78 @@ void log_get_timestamp(char* time_str, size_t buf_size);
  */
 void log_output(LogLevel level, const char* file, int line, const char* func, const char* format, ...);
 
-/* 日志宏定义 */
-#define LOG_DEBUG(format, ...)     do {         if (LOG_LEVEL_DEBUG >= log_get_level()) {             log_output(LOG_LEVEL_DEBUG, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__);         }     } while(0)
+#if LOG_TOKENIZED
+/**
+ * @brief 写入一条令牌化日志
+ * @param entry .log_dict 中的字典条目
+ * @param sig 参数类型（LOG_ARG_xxx，每个参数 4 位）
+ * @param ... 参数
+ */
+void log_token(const char* entry, uint32_t sig, ...);
+
+#define LOG_STR_(x)         #x
+#define LOG_STR(x)          LOG_STR_(x)
+#define LOG_CAT_(a, b)      a##b
+#define LOG_CAT(a, b)       LOG_CAT_(a, b)
+
+/* 字典条目："级别\x1f文件\x1f行号\x1f格式串" */
+#define LOG_DICT_ENTRY(lc, format) \
+    ({ static const char log_entry_[] __attribute__((section(".log_dict"), used)) = \
+           lc "\x1f" __FILE__ "\x1f" LOG_STR(__LINE__) "\x1f" format; \
+       log_entry_; })
+
+#define LOG_ARG_TYPE(x) _Generic((x), \
+    char*: LOG_ARG_STRING, const char*: LOG_ARG_STRING, \
+    unsigned char*: LOG_ARG_STRING, const unsigned char*: LOG_ARG_STRING, \
+    float: LOG_ARG_DOUBLE, double: LOG_ARG_DOUBLE, \
+    long long: LOG_ARG_INT64, unsigned long long: LOG_ARG_INT64, \
+    default: LOG_ARG_INT)
+
+#define LOG_SIG_0()                         0U
+#define LOG_SIG_1(a)                        (LOG_ARG_TYPE(a))
+#define LOG_SIG_2(a, b)                     (LOG_SIG_1(a) | (LOG_ARG_TYPE(b) << 4))
+#define LOG_SIG_3(a, b, c)                  (LOG_SIG_2(a, b) | (LOG_ARG_TYPE(c) << 8))
+#define LOG_SIG_4(a, b, c, d)               (LOG_SIG_3(a, b, c) | (LOG_ARG_TYPE(d) << 12))
+#define LOG_SIG_5(a, b, c, d, e)            (LOG_SIG_4(a, b, c, d) | (LOG_ARG_TYPE(e) << 16))
+#define LOG_SIG_6(a, b, c, d, e, f)         (LOG_SIG_5(a, b, c, d, e) | (LOG_ARG_TYPE(f) << 20))
+#define LOG_SIG_7(a, b, c, d, e, f, g)      (LOG_SIG_6(a, b, c, d, e, f) | (LOG_ARG_TYPE(g) << 24))
+#define LOG_SIG_8(a, b, c, d, e, f, g, h)   (LOG_SIG_7(a, b, c, d, e, f, g) | (LOG_ARG_TYPE(h) << 28))
+#define LOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, n, ...) n
+#define LOG_NARGS(...)      LOG_NARGS_(0, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_ARG_SIG(...)    LOG_CAT(LOG_SIG_, LOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+
+#define LOG_EMIT(level, lc, format, ...) \
+    log_token(LOG_DICT_ENTRY(lc, format), LOG_ARG_SIG(__VA_ARGS__), ##__VA_ARGS__)
+#else
+#define LOG_EMIT(level, lc, format, ...) \
+    log_output(level, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__)
+#endif
+
+/* 日志宏定义：低于 LOG_LEVEL_MIN 的级别编译为空，其余按所属模块的运行时级别过滤 */
+#define LOG_ON(level)       ((uint8_t)(level) >= log_module_level[LOG_MODULE])
+
+#if LOG_LEVEL_MIN <= 0
+#define LOG_DEBUG(format, ...)      do { if (LOG_ON(LOG_LEVEL_DEBUG)) { LOG_EMIT(LOG_LEVEL_DEBUG, "D", format, ##__VA_ARGS__); } } while (0)
+#else
+#define LOG_DEBUG(format, ...)      do { } while (0)
+#endif
 
-#define LOG_INFO(format, ...)     do {         if (LOG_LEVEL_INFO >= log_get_level()) {             log_output(LOG_LEVEL_INFO, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__);         }     } while(0)
+#if LOG_LEVEL_MIN <= 1
+#define LOG_INFO(format, ...)       do { if (LOG_ON(LOG_LEVEL_INFO)) { LOG_EMIT(LOG_LEVEL_INFO, "I", format, ##__VA_ARGS__); } } while (0)
+#else
+#define LOG_INFO(format, ...)       do { } while (0)
+#endif
 
-#define LOG_WARNING(format, ...)     do {         if (LOG_LEVEL_WARNING >= log_get_level()) {             log_output(LOG_LEVEL_WARNING, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__);         }     } while(0)
+#if LOG_LEVEL_MIN <= 2
+#define LOG_WARNING(format, ...)    do { if (LOG_ON(LOG_LEVEL_WARNING)) { LOG_EMIT(LOG_LEVEL_WARNING, "W", format, ##__VA_ARGS__); } } while (0)
+#else
+#define LOG_WARNING(format, ...)    do { } while (0)
+#endif
 
-#define LOG_ERROR(format, ...)     do {         if (LOG_LEVEL_ERROR >= log_get_level()) {             log_output(LOG_LEVEL_ERROR, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__);         }     } while(0)
+#if LOG_LEVEL_MIN <= 3
+#define LOG_ERROR(format, ...)      do { if (LOG_ON(LOG_LEVEL_ERROR)) { LOG_EMIT(LOG_LEVEL_ERROR, "E", format, ##__VA_ARGS__); } } while (0)
+#else
+#define LOG_ERROR(format, ...)      do { } while (0)
+#endif
 
 #endif /* __LOG_H */
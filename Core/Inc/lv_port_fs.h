@@ -0,0 +1,33 @@
+/**
+ * @file lv_port_fs.h
+ *
+ */
+
+#ifndef LV_PORT_FS_H
+#define LV_PORT_FS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lvgl.h"
+
+/*********************
+ *      DEFINES
+ *********************/
+/* SD卡在LVGL中的盘符，例如 "S:/images/icon.bin" */
+#define LV_PORT_FS_LETTER   'S'
+
+/**********************
+ * GLOBAL PROTOTYPES
+ **********************/
+void lv_port_fs_init(void);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
+
+#endif /*LV_PORT_FS_H*/
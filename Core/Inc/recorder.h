@@ -0,0 +1,151 @@
+/**
+ * @file recorder.h
+ * @brief 高速传感器/遥测记录器头文件
+ *
+ * 任意任务或中断调用 recorder_put() 写入定长记录（无锁多生产者环形队列），
+ * 记录任务把记录打包成 RECORDER_BLOCK_SIZE 大小的块，经 sd_stream 整块写入SD卡。
+ *
+ * 磁盘格式（小端）：
+ *   文件由若干个 RECORDER_BLOCK_SIZE 字节的块组成，每块以 recorder_block_header_t 开头，
+ *   sync 字段为 RECORDER_SYNC_WORD，之后紧跟 record_count 条 recorder_record_t，块内剩余部分补零。
+ *   主机端解码工具见 tools/recorder_decode.py。
+ *
+ * 上电后不自动记录：串口命令 "rec start" 以 RECORDER_FILE_PREFIX 新建下一个序号的文件开始记录，
+ * "rec stop" 停止，"rec" 打印统计。已有的记录文件不会被覆盖。
+ *
+ * 卷交给 USB 主机期间（见 sd_owner），当前文件被关闭，写满的块暂存在外部 SRAM 中，
+ * 卷重新挂载后以下一个文件序号继续，先按顺序写出暂存的块。暂存满后的块被丢弃并计数。
+ */
+
+#ifndef __RECORDER_H
+#define __RECORDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 记录负载字节数（记录总长 = 8 + RECORDER_PAYLOAD_SIZE） */
+#ifndef RECORDER_PAYLOAD_SIZE
+#define RECORDER_PAYLOAD_SIZE   24U
+#endif
+
+/* 环形队列槽位数（必须是2的幂），需覆盖一次块写入期间的最大记录数；每槽 36 字节，占内部 SRAM */
+#ifndef RECORDER_RING_SLOTS
+#define RECORDER_RING_SLOTS     128U
+#endif
+
+/* 单次写入SD卡的块大小（字节，扇区整数倍），缓冲区从外部 SRAM 分配 */
+#ifndef RECORDER_BLOCK_SIZE
+#define RECORDER_BLOCK_SIZE     (32U * 1024U)
+#endif
+
+/* 单个文件大小，写满后轮转（必须是块大小的整数倍） */
+#ifndef RECORDER_FILE_SIZE
+#define RECORDER_FILE_SIZE      (64U * 1024U * 1024U)
+#endif
+
+/* 块未写满时的最长落盘间隔（毫秒） */
+#ifndef RECORDER_FLUSH_MS
+#define RECORDER_FLUSH_MS       1000U
+#endif
+
+/* 卷不可用时最多暂存在外部 SRAM 中的块数 */
+#ifndef RECORDER_HOLD_BLOCKS
+#define RECORDER_HOLD_BLOCKS    8U
+#endif
+
+/* "rec start" 使用的文件名前缀（文件为 <卷>/rec_NNNN.bin） */
+#ifndef RECORDER_FILE_PREFIX
+#define RECORDER_FILE_PREFIX    "rec"
+#endif
+
+/* 块头同步字与格式版本 */
+#define RECORDER_SYNC_WORD      0x31434552U     /* "REC1" */
+#define RECORDER_FORMAT_VERSION 1U
+
+/* 定长记录 */
+typedef struct {
+    uint32_t timestamp_us;                  /* 微秒时间戳（TIM2） */
+    uint16_t type;                          /* 记录类型/通道号，由调用者定义 */
+    uint16_t length;                        /* payload 中有效字节数 */
+    uint8_t payload[RECORDER_PAYLOAD_SIZE]; /* 负载 */
+} recorder_record_t;
+
+/* 块头（32字节） */
+typedef struct {
+    uint32_t sync;              /* RECORDER_SYNC_WORD */
+    uint16_t version;           /* RECORDER_FORMAT_VERSION */
+    uint16_t header_size;       /* sizeof(recorder_block_header_t) */
+    uint16_t record_size;       /* sizeof(recorder_record_t) */
+    uint16_t record_count;      /* 本块有效记录数 */
+    uint32_t block_size;        /* RECORDER_BLOCK_SIZE */
+    uint32_t block_seq;         /* 全局块序号，从0开始递增 */
+    uint32_t file_index;        /* 所在文件序号 */
+    uint32_t dropped;           /* 截止本块累计丢弃的记录数 */
+    uint32_t reserved;
+} recorder_block_header_t;
+
+/* 运行统计 */
+typedef struct {
+    uint32_t records_written;   /* 已写入的记录数 */
+    uint32_t records_dropped;   /* 因队列满被丢弃的记录数 */
+    uint32_t blocks_written;    /* 已写入的块数 */
+    uint32_t write_errors;      /* 写入失败次数 */
+    uint32_t ring_high_water;   /* 队列最高占用槽位数 */
+    uint32_t max_write_us;      /* 单块写入最长耗时 */
+    uint32_t blocks_held;       /* 卷不可用期间暂存到 RAM 的块数 */
+} recorder_stats_t;
+
+/**
+ * @brief 初始化记录器（分配块缓冲区、创建记录任务），调度器启动前后均可调用
+ * @note 块缓冲区在外部 SRAM，须在 MX_FSMC_Init 之后调用
+ */
+void recorder_init(void);
+
+/**
+ * @brief 开始记录到SD卡，文件名为 prefix_NNNN.bin
+ * @param dir 卷路径（如 SDPath），卷必须已挂载
+ * @param prefix 文件名前缀
+ * @retval true 成功
+ */
+bool recorder_start(const char *dir, const char *prefix);
+
+/**
+ * @brief 停止记录，写出剩余记录并关闭文件（阻塞直到完成）
+ */
+void recorder_stop(void);
+
+/**
+ * @brief 是否正在记录（卷交给 USB 主机暂存期间也算在记录）
+ */
+bool recorder_is_recording(void);
+
+/**
+ * @brief 写入一条记录（任务/中断均可调用，不阻塞）
+ * @param type 记录类型
+ * @param data 负载
+ * @param len 负载长度，超出 RECORDER_PAYLOAD_SIZE 的部分被截断
+ * @retval true 已入队；false 未在记录或队列满（计入丢弃数）
+ */
+bool recorder_put(uint16_t type, const void *data, uint16_t len);
+
+/**
+ * @brief 获取运行统计
+ * @param stats 输出
+ */
+void recorder_get_stats(recorder_stats_t *stats);
+
+/**
+ * @brief 串口命令 "rec ..."
+ * @return 1 已处理；0 不是本模块的命令
+ */
+int recorder_command(const char *line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RECORDER_H */
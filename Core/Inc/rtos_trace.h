@@ -0,0 +1,260 @@
+/**
+ * @file rtos_trace.h
+ * @brief FreeRTOS 调度与中断事件跟踪
+ *
+ * FreeRTOSConfig.h 把内核跟踪宏（任务切入/切出、就绪、延时、队列/信号量/互斥量收发与阻塞）接到这里，
+ * 中断处理函数用 RTOS_TRACE_ISR_ENTER()/RTOS_TRACE_ISR_EXIT() 标出，应用代码可以加用户标记。
+ * 每个事件 8 字节（TIM2 微秒计数低 32 位 + 类型 + 参数），写入 RAM 环形缓冲区：
+ *   - RTOS_TRACE_MODE_RING：一直记录，满了覆盖最早的事件（默认，出问题后导出最近一段）；
+ *   - RTOS_TRACE_MODE_ONESHOT：记满后自动停止（从 start 开始抓一段）。
+ * 导出（文件格式见 rtos_trace_file_header_t）：
+ *   - USB：诊断盘 trace.bin（主机装入介质时的快照）；
+ *   - 串口：命令 "trace dump" 以十六进制行输出；
+ *   - SD：命令 "trace save" 写入卷根目录 trace.bin。
+ * 主机用 tools/trace_export.py 转换为 Chrome/Perfetto 时间线（JSON）。
+ *
+ * 本头文件由 FreeRTOSConfig.h 包含，不能包含 FreeRTOS 头文件。
+ */
+
+#ifndef __RTOS_TRACE_H
+#define __RTOS_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 为 0 时不编译跟踪，内核跟踪宏保持为空。默认关闭：打开后占用约 10KB 内部 SRAM，
+ * 每次任务切换和中断多一次事件写入；需要时构建参数加 -D RTOS_TRACE_ENABLE=1 */
+#ifndef RTOS_TRACE_ENABLE
+#define RTOS_TRACE_ENABLE       0
+#endif
+
+/* 环形缓冲区事件数（必须是2的幂），每个事件 8 字节 */
+#ifndef RTOS_TRACE_EVENTS
+#define RTOS_TRACE_EVENTS       1024U
+#endif
+
+/* 记录名称的任务数（创建时登记，超出的任务只有编号） */
+#ifndef RTOS_TRACE_MAX_TASKS
+#define RTOS_TRACE_MAX_TASKS    24U
+#endif
+
+/* 用户标记名称表大小 */
+#ifndef RTOS_TRACE_MAX_MARKERS
+#define RTOS_TRACE_MAX_MARKERS  16U
+#endif
+
+#define RTOS_TRACE_NAME_LEN     16U
+
+/* 事件类型 */
+typedef enum {
+    RTOS_TRACE_TASK_IN = 1,         /* arg16 = 任务编号 */
+    RTOS_TRACE_TASK_OUT,            /* arg16 = 任务编号 */
+    RTOS_TRACE_TASK_READY,          /* arg16 = 任务编号 */
+    RTOS_TRACE_TASK_DELAY,          /* arg16 = 任务编号 */
+    RTOS_TRACE_ISR_ENTER,           /* arg8 = 异常号（16 + IRQn） */
+    RTOS_TRACE_ISR_EXIT,            /* arg8 = 异常号 */
+    RTOS_TRACE_QUEUE_SEND,          /* arg8 = 队列类型，arg16 = 队列标识 */
+    RTOS_TRACE_QUEUE_RECV,
+    RTOS_TRACE_QUEUE_SEND_ISR,
+    RTOS_TRACE_QUEUE_RECV_ISR,
+    RTOS_TRACE_QUEUE_BLOCK_SEND,    /* 队列满，任务阻塞 */
+    RTOS_TRACE_QUEUE_BLOCK_RECV,    /* 队列空（信号量不可用），任务阻塞 */
+    RTOS_TRACE_USER_BEGIN,          /* arg8 = 标记号，arg16 = 用户值 */
+    RTOS_TRACE_USER_END,
+    RTOS_TRACE_USER_MARK
+} rtos_trace_type_t;
+
+/* 已分配的用户标记号（RTOS_TRACE_BEGIN/END/MARK 的 id），名称在 rtos_trace_init() 中登记 */
+enum {
+    RTOS_TRACE_ID_LV_TIMER = 1,     /* lv_demo_task 中的 lv_timer_handler() */
+    RTOS_TRACE_ID_LCD_FLUSH         /* LVGL 刷新区域：disp_flush 开始到 DMA 完成 */
+};
+
+typedef enum {
+    RTOS_TRACE_MODE_RING = 0,
+    RTOS_TRACE_MODE_ONESHOT
+} rtos_trace_mode_t;
+
+/* 事件 */
+typedef struct {
+    uint32_t timestamp_us;          /* TIM2 计数（微秒，低 32 位） */
+    uint8_t type;                   /* rtos_trace_type_t */
+    uint8_t arg8;
+    uint16_t arg16;
+} rtos_trace_event_t;
+
+/*
+ * 导出文件：头 + 任务表 + 标记表 + 事件（按时间顺序），均为小端。
+ * 队列标识为 (地址 - 0x20000000) / 4 的低 16 位。
+ */
+#define RTOS_TRACE_MAGIC        0x43525452U     /* "RTRC" */
+#define RTOS_TRACE_VERSION      1U
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t timer_hz;              /* 时间戳频率 */
+    uint32_t event_count;
+    uint32_t dropped;               /* 被覆盖或因停止/导出未记录的事件数 */
+    uint16_t task_count;
+    uint16_t task_entry_size;
+    uint16_t marker_count;
+    uint16_t marker_entry_size;
+} rtos_trace_file_header_t;
+
+typedef struct {
+    uint16_t number;                /* 任务编号（uxTCBNumber） */
+    uint8_t priority;               /* 创建时的优先级 */
+    uint8_t reserved;
+    char name[RTOS_TRACE_NAME_LEN];
+} rtos_trace_task_entry_t;
+
+typedef struct {
+    uint8_t id;
+    char name[RTOS_TRACE_NAME_LEN - 1U];
+} rtos_trace_marker_entry_t;
+
+/* 导出文件的最大长度 */
+#define RTOS_TRACE_MAX_SIZE \
+    (sizeof(rtos_trace_file_header_t) + \
+     RTOS_TRACE_MAX_TASKS * sizeof(rtos_trace_task_entry_t) + \
+     RTOS_TRACE_MAX_MARKERS * sizeof(rtos_trace_marker_entry_t) + \
+     RTOS_TRACE_EVENTS * sizeof(rtos_trace_event_t))
+
+#if RTOS_TRACE_ENABLE
+
+/**
+ * @brief 初始化（调度器启动前调用一次），按 mode 开始记录
+ */
+void rtos_trace_init(rtos_trace_mode_t mode);
+
+/**
+ * @brief 清空缓冲区并开始记录
+ */
+void rtos_trace_start(rtos_trace_mode_t mode);
+
+/**
+ * @brief 停止记录（缓冲区内容保留）
+ */
+void rtos_trace_stop(void);
+
+/**
+ * @brief 是否正在记录
+ */
+bool rtos_trace_running(void);
+
+/**
+ * @brief 写入一个事件（任务与中断均可调用）
+ */
+void rtos_trace_event(uint8_t type, uint8_t arg8, uint16_t arg16);
+
+/**
+ * @brief 给用户标记号命名（导出到文件，主机显示用）
+ * @param id 标记号
+ * @param name 名称（复制保存，最长 14 字符）
+ */
+void rtos_trace_marker_name(uint8_t id, const char *name);
+
+/**
+ * @brief 冻结当前缓冲区内容以便导出，期间暂停记录
+ * @return 导出文件的长度（字节）
+ */
+uint32_t rtos_trace_freeze(void);
+
+/**
+ * @brief 读取冻结的导出文件
+ * @param offset 偏移
+ * @param buf 目标缓冲区
+ * @param len 长度，offset + len 不超过 rtos_trace_freeze() 的返回值
+ */
+void rtos_trace_read(uint32_t offset, uint8_t *buf, uint32_t len);
+
+/**
+ * @brief 结束导出，恢复冻结前的记录状态
+ */
+void rtos_trace_thaw(void);
+
+/**
+ * @brief 处理一行跟踪命令（串口命令行调用）
+ *   trace start [oneshot] | stop | dump | save
+ * @param line 一行命令（不含换行）
+ * @return 1 是跟踪命令；0 不是
+ */
+int rtos_trace_command(const char *line);
+
+/* 内核跟踪宏调用的函数 */
+void rtos_trace_task_create(uint16_t number, uint8_t priority, const char *name);
+
+static inline void rtos_trace_queue(uint8_t type, const void *queue, uint8_t queue_type)
+{
+    rtos_trace_event(type, queue_type, (uint16_t)(((uint32_t)queue - 0x20000000U) >> 2));
+}
+
+static inline void rtos_trace_isr_enter(void)
+{
+    uint32_t ipsr;
+
+    __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+    rtos_trace_event(RTOS_TRACE_ISR_ENTER, (uint8_t)ipsr, 0);
+}
+
+static inline void rtos_trace_isr_exit(void)
+{
+    uint32_t ipsr;
+
+    __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+    rtos_trace_event(RTOS_TRACE_ISR_EXIT, (uint8_t)ipsr, 0);
+}
+
+#define RTOS_TRACE_ISR_ENTER()          rtos_trace_isr_enter()
+#define RTOS_TRACE_ISR_EXIT()           rtos_trace_isr_exit()
+#define RTOS_TRACE_BEGIN(id, value)     rtos_trace_event(RTOS_TRACE_USER_BEGIN, (id), (value))
+#define RTOS_TRACE_END(id, value)       rtos_trace_event(RTOS_TRACE_USER_END, (id), (value))
+#define RTOS_TRACE_MARK(id, value)      rtos_trace_event(RTOS_TRACE_USER_MARK, (id), (value))
+
+/* 接到 FreeRTOS 内核跟踪宏（在 tasks.c/queue.c 中展开，可以访问 TCB 和队列结构） */
+#define traceTASK_CREATE(pxNewTCB) \
+    rtos_trace_task_create((uint16_t)(pxNewTCB)->uxTCBNumber, (uint8_t)(pxNewTCB)->uxPriority, (pxNewTCB)->pcTaskName)
+#define traceTASK_SWITCHED_IN() \
+    rtos_trace_event(RTOS_TRACE_TASK_IN, 0, (uint16_t)pxCurrentTCB->uxTCBNumber)
+#define traceTASK_SWITCHED_OUT() \
+    rtos_trace_event(RTOS_TRACE_TASK_OUT, 0, (uint16_t)pxCurrentTCB->uxTCBNumber)
+#define traceMOVED_TASK_TO_READY_STATE(pxTCB) \
+    rtos_trace_event(RTOS_TRACE_TASK_READY, 0, (uint16_t)(pxTCB)->uxTCBNumber)
+#define traceTASK_DELAY() \
+    rtos_trace_event(RTOS_TRACE_TASK_DELAY, 0, (uint16_t)pxCurrentTCB->uxTCBNumber)
+#define traceTASK_DELAY_UNTIL(xTimeToWake) \
+    rtos_trace_event(RTOS_TRACE_TASK_DELAY, 0, (uint16_t)pxCurrentTCB->uxTCBNumber)
+#define traceQUEUE_SEND(pxQueue) \
+    rtos_trace_queue(RTOS_TRACE_QUEUE_SEND, (pxQueue), (pxQueue)->ucQueueType)
+#define traceQUEUE_RECEIVE(pxQueue) \
+    rtos_trace_queue(RTOS_TRACE_QUEUE_RECV, (pxQueue), (pxQueue)->ucQueueType)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) \
+    rtos_trace_queue(RTOS_TRACE_QUEUE_SEND_ISR, (pxQueue), (pxQueue)->ucQueueType)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) \
+    rtos_trace_queue(RTOS_TRACE_QUEUE_RECV_ISR, (pxQueue), (pxQueue)->ucQueueType)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) \
+    rtos_trace_queue(RTOS_TRACE_QUEUE_BLOCK_SEND, (pxQueue), (pxQueue)->ucQueueType)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) \
+    rtos_trace_queue(RTOS_TRACE_QUEUE_BLOCK_RECV, (pxQueue), (pxQueue)->ucQueueType)
+
+#else
+
+#define RTOS_TRACE_ISR_ENTER()
+#define RTOS_TRACE_ISR_EXIT()
+#define RTOS_TRACE_BEGIN(id, value)
+#define RTOS_TRACE_END(id, value)
+#define RTOS_TRACE_MARK(id, value)
+
+#endif /* RTOS_TRACE_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __RTOS_TRACE_H */
@@ -135,6 +135,22 @@ const char* scene_manager_get_scene_name(scene_id_t scene_id);
  */
 bool scene_manager_is_transitioning(void);
 
+/**
+ * @brief       请求切换场景（任意任务可调用，由 LVGL 任务在 scene_manager_poll() 中执行）
+ * @param       scene_id: 目标场景ID
+ * @param       anim_type: 切换动画类型
+ * @param       anim_time: 动画时长(ms)，最大 65535
+ * @retval      true: 已登记, false: 参数无效
+ */
+bool scene_manager_request(scene_id_t scene_id, scene_anim_t anim_type, uint32_t anim_time);
+
+/**
+ * @brief       执行其他任务登记的场景切换请求（在 LVGL 任务中调用）
+ * @param       无
+ * @retval      无
+ */
+void scene_manager_poll(void);
+
 /******************************************************************************************************/
 /* 预定义场景加载函数 */
 
@@ -0,0 +1,112 @@
+/**
+ * @file sd_io_sched.h
+ * @brief SD卡卷I/O调度器头文件
+ *
+ * 调度任务独占卷的访问，多个客户端按优先级提交请求：
+ *   - 扇区读写（sd_io_read/sd_io_write）：按各优先级的分片上限执行，每片之间重新选择
+ *     最高优先级的请求，LBA 与缓冲区都相邻的同类请求合并成一次多块传输；
+ *   - 文件系统操作（sd_io_call）：在调度任务中执行回调，回调内可以调用 FatFs API。
+ * 界面资源加载使用 SD_IO_PRIO_UI，日志/记录器使用 SD_IO_PRIO_BACKGROUND，
+ * 后台写入繁忙时界面请求最多等待一个后台分片（SD_IO_MAX_CHUNK），
+ * 一般请求最多等待一个 SD_IO_NORMAL_CHUNK 分片。
+ */
+
+#ifndef __SD_IO_SCHED_H
+#define __SD_IO_SCHED_H
+
+#include "ff.h"
+#include "diskio.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 后台请求单次下发到SD卡的最大扇区数（决定高优先级请求的最长等待时间） */
+#ifndef SD_IO_MAX_CHUNK
+#define SD_IO_MAX_CHUNK     16U
+#endif
+
+/* 一般请求的分片上限，USB MSC 的一个媒体包（最大32KB）可一次多块传输完成 */
+#ifndef SD_IO_NORMAL_CHUNK
+#define SD_IO_NORMAL_CHUNK  64U
+#endif
+
+/* 界面请求的分片上限 */
+#ifndef SD_IO_UI_CHUNK
+#define SD_IO_UI_CHUNK      128U
+#endif
+
+/* 请求优先级，数值越小越优先 */
+typedef enum {
+    SD_IO_PRIO_UI = 0,          /* 界面资源加载 */
+    SD_IO_PRIO_NORMAL,          /* 一般文件访问、USB MSC */
+    SD_IO_PRIO_BACKGROUND,      /* 日志、记录器 */
+    SD_IO_PRIO_NUM
+} sd_io_prio_t;
+
+/* 文件系统操作回调，返回值原样返回给 sd_io_call() 的调用者 */
+typedef int (*sd_io_call_t)(void *arg);
+
+/* 运行统计 */
+typedef struct {
+    uint32_t requests[SD_IO_PRIO_NUM];      /* 完成的请求数 */
+    uint32_t max_wait_us[SD_IO_PRIO_NUM];   /* 提交到完成的最长时间 */
+    uint32_t chunks;                        /* 下发到卡的传输次数 */
+    uint32_t merged;                        /* 被合并进前一请求的请求数 */
+    uint32_t errors;                        /* 失败的传输次数 */
+} sd_io_stats_t;
+
+/**
+ * @brief 初始化调度器并创建调度任务（启动时挂载卷之后调用一次，挂载失败也调用）
+ * @param fs 卷；未挂载时扇区请求不取卷锁
+ */
+void sd_io_init(FATFS *fs);
+
+/**
+ * @brief 调度器是否已运行
+ */
+bool sd_io_running(void);
+
+/**
+ * @brief 读扇区（阻塞直到完成）
+ * @param prio 优先级
+ * @param buf 目标缓冲区（4字节对齐，可DMA）
+ * @param sector 起始扇区
+ * @param count 扇区数
+ * @retval DRESULT
+ */
+DRESULT sd_io_read(sd_io_prio_t prio, BYTE *buf, DWORD sector, UINT count);
+
+/**
+ * @brief 写扇区（阻塞直到完成）
+ * @param prio 优先级
+ * @param buf 源缓冲区（4字节对齐，可DMA）
+ * @param sector 起始扇区
+ * @param count 扇区数
+ * @retval DRESULT
+ */
+DRESULT sd_io_write(sd_io_prio_t prio, const BYTE *buf, DWORD sector, UINT count);
+
+/**
+ * @brief 在调度任务中执行文件系统操作（阻塞直到完成）
+ * @note  调度器未运行或在调度任务内调用时直接执行
+ * @param prio 优先级
+ * @param fn 回调
+ * @param arg 回调参数
+ * @retval 回调返回值
+ */
+int sd_io_call(sd_io_prio_t prio, sd_io_call_t fn, void *arg);
+
+/**
+ * @brief 获取运行统计
+ * @param stats 输出
+ */
+void sd_io_get_stats(sd_io_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SD_IO_SCHED_H */
@@ -0,0 +1,101 @@
+/**
+ * @file sd_owner.h
+ * @brief SD卡卷所有权仲裁（固件 FatFs 与 USB MSC 主机互斥访问）
+ *
+ * 同一时刻只有一方可以写卡：
+ *   - USB 主机完成配置（MSC 初始化）后，先通知各客户端释放卷（关闭文件、停止写入），
+ *     保存快速挂载记录并卸载 FatFs，之后 MSC 才向主机报告介质就绪；
+ *   - 主机弹出介质（START STOP UNIT）、总线复位/断开或长时间挂起后，MSC 先停止接受新的
+ *     读写，等待进行中的传输结束，再重新挂载卷（SD_FastMount_Restore 校验缓存的空闲簇数），
+ *     并通知客户端恢复。
+ * 切换在所有权任务中进行，USB 侧的通知函数可以在中断中调用。
+ */
+
+#ifndef __SD_OWNER_H
+#define __SD_OWNER_H
+
+#include "ff.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 最多登记的客户端数 */
+#ifndef SD_OWNER_MAX_CLIENTS
+#define SD_OWNER_MAX_CLIENTS    4U
+#endif
+
+/* USB 总线挂起超过该时间视为拔出（未使用 VBUS 检测时拔线只产生挂起） */
+#ifndef SD_OWNER_SUSPEND_MS
+#define SD_OWNER_SUSPEND_MS     3000U
+#endif
+
+/* 卷的当前所有者 */
+typedef enum {
+    SD_OWNER_FIRMWARE = 0,      /* 固件通过 FatFs 访问（或卡上没有文件系统） */
+    SD_OWNER_TO_USB,            /* 正在释放并卸载 */
+    SD_OWNER_USB,               /* USB 主机独占 */
+    SD_OWNER_TO_FIRMWARE        /* 正在等待 MSC 传输结束并重新挂载 */
+} sd_owner_t;
+
+/* 客户端回调，在所有权任务中依次调用 */
+typedef struct {
+    /* 卷即将交给 USB 主机：落盘并关闭打开的文件，返回后不能再访问卷 */
+    void (*release)(void);
+    /* 卷已交回固件，mounted 为 false 表示重新挂载失败 */
+    void (*remount)(bool mounted);
+} sd_owner_client_t;
+
+/**
+ * @brief 初始化并创建所有权任务（启动时挂载流程结束后调用一次）
+ * @param fs 文件系统对象
+ * @param path 卷路径
+ * @param mounted 卷当前是否已挂载
+ */
+void sd_owner_init(FATFS *fs, const char *path, bool mounted);
+
+/**
+ * @brief 登记客户端（init 前后均可调用）
+ * @param client 回调表，需长期有效
+ * @retval false 客户端已满
+ */
+bool sd_owner_register(const sd_owner_client_t *client);
+
+/**
+ * @brief USB 主机要求访问介质（MSC 配置完成，中断中可调用）
+ */
+void sd_owner_usb_attach(void);
+
+/**
+ * @brief USB 主机放弃介质（弹出、复位、断开，中断中可调用）
+ */
+void sd_owner_usb_detach(void);
+
+/**
+ * @brief USB 总线挂起/恢复（中断中可调用）
+ * @param suspended true 挂起
+ */
+void sd_owner_usb_suspend(bool suspended);
+
+/**
+ * @brief 当前所有者
+ */
+sd_owner_t sd_owner_get(void);
+
+/**
+ * @brief 介质是否可以提供给 USB 主机
+ */
+bool sd_owner_usb_active(void);
+
+/**
+ * @brief 固件侧卷是否已挂载
+ */
+bool sd_owner_mounted(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SD_OWNER_H */
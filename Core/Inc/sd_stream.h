@@ -0,0 +1,86 @@
+/**
+ * @file sd_stream.h
+ * @brief SD卡流式日志文件头文件（预分配连续簇 + 扇区直写 + 按大小轮转）
+ */
+
+#ifndef __SD_STREAM_H
+#define __SD_STREAM_H
+
+#include "ff.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 扇区大小，与 ffconf.h 中 _MAX_SS 一致 */
+#define SD_STREAM_SECTOR_SIZE   512U
+
+/* 文件名前缀最大长度（不含路径） */
+#define SD_STREAM_PREFIX_LEN    16U
+
+/* 流式文件对象 */
+typedef struct {
+    FIL fil;                        /* FatFs 文件对象（仅用于创建/预分配/关闭） */
+    char dir[8];                    /* 所在卷路径，如 "0:/" */
+    char prefix[SD_STREAM_PREFIX_LEN]; /* 文件名前缀，生成 prefix_0000.bin */
+    uint32_t index;                 /* 当前文件序号（跳过已存在的文件） */
+    uint32_t file_size;             /* 每个文件预分配的字节数（也是轮转阈值） */
+    uint32_t start_sector;          /* 当前文件首扇区 LBA */
+    uint32_t sector_count;          /* 当前文件占用的扇区数 */
+    uint32_t sector_pos;            /* 下一个待写扇区（相对首扇区） */
+    uint32_t bytes_written;         /* 当前文件已写入字节数 */
+    uint32_t rotations;             /* 已轮转的文件数 */
+    uint16_t tail_len;              /* 尾部缓冲区中未满一个扇区的字节数 */
+    uint8_t is_open;                /* 是否已打开 */
+    uint8_t tail[SD_STREAM_SECTOR_SIZE] __attribute__((aligned(4))); /* 尾部扇区缓冲（DMA 需4字节对齐） */
+} sd_stream_t;
+
+/**
+ * @brief 打开流式文件并预分配连续空间
+ * @param st 流对象
+ * @param dir 卷路径（如 SDPath）
+ * @param prefix 文件名前缀
+ * @param file_size 单个文件大小（字节），写满后自动轮转到下一个文件
+ * @note 从序号 0 起新建第一个不存在的 prefix_NNNN.bin，不覆盖已有文件
+ * @retval FR_OK 成功；FR_DENIED 找不到足够的连续空闲簇；FR_EXIST 序号已用完
+ */
+FRESULT sd_stream_open(sd_stream_t *st, const char *dir, const char *prefix, uint32_t file_size);
+
+/**
+ * @brief 追加写入数据
+ * @note 整扇区且4字节对齐的数据直接从调用者缓冲区写入SD卡，不经过 FatFs 窗口；
+ *       不足一个扇区的部分暂存在尾部缓冲区。写满 file_size 时自动轮转。
+ * @param st 流对象
+ * @param data 数据
+ * @param len 长度
+ * @retval FR_OK 成功
+ */
+FRESULT sd_stream_write(sd_stream_t *st, const void *data, uint32_t len);
+
+/**
+ * @brief 把尾部未满扇区写到卡上（不推进写指针），用于周期性落盘
+ * @param st 流对象
+ * @retval FR_OK 成功
+ */
+FRESULT sd_stream_sync(sd_stream_t *st);
+
+/**
+ * @brief 关闭当前文件，文件长度截断为实际写入的字节数
+ * @param st 流对象
+ * @retval FR_OK 成功
+ */
+FRESULT sd_stream_close(sd_stream_t *st);
+
+/**
+ * @brief 立即轮转到下一个文件
+ * @param st 流对象
+ * @retval FR_OK 成功
+ */
+FRESULT sd_stream_rotate(sd_stream_t *st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SD_STREAM_H */
@@ -0,0 +1,90 @@
+/**
+ * @file touch_service.h
+ * @brief 触摸采集服务
+ *
+ * 触摸芯片的 I2C 读取放在独立任务中，不占用 LVGL 任务：
+ *   - GT9xxx：INT 引脚（PB1，EXTI1）有新数据时触发中断，任务被唤醒后读一帧并清状态；
+ *     按下期间每 TOUCH_SERVICE_HOLD_MS 没有中断时补读一次，防止漏掉松开的中断。
+ *   - 其他触摸芯片（FT5206、电阻屏）：任务每 TOUCH_SERVICE_POLL_MS 调用 tp_dev.scan() 轮询。
+ * 状态或坐标变化时把带时间戳的样本放入队列，LVGL 读取回调逐个取走（continue_reading），
+ * 一个读取周期内的按下和松开都不会丢。
+ *
+ * 诊断盘 stats.txt 列出中断与读取次数、样本数和从中断到 LVGL 取走样本的延迟；
+ * 每次 I2C 读取的耗时计入 "touch read" 耗时统计项。
+ */
+
+#ifndef __TOUCH_SERVICE_H
+#define __TOUCH_SERVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 样本队列深度 */
+#ifndef TOUCH_SERVICE_QUEUE_LEN
+#define TOUCH_SERVICE_QUEUE_LEN     16U
+#endif
+
+/* 按下期间没有中断时补读的间隔（毫秒），GT9xxx 按下时约每 10ms 报点一次 */
+#ifndef TOUCH_SERVICE_HOLD_MS
+#define TOUCH_SERVICE_HOLD_MS       50U
+#endif
+
+/* 松开状态下没有中断时补读的间隔（毫秒） */
+#ifndef TOUCH_SERVICE_IDLE_MS
+#define TOUCH_SERVICE_IDLE_MS       1000U
+#endif
+
+/* 非中断方式的触摸芯片的轮询周期（毫秒） */
+#ifndef TOUCH_SERVICE_POLL_MS
+#define TOUCH_SERVICE_POLL_MS       10U
+#endif
+
+typedef struct {
+    uint32_t time_us;           /* INT 中断时刻（轮询时为读取时刻），HighResTimer_GetUs() */
+    uint16_t x;
+    uint16_t y;
+    bool pressed;
+} touch_sample_t;
+
+typedef struct {
+    bool irq_mode;              /* true：INT 中断方式；false：轮询 */
+    uint32_t irqs;              /* INT 中断次数 */
+    uint32_t reads;             /* 读取触摸芯片的次数 */
+    uint32_t samples;           /* 放入队列的样本数 */
+    uint32_t dropped;           /* 队列满丢弃的最旧样本数 */
+    uint32_t latency_avg_us;    /* 中断到 LVGL 取走样本的延迟（滑动平均） */
+    uint32_t latency_max_us;
+} touch_service_stats_t;
+
+/**
+ * @brief 创建采集任务并按触摸芯片类型打开 INT 中断（tp_dev.init() 之后、调度器启动前调用一次）
+ */
+void touch_service_init(void);
+
+/**
+ * @brief 取一个样本（LVGL 任务调用，不等待）
+ * @retval true 取到；false 队列为空
+ */
+bool touch_service_get(touch_sample_t *sample);
+
+/**
+ * @brief 队列中等待取走的样本数
+ */
+uint32_t touch_service_pending(void);
+
+/**
+ * @brief INT 引脚的 EXTI 中断（EXTI1_IRQHandler 中调用）
+ */
+void touch_service_irq(void);
+
+void touch_service_get_stats(touch_service_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TOUCH_SERVICE_H */
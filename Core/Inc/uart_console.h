@@ -0,0 +1,25 @@
+/**
+ * @file uart_console.h
+ * @brief 串口控制台（USART1）接收任务
+ *
+ * 接收任务等待 uart_drv 的数据到达通知，由 uart_proto 直接在接收缓冲区上解析二进制帧，
+ * 其余字节按文本处理：回显，并按行执行命令（"log ..."、"cpu ..."、"uart ..."、"rec ..."，以及打开 RTOS_TRACE_ENABLE 时的 "trace ..."）。
+ */
+
+#ifndef __UART_CONSOLE_H
+#define __UART_CONSOLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 创建接收任务（调度器启动前、uart_drv_init() 之后调用一次）
+ */
+void uart_console_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UART_CONSOLE_H */
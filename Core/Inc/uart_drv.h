@@ -0,0 +1,162 @@
+/**
+ * @file uart_drv.h
+ * @brief 串口驱动：DMA 收发环形缓冲区 + 流接口
+ *
+ * 每个串口一对环形缓冲区：
+ *   - 接收：DMA 以循环模式写入，不停止、不重启。半满（HT）、全满（TC）和串口空闲（IDLE）时
+ *     在 DMA 中断里根据 NDTR 发布写入位置并通知读取任务；每次中断的工作量与收到的字节数无关。
+ *   - 发送：写入方只把数据复制进缓冲区，DMA 发送完成（串口 TC 中断）时接着发下一段连续数据。
+ *     任意任务和中断都可以写，一次写入的数据连续出现在串口上，不与其他写入交错。
+ *     缓冲区满时：中断中直接丢弃；任务中最多等待 uart_drv_set_block_ms() 设置的时间，超时后丢弃。
+ *
+ * 串口中断和发送 DMA 中断优先级为 0（控制台与日志共用，关中断期间也要能发出），不能调用 FreeRTOS 接口，
+ * IDLE 时挂起接收 DMA 中断（优先级在 FreeRTOS 可管理范围内）代为通知。
+ * 每个串口只能有一个读取任务；读取可以逐段复制（uart_drv_read），也可以直接在缓冲区上解析
+ * （uart_drv_rx_peek / uart_drv_rx_consume）。
+ *
+ * 增加串口：CubeMX 中配置 UART 及收发 DMA（接收为循环模式），在 uart_port_t 和 uart_drv.c 的端口表中
+ * 各加一项，并在该串口和接收 DMA 的中断函数中调用 uart_drv_usart_irq() / uart_drv_rx_dma_irq()。
+ *
+ * 串口命令 "uart"：打印各串口统计；"uart baud <波特率>"：修改控制台波特率。
+ */
+
+#ifndef __UART_DRV_H
+#define __UART_DRV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 控制台（USART1）收发缓冲区大小（字节，必须是2的幂），DMA 需要访问，不能放在 CCM。
+ * 接收缓冲区需覆盖读取任务可能被耽误的最长时间：4096 字节在 4Mbaud 下约 10ms */
+#ifndef UART_DRV_CONSOLE_RX_SIZE
+#define UART_DRV_CONSOLE_RX_SIZE    4096U
+#endif
+#ifndef UART_DRV_CONSOLE_TX_SIZE
+#define UART_DRV_CONSOLE_TX_SIZE    4096U
+#endif
+
+/* 发送缓冲区满时任务默认的最长等待时间（毫秒），0 表示直接丢弃 */
+#ifndef UART_DRV_BLOCK_MS
+#define UART_DRV_BLOCK_MS           20U
+#endif
+
+typedef enum {
+    UART_PORT_CONSOLE = 0,          /* USART1：日志、printf、命令行、二进制协议 */
+    UART_PORT_COUNT
+} uart_port_t;
+
+typedef struct {
+    uint32_t baud;
+    /* 接收 */
+    uint32_t rx_received;           /* DMA 写入的字节数 */
+    uint32_t rx_overflows;          /* 读取任务来不及取走、被覆盖的次数 */
+    uint32_t rx_lost;               /* 因覆盖丢弃的字节数 */
+    uint32_t rx_line_errors;        /* 串口溢出/帧错误/噪声次数 */
+    uint32_t rx_dma_errors;         /* DMA 传输错误（已自动重启）次数 */
+    uint32_t rx_high_water;         /* 缓冲区最大占用（字节） */
+    uint32_t rx_events;             /* 接收 DMA 中断次数（HT/TC/IDLE），与字节数无关 */
+    uint64_t rx_isr_cycles;         /* 接收 DMA 中断累计耗时（周期），除以 rx_received 得到每字节开销 */
+    /* 发送 */
+    uint32_t tx_written;            /* 写入缓冲区的字节数 */
+    uint32_t tx_sent;               /* DMA 发送完成的字节数 */
+    uint32_t tx_dropped;            /* 缓冲区满丢弃的字节数 */
+    uint32_t tx_blocked;            /* 写入时等待过缓冲区空间的次数 */
+    uint32_t tx_high_water;         /* 缓冲区最大占用（字节） */
+    uint32_t tx_dma_errors;         /* 中途失败重发的 DMA 传输数 */
+} uart_drv_stats_t;
+
+/**
+ * @brief 启动各串口的 DMA 接收（MX_USARTx_UART_Init 之后调用一次）
+ */
+void uart_drv_init(void);
+
+/**
+ * @brief 写入发送缓冲区（任务与中断均可调用）
+ * @param data 数据
+ * @param len 长度，超过缓冲区大小时按缓冲区大小分段
+ * @retval 写入的字节数，其余被丢弃
+ */
+uint32_t uart_drv_write(uart_port_t port, const void *data, uint32_t len);
+
+/**
+ * @brief 设置发送缓冲区满时任务的最长等待时间（毫秒），0 表示直接丢弃
+ */
+void uart_drv_set_block_ms(uart_port_t port, uint32_t ms);
+
+/**
+ * @brief 等待发送缓冲区中的数据全部发出（复位、改波特率前调用，不能在中断中调用）
+ * @param timeout_ms 最长等待时间（毫秒）
+ * @retval 0 已发完；-1 超时
+ */
+int uart_drv_flush(uart_port_t port, uint32_t timeout_ms);
+
+/**
+ * @brief 可读的字节数（读取任务调用）
+ */
+uint32_t uart_drv_readable(uart_port_t port);
+
+/**
+ * @brief 等待数据到达（读取任务调用，调用的任务即登记为该串口的读取任务）
+ * @param timeout_ms 没有数据时最长等待时间（毫秒）
+ * @retval 可读的字节数，超时为 0
+ */
+uint32_t uart_drv_wait(uart_port_t port, uint32_t timeout_ms);
+
+/**
+ * @brief 取出接收数据（读取任务调用，不等待）
+ * @retval 复制的字节数
+ */
+uint32_t uart_drv_read(uart_port_t port, void *buf, uint32_t len);
+
+/**
+ * @brief 直接访问接收缓冲区（读取任务调用），处理完后用 uart_drv_rx_consume() 交还
+ *        被 DMA 追上一圈时丢弃全部未读数据并计入统计
+ * @param ring 返回缓冲区
+ * @param size 返回缓冲区大小（2的幂）
+ * @param read 返回累计取走位置
+ * @retval 累计写入位置，[*read, 返回值) 为可读数据
+ */
+uint32_t uart_drv_rx_peek(uart_port_t port, const uint8_t **ring, uint32_t *size, uint32_t *read);
+
+/**
+ * @brief 交还已处理的接收数据
+ * @param read 新的累计取走位置
+ */
+void uart_drv_rx_consume(uart_port_t port, uint32_t read);
+
+/**
+ * @brief 修改波特率（任务中调用），先等待发送缓冲区发完
+ * @retval 0 成功；-1 波特率超出范围
+ */
+int uart_drv_set_baud(uart_port_t port, uint32_t baud);
+
+/**
+ * @brief 获取统计
+ */
+void uart_drv_get_stats(uart_port_t port, uart_drv_stats_t *stats);
+
+/**
+ * @brief 串口中断（USARTx_IRQHandler 中 HAL_UART_IRQHandler 之前调用）：处理 IDLE
+ */
+void uart_drv_usart_irq(uart_port_t port);
+
+/**
+ * @brief 接收 DMA 中断（HAL_DMA_IRQHandler 之后调用）：发布写入位置并通知读取任务
+ */
+void uart_drv_rx_dma_irq(uart_port_t port);
+
+/**
+ * @brief 串口命令 "uart ..."
+ * @return 1 已处理；0 不是本模块的命令
+ */
+int uart_drv_command(const char *line);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UART_DRV_H */
@@ -0,0 +1,162 @@
+/**
+ * @file uart_proto.h
+ * @brief 串口二进制命令协议
+ *
+ * 帧格式（小端）：
+ *   uint8 0xC3, uint8 0x3C, uint16 len, uint8 cmd, uint8 seq, uint8 flags, uint8 status,
+ *   payload[len], uint16 crc
+ * crc 为 CRC-16/CCITT-FALSE（多项式 0x1021，初值 0xFFFF），覆盖 len 到 payload 末尾。
+ * 同步字 C3 3C 不会出现在 ASCII 或合法 UTF-8 文本中，同一串口上的文本命令行（"log ..."、"cpu" 等）
+ * 与二进制帧可以混合：不属于帧的字节按文本交给命令行。
+ *
+ * 请求的 status 为 0；应答的 cmd 为请求的 cmd | UART_PROTO_REPLY，seq 原样返回，status 为处理结果。
+ * flags 置 UART_PROTO_FLAG_NO_REPLY 时不应答（高速下发数据流时使用）。
+ * 应答经 uart_drv 发出，与日志共用串口，主机端见 tools/uart_proto.py。
+ *
+ * 解析器直接在 DMA 接收环形缓冲区上工作，不复制数据：负载可能跨过缓冲区末尾，
+ * 以两段（seg[0]、seg[1]）交给处理函数。处理函数在接收任务中执行，返回前数据一直有效
+ * （前提是主机在应答前发送的数据不超过一圈缓冲区）。
+ */
+
+#ifndef __UART_PROTO_H
+#define __UART_PROTO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 负载最大长度（需小于接收环形缓冲区的一半） */
+#ifndef UART_PROTO_MAX_PAYLOAD
+#define UART_PROTO_MAX_PAYLOAD  1024U
+#endif
+
+/* 帧不完整时等待剩余部分的最长时间（毫秒），超时后把同步字当作文本跳过 */
+#ifndef UART_PROTO_TIMEOUT_MS
+#define UART_PROTO_TIMEOUT_MS   50U
+#endif
+
+/* 可注册的命令数 */
+#ifndef UART_PROTO_MAX_HANDLERS
+#define UART_PROTO_MAX_HANDLERS 16U
+#endif
+
+#define UART_PROTO_SYNC0        0xC3U
+#define UART_PROTO_SYNC1        0x3CU
+#define UART_PROTO_HEADER_SIZE  8U
+#define UART_PROTO_CRC_SIZE     2U
+#define UART_PROTO_VERSION      1U
+
+#define UART_PROTO_REPLY        0x80U   /* 应答 cmd 最高位 */
+#define UART_PROTO_FLAG_NO_REPLY 0x01U
+
+/* 内置命令 */
+enum {
+    UART_PROTO_CMD_PING = 0x01,         /* 原样返回负载 */
+    UART_PROTO_CMD_INFO = 0x02,         /* uart_proto_info_t + 编译时间字符串 */
+    UART_PROTO_CMD_STATS = 0x03,        /* uart_proto_stats_reply_t */
+    UART_PROTO_CMD_SCENE = 0x10,        /* uint8 场景, uint8 动画, uint16 时长(ms) */
+    UART_PROTO_CMD_STREAM = 0x20        /* 数据流：负载按记录写入记录器，应答 uint32 累计字节数；
+                                         * 记录器未运行时状态为 NOT_RECORDING，队列满丢弃了记录时为 BUSY */
+};
+
+/* 应答状态 */
+typedef enum {
+    UART_PROTO_OK = 0,
+    UART_PROTO_ERR_UNKNOWN_CMD,
+    UART_PROTO_ERR_BAD_ARG,
+    UART_PROTO_ERR_BUSY,
+    UART_PROTO_ERR_NOT_RECORDING
+} uart_proto_status_t;
+
+/* 记录器中数据流记录的类型 */
+#define UART_PROTO_RECORD_TYPE  0x5354U /* "ST" */
+
+/* 收到的帧，负载位于接收缓冲区中 */
+typedef struct {
+    uint8_t cmd;
+    uint8_t seq;
+    uint8_t flags;
+    uint16_t len;
+    const uint8_t *seg[2];
+    uint16_t seg_len[2];            /* seg_len[0] + seg_len[1] == len */
+} uart_proto_frame_t;
+
+typedef struct {
+    uint16_t version;               /* UART_PROTO_VERSION */
+    uint16_t max_payload;           /* UART_PROTO_MAX_PAYLOAD */
+    uint32_t rx_ring_size;
+    uint64_t uptime_us;
+} uart_proto_info_t;
+
+typedef struct {
+    uint32_t frames;                /* 处理的帧数 */
+    uint32_t crc_errors;            /* 校验失败的帧数 */
+    uint32_t timeouts;              /* 等待不完整帧超时的次数 */
+    uint32_t unknown;               /* 没有处理函数的帧数 */
+    uint32_t text_bytes;            /* 交给命令行的文本字节数 */
+    uint32_t stream_bytes;          /* UART_PROTO_CMD_STREAM 收到的负载字节数 */
+    uint32_t stream_dropped;        /* 记录器未运行或队列满丢弃的记录数 */
+} uart_proto_stats_t;
+
+typedef struct {
+    uint32_t rx_received;
+    uint32_t rx_overflows;
+    uint32_t rx_lost;
+    uint32_t rx_line_errors;
+    uint32_t rx_high_water;
+    uint32_t tx_written;
+    uint32_t tx_dropped;
+    uart_proto_stats_t proto;
+    uint16_t cpu_load;              /* 千分比 */
+    uint16_t cpu_avg;
+    uint32_t heap_free;
+} uart_proto_stats_reply_t;
+
+/* 命令处理函数，在接收任务中调用；需要应答时调用 uart_proto_reply() */
+typedef void (*uart_proto_handler_t)(const uart_proto_frame_t *frame);
+
+/* 文本（不属于帧的字节）处理函数 */
+typedef void (*uart_proto_text_t)(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief 注册内置命令，设置文本处理函数
+ */
+void uart_proto_init(uart_proto_text_t text);
+
+/**
+ * @brief 注册命令处理函数
+ * @retval false 表已满或命令号已注册
+ */
+bool uart_proto_register(uint8_t cmd, uart_proto_handler_t handler);
+
+/**
+ * @brief 解析环形缓冲区中 [*read, written) 的数据，取走完整的帧和文本
+ * @param ring 缓冲区
+ * @param ring_size 缓冲区大小（2的幂）
+ * @param read 累计取走位置，不完整的帧留在缓冲区中等下次
+ * @param written 累计写入位置
+ */
+void uart_proto_input(const uint8_t *ring, uint32_t ring_size, uint32_t *read, uint32_t written);
+
+/**
+ * @brief 应答（只能在处理函数中调用），请求带 UART_PROTO_FLAG_NO_REPLY 时不发送
+ * @param data 负载，可以为 NULL（len 为 0）
+ */
+void uart_proto_reply(const uart_proto_frame_t *req, uint8_t status, const void *data, uint16_t len);
+
+/**
+ * @brief 从帧负载中复制一段（处理跨缓冲区末尾的情况）
+ * @retval 复制的字节数
+ */
+uint16_t uart_proto_copy(const uart_proto_frame_t *frame, uint16_t offset, void *buf, uint16_t len);
+
+void uart_proto_get_stats(uart_proto_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UART_PROTO_H */
@@ -0,0 +1,70 @@
+/**
+ * @file usb_selftest.h
+ * @brief USB 吞吐自测
+ *
+ * 依次使用 usbd_conf.c 中的每种端点 FIFO 分配方案重新枚举设备，
+ * 在 CDC 的 bulk 端点上收发测试数据，统计每种方案下实际达到的速率。
+ * 主机端用 tools/usb_selftest.py 持续读（可选同时写）虚拟串口，设备重新枚举后脚本自动重连。
+ * 自测期间 MSC 仍然枚举，但不应在主机上访问磁盘；日志从串口输出。
+ */
+
+#ifndef __USB_SELFTEST_H
+#define __USB_SELFTEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 为1时编译自测并在启动后自动运行一次；为0时不编译（不占任务栈） */
+#ifndef USB_SELFTEST_ENABLE
+#define USB_SELFTEST_ENABLE             0
+#endif
+
+/* 每种方案的测量时长 */
+#ifndef USB_SELFTEST_WINDOW_MS
+#define USB_SELFTEST_WINDOW_MS          5000U
+#endif
+
+/* 等待主机打开串口的最长时间，超时跳过该方案 */
+#ifndef USB_SELFTEST_OPEN_TIMEOUT_MS
+#define USB_SELFTEST_OPEN_TIMEOUT_MS    30000U
+#endif
+
+/* 单个方案的测量结果 */
+typedef struct {
+    uint8_t  profile;           /* 方案编号 */
+    uint8_t  valid;             /* 主机在超时前打开了串口 */
+    uint32_t in_kbps;           /* 设备->主机 KB/s */
+    uint32_t out_kbps;          /* 主机->设备 KB/s */
+} usb_selftest_result_t;
+
+#if USB_SELFTEST_ENABLE
+
+/**
+ * @brief 创建自测任务（USB 已初始化后调用），自测完成后恢复默认方案并退出
+ */
+void usb_selftest_start(void);
+
+/**
+ * @brief 自测是否正在运行
+ */
+bool usb_selftest_running(void);
+
+/**
+ * @brief 获取测量结果
+ * @param out 结果数组
+ * @param max 数组长度
+ * @retval 结果个数
+ */
+uint8_t usb_selftest_get_results(usb_selftest_result_t *out, uint8_t max);
+
+#endif /* USB_SELFTEST_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USB_SELFTEST_H */
@@ -0,0 +1,277 @@
+/**
+ * @file cpu_load.c
+ * @brief 按任务统计 CPU 占用实现
+ *
+ * 采样任务优先级高于所有应用任务，按绝对周期唤醒，本身耗时计入自己的一行。
+ * 各任务的累计运行时间是 32 位微秒数，约 71 分钟回绕，只用两次采样的差值，回绕不影响结果。
+ * 结果表按滑动平均排序，读取时在临界区内复制。
+ */
+
+#include "cpu_load.h"
+#define LOG_MODULE LOG_MOD_CPU
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 采样任务配置 */
+#define CPU_LOAD_TASK_PRIO      (tskIDLE_PRIORITY + 6)  /* 高于记录任务，采样周期稳定 */
+#define CPU_LOAD_STK_SIZE       384                     /* 任务堆栈大小(字) */
+
+/* 千分比的滑动平均以 Q8 定点保存 */
+#define CPU_LOAD_Q              8U
+
+typedef struct {
+    cpu_load_task_t info;
+    uint32_t last_runtime;      /* 上次采样时的累计运行时间 */
+    uint32_t avg_q;             /* 滑动平均，千分比 << CPU_LOAD_Q */
+} cpu_load_entry_t;
+
+/* 采样任务独占的工作区 */
+static TaskStatus_t status[CPU_LOAD_MAX_TASKS];
+static cpu_load_entry_t work[CPU_LOAD_MAX_TASKS];
+static uint32_t last_total_runtime;
+
+/* 对外发布的结果 */
+static cpu_load_entry_t result[CPU_LOAD_MAX_TASKS];
+static uint32_t result_count;
+static uint16_t total_load;
+static uint32_t total_avg_q;
+
+static volatile uint32_t log_period_s = CPU_LOAD_LOG_PERIOD_S;
+static volatile bool overlay_on = true;
+
+static TaskHandle_t cpu_load_task_handle;
+static StaticTask_t cpu_load_task_tcb;
+static StackType_t cpu_load_task_stack[CPU_LOAD_STK_SIZE];
+
+static const cpu_load_entry_t *find_entry(const cpu_load_entry_t *table, uint32_t count, uint16_t number)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        if (table[i].info.number == number) {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+static int compare_avg(const void *a, const void *b)
+{
+    const cpu_load_entry_t *ea = a;
+    const cpu_load_entry_t *eb = b;
+
+    if (ea->avg_q != eb->avg_q) {
+        return (ea->avg_q < eb->avg_q) ? 1 : -1;
+    }
+    return (int)ea->info.number - (int)eb->info.number;
+}
+
+static uint32_t average(uint32_t avg_q, uint16_t load, bool first)
+{
+    uint32_t load_q = (uint32_t)load << CPU_LOAD_Q;
+
+    if (first) {
+        return load_q;
+    }
+    /* avg += (load - avg) / 2^shift，分两个方向避免无符号下溢 */
+    if (load_q >= avg_q) {
+        return avg_q + ((load_q - avg_q) >> CPU_LOAD_AVG_SHIFT);
+    }
+    return avg_q - ((avg_q - load_q) >> CPU_LOAD_AVG_SHIFT);
+}
+
+static uint16_t permille(uint32_t part, uint32_t whole)
+{
+    uint32_t v;
+
+    if (whole == 0U) {
+        return 0;
+    }
+    v = (uint32_t)(((uint64_t)part * 1000U + whole / 2U) / whole);
+    return (uint16_t)((v > 1000U) ? 1000U : v);
+}
+
+/**
+ * @brief 取一次各任务的累计运行时间，更新结果表
+ * @param first 第一次采样只记录基准
+ */
+static void cpu_load_sample(bool first)
+{
+    TaskHandle_t idle = xTaskGetIdleTaskHandle();
+    uint32_t total_runtime;
+    uint32_t elapsed;
+    uint32_t count;
+    uint32_t i;
+    uint16_t idle_load = 0;
+    const cpu_load_entry_t *prev;
+    cpu_load_entry_t *entry;
+
+    count = uxTaskGetSystemState(status, CPU_LOAD_MAX_TASKS, &total_runtime);
+    elapsed = total_runtime - last_total_runtime;
+    last_total_runtime = total_runtime;
+
+    for (i = 0; i < count; i++) {
+        entry = &work[i];
+        prev = find_entry(result, result_count, (uint16_t)status[i].xTaskNumber);
+        strncpy(entry->info.name, status[i].pcTaskName, CPU_LOAD_NAME_LEN - 1U);
+        entry->info.name[CPU_LOAD_NAME_LEN - 1U] = '\0';
+        entry->info.number = (uint16_t)status[i].xTaskNumber;
+        entry->info.priority = (uint8_t)status[i].uxCurrentPriority;
+        /* 新出现的任务以本周期的运行时间为准（创建前为 0） */
+        entry->info.load = permille(status[i].ulRunTimeCounter - (prev ? prev->last_runtime : 0U), elapsed);
+        entry->last_runtime = status[i].ulRunTimeCounter;
+        entry->avg_q = average(prev ? prev->avg_q : 0U, entry->info.load, first || prev == NULL);
+        entry->info.avg = (uint16_t)((entry->avg_q + (1U << (CPU_LOAD_Q - 1U))) >> CPU_LOAD_Q);
+        entry->info.idle = (status[i].xHandle == idle);
+        if (entry->info.idle) {
+            idle_load = entry->info.load;
+        }
+    }
+    qsort(work, count, sizeof(work[0]), compare_avg);
+
+    taskENTER_CRITICAL();
+    memcpy(result, work, count * sizeof(work[0]));
+    result_count = count;
+    total_load = (uint16_t)(1000U - idle_load);
+    total_avg_q = average(total_avg_q, total_load, first);
+    taskEXIT_CRITICAL();
+}
+
+static void cpu_load_log(void)
+{
+    cpu_load_task_t t;
+    uint16_t avg;
+    uint16_t load = cpu_load_total(&avg);
+    uint32_t i;
+
+    LOG_INFO("cpu %u.%u%% (avg %u.%u%%)", load / 10U, load % 10U, avg / 10U, avg % 10U);
+    for (i = 0; cpu_load_get(i, &t); i++) {
+        LOG_DEBUG("cpu  %-16s %3u.%u%% (avg %3u.%u%%)", t.name,
+                  t.load / 10U, t.load % 10U, t.avg / 10U, t.avg % 10U);
+    }
+}
+
+static void cpu_load_task(void *arg)
+{
+    TickType_t wake = xTaskGetTickCount();
+    uint32_t log_elapsed_ms = 0;
+
+    (void)arg;
+    cpu_load_sample(true);
+    for (;;) {
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(CPU_LOAD_PERIOD_MS));
+        cpu_load_sample(false);
+
+        log_elapsed_ms += CPU_LOAD_PERIOD_MS;
+        if (log_period_s != 0U && log_elapsed_ms >= log_period_s * 1000U) {
+            log_elapsed_ms = 0;
+            cpu_load_log();
+        }
+    }
+}
+
+void cpu_load_init(void)
+{
+    if (cpu_load_task_handle != NULL) {
+        return;
+    }
+    cpu_load_task_handle = xTaskCreateStatic(cpu_load_task,
+                                             "cpu_load",
+                                             CPU_LOAD_STK_SIZE,
+                                             NULL,
+                                             CPU_LOAD_TASK_PRIO,
+                                             cpu_load_task_stack,
+                                             &cpu_load_task_tcb);
+}
+
+uint16_t cpu_load_total(uint16_t *avg)
+{
+    uint16_t load;
+
+    taskENTER_CRITICAL();
+    load = total_load;
+    if (avg != NULL) {
+        *avg = (uint16_t)((total_avg_q + (1U << (CPU_LOAD_Q - 1U))) >> CPU_LOAD_Q);
+    }
+    taskEXIT_CRITICAL();
+    return load;
+}
+
+bool cpu_load_get(uint32_t index, cpu_load_task_t *out)
+{
+    bool ok;
+
+    taskENTER_CRITICAL();
+    ok = index < result_count;
+    if (ok) {
+        *out = result[index].info;
+    }
+    taskEXIT_CRITICAL();
+    return ok;
+}
+
+bool cpu_load_find(uint16_t number, cpu_load_task_t *out)
+{
+    const cpu_load_entry_t *entry;
+
+    taskENTER_CRITICAL();
+    entry = find_entry(result, result_count, number);
+    if (entry != NULL) {
+        *out = entry->info;
+    }
+    taskEXIT_CRITICAL();
+    return entry != NULL;
+}
+
+bool cpu_load_overlay_enabled(void)
+{
+    return overlay_on;
+}
+
+static void cpu_load_print(void)
+{
+    cpu_load_task_t t;
+    uint16_t avg;
+    uint16_t load = cpu_load_total(&avg);
+    uint32_t i;
+
+    printf("cpu %u.%u%% (avg %u.%u%%)\r\n", load / 10U, load % 10U, avg / 10U, avg % 10U);
+    printf("%-16s %4s %7s %7s\r\n", "task", "prio", "cpu %", "avg %");
+    for (i = 0; cpu_load_get(i, &t); i++) {
+        printf("%-16s %4u %5u.%u %5u.%u\r\n", t.name, t.priority,
+               t.load / 10U, t.load % 10U, t.avg / 10U, t.avg % 10U);
+    }
+}
+
+int cpu_load_command(const char *line)
+{
+    char buf[32];
+    char *argv[3];
+    int argc = 0;
+    char *save;
+    char *p;
+
+    strncpy(buf, line, sizeof(buf) - 1U);
+    buf[sizeof(buf) - 1U] = '\0';
+    for (p = strtok_r(buf, " \t", &save); p != NULL && argc < 3; p = strtok_r(NULL, " \t", &save)) {
+        argv[argc++] = p;
+    }
+    if (argc == 0 || strcmp(argv[0], "cpu") != 0) {
+        return 0;
+    }
+
+    if (argc == 1) {
+        cpu_load_print();
+    } else if (argc == 3 && strcmp(argv[1], "log") == 0) {
+        log_period_s = (uint32_t)strtoul(argv[2], NULL, 10);
+    } else if (argc == 3 && strcmp(argv[1], "overlay") == 0) {
+        overlay_on = (strcmp(argv[2], "on") == 0);
+    } else {
+        printf("usage: cpu [log <seconds> | overlay on|off]\r\n");
+    }
+    return 1;
+}
@@ -0,0 +1,281 @@
+/**
+ * @file diag_disk.c
+ * @brief 只读诊断盘实现
+ *
+ * 卷布局（每簇一个扇区）：
+ *   引导扇区 | FAT1 | FAT2 | 根目录（512 项） | 数据区
+ * 数据区按文件登记顺序连续分配，第一个文件从簇 2 开始。
+ */
+
+#include "diag_disk.h"
+#include <string.h>
+
+#define DIAG_RSVD_SECTORS       1U
+#define DIAG_NUM_FATS           2U
+#define DIAG_ROOT_ENTRIES       512U
+#define DIAG_ROOT_SECTORS       ((DIAG_ROOT_ENTRIES * 32U) / DIAG_DISK_SECTOR_SIZE)
+#define DIAG_FAT_SECTORS        (((DIAG_DISK_SECTORS + 2U) * 2U + DIAG_DISK_SECTOR_SIZE - 1U) / DIAG_DISK_SECTOR_SIZE)
+#define DIAG_FAT_START          DIAG_RSVD_SECTORS
+#define DIAG_ROOT_START         (DIAG_FAT_START + DIAG_NUM_FATS * DIAG_FAT_SECTORS)
+#define DIAG_DATA_START         (DIAG_ROOT_START + DIAG_ROOT_SECTORS)
+#define DIAG_CLUSTERS           (DIAG_DISK_SECTORS - DIAG_DATA_START)
+
+#define DIAG_MEDIA              0xF8U
+#define DIAG_VOLUME_ID          0x44494147U     /* "DIAG" */
+#define DIAG_FAT_DATE           (((2025U - 1980U) << 9) | (1U << 5) | 1U)
+
+#define DIAG_ATTR_READ_ONLY     0x01U
+#define DIAG_ATTR_VOLUME_ID     0x08U
+
+#if (DIAG_CLUSTERS < 4085U) || (DIAG_CLUSTERS > 65524U)
+#error "DIAG_DISK_SECTORS must give a FAT16 cluster count (4085..65524)"
+#endif
+
+typedef struct {
+    const diag_file_t *file;
+    char name[11];              /* 目录项格式的文件名 */
+    uint16_t first_cluster;
+    uint16_t clusters;
+    uint32_t size;              /* 当前快照长度 */
+} diag_entry_t;
+
+static diag_entry_t entries[DIAG_DISK_MAX_FILES];
+static uint32_t entry_count;
+static uint32_t next_cluster = 2U;
+static volatile bool reload_pending = true;
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static bool diag_name_char(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '~';
+}
+
+/**
+ * @brief "stats.txt" -> "STATS   TXT"
+ */
+static bool diag_make_name(const char *src, char dst[11])
+{
+    uint32_t i = 0;
+    uint32_t limit = 8U;
+    char c;
+
+    memset(dst, ' ', 11);
+    for (; *src != '\0'; src++) {
+        c = *src;
+        if (c == '.' && limit == 8U && i > 0U) {
+            i = 8U;
+            limit = 11U;
+            continue;
+        }
+        if (c >= 'a' && c <= 'z') {
+            c = (char)(c - 'a' + 'A');
+        }
+        if (!diag_name_char(c) || i >= limit) {
+            return false;
+        }
+        dst[i++] = c;
+    }
+    return i > 0U;
+}
+
+bool diag_disk_register(const diag_file_t *file)
+{
+    diag_entry_t *e;
+    uint32_t clusters;
+
+    if (file == NULL || file->read == NULL || entry_count >= DIAG_DISK_MAX_FILES) {
+        return false;
+    }
+    clusters = (file->max_size + DIAG_DISK_SECTOR_SIZE - 1U) / DIAG_DISK_SECTOR_SIZE;
+    if (clusters == 0U || next_cluster + clusters > DIAG_CLUSTERS + 2U) {
+        return false;
+    }
+
+    e = &entries[entry_count];
+    if (!diag_make_name(file->name, e->name)) {
+        return false;
+    }
+    e->file = file;
+    e->first_cluster = (uint16_t)next_cluster;
+    e->clusters = (uint16_t)clusters;
+    e->size = 0;
+    next_cluster += clusters;
+    entry_count++;
+    reload_pending = true;
+    return true;
+}
+
+void diag_disk_reload(void)
+{
+    reload_pending = true;
+}
+
+static void diag_snapshot(void)
+{
+    uint32_t i;
+    uint32_t size;
+
+    for (i = 0; i < entry_count; i++) {
+        size = (entries[i].file->update != NULL) ? entries[i].file->update() : entries[i].file->max_size;
+        entries[i].size = (size > entries[i].file->max_size) ? entries[i].file->max_size : size;
+    }
+}
+
+static void diag_boot_sector(uint8_t *buf)
+{
+    buf[0] = 0xEB;
+    buf[1] = 0x3C;
+    buf[2] = 0x90;
+    memcpy(&buf[3], "MSDOS5.0", 8);
+    put16(&buf[11], DIAG_DISK_SECTOR_SIZE);
+    buf[13] = 1U;                               /* 每簇扇区数 */
+    put16(&buf[14], DIAG_RSVD_SECTORS);
+    buf[16] = DIAG_NUM_FATS;
+    put16(&buf[17], DIAG_ROOT_ENTRIES);
+#if DIAG_DISK_SECTORS < 0x10000U
+    put16(&buf[19], DIAG_DISK_SECTORS);
+#else
+    put32(&buf[32], DIAG_DISK_SECTORS);
+#endif
+    buf[21] = DIAG_MEDIA;
+    put16(&buf[22], DIAG_FAT_SECTORS);
+    put16(&buf[24], 63U);
+    put16(&buf[26], 255U);
+    buf[36] = 0x80;                             /* 驱动器号 */
+    buf[38] = 0x29;                             /* 扩展引导签名 */
+    put32(&buf[39], DIAG_VOLUME_ID);
+    memcpy(&buf[43], "DIAG       ", 11);
+    memcpy(&buf[54], "FAT16   ", 8);
+    buf[510] = 0x55;
+    buf[511] = 0xAA;
+}
+
+static void diag_fat_sector(uint8_t *buf, uint32_t fat_sector)
+{
+    uint32_t first = fat_sector * (DIAG_DISK_SECTOR_SIZE / 2U);
+    uint32_t last = first + DIAG_DISK_SECTOR_SIZE / 2U;
+    uint32_t i;
+    uint32_t c;
+    uint32_t end;
+
+    if (fat_sector == 0U) {
+        put16(&buf[0], 0xFF00U | DIAG_MEDIA);
+        put16(&buf[2], 0xFFFFU);
+    }
+    for (i = 0; i < entry_count; i++) {
+        /* 链长按快照长度，预留的其余簇在 FAT 中是空闲的 */
+        end = (uint32_t)entries[i].first_cluster +
+              (entries[i].size + DIAG_DISK_SECTOR_SIZE - 1U) / DIAG_DISK_SECTOR_SIZE;
+        for (c = entries[i].first_cluster; c < end; c++) {
+            if (c >= first && c < last) {
+                put16(&buf[(c - first) * 2U], (c + 1U == end) ? 0xFFFFU : (uint16_t)(c + 1U));
+            }
+        }
+    }
+}
+
+static void diag_root_sector(uint8_t *buf, uint32_t root_sector)
+{
+    uint32_t idx;
+    uint32_t k;
+    uint8_t *d;
+    diag_entry_t *e;
+
+    for (k = 0; k < DIAG_DISK_SECTOR_SIZE / 32U; k++) {
+        idx = root_sector * (DIAG_DISK_SECTOR_SIZE / 32U) + k;
+        d = &buf[k * 32U];
+        if (idx == 0U) {
+            memcpy(d, "DIAG       ", 11);
+            d[11] = DIAG_ATTR_VOLUME_ID;
+            put16(&d[24], DIAG_FAT_DATE);
+        } else if (idx <= entry_count) {
+            e = &entries[idx - 1U];
+            memcpy(d, e->name, 11);
+            d[11] = DIAG_ATTR_READ_ONLY;
+            put16(&d[16], DIAG_FAT_DATE);       /* 创建日期 */
+            put16(&d[18], DIAG_FAT_DATE);       /* 访问日期 */
+            put16(&d[24], DIAG_FAT_DATE);       /* 修改日期 */
+            put16(&d[26], (e->size != 0U) ? e->first_cluster : 0U);
+            put32(&d[28], e->size);
+        } else {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief 数据区：返回本次处理的扇区数（同一文件内的连续扇区一次读出）
+ */
+static uint32_t diag_data_sectors(uint8_t *buf, uint32_t data_sector, uint32_t count)
+{
+    uint32_t cluster = data_sector + 2U;
+    uint32_t i;
+    uint32_t offset;
+    uint32_t run;
+    uint32_t len;
+    diag_entry_t *e;
+
+    for (i = 0; i < entry_count; i++) {
+        e = &entries[i];
+        if (cluster >= e->first_cluster && cluster < (uint32_t)e->first_cluster + e->clusters) {
+            run = (uint32_t)e->first_cluster + e->clusters - cluster;
+            if (run > count) {
+                run = count;
+            }
+            offset = (cluster - e->first_cluster) * DIAG_DISK_SECTOR_SIZE;
+            if (offset < e->size) {
+                len = e->size - offset;
+                if (len > run * DIAG_DISK_SECTOR_SIZE) {
+                    len = run * DIAG_DISK_SECTOR_SIZE;
+                }
+                e->file->read(offset, buf, len);
+            }
+            return run;
+        }
+    }
+    return 1U;
+}
+
+int diag_disk_read(uint8_t *buf, uint32_t sector, uint32_t count)
+{
+    uint32_t n;
+
+    if (sector >= DIAG_DISK_SECTORS || count > DIAG_DISK_SECTORS - sector) {
+        return -1;
+    }
+    if (reload_pending) {
+        reload_pending = false;
+        diag_snapshot();
+    }
+
+    memset(buf, 0, count * DIAG_DISK_SECTOR_SIZE);
+    while (count > 0U) {
+        n = 1U;
+        if (sector == 0U) {
+            diag_boot_sector(buf);
+        } else if (sector < DIAG_ROOT_START) {
+            diag_fat_sector(buf, (sector - DIAG_FAT_START) % DIAG_FAT_SECTORS);
+        } else if (sector < DIAG_DATA_START) {
+            diag_root_sector(buf, sector - DIAG_ROOT_START);
+        } else {
+            n = diag_data_sectors(buf, sector - DIAG_DATA_START, count);
+        }
+        buf += n * DIAG_DISK_SECTOR_SIZE;
+        sector += n;
+        count -= n;
+    }
+    return 0;
+}
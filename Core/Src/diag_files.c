@@ -0,0 +1,354 @@
+/**
+ * @file diag_files.c
+ * @brief 诊断盘上的固件状态文件实现
+ *
+ * 快照在 MSC 工作任务中生成，文本缓冲区第一次使用时从外部 SRAM 分配并一直保留。
+ */
+
+#include "diag_files.h"
+#include "diag_disk.h"
+#include "sd_io_sched.h"
+#include "sd_owner.h"
+#include "recorder.h"
+#include "malloc.h"
+#include "usbd_conf.h"
+#include "uart_drv.h"
+#include "touch_service.h"
+#include "i2c_bus.h"
+#include "high_res_timer.h"
+#include "rtos_trace.h"
+#include "cpu_load.h"
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DIAG_HEAP_TABLE_BYTES   (MEM3_ALLOC_TABLE_SIZE * sizeof(MT_TYPE))
+
+static char *stats_buf;
+static uint32_t stats_len;
+static diag_heap_header_t heap_header;
+#if LOG_HISTORY_SIZE > 0
+static char *log_buf;
+#endif
+#if RTOS_TRACE_ENABLE
+static uint8_t *trace_buf;
+#endif
+
+static void *diag_alloc(uint32_t size)
+{
+    void *p;
+
+    vTaskSuspendAll();          /* mymalloc 不可重入 */
+    p = mymalloc(SRAMEX, size);
+    xTaskResumeAll();
+    return p;
+}
+
+static void diag_free(void *p)
+{
+    vTaskSuspendAll();
+    myfree(SRAMEX, p);
+    xTaskResumeAll();
+}
+
+/* ---------------- stats.txt ---------------- */
+
+static void stats_printf(const char *fmt, ...)
+{
+    va_list args;
+    int n;
+
+    if (stats_len >= DIAG_STATS_MAX - 1U) {
+        return;
+    }
+    va_start(args, fmt);
+    n = vsnprintf(&stats_buf[stats_len], DIAG_STATS_MAX - stats_len, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        stats_len += (uint32_t)n;
+        if (stats_len > DIAG_STATS_MAX - 1U) {
+            stats_len = DIAG_STATS_MAX - 1U;
+        }
+    }
+}
+
+static const char *owner_name(sd_owner_t owner)
+{
+    switch (owner) {
+    case SD_OWNER_FIRMWARE:    return "firmware";
+    case SD_OWNER_TO_USB:      return "to usb";
+    case SD_OWNER_USB:         return "usb";
+    case SD_OWNER_TO_FIRMWARE: return "to firmware";
+    default:                   return "?";
+    }
+}
+
+static char task_state_char(eTaskState state)
+{
+    switch (state) {
+    case eRunning:   return 'X';
+    case eReady:     return 'R';
+    case eBlocked:   return 'B';
+    case eSuspended: return 'S';
+    case eDeleted:   return 'D';
+    default:         return '?';
+    }
+}
+
+static void stats_tasks(void)
+{
+    TaskStatus_t *tasks;
+    UBaseType_t count;
+    UBaseType_t i;
+    cpu_load_task_t load;
+    uint16_t total;
+    uint16_t avg;
+
+    /* 多留几项，生成期间新建的任务不会导致取不到 */
+    count = uxTaskGetNumberOfTasks() + 4U;
+    tasks = diag_alloc(count * sizeof(TaskStatus_t));
+    if (tasks == NULL) {
+        stats_printf("tasks: no memory\r\n");
+        return;
+    }
+    count = uxTaskGetSystemState(tasks, count, NULL);
+    total = cpu_load_total(&avg);
+    stats_printf("\r\ncpu           %u.%u %% (avg %u.%u %%)\r\n",
+                 total / 10U, total % 10U, avg / 10U, avg % 10U);
+    stats_printf("%-16s %5s %4s %12s %7s %7s\r\n", "task", "state", "prio", "stack free B", "cpu %", "avg %");
+    for (i = 0; i < count; i++) {
+        if (!cpu_load_find((uint16_t)tasks[i].xTaskNumber, &load)) {
+            memset(&load, 0, sizeof(load));
+        }
+        stats_printf("%-16s %5c %4lu %12lu %5u.%u %5u.%u\r\n",
+                     tasks[i].pcTaskName,
+                     task_state_char(tasks[i].eCurrentState),
+                     (unsigned long)tasks[i].uxCurrentPriority,
+                     (unsigned long)tasks[i].usStackHighWaterMark * sizeof(StackType_t),
+                     load.load / 10U, load.load % 10U, load.avg / 10U, load.avg % 10U);
+    }
+    diag_free(tasks);
+}
+
+static void stats_timing(void)
+{
+    time_stat_t stat;
+    uint32_t i;
+
+    if (!TimeStat_Get(0, &stat)) {
+        return;
+    }
+    stats_printf("\r\n%-20s %10s %10s %10s %10s\r\n", "timing", "count", "avg ns", "min ns", "max ns");
+    for (i = 0; TimeStat_Get(i, &stat); i++) {
+        stats_printf("%-20s %10lu %10lu %10lu %10lu\r\n", stat.name, (unsigned long)stat.count,
+                     (unsigned long)(stat.count ? HighResTimer_CyclesToNs((uint32_t)(stat.total_cycles / stat.count)) : 0U),
+                     (unsigned long)(stat.count ? HighResTimer_CyclesToNs(stat.min_cycles) : 0U),
+                     (unsigned long)HighResTimer_CyclesToNs(stat.max_cycles));
+    }
+}
+
+static uint32_t stats_update(void)
+{
+    sd_io_stats_t io;
+    recorder_stats_t rec;
+    uart_drv_stats_t uart;
+    touch_service_stats_t touch;
+    i2c_bus_stats_t i2c;
+#if USBD_DEFER_TO_TASK
+    USBD_EventStatsTypeDef usb;
+#endif
+    TickType_t now = xTaskGetTickCount();
+    uint16_t ext_used;
+
+    if (stats_buf == NULL) {
+        stats_buf = diag_alloc(DIAG_STATS_MAX);
+        if (stats_buf == NULL) {
+            return 0;
+        }
+    }
+    stats_len = 0;
+    ext_used = my_mem_perused(SRAMEX);
+    sd_io_get_stats(&io);
+    recorder_get_stats(&rec);
+
+    stats_printf("uptime        %lu.%03lu s\r\n",
+                 (unsigned long)(now / configTICK_RATE_HZ),
+                 (unsigned long)((now % configTICK_RATE_HZ) * 1000U / configTICK_RATE_HZ));
+    stats_printf("rtos heap     %lu / %lu B free, min %lu B\r\n",
+                 (unsigned long)xPortGetFreeHeapSize(), (unsigned long)configTOTAL_HEAP_SIZE,
+                 (unsigned long)xPortGetMinimumEverFreeHeapSize());
+    stats_printf("ext sram      %u.%u %% used\r\n", ext_used / 10U, ext_used % 10U);
+    stats_printf("sd volume     %s, %s\r\n", owner_name(sd_owner_get()),
+                 sd_owner_mounted() ? "mounted" : "not mounted");
+    stats_printf("sd_io         ui %lu req (max %lu us), normal %lu req (max %lu us), background %lu req (max %lu us)\r\n",
+                 (unsigned long)io.requests[SD_IO_PRIO_UI], (unsigned long)io.max_wait_us[SD_IO_PRIO_UI],
+                 (unsigned long)io.requests[SD_IO_PRIO_NORMAL], (unsigned long)io.max_wait_us[SD_IO_PRIO_NORMAL],
+                 (unsigned long)io.requests[SD_IO_PRIO_BACKGROUND], (unsigned long)io.max_wait_us[SD_IO_PRIO_BACKGROUND]);
+    stats_printf("              %lu chunks, %lu merged, %lu errors\r\n",
+                 (unsigned long)io.chunks, (unsigned long)io.merged, (unsigned long)io.errors);
+    stats_printf("recorder      %lu records, %lu dropped, %lu blocks, %lu held, %lu errors\r\n",
+                 (unsigned long)rec.records_written, (unsigned long)rec.records_dropped,
+                 (unsigned long)rec.blocks_written, (unsigned long)rec.blocks_held,
+                 (unsigned long)rec.write_errors);
+    stats_printf("              ring high water %lu, max write %lu us\r\n",
+                 (unsigned long)rec.ring_high_water, (unsigned long)rec.max_write_us);
+    uart_drv_get_stats(UART_PORT_CONSOLE, &uart);
+    stats_printf("uart tx       %lu written, %lu sent, %lu dropped, %lu waits, high water %lu, %lu dma errors\r\n",
+                 (unsigned long)uart.tx_written, (unsigned long)uart.tx_sent, (unsigned long)uart.tx_dropped,
+                 (unsigned long)uart.tx_blocked, (unsigned long)uart.tx_high_water, (unsigned long)uart.tx_dma_errors);
+    stats_printf("uart rx       %lu received, %lu overflows (%lu B lost), high water %lu, %lu line errors, %lu dma errors\r\n",
+                 (unsigned long)uart.rx_received, (unsigned long)uart.rx_overflows, (unsigned long)uart.rx_lost,
+                 (unsigned long)uart.rx_high_water, (unsigned long)uart.rx_line_errors,
+                 (unsigned long)uart.rx_dma_errors);
+    stats_printf("              %lu irqs, %lu cycles/KB, %lu baud\r\n",
+                 (unsigned long)uart.rx_events,
+                 (unsigned long)(uart.rx_received != 0U ? uart.rx_isr_cycles * 1024U / uart.rx_received : 0U),
+                 (unsigned long)uart.baud);
+    touch_service_get_stats(&touch);
+    stats_printf("touch         %s, %lu irqs, %lu reads, %lu samples (%lu dropped), latency avg %lu us, max %lu us\r\n",
+                 touch.irq_mode ? "irq" : "poll", (unsigned long)touch.irqs, (unsigned long)touch.reads,
+                 (unsigned long)touch.samples, (unsigned long)touch.dropped,
+                 (unsigned long)touch.latency_avg_us, (unsigned long)touch.latency_max_us);
+    i2c_bus_get_stats(&i2c);
+    stats_printf("i2c           %lu transfers (%lu dma, %lu B), %lu errors, %lu timeouts, %lu busy, %lu resets\r\n",
+                 (unsigned long)i2c.transfers, (unsigned long)i2c.dma_transfers, (unsigned long)i2c.bytes,
+                 (unsigned long)i2c.errors, (unsigned long)i2c.timeouts, (unsigned long)i2c.lock_timeouts,
+                 (unsigned long)i2c.resets);
+    stats_printf("              max wait %lu us, max transfer %lu us\r\n",
+                 (unsigned long)i2c.lock_wait_max_us, (unsigned long)i2c.xfer_max_us);
+#if USBD_DEFER_TO_TASK
+    USBD_LL_GetEventStats(&usb);
+    stats_printf("usb events    %lu, queue high water %u, %lu dropped\r\n",
+                 (unsigned long)usb.events, (unsigned)usb.high_water, (unsigned long)usb.overflows);
+#endif
+    stats_tasks();
+    stats_timing();
+    return stats_len;
+}
+
+static void stats_read(uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    memcpy(buf, &stats_buf[offset], len);
+}
+
+/* ---------------- heap.bin ---------------- */
+
+static uint32_t heap_update(void)
+{
+    heap_header.magic = DIAG_HEAP_MAGIC;
+    heap_header.version = DIAG_HEAP_VERSION;
+    heap_header.header_size = sizeof(diag_heap_header_t);
+    heap_header.rtos_heap_size = configTOTAL_HEAP_SIZE;
+    heap_header.rtos_heap_free = xPortGetFreeHeapSize();
+    heap_header.rtos_heap_min = xPortGetMinimumEverFreeHeapSize();
+    heap_header.pool_base = (uint32_t)mallco_dev.membase[SRAMEX];
+    heap_header.block_size = MEM3_BLOCK_SIZE;
+    heap_header.table_entries = MEM3_ALLOC_TABLE_SIZE;
+    heap_header.table_entry_size = sizeof(MT_TYPE);
+    return mallco_dev.memrdy[SRAMEX] ? sizeof(diag_heap_header_t) + DIAG_HEAP_TABLE_BYTES
+                                     : sizeof(diag_heap_header_t);
+}
+
+static void heap_read(uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    uint32_t n;
+
+    if (offset < sizeof(diag_heap_header_t)) {
+        n = sizeof(diag_heap_header_t) - offset;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(buf, (const uint8_t *)&heap_header + offset, n);
+        buf += n;
+        offset += n;
+        len -= n;
+    }
+    if (len > 0U) {
+        memcpy(buf, (const uint8_t *)mallco_dev.memmap[SRAMEX] + (offset - sizeof(diag_heap_header_t)), len);
+    }
+}
+
+/* ---------------- log.txt ---------------- */
+
+#if LOG_HISTORY_SIZE > 0
+static uint32_t log_update(void)
+{
+    if (log_buf == NULL) {
+        log_buf = diag_alloc(LOG_HISTORY_SIZE);
+        if (log_buf == NULL) {
+            return 0;
+        }
+    }
+    return (uint32_t)log_history_copy(log_buf, LOG_HISTORY_SIZE);
+}
+
+static void log_read(uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    memcpy(buf, &log_buf[offset], len);
+}
+#endif
+
+/* ---------------- trace.bin ---------------- */
+
+#if RTOS_TRACE_ENABLE
+static uint32_t trace_update(void)
+{
+    uint32_t size;
+
+    if (trace_buf == NULL) {
+        trace_buf = diag_alloc(RTOS_TRACE_MAX_SIZE);
+        if (trace_buf == NULL) {
+            return 0;
+        }
+    }
+    /* 复制出来，记录只在复制期间暂停 */
+    size = rtos_trace_freeze();
+    rtos_trace_read(0, trace_buf, size);
+    rtos_trace_thaw();
+    return size;
+}
+
+static void trace_read(uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    memcpy(buf, &trace_buf[offset], len);
+}
+#endif
+
+static const diag_file_t diag_stats_file = {
+    "stats.txt", DIAG_STATS_MAX, stats_update, stats_read
+};
+
+static const diag_file_t diag_heap_file = {
+    "heap.bin", sizeof(diag_heap_header_t) + DIAG_HEAP_TABLE_BYTES, heap_update, heap_read
+};
+
+#if LOG_HISTORY_SIZE > 0
+static const diag_file_t diag_log_file = {
+#if LOG_TOKENIZED
+    "log.bin", LOG_HISTORY_SIZE, log_update, log_read
+#else
+    "log.txt", LOG_HISTORY_SIZE, log_update, log_read
+#endif
+};
+#endif
+
+#if RTOS_TRACE_ENABLE
+static const diag_file_t diag_trace_file = {
+    "trace.bin", RTOS_TRACE_MAX_SIZE, trace_update, trace_read
+};
+#endif
+
+void diag_files_init(void)
+{
+    diag_disk_register(&diag_stats_file);
+    diag_disk_register(&diag_heap_file);
+#if LOG_HISTORY_SIZE > 0
+    diag_disk_register(&diag_log_file);
+#endif
+#if RTOS_TRACE_ENABLE
+    diag_disk_register(&diag_trace_file);
+#endif
+}
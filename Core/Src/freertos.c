@@ -26,7 +26,9 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
-
+#include "usbd_storage_if.h"
+#include "usb_selftest.h"
+#include "diag_files.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -114,6 +116,11 @@ void StartDefaultTask(void *argument)
   /* init code for USB_DEVICE */
   MX_USB_DEVICE_Init();
   /* USER CODE BEGIN StartDefaultTask */
+  diag_files_init();
+  STORAGE_Start_FS();
+#if USB_SELFTEST_ENABLE
+  usb_selftest_start();
+#endif
   /* Infinite loop */
   for(;;)
   {
@@ -1,17 +1,43 @@
 /**
  * @file high_res_timer.c
- * @brief 高精度定时器实现，提供毫秒级时间戳
+ * @brief 高精度时间基准实现
+ *
+ * TIM2 以 1MHz 计数，溢出（约 71 分钟一次）中断里累加高 32 位，得到不回绕的 64 位微秒时钟；
+ * DWT CYCCNT 按内核时钟计数，用于测量短代码段。
  */
 
 #include "high_res_timer.h"
 #include "stm32f4xx_hal.h"
 
+/* TIM2 溢出中断优先级（只累加计数，不调用 FreeRTOS 接口） */
+#define HIGH_RES_TIMER_IRQ_PRIO     0U
+
 /* 定时器句柄 */
 TIM_HandleTypeDef htim;
 
+/* 微秒时钟的高 32 位，TIM2 溢出中断中累加 */
+static volatile uint32_t us_high;
+
+/* 已注册的统计项链表 */
+static time_stat_t *stat_list;
+
+/**
+ * @brief TIM2 的输入时钟（APB1 分频不为 1 时为 PCLK1 的 2 倍）
+ */
+static uint32_t HighResTimer_ClockHz(void)
+{
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+
+    if ((RCC->CFGR & RCC_CFGR_PPRE1) != RCC_HCLK_DIV1)
+    {
+        pclk1 *= 2U;
+    }
+    return pclk1;
+}
+
 /**
  * @brief 初始化高精度定时器
- * @note 使用TIM2，配置为1ms精度
+ * @note 使用TIM2，1MHz 计数，并打开 DWT 周期计数器
  */
 void HighResTimer_Init(void)
 {
@@ -20,7 +46,7 @@ void HighResTimer_Init(void)
 
     /* 定时器配置 */
     htim.Instance = TIM2;
-    htim.Init.Prescaler = (SystemCoreClock / 1000000) - 1;  // 1MHz计数频率
+    htim.Init.Prescaler = (HighResTimer_ClockHz() / 1000000) - 1;  // 1MHz计数频率（TIM2 挂在 APB1 上，不是 SystemCoreClock）
     htim.Init.CounterMode = TIM_COUNTERMODE_UP;
     htim.Init.Period = 0xFFFFFFFF;  // 最大周期，32位定时器
     htim.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
@@ -31,29 +57,158 @@ void HighResTimer_Init(void)
         Error_Handler();
     }
 
+    /* 初始化时写 UG 置起的更新标志不算溢出 */
+    __HAL_TIM_CLEAR_FLAG(&htim, TIM_FLAG_UPDATE);
+    us_high = 0;
+    HAL_NVIC_SetPriority(TIM2_IRQn, HIGH_RES_TIMER_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(TIM2_IRQn);
+
     /* 启动定时器 */
-    if (HAL_TIM_Base_Start(&htim) != HAL_OK)
+    if (HAL_TIM_Base_Start_IT(&htim) != HAL_OK)
     {
         Error_Handler();
     }
+
+    /* DWT 周期计数器 */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief TIM2 中断：计数溢出时累加高 32 位（不经过 HAL，HAL_TIM_PeriodElapsedCallback 留给 HAL 时基）
+ */
+void HighResTimer_IRQHandler(void)
+{
+    if ((TIM2->SR & TIM_SR_UIF) != 0U)
+    {
+        TIM2->SR = ~TIM_SR_UIF;
+        us_high++;
+    }
 }
 
 /**
  * @brief 获取高精度毫秒时间戳
- * @return 当前毫秒时间戳
+ * @return 上电以来的毫秒数（约 49 天回绕）
  */
 uint32_t HighResTimer_GetMs(void)
 {
-    /* 获取定时器计数值，转换为毫秒 */
-    return __HAL_TIM_GET_COUNTER(&htim) / 1000;
+    return (uint32_t)(HighResTimer_GetUs64() / 1000U);
 }
 
 /**
  * @brief 获取高精度微秒时间戳
- * @return 当前微秒时间戳
+ * @return 当前微秒时间戳（32 位，约 71 分钟回绕，适合求差）
  */
 uint32_t HighResTimer_GetUs(void)
 {
     /* 获取定时器计数值，转换为微秒 */
     return __HAL_TIM_GET_COUNTER(&htim);
 }
+
+/**
+ * @brief 获取64位微秒时间戳，任何上下文都可调用
+ * @return 上电以来的微秒数
+ */
+uint64_t HighResTimer_GetUs64(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t high;
+    uint32_t now;
+
+    __disable_irq();
+    high = us_high;
+    now = TIM2->CNT;
+    /* 已经溢出但中断还没处理（关中断期间或调用者优先级更高）：重读计数，刚回绕的值属于下一轮 */
+    if ((TIM2->SR & TIM_SR_UIF) != 0U)
+    {
+        now = TIM2->CNT;
+        if (now < 0x80000000U)
+        {
+            high++;
+        }
+    }
+    __set_PRIMASK(primask);
+    return ((uint64_t)high << 32) | now;
+}
+
+/**
+ * @brief 周期数换算成纳秒
+ */
+uint32_t HighResTimer_CyclesToNs(uint32_t cycles)
+{
+    return (uint32_t)(((uint64_t)cycles * 1000000000U) / SystemCoreClock);
+}
+
+/**
+ * @brief 记录一次耗时，第一次使用时把统计项加入链表
+ * @param stat 统计项
+ * @param cycles 耗时（内核时钟周期）
+ */
+void TimeStat_Add(time_stat_t *stat, uint32_t cycles)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (!stat->registered)
+    {
+        stat->registered = 1;
+        stat->min_cycles = UINT32_MAX;
+        stat->next = stat_list;
+        stat_list = stat;
+    }
+    stat->count++;
+    stat->total_cycles += cycles;
+    if (cycles < stat->min_cycles)
+    {
+        stat->min_cycles = cycles;
+    }
+    if (cycles > stat->max_cycles)
+    {
+        stat->max_cycles = cycles;
+    }
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 获取统计项快照
+ * @param index 序号（按第一次使用的先后倒序）
+ * @param out 快照
+ * @retval 1 成功；0 没有这一项
+ */
+uint8_t TimeStat_Get(uint32_t index, time_stat_t *out)
+{
+    uint32_t primask = __get_PRIMASK();
+    time_stat_t *stat;
+
+    __disable_irq();
+    for (stat = stat_list; stat != NULL && index > 0U; stat = stat->next)
+    {
+        index--;
+    }
+    if (stat != NULL)
+    {
+        *out = *stat;
+    }
+    __set_PRIMASK(primask);
+    return stat != NULL;
+}
+
+/**
+ * @brief 清零所有统计项（保留注册）
+ */
+void TimeStat_ResetAll(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    time_stat_t *stat;
+
+    __disable_irq();
+    for (stat = stat_list; stat != NULL; stat = stat->next)
+    {
+        stat->count = 0;
+        stat->total_cycles = 0;
+        stat->min_cycles = UINT32_MAX;
+        stat->max_cycles = 0;
+    }
+    __set_PRIMASK(primask);
+}
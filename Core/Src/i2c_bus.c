@@ -0,0 +1,276 @@
+/**
+ * @file i2c_bus.c
+ * @brief I2C1 总线驱动实现
+ *
+ * 同一时刻只有持有互斥量的任务在传输，完成信号量只有它在等；
+ * 超时后迟到的完成中断可能多给一次信号量，下一个事务开始前先清掉。
+ */
+
+#include "i2c_bus.h"
+#include "i2c.h"
+#define LOG_MODULE LOG_MOD_I2C
+#include "log.h"
+#include "high_res_timer.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include <stdbool.h>
+
+/* 总线卡死恢复用的引脚（与 i2c.c 中 I2C1 的引脚一致） */
+#define I2C_BUS_SCL_PORT        GPIOB
+#define I2C_BUS_SCL_PIN         GPIO_PIN_8
+#define I2C_BUS_SDA_PORT        GPIOB
+#define I2C_BUS_SDA_PIN         GPIO_PIN_9
+
+/* 器件应答探测的单次超时（毫秒） */
+#define I2C_BUS_PROBE_MS        2U
+
+static StaticSemaphore_t i2c_bus_mutex_buf;
+static SemaphoreHandle_t i2c_bus_mutex;
+static StaticSemaphore_t i2c_bus_done_buf;
+static SemaphoreHandle_t i2c_bus_done;
+
+static volatile int i2c_bus_result;     /* 完成中断写入：0 成功；-1 错误 */
+static i2c_bus_stats_t i2c_stats;
+
+static bool i2c_bus_rtos(void)
+{
+    return xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+}
+
+static void i2c_bus_delay_us(uint32_t us)
+{
+    uint32_t start = HighResTimer_GetUs();
+
+    while (HighResTimer_GetUs() - start < us) {
+    }
+}
+
+/**
+ * @brief 外设复位；从机拉住 SDA 时先用 GPIO 补发最多 9 个时钟让它释放总线
+ */
+static void i2c_bus_reset(void)
+{
+    GPIO_InitTypeDef gpio_init_struct = {0};
+    uint32_t i;
+
+    (void)HAL_I2C_DeInit(&hi2c1);
+
+    gpio_init_struct.Pin = I2C_BUS_SCL_PIN;
+    gpio_init_struct.Mode = GPIO_MODE_OUTPUT_OD;
+    gpio_init_struct.Pull = GPIO_PULLUP;
+    gpio_init_struct.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_WritePin(I2C_BUS_SCL_PORT, I2C_BUS_SCL_PIN, GPIO_PIN_SET);
+    HAL_GPIO_Init(I2C_BUS_SCL_PORT, &gpio_init_struct);
+    gpio_init_struct.Pin = I2C_BUS_SDA_PIN;
+    gpio_init_struct.Mode = GPIO_MODE_INPUT;
+    HAL_GPIO_Init(I2C_BUS_SDA_PORT, &gpio_init_struct);
+
+    for (i = 0; i < 9U && HAL_GPIO_ReadPin(I2C_BUS_SDA_PORT, I2C_BUS_SDA_PIN) == GPIO_PIN_RESET; i++) {
+        HAL_GPIO_WritePin(I2C_BUS_SCL_PORT, I2C_BUS_SCL_PIN, GPIO_PIN_RESET);
+        i2c_bus_delay_us(5);
+        HAL_GPIO_WritePin(I2C_BUS_SCL_PORT, I2C_BUS_SCL_PIN, GPIO_PIN_SET);
+        i2c_bus_delay_us(5);
+    }
+    HAL_GPIO_DeInit(I2C_BUS_SCL_PORT, I2C_BUS_SCL_PIN);
+    HAL_GPIO_DeInit(I2C_BUS_SDA_PORT, I2C_BUS_SDA_PIN);
+
+    /* 软件复位清掉 BUSY 标志，再按 CubeMX 配置重新初始化（MspInit 重新配置引脚和 DMA） */
+    __HAL_RCC_I2C1_FORCE_RESET();
+    __HAL_RCC_I2C1_RELEASE_RESET();
+    if (HAL_I2C_Init(&hi2c1) != HAL_OK) {
+        LOG_ERROR("i2c: reinit failed");
+    }
+    i2c_stats.resets++;
+}
+
+/**
+ * @brief 取得总线
+ * @retval 0 成功；-1 超时
+ */
+static int i2c_bus_lock(void)
+{
+    uint32_t start = HighResTimer_GetUs();
+    uint32_t wait;
+
+    if (xSemaphoreTake(i2c_bus_mutex, pdMS_TO_TICKS(I2C_BUS_LOCK_MS)) != pdTRUE) {
+        i2c_stats.lock_timeouts++;
+        return -1;
+    }
+    wait = HighResTimer_GetUs() - start;
+    if (wait > i2c_stats.lock_wait_max_us) {
+        i2c_stats.lock_wait_max_us = wait;
+    }
+    return 0;
+}
+
+static void i2c_bus_unlock(void)
+{
+    (void)xSemaphoreGive(i2c_bus_mutex);
+}
+
+/**
+ * @brief 一次寄存器读写：调度器运行时用 DMA/中断并阻塞等待，否则 HAL 轮询
+ */
+static int i2c_bus_xfer(bool is_read, uint16_t dev_addr, uint16_t reg, uint16_t reg_size,
+                        uint8_t *buf, uint16_t len, uint32_t timeout_ms)
+{
+    bool use_dma = (len >= I2C_BUS_DMA_MIN);
+    uint16_t mem_size = (reg_size == I2C_BUS_REG_16BIT) ? I2C_MEMADD_SIZE_16BIT : I2C_MEMADD_SIZE_8BIT;
+    HAL_StatusTypeDef status;
+    uint32_t start;
+    uint32_t elapsed;
+    int ret = 0;
+
+    if (len == 0U) {
+        return 0;
+    }
+
+    if (!i2c_bus_rtos()) {
+        if (is_read) {
+            status = HAL_I2C_Mem_Read(&hi2c1, dev_addr, reg, mem_size, buf, len, timeout_ms);
+        } else {
+            status = HAL_I2C_Mem_Write(&hi2c1, dev_addr, reg, mem_size, buf, len, timeout_ms);
+        }
+        if (status == HAL_OK) {
+            i2c_stats.transfers++;
+            i2c_stats.bytes += len;
+            return 0;
+        }
+        i2c_stats.errors++;
+        if (status == HAL_TIMEOUT || status == HAL_BUSY) {
+            i2c_bus_reset();
+        }
+        return -1;
+    }
+
+    if (i2c_bus_lock() != 0) {
+        return -1;
+    }
+    (void)xSemaphoreTake(i2c_bus_done, 0);
+    i2c_bus_result = 0;
+    start = HighResTimer_GetUs();
+
+    if (is_read) {
+        status = use_dma ? HAL_I2C_Mem_Read_DMA(&hi2c1, dev_addr, reg, mem_size, buf, len)
+                         : HAL_I2C_Mem_Read_IT(&hi2c1, dev_addr, reg, mem_size, buf, len);
+    } else {
+        status = use_dma ? HAL_I2C_Mem_Write_DMA(&hi2c1, dev_addr, reg, mem_size, buf, len)
+                         : HAL_I2C_Mem_Write_IT(&hi2c1, dev_addr, reg, mem_size, buf, len);
+    }
+
+    if (status != HAL_OK) {
+        /* 启动前等待 BUSY 超时：上一个从机没有释放总线 */
+        i2c_stats.errors++;
+        i2c_bus_reset();
+        ret = -1;
+    } else if (xSemaphoreTake(i2c_bus_done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        i2c_stats.timeouts++;
+        i2c_bus_reset();
+        ret = -1;
+    } else if (i2c_bus_result != 0) {
+        i2c_stats.errors++;
+        ret = -1;
+    } else {
+        i2c_stats.transfers++;
+        i2c_stats.bytes += len;
+        if (use_dma) {
+            i2c_stats.dma_transfers++;
+        }
+    }
+
+    elapsed = HighResTimer_GetUs() - start;
+    if (elapsed > i2c_stats.xfer_max_us) {
+        i2c_stats.xfer_max_us = elapsed;
+    }
+    i2c_bus_unlock();
+    return ret;
+}
+
+void i2c_bus_init(void)
+{
+    i2c_bus_mutex = xSemaphoreCreateMutexStatic(&i2c_bus_mutex_buf);
+    i2c_bus_done = xSemaphoreCreateBinaryStatic(&i2c_bus_done_buf);
+}
+
+int i2c_bus_mem_read(uint16_t dev_addr, uint16_t reg, uint16_t reg_size,
+                     uint8_t *buf, uint16_t len, uint32_t timeout_ms)
+{
+    return i2c_bus_xfer(true, dev_addr, reg, reg_size, buf, len, timeout_ms);
+}
+
+int i2c_bus_mem_write(uint16_t dev_addr, uint16_t reg, uint16_t reg_size,
+                      const uint8_t *buf, uint16_t len, uint32_t timeout_ms)
+{
+    /* HAL 接口参数不带 const，发送时不会写缓冲区 */
+    return i2c_bus_xfer(false, dev_addr, reg, reg_size, (uint8_t *)buf, len, timeout_ms);
+}
+
+int i2c_bus_wait_ready(uint16_t dev_addr, uint32_t timeout_ms)
+{
+    uint32_t start = HighResTimer_GetMs();
+    HAL_StatusTypeDef status;
+    bool rtos;
+
+    for (;;) {
+        rtos = i2c_bus_rtos();
+        if (rtos && i2c_bus_lock() != 0) {
+            return -1;
+        }
+        status = HAL_I2C_IsDeviceReady(&hi2c1, dev_addr, 1, I2C_BUS_PROBE_MS);
+        if (rtos) {
+            i2c_bus_unlock();
+        }
+        if (status == HAL_OK) {
+            return 0;
+        }
+        if (HighResTimer_GetMs() - start >= timeout_ms) {
+            i2c_stats.timeouts++;
+            return -1;
+        }
+        /* 器件忙期间让出总线和 CPU */
+        if (rtos) {
+            vTaskDelay(1);
+        } else {
+            HAL_Delay(1);
+        }
+    }
+}
+
+void i2c_bus_get_stats(i2c_bus_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = i2c_stats;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief 事务完成或出错时通知等待的任务
+ * @param result 0 成功；-1 错误
+ */
+static void i2c_bus_complete(I2C_HandleTypeDef *hi2c, int result)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (hi2c != &hi2c1 || !i2c_bus_rtos()) {
+        return;
+    }
+    i2c_bus_result = result;
+    (void)xSemaphoreGiveFromISR(i2c_bus_done, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    i2c_bus_complete(hi2c, 0);
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+    i2c_bus_complete(hi2c, 0);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+    i2c_bus_complete(hi2c, -1);
+}
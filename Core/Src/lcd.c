@@ -29,6 +29,7 @@
 #include "stdlib.h"
 #include "lcd.h"
 #include "lcdfont.h"
+#define LOG_MODULE LOG_MOD_DISPLAY
 #include "log.h"
 /* lcd_ex.c存放各个LCD驱动IC的寄存器初始化部分代码,以简化lcd.c,该.c文件
  * 不直接加入到工程里面,只有lcd.c会用到,所以通过include的形式添加.(不要在
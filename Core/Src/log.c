@@ -6,8 +6,11 @@
 #include "log.h"
 #include <stdarg.h>
 #include <string.h>
+#include <stdbool.h>
 #include "stm32f4xx_hal.h"
 #include "rtc.h"
+#include "high_res_timer.h"
+#include "uart_drv.h"
 
 /* 日志级别字符串 */
 const char LOG_LEVEL_STR[] = {
@@ -17,8 +20,54 @@ const char LOG_LEVEL_STR[] = {
     'E'
 };
 
-/* 当前日志级别，默认为INFO级别 */
-LogLevel current_log_level = LOG_LEVEL_INFO;
+/* 各模块日志级别，默认为INFO级别 */
+volatile uint8_t log_module_level[LOG_MOD_COUNT] = {
+    [0 ... LOG_MOD_COUNT - 1] = LOG_LEVEL_INFO
+};
+
+/* 模块名（log 命令使用），顺序同 LogModule */
+static const char* const log_module_name[LOG_MOD_COUNT] = {
+    "app", "display", "sd", "usb", "touch", "scene", "cpu", "i2c"
+};
+
+/* 级别名，顺序同 LogLevel */
+static const char* const log_level_name[] = {
+    "debug", "info", "warning", "error", "none"
+};
+
+/* 日志输出钩子 */
+static volatile log_sink_t log_sink;
+
+#if LOG_HISTORY_SIZE > 0
+/* 最近日志环形缓冲区，history_total 为累计写入字节数 */
+static char history[LOG_HISTORY_SIZE];
+static uint32_t history_total;
+
+/**
+ * @brief 追加到最近日志（任务与中断均可能输出日志，短暂关中断）
+ */
+static void log_history_put(const char* line, size_t len)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t pos;
+    size_t n;
+
+    if (len > LOG_HISTORY_SIZE) {
+        line += len - LOG_HISTORY_SIZE;
+        len = LOG_HISTORY_SIZE;
+    }
+    __disable_irq();
+    pos = history_total % LOG_HISTORY_SIZE;
+    n = LOG_HISTORY_SIZE - pos;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(&history[pos], line, n);
+    memcpy(history, line + n, len - n);
+    history_total += len;
+    __set_PRIMASK(primask);
+}
+#endif
 
 /**
  * @brief 设置日志级别
@@ -26,7 +75,11 @@ LogLevel current_log_level = LOG_LEVEL_INFO;
  */
 void log_set_level(LogLevel level)
 {
-    current_log_level = level;
+    uint32_t i;
+
+    for (i = 0; i < LOG_MOD_COUNT; i++) {
+        log_module_level[i] = (uint8_t)level;
+    }
 }
 
 /**
@@ -35,11 +88,183 @@ void log_set_level(LogLevel level)
  */
 LogLevel log_get_level(void)
 {
-    return current_log_level;
+    return (LogLevel)log_module_level[LOG_MOD_APP];
+}
+
+/**
+ * @brief 设置单个模块的日志级别
+ * @param module 模块
+ * @param level 日志级别
+ */
+void log_set_module_level(LogModule module, LogLevel level)
+{
+    if ((uint32_t)module < LOG_MOD_COUNT) {
+        log_module_level[module] = (uint8_t)level;
+    }
+}
+
+/**
+ * @brief 获取单个模块的日志级别
+ * @param module 模块
+ * @return 日志级别
+ */
+LogLevel log_get_module_level(LogModule module)
+{
+    if ((uint32_t)module >= LOG_MOD_COUNT) {
+        return LOG_LEVEL_NONE;
+    }
+    return (LogLevel)log_module_level[module];
+}
+
+/**
+ * @brief 按名称查找级别，可只写首字母
+ * @return 级别；-1 无此级别
+ */
+static int log_parse_level(const char* name)
+{
+    uint32_t i;
+
+    for (i = 0; i <= LOG_LEVEL_NONE; i++) {
+        if (strcmp(name, log_level_name[i]) == 0 ||
+            (name[1] == '\0' && name[0] == log_level_name[i][0])) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 处理一行日志命令
+ * @param line 一行命令（不含换行）
+ * @return 1 是日志命令；0 不是日志命令
+ */
+int log_command(const char* line)
+{
+    char buf[32];
+    char* argv[3];
+    int argc = 0;
+    char* save;
+    char* p;
+    int level;
+    uint32_t i;
+
+    strncpy(buf, line, sizeof(buf) - 1U);
+    buf[sizeof(buf) - 1U] = '\0';
+    for (p = strtok_r(buf, " \t", &save); p != NULL && argc < 3; p = strtok_r(NULL, " \t", &save)) {
+        argv[argc++] = p;
+    }
+    if (argc == 0 || strcmp(argv[0], "log") != 0) {
+        return 0;
+    }
+
+    if (argc == 1) {
+        for (i = 0; i < LOG_MOD_COUNT; i++) {
+            printf("%-8s %s\r\n", log_module_name[i], log_level_name[log_module_level[i]]);
+        }
+        printf("compiled min level: %s\r\n", log_level_name[LOG_LEVEL_MIN]);
+        return 1;
+    }
+
+    level = (argc == 3) ? log_parse_level(argv[2]) : -1;
+    if (level < 0) {
+        printf("usage: log [<module|all> <debug|info|warning|error|none>]\r\n");
+        return 1;
+    }
+    if (strcmp(argv[1], "all") == 0) {
+        log_set_level((LogLevel)level);
+        return 1;
+    }
+    for (i = 0; i < LOG_MOD_COUNT; i++) {
+        if (strcmp(argv[1], log_module_name[i]) == 0) {
+            log_set_module_level((LogModule)i, (LogLevel)level);
+            return 1;
+        }
+    }
+    printf("unknown log module: %s\r\n", argv[1]);
+    return 1;
+}
+
+/**
+ * @brief 设置日志输出钩子
+ * @param sink 输出钩子，NULL 表示只用串口
+ */
+void log_set_sink(log_sink_t sink)
+{
+    log_sink = sink;
 }
 
 /**
- * @brief 获取当前系统时间（精确到毫秒）
+ * @brief 复制最近的日志（从最早的完整一行开始）
+ * @param dst 目标缓冲区
+ * @param size 缓冲区大小
+ * @return 复制的字节数
+ */
+size_t log_history_copy(char* dst, size_t size)
+{
+#if LOG_HISTORY_SIZE > 0
+    uint32_t primask = __get_PRIMASK();
+    uint32_t total;
+    uint32_t start;
+    size_t len;
+    size_t pos;
+    size_t n;
+    size_t skip = 0;
+    bool line_start;
+
+    __disable_irq();
+    total = history_total;
+    len = (total < LOG_HISTORY_SIZE) ? total : LOG_HISTORY_SIZE;
+    if (len > size) {
+        len = size;
+    }
+    start = total - (uint32_t)len;
+    pos = start % LOG_HISTORY_SIZE;
+    n = LOG_HISTORY_SIZE - pos;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(dst, &history[pos], n);
+    memcpy(dst + n, history, len - n);
+    line_start = (start == 0U) ||
+                 (len < LOG_HISTORY_SIZE && history[(start - 1U) % LOG_HISTORY_SIZE] == '\n');
+    __set_PRIMASK(primask);
+
+    /* 开头不完整的一行丢弃（令牌化记录由解码工具按同步字节重新对齐） */
+    if (!line_start && !LOG_TOKENIZED) {
+        while (skip < len && dst[skip] != '\n') {
+            skip++;
+        }
+        if (skip < len) {
+            skip++;
+        }
+        memmove(dst, dst + skip, len - skip);
+    }
+    return len - skip;
+#else
+    (void)dst;
+    (void)size;
+    return 0;
+#endif
+}
+
+/**
+ * @brief 一条日志交给最近日志缓冲区和输出通道（钩子未处理时走串口）
+ */
+static void log_emit(const char* data, size_t len)
+{
+    log_sink_t sink = log_sink;
+
+#if LOG_HISTORY_SIZE > 0
+    log_history_put(data, len);
+#endif
+    if (sink != NULL && sink(data, len)) {
+        return;
+    }
+    uart_drv_write(UART_PORT_CONSOLE, data, (uint32_t)len);
+}
+
+/**
+ * @brief 获取 RTC 墙上时间（精确到毫秒）
  * @param time_str 存储时间字符串的缓冲区
  * @param buf_size 缓冲区大小
  */
@@ -49,6 +274,57 @@ void log_get_timestamp(char* time_str, size_t buf_size)
     RTC_GetCurrentTime(time_str, buf_size);
 }
 
+/* 上次输出锚点的微秒时间戳，UINT64_MAX 表示还没有输出过 */
+static uint64_t anchor_us = UINT64_MAX;
+
+/**
+ * @brief 距上次锚点超过 LOG_ANCHOR_INTERVAL_S 时先输出一行 RTC 墙上时间
+ * @param now 当前微秒时间戳
+ */
+static void log_anchor(uint64_t now)
+{
+    uint32_t primask = __get_PRIMASK();
+    char rtc_str[16];
+    bool due;
+
+    __disable_irq();
+    due = (anchor_us == UINT64_MAX ||
+           now - anchor_us >= (uint64_t)LOG_ANCHOR_INTERVAL_S * 1000000U);
+    if (due) {
+        anchor_us = now;
+    }
+    __set_PRIMASK(primask);
+    if (!due) {
+        return;
+    }
+
+    log_get_timestamp(rtc_str, sizeof(rtc_str));
+#if LOG_TOKENIZED
+    uint8_t rec[8 + 4 + 1 + sizeof(rtc_str)];
+    uint32_t lo = (uint32_t)now;
+    uint32_t hi = (uint32_t)(now >> 32);
+    size_t n = strnlen(rtc_str, sizeof(rtc_str));
+
+    rec[0] = LOG_TOKEN_SYNC;
+    rec[2] = (uint8_t)LOG_TOKEN_ANCHOR_ID;
+    rec[3] = (uint8_t)(LOG_TOKEN_ANCHOR_ID >> 8);
+    memcpy(&rec[4], &lo, 4);
+    memcpy(&rec[8], &hi, 4);
+    rec[12] = (uint8_t)n;
+    memcpy(&rec[13], rtc_str, n);
+    rec[1] = (uint8_t)(13U + n);
+    log_emit((const char*)rec, 13U + n);
+#else
+    char buf[48];
+    int len = snprintf(buf, sizeof(buf), "[%6lu.%06lu][T] rtc %s\r\n",
+                       (unsigned long)(now / 1000000U), (unsigned long)(now % 1000000U), rtc_str);
+
+    if (len > 0) {
+        log_emit(buf, (size_t)len < sizeof(buf) ? (size_t)len : sizeof(buf) - 1U);
+    }
+#endif
+}
+
 /**
  * @brief 输出日志
  * @param level 日志级别
@@ -58,18 +334,17 @@ void log_get_timestamp(char* time_str, size_t buf_size)
  * @param format 格式化字符串
  * @param ... 可变参数
  */
+static TIME_STAT_DEFINE(log_output_stat, "log_output");
+
 void log_output(LogLevel level, const char* file, int line, const char* func, const char* format, ...)
 {
+    TIME_SCOPE(log_output_stat);
+
     // 检查日志级别是否有效
     if (level < LOG_LEVEL_DEBUG || level > LOG_LEVEL_ERROR) {
         return;
     }
 
-    // 检查是否应该输出此级别的日志
-    if (level < current_log_level) {
-        return;
-    }
-
     // 提取文件名（去掉路径）
     const char* filename = strrchr(file, '/');
     if (filename == NULL) {
@@ -83,17 +358,118 @@ void log_output(LogLevel level, const char* file, int line, const char* func, co
         filename++; // 跳过斜杠
     }
 
-    // 构建日志前缀，包含时间戳
-    char time_str[16]; // 足够存储 HH:MM:SS.mmm 格式的时间字符串
-    log_get_timestamp(time_str, sizeof(time_str));
-    printf("[%s][%c][%s:%d][%s] ", time_str, LOG_LEVEL_STR[level], filename, line, func);
+    // 整行格式化到缓冲区，一次交给输出通道，避免多任务输出交错
+    char buf[LOG_LINE_MAX];
+    uint64_t now = HighResTimer_GetUs64();
+    int len;
+    int n;
+
+    log_anchor(now);
+    len = snprintf(buf, sizeof(buf), "[%6lu.%06lu][%c][%s:%d][%s] ",
+                   (unsigned long)(now / 1000000U), (unsigned long)(now % 1000000U),
+                   LOG_LEVEL_STR[level], filename, line, func);
+    if (len < 0) {
+        return;
+    }
+    if (len > (int)sizeof(buf) - 3) {
+        len = (int)sizeof(buf) - 3;
+    }
 
     // 处理可变参数
     va_list args;
     va_start(args, format);
-    vprintf(format, args);
+    n = vsnprintf(&buf[len], sizeof(buf) - 2 - (size_t)len, format, args);
     va_end(args);
+    if (n > 0) {
+        len += n;
+        if (len > (int)sizeof(buf) - 3) {
+            len = (int)sizeof(buf) - 3;
+        }
+    }
 
     // 添加换行符
-    printf("\r\n");
+    buf[len++] = '\r';
+    buf[len++] = '\n';
+    buf[len] = '\0';
+
+    log_emit(buf, (size_t)len);
+}
+
+#if LOG_TOKENIZED
+extern const char __log_dict_start[];
+
+/**
+ * @brief 写入一条令牌化日志
+ * @param entry .log_dict 中的字典条目
+ * @param sig 参数类型（LOG_ARG_xxx，每个参数 4 位）
+ * @param ... 参数
+ */
+void log_token(const char* entry, uint32_t sig, ...)
+{
+    uint8_t rec[LOG_TOKEN_MAX];
+    uint32_t id = (uint32_t)(entry - __log_dict_start);
+    uint64_t now = HighResTimer_GetUs64();
+    uint32_t ts = (uint32_t)now;
+    uint32_t pos = 8;
+    uint32_t v32;
+    uint64_t v64;
+    double d;
+    const char* str;
+    size_t n;
+    va_list args;
+
+    log_anchor(now);
+    rec[0] = LOG_TOKEN_SYNC;
+    rec[2] = (uint8_t)id;
+    rec[3] = (uint8_t)(id >> 8);
+    memcpy(&rec[4], &ts, 4);
+
+    va_start(args, sig);
+    for (; sig != 0U; sig >>= 4) {
+        switch (sig & 0xFU) {
+        case LOG_ARG_INT64:
+            v64 = va_arg(args, uint64_t);
+            if (pos + 8U > sizeof(rec)) {
+                goto full;
+            }
+            memcpy(&rec[pos], &v64, 8);
+            pos += 8U;
+            break;
+        case LOG_ARG_DOUBLE:
+            d = va_arg(args, double);
+            if (pos + 8U > sizeof(rec)) {
+                goto full;
+            }
+            memcpy(&rec[pos], &d, 8);
+            pos += 8U;
+            break;
+        case LOG_ARG_STRING:
+            str = va_arg(args, const char*);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            if (pos + 1U > sizeof(rec)) {
+                goto full;
+            }
+            n = strnlen(str, sizeof(rec) - pos - 1U);
+            rec[pos++] = (uint8_t)n;
+            memcpy(&rec[pos], str, n);
+            pos += n;
+            break;
+        default:
+            v32 = va_arg(args, uint32_t);
+            if (pos + 4U > sizeof(rec)) {
+                goto full;
+            }
+            memcpy(&rec[pos], &v32, 4);
+            pos += 4U;
+            break;
+        }
+    }
+full:
+    va_end(args);
+
+    rec[1] = (uint8_t)pos;
+    log_emit((const char*)rec, pos);
 }
+#endif
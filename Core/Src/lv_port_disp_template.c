@@ -14,7 +14,9 @@
 /* 导入lcd驱动头文件 */
 #include "lcd.h"
 #include "dma.h"
+#define LOG_MODULE LOG_MOD_DISPLAY
 #include "log.h"
+#include "rtos_trace.h"
 
 /*********************
  *      DEFINES
@@ -92,6 +94,7 @@ static void lcd_dma_xfer_cplt_cb(DMA_HandleTypeDef *hdma)
         g_lcd_dma_ctx.active = 0;
         /* 通知 LVGL 刷新完成 */
         if(g_lcd_dma_ctx.disp_drv) {
+            RTOS_TRACE_END(RTOS_TRACE_ID_LCD_FLUSH, 0);
             lv_disp_flush_ready(g_lcd_dma_ctx.disp_drv);
             g_lcd_dma_ctx.disp_drv = NULL;
         }
@@ -369,12 +372,15 @@ static void disp_init(void)
  */
 static void disp_flush(lv_disp_drv_t * disp_drv, const lv_area_t * area, lv_color_t * color_p)
 {
+    /* 用户值为区域行数 */
+    RTOS_TRACE_BEGIN(RTOS_TRACE_ID_LCD_FLUSH, (uint16_t)(area->y2 - area->y1 + 1));
 #if USE_DMA_LCD
     /* 异步 DMA 路径：启动传输并立即返回，完成后在回调中调用 lv_disp_flush_ready */
     lcd_draw_fast_rgb_color_dma_async(area->x1, area->y1, area->x2, area->y2, (uint16_t*)color_p, disp_drv);
     return; /* 不要在此处调用 lv_disp_flush_ready */
 #else
     lcd_draw_fast_rgb_color(area->x1,area->y1,area->x2,area->y2,(uint16_t*)color_p);
+    RTOS_TRACE_END(RTOS_TRACE_ID_LCD_FLUSH, 0);
     lv_disp_flush_ready(disp_drv);
 #endif
 }
@@ -0,0 +1,194 @@
+/**
+ * @file lv_port_fs.c
+ *
+ * LVGL 文件系统接口：SD卡（FatFs），所有文件操作通过 sd_io 调度器以 SD_IO_PRIO_UI 优先级执行，
+ * 后台日志写入繁忙时界面资源加载仍能及时得到服务。
+ */
+
+/*********************
+ *      INCLUDES
+ *********************/
+#include "lv_port_fs.h"
+#include "sd_io_sched.h"
+#include "fatfs.h"
+#include <stdio.h>
+
+/**********************
+ *      TYPEDEFS
+ **********************/
+/* 在调度任务中执行的操作参数 */
+typedef struct {
+    FIL *fp;
+    const char *path;
+    BYTE mode;
+    void *buf;
+    UINT len;
+    UINT done;
+    FSIZE_t pos;
+} fs_op_t;
+
+/**********************
+ *  STATIC PROTOTYPES
+ **********************/
+static void * fs_open(lv_fs_drv_t * drv, const char * path, lv_fs_mode_t mode);
+static lv_fs_res_t fs_close(lv_fs_drv_t * drv, void * file_p);
+static lv_fs_res_t fs_read(lv_fs_drv_t * drv, void * file_p, void * buf, uint32_t btr, uint32_t * br);
+static lv_fs_res_t fs_write(lv_fs_drv_t * drv, void * file_p, const void * buf, uint32_t btw, uint32_t * bw);
+static lv_fs_res_t fs_seek(lv_fs_drv_t * drv, void * file_p, uint32_t pos, lv_fs_whence_t whence);
+static lv_fs_res_t fs_tell(lv_fs_drv_t * drv, void * file_p, uint32_t * pos_p);
+
+/**********************
+ *  STATIC VARIABLES
+ **********************/
+static lv_fs_drv_t fs_drv;
+
+/**********************
+ *   GLOBAL FUNCTIONS
+ **********************/
+
+void lv_port_fs_init(void)
+{
+    lv_fs_drv_init(&fs_drv);
+
+    fs_drv.letter = LV_PORT_FS_LETTER;
+    fs_drv.open_cb = fs_open;
+    fs_drv.close_cb = fs_close;
+    fs_drv.read_cb = fs_read;
+    fs_drv.write_cb = fs_write;
+    fs_drv.seek_cb = fs_seek;
+    fs_drv.tell_cb = fs_tell;
+
+    lv_fs_drv_register(&fs_drv);
+}
+
+/**********************
+ *   STATIC FUNCTIONS
+ **********************/
+
+static lv_fs_res_t fs_res(int res)
+{
+    return (res == FR_OK) ? LV_FS_RES_OK : LV_FS_RES_UNKNOWN;
+}
+
+static int op_open(void * arg)
+{
+    fs_op_t * op = arg;
+    char full[64];
+
+    /* LVGL 传入的路径不含盘符，加上 FatFs 卷号 */
+    snprintf(full, sizeof(full), "%s%s", SDPath, (op->path[0] == '/') ? op->path + 1 : op->path);
+    return f_open(op->fp, full, op->mode);
+}
+
+static int op_close(void * arg)
+{
+    return f_close(((fs_op_t *)arg)->fp);
+}
+
+static int op_read(void * arg)
+{
+    fs_op_t * op = arg;
+    return f_read(op->fp, op->buf, op->len, &op->done);
+}
+
+static int op_write(void * arg)
+{
+    fs_op_t * op = arg;
+    return f_write(op->fp, op->buf, op->len, &op->done);
+}
+
+static int op_seek(void * arg)
+{
+    fs_op_t * op = arg;
+    return f_lseek(op->fp, op->pos);
+}
+
+static void * fs_open(lv_fs_drv_t * drv, const char * path, lv_fs_mode_t mode)
+{
+    fs_op_t op = {0};
+    LV_UNUSED(drv);
+
+    op.fp = lv_mem_alloc(sizeof(FIL));
+    if(op.fp == NULL) return NULL;
+
+    op.path = path;
+    if(mode == LV_FS_MODE_WR) op.mode = FA_WRITE | FA_OPEN_ALWAYS;
+    else if(mode == LV_FS_MODE_RD) op.mode = FA_READ;
+    else op.mode = FA_READ | FA_WRITE | FA_OPEN_ALWAYS;
+
+    if(sd_io_call(SD_IO_PRIO_UI, op_open, &op) != FR_OK) {
+        lv_mem_free(op.fp);
+        return NULL;
+    }
+    return op.fp;
+}
+
+static lv_fs_res_t fs_close(lv_fs_drv_t * drv, void * file_p)
+{
+    fs_op_t op = {0};
+    int res;
+    LV_UNUSED(drv);
+
+    op.fp = file_p;
+    res = sd_io_call(SD_IO_PRIO_UI, op_close, &op);
+    lv_mem_free(file_p);
+    return fs_res(res);
+}
+
+static lv_fs_res_t fs_read(lv_fs_drv_t * drv, void * file_p, void * buf, uint32_t btr, uint32_t * br)
+{
+    fs_op_t op = {0};
+    int res;
+    LV_UNUSED(drv);
+
+    op.fp = file_p;
+    op.buf = buf;
+    op.len = btr;
+    res = sd_io_call(SD_IO_PRIO_UI, op_read, &op);
+    if(br != NULL) *br = op.done;
+    return fs_res(res);
+}
+
+static lv_fs_res_t fs_write(lv_fs_drv_t * drv, void * file_p, const void * buf, uint32_t btw, uint32_t * bw)
+{
+    fs_op_t op = {0};
+    int res;
+    LV_UNUSED(drv);
+
+    op.fp = file_p;
+    op.buf = (void *)buf;
+    op.len = btw;
+    res = sd_io_call(SD_IO_PRIO_UI, op_write, &op);
+    if(bw != NULL) *bw = op.done;
+    return fs_res(res);
+}
+
+static lv_fs_res_t fs_seek(lv_fs_drv_t * drv, void * file_p, uint32_t pos, lv_fs_whence_t whence)
+{
+    fs_op_t op = {0};
+    FIL * fp = file_p;
+    LV_UNUSED(drv);
+
+    op.fp = fp;
+    switch(whence) {
+        case LV_FS_SEEK_SET:
+            op.pos = pos;
+            break;
+        case LV_FS_SEEK_CUR:
+            op.pos = f_tell(fp) + pos;
+            break;
+        case LV_FS_SEEK_END:
+            op.pos = f_size(fp) + pos;
+            break;
+        default:
+            return LV_FS_RES_INV_PARAM;
+    }
+    return fs_res(sd_io_call(SD_IO_PRIO_UI, op_seek, &op));
+}
+
+static lv_fs_res_t fs_tell(lv_fs_drv_t * drv, void * file_p, uint32_t * pos_p)
+{
+    LV_UNUSED(drv);
+    *pos_p = f_tell((FIL *)file_p);
+    return LV_FS_RES_OK;
+}
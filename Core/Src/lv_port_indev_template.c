@@ -14,6 +14,7 @@
 
 /* 导入驱动头文件 */
 #include "touch.h"
+#include "touch_service.h"
 #include "lcd.h"
 // #include "./BSP/KEY/key.h"
 
@@ -32,8 +33,6 @@
 /* 触摸屏 */
 static void touchpad_init(void);
 static void touchpad_read(lv_indev_drv_t * indev_drv, lv_indev_data_t * data);
-static bool touchpad_is_pressed(void);
-static void touchpad_get_xy(lv_coord_t * x, lv_coord_t * y);
 
 /* 鼠标 */
 //static void mouse_init(void);
@@ -189,6 +188,20 @@ void lv_port_indev_init(void)
 //    lv_indev_set_button_points(indev_button, btn_points);
 }
 
+/**
+ * @brief       有新的触摸样本时让读取定时器在本次 lv_timer_handler 中运行，
+ *              不必等满 LV_INDEV_DEF_READ_PERIOD（LVGL 任务在 lv_timer_handler 之前调用）
+ * @param       无
+ * @retval      无
+ */
+void lv_port_indev_poll(void)
+{
+    if (indev_touchpad != NULL && touch_service_pending() != 0U)
+    {
+        lv_timer_ready(indev_touchpad->driver->read_timer);
+    }
+}
+
 /**********************
  *   STATIC FUNCTIONS
  **********************/
@@ -206,10 +219,13 @@ static void touchpad_init(void)
 {
     /*Your code comes here*/
     tp_dev.init();
+    touch_service_init();   /* 在独立任务中读取触摸芯片 */
 }
 
 /**
  * @brief       图形库的触摸屏读取回调函数
+ *   @note      每次取采集服务队列中的一个样本，队列中还有样本时让 LVGL 接着读，
+ *              一个读取周期内的按下和松开都会被处理
  * @param       indev_drv   : 触摸屏设备
  *   @arg       data        : 输入设备数据结构体
  * @retval      无
@@ -218,54 +234,26 @@ static void touchpad_read(lv_indev_drv_t * indev_drv, lv_indev_data_t * data)
 {
     static lv_coord_t last_x = 0;
     static lv_coord_t last_y = 0;
+    static bool pressed = false;
+    touch_sample_t sample;
 
-    /* 保存按下的坐标和状态 */
-    if(touchpad_is_pressed())
-    {
-        touchpad_get_xy(&last_x, &last_y);
-        data->state = LV_INDEV_STATE_PR;
-    } 
-    else
+    (void)indev_drv;
+
+    if (touch_service_get(&sample))
     {
-        data->state = LV_INDEV_STATE_REL;
+        pressed = sample.pressed;
+        last_x = (lv_coord_t)sample.x;
+        last_y = (lv_coord_t)sample.y;
+        data->continue_reading = (touch_service_pending() != 0U);
     }
 
+    data->state = pressed ? LV_INDEV_STATE_PR : LV_INDEV_STATE_REL;
+
     /* 设置最后按下的坐标 */
     data->point.x = last_x;
     data->point.y = last_y;
 }
 
-/**
- * @brief       获取触摸屏设备的状态
- * @param       无
- * @retval      返回触摸屏设备是否被按下
- */
-static bool touchpad_is_pressed(void)
-{
-    /*Your code comes here*/
-    tp_dev.scan(0);
-
-    if (tp_dev.sta & TP_PRES_DOWN)
-    {
-        return true;
-    }
-
-    return false;
-}
-
-/**
- * @brief       在触摸屏被按下的时候读取 x、y 坐标
- * @param       x   : x坐标的指针
- *   @arg       y   : y坐标的指针
- * @retval      无
- */
-static void touchpad_get_xy(lv_coord_t * x, lv_coord_t * y)
-{
-    /*Your code comes here*/
-    (*x) = tp_dev.x[0];
-    (*y) = tp_dev.y[0];
-}
-
 /*------------------
  * 鼠标
  * -----------------*/
@@ -25,9 +25,13 @@
 #include "lvgl.h"
 #include "lv_port_disp_template.h"
 #include "lv_port_indev_template.h"
+#include "lv_port_fs.h"
 #include "gui_guider.h"
 #include "scene_manager.h"
 #include "cyclic_pager.h"
+#include "high_res_timer.h"
+#include "rtos_trace.h"
+#include "cpu_load.h"
 
 lv_ui guider_ui;
 
@@ -418,6 +422,7 @@ void lvgl_demo(void)
     lv_init();            /* lvgl系统初始化 */
     lv_port_disp_init();  /* lvgl显示接口初始化,放在lv_init()的后面 */
     lv_port_indev_init(); /* lvgl输入接口初始化,放在lv_init()的后面 */
+    lv_port_fs_init();    /* lvgl文件系统接口初始化(SD卡, 盘符S) */
 
     xTaskCreate((TaskFunction_t)start_task,          /* 任务函数 */
                 (const char *)"start_task",          /* 任务名称 */
@@ -466,11 +471,63 @@ void lvgl_demo_entry(void)
     /* 通过手势左右滑动切换，无需按钮。触摸驱动需正确上报 LV_EVENT_GESTURE 与方向。 */
 }
 
+/* CPU 占用浮层：顶层左上角，显示总占用和占用最多的几个任务 */
+#define CPU_OVERLAY_TASKS 4
+
+static lv_obj_t *cpu_overlay;
+
+static void cpu_overlay_update(lv_timer_t *timer)
+{
+    char text[128];
+    int len;
+    uint32_t i;
+    uint32_t shown = 0;
+    uint16_t avg;
+    uint16_t load;
+    cpu_load_task_t t;
+
+    (void)timer;
+    if (!cpu_load_overlay_enabled())
+    {
+        lv_obj_add_flag(cpu_overlay, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+    lv_obj_clear_flag(cpu_overlay, LV_OBJ_FLAG_HIDDEN);
+
+    load = cpu_load_total(&avg);
+    len = lv_snprintf(text, sizeof(text), "CPU %u.%u%% (avg %u.%u%%)",
+                      load / 10U, load % 10U, avg / 10U, avg % 10U);
+    for (i = 0; shown < CPU_OVERLAY_TASKS && cpu_load_get(i, &t) && len < (int)sizeof(text); i++)
+    {
+        /* 空闲任务的占用已体现在总占用中 */
+        if (t.idle)
+            continue;
+        len += lv_snprintf(&text[len], sizeof(text) - len, "\n%-12.12s %3u.%u%%",
+                           t.name, t.avg / 10U, t.avg % 10U);
+        shown++;
+    }
+    lv_label_set_text(cpu_overlay, text);
+}
+
+static void cpu_overlay_create(void)
+{
+    cpu_overlay = lv_label_create(lv_layer_top());
+    lv_obj_set_style_bg_color(cpu_overlay, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(cpu_overlay, LV_OPA_50, 0);
+    lv_obj_set_style_text_color(cpu_overlay, lv_color_white(), 0);
+    lv_obj_set_style_pad_all(cpu_overlay, 3, 0);
+    lv_obj_align(cpu_overlay, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_label_set_text(cpu_overlay, "");
+    lv_timer_create(cpu_overlay_update, CPU_LOAD_PERIOD_MS, NULL);
+}
+
 /**
  * @brief       LVGL运行例程 (使用场景管理器)
  * @param       pvParameters : 传入参数(未用到)
  * @retval      无
  */
+static TIME_STAT_DEFINE(lv_handler_stat, "lv_timer_handler");
+
 void lv_demo_task(void *pvParameters)
 {
     pvParameters = pvParameters;
@@ -482,11 +539,20 @@ void lv_demo_task(void *pvParameters)
     // events_init(&guider_ui);
     // lvgl_demo_entry();
     scrollicon();
+    cpu_overlay_create();
     /* 主循环 - 优化的LVGL任务处理 */
     while (1)
     {
         /* 使用返回值优化延时 */
-        uint32_t time_till_next = lv_timer_handler();
+        uint32_t time_till_next;
+        {
+            TIME_SCOPE(lv_handler_stat);
+            RTOS_TRACE_BEGIN(RTOS_TRACE_ID_LV_TIMER, 0);
+            scene_manager_poll();  /* 串口协议等其他任务登记的场景切换 */
+            lv_port_indev_poll();  /* 有触摸样本时立即读取 */
+            time_till_next = lv_timer_handler();
+            RTOS_TRACE_END(RTOS_TRACE_ID_LV_TIMER, 0);
+        }
 
         /* 限制最大延时为5ms，防止响应延迟 */
         if (time_till_next > 5)
@@ -27,7 +27,6 @@
 #include "usart.h"
 #include "usb_device.h"
 #include "gpio.h"
-#include "uart_dma_rx.h"
 #include "fsmc.h"
 
 /* Private includes ----------------------------------------------------------*/
@@ -40,7 +39,16 @@
 #include "lvgl.h"
 #include "lvgl_demo.h"
 #include "sram.h"
-#include "uart_dma_rx.h"
+#include "uart_drv.h"
+#include "i2c_bus.h"
+#include "uart_console.h"
+#include "high_res_timer.h"
+#include "sd_fastmount.h"
+#include "sd_io_sched.h"
+#include "sd_owner.h"
+#include "recorder.h"
+#include "rtos_trace.h"
+#include "cpu_load.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -302,8 +310,19 @@ void test_sd_read_write(void)
     f_close(&SDFile);
   }
 }
+/* 启动任务：挂载SD卡，启动卷调度器与所有权任务，之后闪烁 LED。
+ * 栈静态分配（FatFs 挂载与 printf 需要较大的栈，FreeRTOS 堆放不下） */
+#define START_TASK_PRIO     (tskIDLE_PRIORITY + 1)
+#define START_BOOT_PRIO     (tskIDLE_PRIORITY + 5)  /* 挂载与快速挂载恢复期间高于 LVGL 任务，不被界面刷新拖慢 */
+#define START_STK_SIZE      1024
+static StaticTask_t start_task_tcb;
+static StackType_t start_task_stack[START_STK_SIZE];
+
 static void start_task(void *arg)
 {
+  uint32_t readyStart = HAL_GetTick();
+
+  (void)arg;
 
   LOG_INFO("Attempting to mount SD card...");
   FRESULT mountResult = f_mount(&SDFatFS, SDPath, 1);
@@ -327,17 +346,32 @@ static void start_task(void *arg)
     LOG_ERROR("Mount failed with error code: %d", mountResult);
     break;
   }
+  // 启动卷I/O调度器，之后界面、记录器与USB的SD访问都按优先级排队；
+  // 挂载失败时也启动（卡上没有文件系统时 USB 主机仍经调度器访问扇区）
+  sd_io_init(&SDFatFS);
 
   if (mountResult == FR_OK)
   {
+    // 恢复EEPROM中缓存的空闲簇数，避免 f_getfree 扫描整张FAT
+    SD_FastMount_Restore(&SDFatFS);
+  }
+  // 之后的卡信息与读写测试（记录失效时 f_getfree 要扫描整张FAT）不应压住界面，回到普通优先级
+  vTaskPrioritySet(NULL, START_TASK_PRIO);
 
+  if (mountResult == FR_OK)
+  {
     show_sdcard_info();
+    LOG_INFO("SD card ready in %lu ms", HAL_GetTick() - readyStart);
     test_sd_read_write();
+    // FAT 已落盘，保存空闲簇数供下次启动使用
+    SD_FastMount_Checkpoint(&SDFatFS);
   }
   else
   {
     LOG_ERROR("Failed to mount SD card");
   }
+  // 之后由所有权任务在固件与USB主机之间切换卷（卡上没有文件系统时也可交给主机格式化）
+  sd_owner_init(&SDFatFS, SDPath, mountResult == FR_OK);
   demo();
   test();
   while (1)
@@ -465,9 +499,16 @@ int main(void)
   MX_SDIO_SD_Init();
   MX_FATFS_Init();
   MX_FSMC_Init();
-  // MX_I2C1_Init();
+  MX_I2C1_Init();
   /* USER CODE BEGIN 2 */
+  uart_drv_init();  /* 串口 DMA 循环接收 */
+  i2c_bus_init();  /* I2C1 总线（EEPROM），400kHz + DMA */
   MX_RTC_Init();
+  HighResTimer_Init();  /* TIM2 1MHz 时间基准，记录器时间戳使用 */
+  recorder_init();  /* 记录任务，串口命令 "rec start" 开始记录 */
+#if RTOS_TRACE_ENABLE
+  rtos_trace_init(RTOS_TRACE_MODE_RING);  /* 调度跟踪，在创建任务前开始以登记任务名 */
+#endif
   // sram_init();
   log_set_level(LOG_LEVEL_DEBUG);
   // lcd_init();
@@ -484,10 +525,10 @@ int main(void)
   // lcd_show_string(10, 10, 220, 32, 32, "STM32", RED);
   // lcd_show_string(10, 47, 220, 24, 24, "Timer", RED);
   // lcd_show_string(10, 76, 220, 16, 16, "ATOM@ALIENTEK", RED);
-  // xTaskCreate(start_task, "Task1", 2048, NULL, 1, NULL);
+  xTaskCreateStatic(start_task, "Task1", START_STK_SIZE, NULL, START_BOOT_PRIO, start_task_stack, &start_task_tcb);
   xTaskCreate(process_task, "Task2", 128, NULL, 1, NULL);
-  // UART_Rx_Task_Create();  // 创建串口接收任务
-  UART_DMA_Rx_Task_Create();
+  uart_console_init();  /* 串口控制台：命令行与二进制协议 */
+  cpu_load_init();  /* 按任务统计 CPU 占用（串口命令 cpu） */
   lvgl_demo();
   /* USER CODE END 2 */
 
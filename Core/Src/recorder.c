@@ -0,0 +1,498 @@
+/**
+ * @file recorder.c
+ * @brief 高速传感器/遥测记录器实现
+ *
+ * 生产者：有界无锁多生产者队列（每个槽位带序号，CAS 抢占入队位置），
+ *         中断中调用不会等待被抢占的任务，队列满时直接丢弃并计数。
+ * 消费者：记录任务每 RECORDER_POLL_MS 或被唤醒时把队列搬运到块缓冲区，
+ *         块满或超时后整块写入 sd_stream（扇区对齐，走直写快路径）。
+ * 卷切换：sd_owner 释放卷前关闭文件并进入暂存状态，写满的块复制到 mymalloc(SRAMEX) 分配的
+ *         外部 SRAM 中；卷交回后轮转到新文件，先写出暂存块。外部 SRAM 在 FSMC 上，SDIO 的 DMA2 可以直接访问。
+ * 内存：块缓冲区和暂存块都在外部 SRAM，内部 SRAM 只放队列、任务栈和流对象。
+ */
+
+#include "recorder.h"
+#include "sd_stream.h"
+#include "sd_owner.h"
+#include "high_res_timer.h"
+#include "malloc.h"
+#define LOG_MODULE LOG_MOD_SD
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "fatfs.h"
+#include <stdio.h>
+#include <string.h>
+
+/* 记录任务配置 */
+#define RECORDER_TASK_PRIO      (tskIDLE_PRIORITY + 5)  /* 高于LVGL任务，保证及时搬运队列 */
+#define RECORDER_STK_SIZE       512                     /* 任务堆栈大小(字) */
+#define RECORDER_POLL_MS        5                       /* 队列轮询周期 */
+
+/* 任务通知位 */
+#define RECORDER_NOTIFY_DATA    (1UL << 0)
+#define RECORDER_NOTIFY_START   (1UL << 1)
+#define RECORDER_NOTIFY_STOP    (1UL << 2)
+#define RECORDER_NOTIFY_HOLD    (1UL << 3)
+#define RECORDER_NOTIFY_RESUME  (1UL << 4)
+
+#define RECORDER_RING_MASK      (RECORDER_RING_SLOTS - 1U)
+#define RECORDER_BLOCK_RECORDS  ((RECORDER_BLOCK_SIZE - sizeof(recorder_block_header_t)) / sizeof(recorder_record_t))
+
+#if (RECORDER_RING_SLOTS & RECORDER_RING_MASK) != 0
+#error "RECORDER_RING_SLOTS must be a power of two"
+#endif
+#if (RECORDER_FILE_SIZE % RECORDER_BLOCK_SIZE) != 0
+#error "RECORDER_FILE_SIZE must be a multiple of RECORDER_BLOCK_SIZE"
+#endif
+
+/* 队列槽位：seq == pos 表示空闲，seq == pos + 1 表示已写入待取走 */
+typedef struct {
+    volatile uint32_t seq;
+    recorder_record_t rec;
+} recorder_slot_t;
+
+static recorder_slot_t ring[RECORDER_RING_SLOTS];
+static uint32_t enqueue_pos;                /* 生产者共享，CAS 修改 */
+static uint32_t dequeue_pos;                /* 仅消费者修改 */
+
+/* 块缓冲区：recorder_init 时从外部 SRAM 分配（SDIO DMA 可访问，内部 SRAM 放不下 32KB） */
+static uint8_t *block_buf;
+static uint32_t block_records;
+static uint32_t block_seq;
+static TickType_t block_start_tick;
+
+static sd_stream_t stream;
+static volatile uint8_t recording;
+static recorder_stats_t stats;
+
+/* 卷交给 USB 主机期间暂存的块 */
+static uint8_t *hold_blocks[RECORDER_HOLD_BLOCKS];
+static uint32_t hold_count;
+static volatile uint8_t holding;            /* 卷不可用，写满的块进入暂存 */
+static uint8_t stream_held;                 /* 暂存开始时文件是打开的，卷交回后需要重新打开 */
+static volatile bool resume_mounted;
+
+/* 启动参数与结果 */
+static const char *start_dir;
+static const char *start_prefix;
+static volatile bool start_ok;
+
+/* 任务与同步对象（静态分配，FreeRTOS 堆很小） */
+static TaskHandle_t recorder_task_handle;
+static StaticTask_t recorder_task_tcb;
+static StackType_t recorder_task_stack[RECORDER_STK_SIZE];
+static SemaphoreHandle_t recorder_done_sem;
+static StaticSemaphore_t recorder_done_sem_buf;
+
+bool recorder_put(uint16_t type, const void *data, uint16_t len)
+{
+    recorder_slot_t *slot;
+    uint32_t pos;
+    uint32_t used;
+
+    if (!recording) {
+        return false;
+    }
+
+    pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        slot = &ring[pos & RECORDER_RING_MASK];
+        int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+
+        if (diff == 0) {
+            /* 槽位空闲，抢占入队位置；失败时 pos 被更新为最新值 */
+            if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            /* 队列满 */
+            __atomic_fetch_add(&stats.records_dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        } else {
+            pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (len > RECORDER_PAYLOAD_SIZE) {
+        len = RECORDER_PAYLOAD_SIZE;
+    }
+    slot->rec.timestamp_us = HighResTimer_GetUs();
+    slot->rec.type = type;
+    slot->rec.length = len;
+    memcpy(slot->rec.payload, data, len);
+    if (len < RECORDER_PAYLOAD_SIZE) {
+        memset(&slot->rec.payload[len], 0, RECORDER_PAYLOAD_SIZE - len);
+    }
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+    /* 统计最高占用（近似值，不影响正确性） */
+    used = pos + 1 - __atomic_load_n(&dequeue_pos, __ATOMIC_RELAXED);
+    if (used > stats.ring_high_water) {
+        stats.ring_high_water = used;
+    }
+
+    /* 队列过半时提前唤醒记录任务；中断中不调用内核API，依赖任务轮询 */
+    if (used == RECORDER_RING_SLOTS / 2 && !xPortIsInsideInterrupt() && recorder_task_handle != NULL) {
+        xTaskNotify(recorder_task_handle, RECORDER_NOTIFY_DATA, eSetBits);
+    }
+    return true;
+}
+
+/**
+ * @brief 下一块所在的文件序号（写入前若即将轮转，块会落在下一个文件里）
+ */
+static uint32_t recorder_file_index(void)
+{
+    return (stream.sector_pos >= stream.sector_count) ? stream.index + 1 : stream.index;
+}
+
+/**
+ * @brief 把当前块复制到外部 SRAM 暂存，暂存已满时丢弃
+ */
+static void recorder_hold_block(void)
+{
+    uint8_t *buf = NULL;
+
+    if (hold_count < RECORDER_HOLD_BLOCKS) {
+        vTaskSuspendAll();      /* mymalloc 不可重入 */
+        buf = mymalloc(SRAMEX, RECORDER_BLOCK_SIZE);
+        xTaskResumeAll();
+    }
+    if (buf == NULL) {
+        __atomic_fetch_add(&stats.records_dropped, block_records, __ATOMIC_RELAXED);
+        LOG_WARNING("recorder: hold buffer full, block %lu dropped", (unsigned long)block_seq);
+        return;
+    }
+    memcpy(buf, block_buf, RECORDER_BLOCK_SIZE);
+    hold_blocks[hold_count++] = buf;
+    stats.blocks_held++;
+}
+
+/**
+ * @brief 按顺序写出（或丢弃）暂存的块并释放内存
+ * @param write false 时全部计入丢弃数
+ */
+static void recorder_flush_held(bool write)
+{
+    recorder_block_header_t *hdr;
+    FRESULT res;
+    uint32_t i;
+
+    for (i = 0; i < hold_count; i++) {
+        hdr = (recorder_block_header_t *)hold_blocks[i];
+        res = FR_DENIED;
+        if (write) {
+            hdr->file_index = recorder_file_index();
+            res = sd_stream_write(&stream, hold_blocks[i], RECORDER_BLOCK_SIZE);
+            if (res != FR_OK) {
+                stats.write_errors++;
+                LOG_ERROR("recorder: held block %lu write failed: %d", (unsigned long)hdr->block_seq, res);
+            }
+        }
+        if (res == FR_OK) {
+            stats.blocks_written++;
+            stats.records_written += hdr->record_count;
+        } else {
+            __atomic_fetch_add(&stats.records_dropped, hdr->record_count, __ATOMIC_RELAXED);
+        }
+
+        vTaskSuspendAll();
+        myfree(SRAMEX, hold_blocks[i]);
+        xTaskResumeAll();
+        hold_blocks[i] = NULL;
+    }
+    hold_count = 0;
+}
+
+/**
+ * @brief 写出当前块（不足部分补零，保证每次都是整块对齐写入）；卷不可用时进入暂存
+ */
+static void recorder_write_block(void)
+{
+    recorder_block_header_t *hdr = (recorder_block_header_t *)block_buf;
+    uint32_t used = sizeof(*hdr) + block_records * sizeof(recorder_record_t);
+    uint32_t t0, dt;
+    FRESULT res;
+
+    if (block_records == 0) {
+        return;
+    }
+
+    hdr->sync = RECORDER_SYNC_WORD;
+    hdr->version = RECORDER_FORMAT_VERSION;
+    hdr->header_size = sizeof(*hdr);
+    hdr->record_size = sizeof(recorder_record_t);
+    hdr->record_count = (uint16_t)block_records;
+    hdr->block_size = RECORDER_BLOCK_SIZE;
+    hdr->block_seq = block_seq;
+    hdr->file_index = recorder_file_index();
+    hdr->dropped = stats.records_dropped;
+    hdr->reserved = 0;
+    memset(&block_buf[used], 0, RECORDER_BLOCK_SIZE - used);
+
+    if (holding) {
+        recorder_hold_block();
+        block_seq++;
+        block_records = 0;
+        block_start_tick = xTaskGetTickCount();
+        return;
+    }
+
+    t0 = HighResTimer_GetUs();
+    res = sd_stream_write(&stream, block_buf, RECORDER_BLOCK_SIZE);
+    dt = HighResTimer_GetUs() - t0;
+
+    if (res == FR_OK) {
+        stats.blocks_written++;
+        stats.records_written += block_records;
+    } else {
+        stats.write_errors++;
+        LOG_ERROR("recorder: block %lu write failed: %d", (unsigned long)block_seq, res);
+    }
+    if (dt > stats.max_write_us) {
+        stats.max_write_us = dt;
+    }
+
+    block_seq++;
+    block_records = 0;
+    block_start_tick = xTaskGetTickCount();
+}
+
+/**
+ * @brief 把队列中已就绪的记录搬到块缓冲区，块满即写出
+ */
+static void recorder_drain(void)
+{
+    recorder_record_t *dst = (recorder_record_t *)(block_buf + sizeof(recorder_block_header_t));
+
+    for (;;) {
+        recorder_slot_t *slot = &ring[dequeue_pos & RECORDER_RING_MASK];
+
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != dequeue_pos + 1) {
+            break;  /* 没有更多就绪记录（或生产者尚未写完） */
+        }
+        if (block_records == 0) {
+            block_start_tick = xTaskGetTickCount();
+        }
+        memcpy(&dst[block_records++], &slot->rec, sizeof(recorder_record_t));
+        __atomic_store_n(&slot->seq, dequeue_pos + RECORDER_RING_SLOTS, __ATOMIC_RELEASE);
+        __atomic_store_n(&dequeue_pos, dequeue_pos + 1, __ATOMIC_RELAXED);
+
+        if (block_records >= RECORDER_BLOCK_RECORDS) {
+            recorder_write_block();
+        }
+    }
+}
+
+/**
+ * @brief 记录任务
+ */
+static void recorder_task(void *argument)
+{
+    uint32_t bits;
+
+    (void)argument;
+
+    for (;;) {
+        bits = 0;
+        xTaskNotifyWait(0, 0xFFFFFFFFUL, &bits, pdMS_TO_TICKS(RECORDER_POLL_MS));
+
+        if (bits & RECORDER_NOTIFY_START) {
+            start_ok = false;
+            if (!recording && sd_stream_open(&stream, start_dir, start_prefix, RECORDER_FILE_SIZE) == FR_OK) {
+                block_records = 0;
+                block_seq = 0;
+                recording = 1;
+                start_ok = true;
+                LOG_INFO("recorder: started, %lu records per block", (unsigned long)RECORDER_BLOCK_RECORDS);
+            }
+            xSemaphoreGive(recorder_done_sem);
+        }
+
+        if (bits & RECORDER_NOTIFY_HOLD) {
+            if (!holding) {
+                if (recording) {
+                    /* 已有记录先落盘，关闭文件（截断到实际长度），之后写满的块暂存在 RAM 中 */
+                    recorder_drain();
+                    recorder_write_block();
+                    sd_stream_close(&stream);
+                    stream_held = 1;
+                }
+                holding = 1;
+                LOG_INFO("recorder: volume released, buffering up to %u blocks", (unsigned)RECORDER_HOLD_BLOCKS);
+            }
+            xSemaphoreGive(recorder_done_sem);
+        }
+
+        if (recording) {
+            recorder_drain();
+            /* 暂存期间不按超时写出未满的块，节省暂存空间 */
+            if (block_records > 0 && !holding &&
+                (xTaskGetTickCount() - block_start_tick) >= pdMS_TO_TICKS(RECORDER_FLUSH_MS)) {
+                recorder_write_block();
+            }
+        }
+
+        if (bits & RECORDER_NOTIFY_STOP) {
+            if (recording) {
+                recording = 0;
+                recorder_drain();
+                recorder_write_block();
+                sd_stream_close(&stream);
+                LOG_INFO("recorder: stopped, %lu records, %lu dropped",
+                         (unsigned long)stats.records_written, (unsigned long)stats.records_dropped);
+            }
+            xSemaphoreGive(recorder_done_sem);
+        }
+
+        if ((bits & RECORDER_NOTIFY_RESUME) && holding) {
+            if (stream_held) {
+                uint32_t held = hold_count;
+
+                stream_held = 0;
+                /* 原文件已关闭，以下一个序号重新打开，先写出暂存的块 */
+                if (resume_mounted && sd_stream_rotate(&stream) == FR_OK) {
+                    recorder_flush_held(true);
+                    if (!recording) {
+                        sd_stream_close(&stream);
+                    }
+                    LOG_INFO("recorder: volume back, %lu held blocks written", (unsigned long)held);
+                } else {
+                    /* 剩余记录仍进入暂存，随后一并计入丢弃数 */
+                    LOG_ERROR("recorder: cannot reopen stream after remount, recording stopped");
+                    stats.write_errors++;
+                    recording = 0;
+                    recorder_drain();
+                    __atomic_fetch_add(&stats.records_dropped, block_records, __ATOMIC_RELAXED);
+                    block_records = 0;
+                    recorder_flush_held(false);
+                }
+            }
+            holding = 0;
+        }
+    }
+}
+
+/* sd_owner 客户端回调，在所有权任务中调用 */
+static void recorder_owner_release(void)
+{
+    xTaskNotify(recorder_task_handle, RECORDER_NOTIFY_HOLD, eSetBits);
+    xSemaphoreTake(recorder_done_sem, portMAX_DELAY);
+}
+
+static void recorder_owner_remount(bool mounted)
+{
+    resume_mounted = mounted;
+    xTaskNotify(recorder_task_handle, RECORDER_NOTIFY_RESUME, eSetBits);
+}
+
+static const sd_owner_client_t recorder_owner_client = {
+    recorder_owner_release,
+    recorder_owner_remount,
+};
+
+void recorder_init(void)
+{
+    uint32_t i;
+
+    if (recorder_task_handle != NULL) {
+        return;
+    }
+
+    vTaskSuspendAll();          /* mymalloc 不可重入 */
+    block_buf = mymalloc(SRAMEX, RECORDER_BLOCK_SIZE);
+    xTaskResumeAll();
+    if (block_buf == NULL) {
+        LOG_ERROR("recorder: no memory for %u byte block buffer", (unsigned)RECORDER_BLOCK_SIZE);
+        return;
+    }
+
+    for (i = 0; i < RECORDER_RING_SLOTS; i++) {
+        ring[i].seq = i;
+    }
+    enqueue_pos = 0;
+    dequeue_pos = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    recorder_done_sem = xSemaphoreCreateBinaryStatic(&recorder_done_sem_buf);
+    recorder_task_handle = xTaskCreateStatic(recorder_task,
+                                             "recorder",
+                                             RECORDER_STK_SIZE,
+                                             NULL,
+                                             RECORDER_TASK_PRIO,
+                                             recorder_task_stack,
+                                             &recorder_task_tcb);
+    sd_owner_register(&recorder_owner_client);
+}
+
+bool recorder_start(const char *dir, const char *prefix)
+{
+    if (recorder_task_handle == NULL) {
+        return false;
+    }
+    start_dir = dir;
+    start_prefix = prefix;
+    xTaskNotify(recorder_task_handle, RECORDER_NOTIFY_START, eSetBits);
+    xSemaphoreTake(recorder_done_sem, portMAX_DELAY);
+    return start_ok;
+}
+
+void recorder_stop(void)
+{
+    if (recorder_task_handle == NULL) {
+        return;
+    }
+    xTaskNotify(recorder_task_handle, RECORDER_NOTIFY_STOP, eSetBits);
+    xSemaphoreTake(recorder_done_sem, portMAX_DELAY);
+}
+
+bool recorder_is_recording(void)
+{
+    return recording != 0U;
+}
+
+void recorder_get_stats(recorder_stats_t *out)
+{
+    if (out != NULL) {
+        memcpy(out, &stats, sizeof(*out));
+    }
+}
+
+int recorder_command(const char *line)
+{
+    char buf[32];
+    char *argv[2];
+    int argc = 0;
+    char *save;
+    char *p;
+
+    strncpy(buf, line, sizeof(buf) - 1U);
+    buf[sizeof(buf) - 1U] = '\0';
+    for (p = strtok_r(buf, " \t", &save); p != NULL && argc < 2; p = strtok_r(NULL, " \t", &save)) {
+        argv[argc++] = p;
+    }
+    if (argc == 0 || strcmp(argv[0], "rec") != 0) {
+        return 0;
+    }
+
+    if (argc == 1) {
+        printf("rec %s, %lu records (%lu dropped), %lu blocks, %lu held, %lu errors\r\n",
+               recording ? "on" : "off", (unsigned long)stats.records_written,
+               (unsigned long)stats.records_dropped, (unsigned long)stats.blocks_written,
+               (unsigned long)stats.blocks_held, (unsigned long)stats.write_errors);
+    } else if (strcmp(argv[1], "start") == 0) {
+        if (recording) {
+            printf("rec already running\r\n");
+        } else if (!sd_owner_mounted() || !recorder_start(SDPath, RECORDER_FILE_PREFIX)) {
+            printf("rec start failed\r\n");
+        }
+    } else if (strcmp(argv[1], "stop") == 0) {
+        recorder_stop();
+    } else {
+        printf("usage: rec [start|stop]\r\n");
+    }
+    return 1;
+}
@@ -0,0 +1,403 @@
+/**
+ * @file rtos_trace.c
+ * @brief FreeRTOS 调度与中断事件跟踪实现
+ *
+ * 事件在调度器内部（临界区、PendSV）和各级中断中产生，写入时关中断（只写 8 字节）。
+ * 导出时冻结缓冲区：冻结期间产生的事件不记录，只计数；导出由互斥量串行化，只能在任务中进行。
+ */
+
+#include "rtos_trace.h"
+
+#if RTOS_TRACE_ENABLE
+
+#include "stm32f4xx_hal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "fatfs.h"
+#include "sd_owner.h"
+#include "uart_drv.h"
+#include <stdio.h>
+#include <string.h>
+
+#if (RTOS_TRACE_EVENTS & (RTOS_TRACE_EVENTS - 1U)) != 0U
+#error "RTOS_TRACE_EVENTS must be a power of 2"
+#endif
+
+/* 串口导出每行字节数 */
+#define RTOS_TRACE_DUMP_LINE    32U
+
+typedef enum {
+    TRACE_STOPPED = 0,
+    TRACE_RUNNING,
+    TRACE_FROZEN            /* 导出中，结束后恢复记录 */
+} trace_state_t;
+
+static rtos_trace_event_t trace_ring[RTOS_TRACE_EVENTS];
+static volatile trace_state_t trace_state;
+static rtos_trace_mode_t trace_mode;
+static uint32_t trace_head;             /* 本次 start 以来写入的事件数 */
+static uint32_t trace_lost;             /* 冻结或单次模式记满后未记录的事件数 */
+
+/* 任务与标记名称表，只追加 */
+static rtos_trace_task_entry_t task_table[RTOS_TRACE_MAX_TASKS];
+static volatile uint16_t task_count;
+static rtos_trace_marker_entry_t marker_table[RTOS_TRACE_MAX_MARKERS];
+static volatile uint16_t marker_count;
+
+/* 冻结时的快照 */
+static SemaphoreHandle_t export_mutex;
+static StaticSemaphore_t export_mutex_buf;
+static trace_state_t frozen_from;
+static rtos_trace_file_header_t frozen_header;
+static uint32_t frozen_first;           /* 最早事件的序号 */
+
+/* SD 导出：卷交给 USB 前等待进行中的保存结束 */
+static SemaphoreHandle_t save_mutex;
+static StaticSemaphore_t save_mutex_buf;
+static bool sd_released;
+static FIL save_file;
+static uint8_t save_buf[512];
+
+void rtos_trace_event(uint8_t type, uint8_t arg8, uint16_t arg16)
+{
+    uint32_t primask;
+    rtos_trace_event_t *ev;
+
+    if (trace_state == TRACE_STOPPED) {
+        return;
+    }
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if (trace_state == TRACE_RUNNING) {
+        ev = &trace_ring[trace_head & (RTOS_TRACE_EVENTS - 1U)];
+        ev->timestamp_us = TIM2->CNT;
+        ev->type = type;
+        ev->arg8 = arg8;
+        ev->arg16 = arg16;
+        trace_head++;
+        if (trace_mode == RTOS_TRACE_MODE_ONESHOT && trace_head >= RTOS_TRACE_EVENTS) {
+            trace_state = TRACE_STOPPED;
+        }
+    } else if (trace_state == TRACE_FROZEN) {
+        trace_lost++;
+    }
+    __set_PRIMASK(primask);
+}
+
+void rtos_trace_task_create(uint16_t number, uint8_t priority, const char *name)
+{
+    uint32_t primask = __get_PRIMASK();
+    rtos_trace_task_entry_t *entry;
+
+    __disable_irq();
+    if (task_count < RTOS_TRACE_MAX_TASKS) {
+        entry = &task_table[task_count];
+        entry->number = number;
+        entry->priority = priority;
+        strncpy(entry->name, name, RTOS_TRACE_NAME_LEN - 1U);
+        entry->name[RTOS_TRACE_NAME_LEN - 1U] = '\0';
+        task_count++;
+    }
+    __set_PRIMASK(primask);
+}
+
+void rtos_trace_marker_name(uint8_t id, const char *name)
+{
+    uint32_t primask = __get_PRIMASK();
+    rtos_trace_marker_entry_t *entry;
+
+    __disable_irq();
+    if (marker_count < RTOS_TRACE_MAX_MARKERS) {
+        entry = &marker_table[marker_count];
+        entry->id = id;
+        strncpy(entry->name, name, sizeof(entry->name) - 1U);
+        entry->name[sizeof(entry->name) - 1U] = '\0';
+        marker_count++;
+    }
+    __set_PRIMASK(primask);
+}
+
+void rtos_trace_start(rtos_trace_mode_t mode)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    trace_mode = mode;
+    trace_head = 0;
+    trace_lost = 0;
+    trace_state = TRACE_RUNNING;
+    __set_PRIMASK(primask);
+}
+
+void rtos_trace_stop(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (trace_state == TRACE_RUNNING) {
+        trace_state = TRACE_STOPPED;
+    }
+    __set_PRIMASK(primask);
+}
+
+bool rtos_trace_running(void)
+{
+    return trace_state == TRACE_RUNNING;
+}
+
+uint32_t rtos_trace_freeze(void)
+{
+    uint32_t primask;
+    uint32_t count;
+
+    xSemaphoreTake(export_mutex, portMAX_DELAY);
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    frozen_from = trace_state;
+    if (trace_state == TRACE_RUNNING) {
+        trace_state = TRACE_FROZEN;
+    }
+    count = (trace_head < RTOS_TRACE_EVENTS) ? trace_head : RTOS_TRACE_EVENTS;
+    frozen_first = trace_head - count;
+    frozen_header.event_count = count;
+    frozen_header.dropped = frozen_first + trace_lost;
+    frozen_header.task_count = task_count;
+    frozen_header.marker_count = marker_count;
+    __set_PRIMASK(primask);
+
+    frozen_header.magic = RTOS_TRACE_MAGIC;
+    frozen_header.version = RTOS_TRACE_VERSION;
+    frozen_header.header_size = sizeof(rtos_trace_file_header_t);
+    frozen_header.timer_hz = 1000000U;
+    frozen_header.task_entry_size = sizeof(rtos_trace_task_entry_t);
+    frozen_header.marker_entry_size = sizeof(rtos_trace_marker_entry_t);
+
+    return sizeof(rtos_trace_file_header_t) +
+           frozen_header.task_count * sizeof(rtos_trace_task_entry_t) +
+           frozen_header.marker_count * sizeof(rtos_trace_marker_entry_t) +
+           count * sizeof(rtos_trace_event_t);
+}
+
+/**
+ * @brief 从一段连续区域中取出落在 [*offset, *offset + *len) 内的部分
+ * @param base 区域在文件中的起始偏移
+ */
+static void read_region(const uint8_t *src, uint32_t base, uint32_t size,
+                        uint32_t *offset, uint8_t **buf, uint32_t *len)
+{
+    uint32_t n;
+
+    if (*len == 0U || *offset < base || *offset >= base + size) {
+        return;
+    }
+    n = base + size - *offset;
+    if (n > *len) {
+        n = *len;
+    }
+    memcpy(*buf, src + (*offset - base), n);
+    *offset += n;
+    *buf += n;
+    *len -= n;
+}
+
+void rtos_trace_read(uint32_t offset, uint8_t *buf, uint32_t len)
+{
+    const uint32_t ring_bytes = sizeof(trace_ring);
+    uint32_t base = 0;
+    uint32_t size;
+    uint32_t start;
+    uint32_t pos;
+    uint32_t n;
+
+    size = sizeof(rtos_trace_file_header_t);
+    read_region((const uint8_t *)&frozen_header, base, size, &offset, &buf, &len);
+    base += size;
+    size = frozen_header.task_count * sizeof(rtos_trace_task_entry_t);
+    read_region((const uint8_t *)task_table, base, size, &offset, &buf, &len);
+    base += size;
+    size = frozen_header.marker_count * sizeof(rtos_trace_marker_entry_t);
+    read_region((const uint8_t *)marker_table, base, size, &offset, &buf, &len);
+    base += size;
+
+    /* 事件：从最早的一个开始，在环形缓冲区中可能回绕 */
+    if (len == 0U || offset < base) {
+        return;
+    }
+    start = (frozen_first & (RTOS_TRACE_EVENTS - 1U)) * sizeof(rtos_trace_event_t);
+    pos = (start + (offset - base)) % ring_bytes;
+    while (len > 0U) {
+        n = ring_bytes - pos;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(buf, (const uint8_t *)trace_ring + pos, n);
+        buf += n;
+        len -= n;
+        pos = 0;
+    }
+}
+
+void rtos_trace_thaw(void)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    if (trace_state == TRACE_FROZEN) {
+        trace_state = frozen_from;
+    }
+    __set_PRIMASK(primask);
+
+    xSemaphoreGive(export_mutex);
+}
+
+/* ---------------- 导出 ---------------- */
+
+/**
+ * @brief 串口导出：十六进制行，"trace begin <字节数>" 与 "trace end" 之间
+ */
+static void rtos_trace_dump(void)
+{
+    uint8_t line[RTOS_TRACE_DUMP_LINE];
+    uint32_t size = rtos_trace_freeze();
+    uint32_t offset;
+    uint32_t n;
+    uint32_t i;
+
+    printf("trace begin %lu\r\n", (unsigned long)size);
+    for (offset = 0; offset < size; offset += n) {
+        n = size - offset;
+        if (n > sizeof(line)) {
+            n = sizeof(line);
+        }
+        rtos_trace_read(offset, line, n);
+        for (i = 0; i < n; i++) {
+            printf("%02x", line[i]);
+        }
+        printf("\r\n");
+        /* 不要超过串口发送缓冲区，否则后面的行会被丢弃 */
+        if ((offset / RTOS_TRACE_DUMP_LINE) % 32U == 31U) {
+            uart_drv_flush(UART_PORT_CONSOLE, 1000);
+        }
+    }
+    printf("trace end\r\n");
+    rtos_trace_thaw();
+}
+
+/**
+ * @brief SD 导出：写入卷根目录 trace.bin
+ */
+static void rtos_trace_save(void)
+{
+    char path[16];
+    uint32_t size;
+    uint32_t offset;
+    uint32_t n;
+    UINT written;
+    FRESULT res = FR_OK;
+
+    xSemaphoreTake(save_mutex, portMAX_DELAY);
+    if (sd_released || !sd_owner_mounted() || sd_owner_get() != SD_OWNER_FIRMWARE) {
+        xSemaphoreGive(save_mutex);
+        printf("trace: sd volume not available\r\n");
+        return;
+    }
+
+    snprintf(path, sizeof(path), "%strace.bin", SDPath);
+    res = f_open(&save_file, path, FA_CREATE_ALWAYS | FA_WRITE);
+    if (res == FR_OK) {
+        size = rtos_trace_freeze();
+        for (offset = 0; offset < size && res == FR_OK; offset += n) {
+            n = size - offset;
+            if (n > sizeof(save_buf)) {
+                n = sizeof(save_buf);
+            }
+            rtos_trace_read(offset, save_buf, n);
+            res = f_write(&save_file, save_buf, n, &written);
+            if (res == FR_OK && written != n) {
+                res = FR_DENIED;
+            }
+        }
+        rtos_trace_thaw();
+        if (f_close(&save_file) != FR_OK && res == FR_OK) {
+            res = FR_DISK_ERR;
+        }
+    }
+    xSemaphoreGive(save_mutex);
+
+    if (res == FR_OK) {
+        printf("trace: saved %s (%lu bytes)\r\n", path, (unsigned long)size);
+    } else {
+        printf("trace: save failed (%d)\r\n", (int)res);
+    }
+}
+
+static void rtos_trace_owner_release(void)
+{
+    xSemaphoreTake(save_mutex, portMAX_DELAY);
+    sd_released = true;
+    xSemaphoreGive(save_mutex);
+}
+
+static void rtos_trace_owner_remount(bool mounted)
+{
+    sd_released = !mounted;
+}
+
+static const sd_owner_client_t rtos_trace_owner_client = {
+    rtos_trace_owner_release,
+    rtos_trace_owner_remount,
+};
+
+int rtos_trace_command(const char *line)
+{
+    char buf[32];
+    char *argv[3];
+    int argc = 0;
+    char *save;
+    char *p;
+
+    strncpy(buf, line, sizeof(buf) - 1U);
+    buf[sizeof(buf) - 1U] = '\0';
+    for (p = strtok_r(buf, " \t", &save); p != NULL && argc < 3; p = strtok_r(NULL, " \t", &save)) {
+        argv[argc++] = p;
+    }
+    if (argc == 0 || strcmp(argv[0], "trace") != 0) {
+        return 0;
+    }
+
+    if (argc == 1) {
+        printf("trace: %s, %lu events, %lu lost\r\n",
+               rtos_trace_running() ? "running" : "stopped",
+               (unsigned long)trace_head, (unsigned long)trace_lost);
+    } else if (strcmp(argv[1], "start") == 0) {
+        rtos_trace_start((argc == 3 && strcmp(argv[2], "oneshot") == 0) ? RTOS_TRACE_MODE_ONESHOT
+                                                                         : RTOS_TRACE_MODE_RING);
+    } else if (strcmp(argv[1], "stop") == 0) {
+        rtos_trace_stop();
+    } else if (strcmp(argv[1], "dump") == 0) {
+        rtos_trace_dump();
+    } else if (strcmp(argv[1], "save") == 0) {
+        rtos_trace_save();
+    } else {
+        printf("usage: trace [start [oneshot] | stop | dump | save]\r\n");
+    }
+    return 1;
+}
+
+void rtos_trace_init(rtos_trace_mode_t mode)
+{
+    if (export_mutex != NULL) {
+        return;
+    }
+    export_mutex = xSemaphoreCreateMutexStatic(&export_mutex_buf);
+    save_mutex = xSemaphoreCreateMutexStatic(&save_mutex_buf);
+    sd_owner_register(&rtos_trace_owner_client);
+
+    rtos_trace_marker_name(RTOS_TRACE_ID_LV_TIMER, "lv_timer");
+    rtos_trace_marker_name(RTOS_TRACE_ID_LCD_FLUSH, "lcd flush");
+    rtos_trace_start(mode);
+}
+
+#endif /* RTOS_TRACE_ENABLE */
@@ -16,6 +16,9 @@
 /* 全局场景管理器实例 */
 static scene_manager_t g_scene_manager = {0};
 
+/* 其他任务登记的切换请求：场景ID | 动画 << 8 | 时长 << 16，0 表示没有请求；一次 32 位读写，不需要加锁 */
+static volatile uint32_t g_scene_request;
+
 /* 函数前置声明 */
 static void scene_anim_ready_cb(lv_anim_t *a);
 static void btn_settings_event_cb(lv_event_t *e);
@@ -265,6 +268,35 @@ bool scene_manager_is_transitioning(void)
     return g_scene_manager.transition_in_progress;
 }
 
+/**
+ * @brief       请求切换场景（任意任务可调用）
+ */
+bool scene_manager_request(scene_id_t scene_id, scene_anim_t anim_type, uint32_t anim_time)
+{
+    if (scene_id == SCENE_NONE || scene_id >= SCENE_MAX || anim_type > ANIM_ZOOM_OUT || anim_time > 0xFFFFU) {
+        return false;
+    }
+    /* 后到的请求覆盖还没执行的请求 */
+    g_scene_request = (uint32_t)scene_id | ((uint32_t)anim_type << 8) | (anim_time << 16);
+    return true;
+}
+
+/**
+ * @brief       执行登记的场景切换请求（LVGL 任务中调用）
+ */
+void scene_manager_poll(void)
+{
+    uint32_t req;
+
+    if (g_scene_request == 0U) {
+        return;
+    }
+    req = __atomic_exchange_n(&g_scene_request, 0U, __ATOMIC_ACQ_REL);
+    if (req != 0U) {
+        scene_manager_load((scene_id_t)(req & 0xFFU), (scene_anim_t)((req >> 8) & 0xFFU), req >> 16);
+    }
+}
+
 /******************************************************************************************************/
 /* 预定义场景实现 */
 
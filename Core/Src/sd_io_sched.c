@@ -0,0 +1,337 @@
+/**
+ * @file sd_io_sched.c
+ * @brief SD卡卷I/O调度器实现
+ *
+ * 每个优先级一条 FIFO 链表，请求对象放在提交者的栈上，完成后通过请求内的静态信号量唤醒提交者。
+ * 调度任务每次只执行一个分片（扇区数上限随优先级而定）或一个回调，然后重新从最高优先级选取，
+ * 因此低优先级的大块写入不会长时间阻塞界面请求，而高优先级请求可以用更大的多块传输。扇区传输期间持有 FatFs 卷锁，
+ * 与直接调用 FatFs 的代码保持互斥。
+ */
+
+#include "sd_io_sched.h"
+#include "high_res_timer.h"
+#define LOG_MODULE LOG_MOD_SD
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include <string.h>
+
+/* 调度任务配置 */
+#define SD_IO_TASK_PRIO     (tskIDLE_PRIORITY + 6)  /* 高于所有客户端任务 */
+#define SD_IO_STK_SIZE      768                     /* 任务堆栈大小(字)，回调中会调用 FatFs */
+
+#define SD_IO_SECTOR_SIZE   512U
+
+typedef enum {
+    SD_IO_OP_READ = 0,
+    SD_IO_OP_WRITE,
+    SD_IO_OP_CALL
+} sd_io_op_t;
+
+typedef struct sd_io_req {
+    struct sd_io_req *next;
+    uint8_t op;
+    uint8_t prio;
+    uint8_t *buf;               /* 扇区请求：下一片的缓冲区 */
+    uint32_t sector;            /* 扇区请求：下一片的起始扇区 */
+    uint32_t count;             /* 扇区请求：剩余扇区数 */
+    sd_io_call_t fn;
+    void *arg;
+    int result;
+    uint32_t t_submit;
+    SemaphoreHandle_t done;
+    StaticSemaphore_t done_buf;
+} sd_io_req_t;
+
+/* 各优先级的分片上限（扇区） */
+static const uint32_t chunk_limit[SD_IO_PRIO_NUM] = {
+    SD_IO_UI_CHUNK,
+    SD_IO_NORMAL_CHUNK,
+    SD_IO_MAX_CHUNK,
+};
+
+static FATFS *io_fs;
+static sd_io_req_t *queue_head[SD_IO_PRIO_NUM];
+static sd_io_req_t *queue_tail[SD_IO_PRIO_NUM];
+static sd_io_stats_t stats;
+
+static TaskHandle_t sd_io_task_handle;
+static StaticTask_t sd_io_task_tcb;
+static StackType_t sd_io_task_stack[SD_IO_STK_SIZE];
+
+static int io_lock(void)
+{
+#if _FS_REENTRANT
+    /* 卷已卸载（交给 USB 主机，见 sd_owner）时没有卷锁，扇区访问只在调度任务中进行 */
+    if (io_fs->fs_type == 0) {
+        return 1;
+    }
+    return ff_req_grant(io_fs->sobj);
+#else
+    return 1;
+#endif
+}
+
+static void io_unlock(void)
+{
+#if _FS_REENTRANT
+    if (io_fs->fs_type != 0) {
+        ff_rel_grant(io_fs->sobj);
+    }
+#endif
+}
+
+/**
+ * @brief 执行一次扇区传输（持有卷锁）
+ */
+static DRESULT io_transfer(uint8_t op, uint8_t *buf, uint32_t sector, uint32_t count)
+{
+    DRESULT res;
+
+    if (!io_lock()) {
+        return RES_NOTRDY;
+    }
+    if (op == SD_IO_OP_READ) {
+        res = disk_read(io_fs->drv, buf, sector, count);
+    } else {
+        res = disk_write(io_fs->drv, buf, sector, count);
+    }
+    io_unlock();
+    return res;
+}
+
+/**
+ * @brief 从队列中取下请求并唤醒提交者（唤醒后不能再访问 req）
+ */
+static void io_complete(sd_io_req_t *req, int result)
+{
+    uint32_t wait = HighResTimer_GetUs() - req->t_submit;
+    uint8_t prio = req->prio;
+
+    stats.requests[prio]++;
+    if (wait > stats.max_wait_us[prio]) {
+        stats.max_wait_us[prio] = wait;
+    }
+    req->result = result;
+    xSemaphoreGive(req->done);
+}
+
+/**
+ * @brief 移除队首请求
+ */
+static void io_pop(uint8_t prio)
+{
+    taskENTER_CRITICAL();
+    queue_head[prio] = queue_head[prio]->next;
+    if (queue_head[prio] == NULL) {
+        queue_tail[prio] = NULL;
+    }
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief 执行最高优先级队首请求的一个分片
+ * @retval false 所有队列为空
+ */
+static bool io_service_one(void)
+{
+    sd_io_req_t *req = NULL;
+    sd_io_req_t *last;
+    uint32_t n, limit, merged = 0;
+    uint8_t prio;
+    DRESULT res;
+
+    taskENTER_CRITICAL();
+    for (prio = 0; prio < SD_IO_PRIO_NUM; prio++) {
+        if (queue_head[prio] != NULL) {
+            req = queue_head[prio];
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if (req == NULL) {
+        return false;
+    }
+
+    if (req->op == SD_IO_OP_CALL) {
+        io_pop(prio);
+        io_complete(req, req->fn(req->arg));
+        return true;
+    }
+
+    limit = chunk_limit[prio];
+    n = (req->count > limit) ? limit : req->count;
+
+    /* 队首请求能在本片内完成时，尝试把紧随其后、LBA 和缓冲区都相邻的同类请求并入 */
+    last = req;
+    if (n == req->count) {
+        taskENTER_CRITICAL();
+        while (last->next != NULL) {
+            sd_io_req_t *nx = last->next;
+
+            if (nx->op != req->op || nx->sector != req->sector + n ||
+                nx->buf != req->buf + n * SD_IO_SECTOR_SIZE || n + nx->count > limit) {
+                break;
+            }
+            n += nx->count;
+            last = nx;
+            merged++;
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    res = io_transfer(req->op, req->buf, req->sector, n);
+    stats.chunks++;
+    stats.merged += merged;
+    if (res != RES_OK) {
+        stats.errors++;
+    }
+
+    if (res == RES_OK && n < req->count) {
+        /* 只完成了一部分，留在队首等待下一次调度 */
+        req->buf += n * SD_IO_SECTOR_SIZE;
+        req->sector += n;
+        req->count -= n;
+        return true;
+    }
+
+    /* 完成队首及所有被合并的请求（出错时一并失败） */
+    for (;;) {
+        sd_io_req_t *cur = queue_head[prio];
+        bool end = (cur == last);
+
+        io_pop(prio);
+        io_complete(cur, res);
+        if (end) {
+            break;
+        }
+    }
+    return true;
+}
+
+static void sd_io_task(void *argument)
+{
+    (void)argument;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (io_service_one()) {
+        }
+    }
+}
+
+/**
+ * @brief 入队并等待完成
+ */
+static int io_submit(sd_io_req_t *req)
+{
+    req->next = NULL;
+    req->t_submit = HighResTimer_GetUs();
+    req->done = xSemaphoreCreateBinaryStatic(&req->done_buf);
+
+    taskENTER_CRITICAL();
+    if (queue_tail[req->prio] != NULL) {
+        queue_tail[req->prio]->next = req;
+    } else {
+        queue_head[req->prio] = req;
+    }
+    queue_tail[req->prio] = req;
+    taskEXIT_CRITICAL();
+
+    xTaskNotifyGive(sd_io_task_handle);
+    xSemaphoreTake(req->done, portMAX_DELAY);
+    return req->result;
+}
+
+/**
+ * @brief 调度器未运行或已在调度任务中时直接执行
+ */
+static bool io_direct(void)
+{
+    return sd_io_task_handle == NULL || xTaskGetCurrentTaskHandle() == sd_io_task_handle;
+}
+
+static DRESULT io_sector_request(sd_io_prio_t prio, uint8_t op, uint8_t *buf, DWORD sector, UINT count)
+{
+    sd_io_req_t req;
+
+    if (io_fs == NULL || buf == NULL || count == 0 || prio >= SD_IO_PRIO_NUM) {
+        return RES_PARERR;
+    }
+    if (io_direct()) {
+        return io_transfer(op, buf, sector, count);
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.op = op;
+    req.prio = prio;
+    req.buf = buf;
+    req.sector = sector;
+    req.count = count;
+    return (DRESULT)io_submit(&req);
+}
+
+DRESULT sd_io_read(sd_io_prio_t prio, BYTE *buf, DWORD sector, UINT count)
+{
+    return io_sector_request(prio, SD_IO_OP_READ, buf, sector, count);
+}
+
+DRESULT sd_io_write(sd_io_prio_t prio, const BYTE *buf, DWORD sector, UINT count)
+{
+    /* 写请求不会修改缓冲区，去掉 const 仅为复用请求结构 */
+    return io_sector_request(prio, SD_IO_OP_WRITE, (uint8_t *)buf, sector, count);
+}
+
+int sd_io_call(sd_io_prio_t prio, sd_io_call_t fn, void *arg)
+{
+    sd_io_req_t req;
+
+    if (fn == NULL || prio >= SD_IO_PRIO_NUM) {
+        return -1;
+    }
+    if (io_direct()) {
+        return fn(arg);
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.op = SD_IO_OP_CALL;
+    req.prio = prio;
+    req.fn = fn;
+    req.arg = arg;
+    return io_submit(&req);
+}
+
+bool sd_io_running(void)
+{
+    return sd_io_task_handle != NULL;
+}
+
+void sd_io_init(FATFS *fs)
+{
+    if (sd_io_task_handle != NULL || fs == NULL) {
+        return;
+    }
+
+    io_fs = fs;
+    memset(&stats, 0, sizeof(stats));
+    sd_io_task_handle = xTaskCreateStatic(sd_io_task,
+                                          "sd_io",
+                                          SD_IO_STK_SIZE,
+                                          NULL,
+                                          SD_IO_TASK_PRIO,
+                                          sd_io_task_stack,
+                                          &sd_io_task_tcb);
+    LOG_INFO("sd_io: scheduler started, chunk %u/%u/%u sectors",
+             (unsigned)SD_IO_UI_CHUNK, (unsigned)SD_IO_NORMAL_CHUNK, (unsigned)SD_IO_MAX_CHUNK);
+}
+
+void sd_io_get_stats(sd_io_stats_t *out)
+{
+    if (out != NULL) {
+        taskENTER_CRITICAL();
+        memcpy(out, &stats, sizeof(*out));
+        taskEXIT_CRITICAL();
+    }
+}
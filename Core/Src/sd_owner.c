@@ -0,0 +1,237 @@
+/**
+ * @file sd_owner.c
+ * @brief SD卡卷所有权仲裁实现
+ *
+ * USB 侧只修改"主机是否需要介质"的期望状态并唤醒所有权任务，任务把实际所有者收敛到期望状态。
+ * 复位后立即重新配置（先 detach 后 attach）这类抖动因此只会引起一次切换或者不切换。
+ * 卸载/挂载经 sd_io_call 在调度任务中执行，与排队中的扇区请求串行。
+ */
+
+#include "sd_owner.h"
+#include "sd_io_sched.h"
+#include "sd_fastmount.h"
+#include "usbd_storage_if.h"
+#include "high_res_timer.h"
+#define LOG_MODULE LOG_MOD_SD
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* 所有权任务配置 */
+#define SD_OWNER_TASK_PRIO      (tskIDLE_PRIORITY + 4)  /* 低于 sd_io 与记录器，切换时要等它们完成 */
+#define SD_OWNER_STK_SIZE       512                     /* 任务堆栈大小(字)，调度器未运行时直接挂载 */
+#define SD_OWNER_POLL_MS        100U                    /* 挂载计时与等待 MSC 空闲的轮询周期 */
+#define SD_OWNER_IDLE_POLL_MS   10U
+
+static FATFS *owner_fs;
+static const char *owner_path;
+static volatile uint8_t owner = SD_OWNER_FIRMWARE;
+static volatile bool mounted;
+
+/* USB 侧期望状态（中断中修改） */
+static volatile bool usb_want;
+static volatile bool usb_suspended;
+static volatile TickType_t suspend_tick;
+
+static const sd_owner_client_t *clients[SD_OWNER_MAX_CLIENTS];
+static uint8_t client_count;
+
+static TaskHandle_t owner_task_handle;
+static StaticTask_t owner_task_tcb;
+static StackType_t owner_task_stack[SD_OWNER_STK_SIZE];
+
+/**
+ * @brief 唤醒所有权任务（中断或任务上下文均可调用；任务未创建时由 init 处理期望状态）
+ */
+static void owner_wake(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (owner_task_handle == NULL) {
+        return;
+    }
+    if (xPortIsInsideInterrupt()) {
+        vTaskNotifyGiveFromISR(owner_task_handle, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xTaskNotifyGive(owner_task_handle);
+    }
+}
+
+/* 在 sd_io 调度任务中执行 */
+static int owner_unmount(void *arg)
+{
+    (void)arg;
+
+    /* 先把空闲簇数写回 EEPROM 并置 clean，主机只读时重新挂载仍能命中快速挂载 */
+    SD_FastMount_Checkpoint(owner_fs);
+    return f_mount(NULL, owner_path, 0);
+}
+
+static int owner_mount(void *arg)
+{
+    FRESULT res;
+
+    (void)arg;
+
+    res = f_mount(owner_fs, owner_path, 1);
+    if (res == FR_OK) {
+        /* 主机写过 FAT 时 clean 已被 SD_write 钩子清除，这里会退回完整扫描 */
+        if (SD_FastMount_Restore(owner_fs)) {
+            LOG_INFO("sd_owner: fast mount record valid");
+        }
+    }
+    return res;
+}
+
+static void owner_to_usb(void)
+{
+    uint32_t t0 = HighResTimer_GetUs();
+    uint8_t i;
+
+    owner = SD_OWNER_TO_USB;
+    LOG_INFO("sd_owner: USB host attached, releasing volume");
+
+    for (i = 0; i < client_count; i++) {
+        if (clients[i]->release != NULL) {
+            clients[i]->release();
+        }
+    }
+    if (mounted) {
+        int res = sd_io_call(SD_IO_PRIO_NORMAL, owner_unmount, NULL);
+
+        if (res != FR_OK) {
+            LOG_WARNING("sd_owner: unmount returned %d", res);
+        }
+        mounted = false;
+    }
+
+    owner = SD_OWNER_USB;
+    LOG_INFO("sd_owner: volume handed to USB in %lu us", (unsigned long)(HighResTimer_GetUs() - t0));
+}
+
+static void owner_to_firmware(void)
+{
+    uint32_t t0 = HighResTimer_GetUs();
+    int res;
+    uint8_t i;
+
+    /* 先让 MSC 拒绝新的读写，再等进行中的包写完，之后卡上不会再有主机的数据落下 */
+    owner = SD_OWNER_TO_FIRMWARE;
+    while (STORAGE_Busy_FS()) {
+        vTaskDelay(pdMS_TO_TICKS(SD_OWNER_IDLE_POLL_MS));
+    }
+
+    res = sd_io_call(SD_IO_PRIO_NORMAL, owner_mount, NULL);
+    mounted = (res == FR_OK);
+    if (mounted) {
+        LOG_INFO("sd_owner: volume remounted in %lu us", (unsigned long)(HighResTimer_GetUs() - t0));
+    } else {
+        LOG_ERROR("sd_owner: remount failed: %d", res);
+    }
+    owner = SD_OWNER_FIRMWARE;
+
+    for (i = 0; i < client_count; i++) {
+        if (clients[i]->remount != NULL) {
+            clients[i]->remount(mounted);
+        }
+    }
+}
+
+static void sd_owner_task(void *argument)
+{
+    TickType_t wait;
+
+    (void)argument;
+
+    for (;;) {
+        /* 主机持有介质且总线挂起时定期检查挂起时长 */
+        wait = (owner == SD_OWNER_USB && usb_suspended) ? pdMS_TO_TICKS(SD_OWNER_POLL_MS) : portMAX_DELAY;
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        if (usb_suspended && usb_want &&
+            (xTaskGetTickCount() - suspend_tick) >= pdMS_TO_TICKS(SD_OWNER_SUSPEND_MS)) {
+            LOG_INFO("sd_owner: USB suspended for %u ms, treating as detached", (unsigned)SD_OWNER_SUSPEND_MS);
+            usb_want = false;
+        }
+
+        if (usb_want && owner == SD_OWNER_FIRMWARE) {
+            owner_to_usb();
+        } else if (!usb_want && owner == SD_OWNER_USB) {
+            owner_to_firmware();
+        }
+    }
+}
+
+void sd_owner_init(FATFS *fs, const char *path, bool is_mounted)
+{
+    if (owner_task_handle != NULL || fs == NULL || path == NULL) {
+        return;
+    }
+
+    owner_fs = fs;
+    owner_path = path;
+    mounted = is_mounted;
+    owner_task_handle = xTaskCreateStatic(sd_owner_task,
+                                          "sd_owner",
+                                          SD_OWNER_STK_SIZE,
+                                          NULL,
+                                          SD_OWNER_TASK_PRIO,
+                                          owner_task_stack,
+                                          &owner_task_tcb);
+    /* 启动挂载期间主机可能已完成配置 */
+    owner_wake();
+}
+
+bool sd_owner_register(const sd_owner_client_t *client)
+{
+    bool ok = false;
+
+    if (client == NULL) {
+        return false;
+    }
+    taskENTER_CRITICAL();
+    if (client_count < SD_OWNER_MAX_CLIENTS) {
+        clients[client_count++] = client;
+        ok = true;
+    }
+    taskEXIT_CRITICAL();
+    return ok;
+}
+
+void sd_owner_usb_attach(void)
+{
+    usb_want = true;
+    usb_suspended = false;
+    owner_wake();
+}
+
+void sd_owner_usb_detach(void)
+{
+    usb_want = false;
+    owner_wake();
+}
+
+void sd_owner_usb_suspend(bool suspended)
+{
+    if (suspended) {
+        suspend_tick = xPortIsInsideInterrupt() ? xTaskGetTickCountFromISR() : xTaskGetTickCount();
+    }
+    usb_suspended = suspended;
+    owner_wake();
+}
+
+sd_owner_t sd_owner_get(void)
+{
+    return (sd_owner_t)owner;
+}
+
+bool sd_owner_usb_active(void)
+{
+    return owner == SD_OWNER_USB;
+}
+
+bool sd_owner_mounted(void)
+{
+    return mounted;
+}
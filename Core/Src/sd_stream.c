@@ -0,0 +1,278 @@
+/**
+ * @file sd_stream.c
+ * @brief SD卡流式日志文件实现
+ *
+ * 打开文件时用 f_expand 一次性分配连续簇，之后的数据按扇区直接调用 disk_write
+ * 写入预分配区域，不再经过 FatFs 的簇链查找/扩展和窗口缓冲，写入路径上没有 FAT 分配。
+ * 文件写满预分配大小后自动关闭并轮转到下一个序号的文件；关闭时把文件长度截断为实际写入量。
+ * 文件只新建不覆盖：序号对应的文件已存在时跳到下一个序号，之前的记录不会被截断。
+ * 预分配和截断都会改写 FAT，完成后立即更新 EEPROM 中的空闲簇记录（见 sd_fastmount），
+ * 下次上电挂载不必扫描整张 FAT；扇区直写只改数据区，不会使记录失效。
+ *
+ * 注意：文件打开期间目录项中的长度是预分配长度，异常掉电后文件末尾为未写入的旧数据，
+ *       上层格式需自带同步标记（见 recorder）。
+ */
+
+#include "sd_stream.h"
+#include "diskio.h"
+#include "sd_io_sched.h"
+#include "sd_fastmount.h"
+#define LOG_MODULE LOG_MOD_SD
+#include "log.h"
+#include <string.h>
+#include <stdio.h>
+
+/* 单次 disk_write 最大扇区数，限制持有卷锁的时间 */
+#define SD_STREAM_MAX_BURST     64U
+
+/* 文件序号上限（文件名中的四位数字） */
+#define SD_STREAM_MAX_INDEX     9999U
+
+/**
+ * @brief 获取卷访问权（与 FatFs 自身的 _FS_REENTRANT 锁互斥）
+ */
+static int stream_lock(sd_stream_t *st)
+{
+#if _FS_REENTRANT
+    return ff_req_grant(st->fil.obj.fs->sobj);
+#else
+    (void)st;
+    return 1;
+#endif
+}
+
+static void stream_unlock(sd_stream_t *st)
+{
+#if _FS_REENTRANT
+    ff_rel_grant(st->fil.obj.fs->sobj);
+#else
+    (void)st;
+#endif
+}
+
+/**
+ * @brief 直接写扇区到当前文件的预分配区域
+ */
+static FRESULT stream_write_sectors(sd_stream_t *st, const uint8_t *buf, uint32_t sector_ofs, uint32_t count)
+{
+    DRESULT dres;
+
+    /* 调度器运行时以后台优先级提交，让出界面等高优先级请求 */
+    if (sd_io_running()) {
+        dres = sd_io_write(SD_IO_PRIO_BACKGROUND, buf, st->start_sector + sector_ofs, count);
+        return (dres == RES_OK) ? FR_OK : FR_DISK_ERR;
+    }
+
+    if (!stream_lock(st)) {
+        return FR_TIMEOUT;
+    }
+    dres = disk_write(st->fil.obj.fs->drv, buf, st->start_sector + sector_ofs, count);
+    stream_unlock(st);
+
+    return (dres == RES_OK) ? FR_OK : FR_DISK_ERR;
+}
+
+/**
+ * @brief 从当前序号起新建第一个不存在的文件并预分配连续空间
+ */
+static FRESULT stream_open_current(sd_stream_t *st)
+{
+    char path[8 + SD_STREAM_PREFIX_LEN + 12];
+    FATFS *fs;
+    FRESULT res;
+
+    for (;;) {
+        if (st->index > SD_STREAM_MAX_INDEX) {
+            LOG_ERROR("sd_stream: no free file index for %s%s_*.bin", st->dir, st->prefix);
+            return FR_EXIST;
+        }
+        snprintf(path, sizeof(path), "%s%s_%04lu.bin", st->dir, st->prefix, (unsigned long)st->index);
+
+        /* 不覆盖已有文件：已存在时换下一个序号 */
+        res = f_open(&st->fil, path, FA_CREATE_NEW | FA_WRITE);
+        if (res != FR_EXIST) {
+            break;
+        }
+        st->index++;
+    }
+    if (res != FR_OK) {
+        LOG_ERROR("sd_stream: open %s failed: %d", path, res);
+        return res;
+    }
+
+    /* 一次性分配连续簇，写入时不再触碰 FAT */
+    res = f_expand(&st->fil, st->file_size, 1);
+    if (res == FR_OK) {
+        /* 立即提交目录项和 FAT，掉电时不会留下丢失簇 */
+        res = f_sync(&st->fil);
+    }
+    if (res != FR_OK) {
+        LOG_ERROR("sd_stream: expand %s to %lu bytes failed: %d", path, (unsigned long)st->file_size, res);
+        f_close(&st->fil);
+        f_unlink(path);
+        return res;
+    }
+
+    fs = st->fil.obj.fs;
+    SD_FastMount_Checkpoint(fs);
+    st->start_sector = fs->database + (st->fil.obj.sclust - 2) * fs->csize;
+    st->sector_count = st->file_size / SD_STREAM_SECTOR_SIZE;
+    st->sector_pos = 0;
+    st->bytes_written = 0;
+    st->tail_len = 0;
+    st->is_open = 1;
+
+    LOG_DEBUG("sd_stream: %s at LBA %lu, %lu sectors", path,
+              (unsigned long)st->start_sector, (unsigned long)st->sector_count);
+    return FR_OK;
+}
+
+/**
+ * @brief 落盘尾部扇区并把文件截断为实际长度
+ */
+static FRESULT stream_close_current(sd_stream_t *st)
+{
+    FATFS *fs = st->fil.obj.fs;
+    FRESULT res;
+
+    if (!st->is_open) {
+        return FR_OK;
+    }
+    st->is_open = 0;
+
+    res = sd_stream_sync(st);
+
+    /* 截断到实际写入长度，释放未用的预分配簇 */
+    if (res == FR_OK && st->bytes_written < st->fil.obj.objsize) {
+        res = f_lseek(&st->fil, st->bytes_written);
+        if (res == FR_OK) {
+            res = f_truncate(&st->fil);
+        }
+    }
+
+    if (f_close(&st->fil) != FR_OK && res == FR_OK) {
+        res = FR_DISK_ERR;
+    }
+    if (res == FR_OK) {
+        SD_FastMount_Checkpoint(fs);
+    }
+    return res;
+}
+
+FRESULT sd_stream_open(sd_stream_t *st, const char *dir, const char *prefix, uint32_t file_size)
+{
+    if (st == NULL || dir == NULL || prefix == NULL) {
+        return FR_INVALID_PARAMETER;
+    }
+
+    memset(st, 0, sizeof(*st));
+    strncpy(st->dir, dir, sizeof(st->dir) - 1);
+    strncpy(st->prefix, prefix, sizeof(st->prefix) - 1);
+
+    /* 文件大小按扇区向下对齐 */
+    st->file_size = file_size & ~(SD_STREAM_SECTOR_SIZE - 1U);
+    if (st->file_size == 0) {
+        return FR_INVALID_PARAMETER;
+    }
+
+    return stream_open_current(st);
+}
+
+FRESULT sd_stream_rotate(sd_stream_t *st)
+{
+    FRESULT res = stream_close_current(st);
+
+    if (res != FR_OK) {
+        LOG_WARNING("sd_stream: close before rotate returned %d", res);
+    }
+    st->index++;
+    st->rotations++;
+    return stream_open_current(st);
+}
+
+FRESULT sd_stream_write(sd_stream_t *st, const void *data, uint32_t len)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    FRESULT res;
+
+    if (st == NULL || !st->is_open) {
+        return FR_INVALID_OBJECT;
+    }
+
+    while (len > 0) {
+        /* 预分配区域已写满，轮转到下一个文件 */
+        if (st->sector_pos >= st->sector_count) {
+            res = sd_stream_rotate(st);
+            if (res != FR_OK) {
+                return res;
+            }
+        }
+
+        if (st->tail_len == 0 && len >= SD_STREAM_SECTOR_SIZE && ((uint32_t)src & 0x3U) == 0) {
+            /* 快路径：整扇区、对齐，直接从调用者缓冲区 DMA 写入 */
+            uint32_t n = len / SD_STREAM_SECTOR_SIZE;
+            uint32_t room = st->sector_count - st->sector_pos;
+
+            if (n > room) {
+                n = room;
+            }
+            if (n > SD_STREAM_MAX_BURST) {
+                n = SD_STREAM_MAX_BURST;
+            }
+
+            res = stream_write_sectors(st, src, st->sector_pos, n);
+            if (res != FR_OK) {
+                return res;
+            }
+            st->sector_pos += n;
+            st->bytes_written += n * SD_STREAM_SECTOR_SIZE;
+            src += n * SD_STREAM_SECTOR_SIZE;
+            len -= n * SD_STREAM_SECTOR_SIZE;
+        } else {
+            /* 慢路径：拼接到尾部缓冲区，凑满一个扇区再写 */
+            uint32_t n = SD_STREAM_SECTOR_SIZE - st->tail_len;
+
+            if (n > len) {
+                n = len;
+            }
+            memcpy(&st->tail[st->tail_len], src, n);
+            st->tail_len += n;
+            st->bytes_written += n;
+            src += n;
+            len -= n;
+
+            if (st->tail_len == SD_STREAM_SECTOR_SIZE) {
+                res = stream_write_sectors(st, st->tail, st->sector_pos, 1);
+                if (res != FR_OK) {
+                    return res;
+                }
+                st->sector_pos++;
+                st->tail_len = 0;
+            }
+        }
+    }
+
+    return FR_OK;
+}
+
+FRESULT sd_stream_sync(sd_stream_t *st)
+{
+    if (st == NULL) {
+        return FR_INVALID_OBJECT;
+    }
+    if (st->tail_len == 0 || st->sector_pos >= st->sector_count) {
+        return FR_OK;
+    }
+
+    /* 尾部补零后写入当前扇区，写指针不前进，后续数据会覆盖补零部分 */
+    memset(&st->tail[st->tail_len], 0, SD_STREAM_SECTOR_SIZE - st->tail_len);
+    return stream_write_sectors(st, st->tail, st->sector_pos, 1);
+}
+
+FRESULT sd_stream_close(sd_stream_t *st)
+{
+    if (st == NULL) {
+        return FR_INVALID_OBJECT;
+    }
+    return stream_close_current(st);
+}
@@ -25,6 +25,11 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "dma.h"
+#include "high_res_timer.h"
+#include "rtos_trace.h"
+#include "uart_drv.h"
+#include "touch_service.h"
+#include "i2c.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -185,19 +190,13 @@ void TIM1_UP_TIM10_IRQHandler(void)
 void USART1_IRQHandler(void)
 {
   /* USER CODE BEGIN USART1_IRQn 0 */
-  /* 处理IDLE中断 */
-  if (__HAL_UART_GET_FLAG(&huart1, UART_FLAG_IDLE) != RESET)
-  {
-    /* 清除IDLE标志 */
-    __HAL_UART_CLEAR_IDLEFLAG(&huart1);
-    
-    /* 调用IDLE回调函数 */
-    HAL_UART_IdleCpltCallback(&huart1);
-  }
+  RTOS_TRACE_ISR_ENTER();
+  /* 处理IDLE中断（接收 DMA 为循环模式，见 uart_drv.c） */
+  uart_drv_usart_irq(UART_PORT_CONSOLE);
   /* USER CODE END USART1_IRQn 0 */
   HAL_UART_IRQHandler(&huart1);
   /* USER CODE BEGIN USART1_IRQn 1 */
-
+  RTOS_TRACE_ISR_EXIT();
   /* USER CODE END USART1_IRQn 1 */
 }
 
@@ -207,11 +206,11 @@ void USART1_IRQHandler(void)
 void SDIO_IRQHandler(void)
 {
   /* USER CODE BEGIN SDIO_IRQn 0 */
-
+  RTOS_TRACE_ISR_ENTER();
   /* USER CODE END SDIO_IRQn 0 */
   HAL_SD_IRQHandler(&hsd);
   /* USER CODE BEGIN SDIO_IRQn 1 */
-
+  RTOS_TRACE_ISR_EXIT();
   /* USER CODE END SDIO_IRQn 1 */
 }
 
@@ -225,11 +224,12 @@ receive DMA stream. */
 DMA2_Stream2_IRQHandler(void)
 {
   /* USER CODE BEGIN DMA2_Stream2_IRQn 0 */
-
+  RTOS_TRACE_ISR_ENTER();
   /* USER CODE END DMA2_Stream2_IRQn 0 */
   HAL_DMA_IRQHandler(&hdma_usart1_rx);
   /* USER CODE BEGIN DMA2_Stream2_IRQn 1 */
-
+  uart_drv_rx_dma_irq(UART_PORT_CONSOLE);
+  RTOS_TRACE_ISR_EXIT();
   /* USER CODE END DMA2_Stream2_IRQn 1 */
 }
 
@@ -239,11 +239,11 @@ DMA2_Stream2_IRQHandler(void)
 void DMA2_Stream3_IRQHandler(void)
 {
   /* USER CODE BEGIN DMA2_Stream3_IRQn 0 */
-
+  RTOS_TRACE_ISR_ENTER();
   /* USER CODE END DMA2_Stream3_IRQn 0 */
   HAL_DMA_IRQHandler(&hdma_sdio_rx);
   /* USER CODE BEGIN DMA2_Stream3_IRQn 1 */
-
+  RTOS_TRACE_ISR_EXIT();
   /* USER CODE END DMA2_Stream3_IRQn 1 */
 }
 
@@ -253,11 +253,11 @@ void DMA2_Stream3_IRQHandler(void)
 void OTG_FS_IRQHandler(void)
 {
   /* USER CODE BEGIN OTG_FS_IRQn 0 */
-
+  RTOS_TRACE_ISR_ENTER();
   /* USER CODE END OTG_FS_IRQn 0 */
   HAL_PCD_IRQHandler(&hpcd_USB_OTG_FS);
   /* USER CODE BEGIN OTG_FS_IRQn 1 */
-
+  RTOS_TRACE_ISR_EXIT();
   /* USER CODE END OTG_FS_IRQn 1 */
 }
 
@@ -267,11 +267,11 @@ void OTG_FS_IRQHandler(void)
 void DMA2_Stream6_IRQHandler(void)
 {
   /* USER CODE BEGIN DMA2_Stream6_IRQn 0 */
-
+  RTOS_TRACE_ISR_ENTER();
   /* USER CODE END DMA2_Stream6_IRQn 0 */
   HAL_DMA_IRQHandler(&hdma_sdio_tx);
   /* USER CODE BEGIN DMA2_Stream6_IRQn 1 */
-
+  RTOS_TRACE_ISR_EXIT();
   /* USER CODE END DMA2_Stream6_IRQn 1 */
 }
 
@@ -282,7 +282,77 @@ void DMA2_Stream6_IRQHandler(void)
   */
 void DMA2_Stream0_IRQHandler(void)
 {
+    RTOS_TRACE_ISR_ENTER();
     HAL_DMA_IRQHandler(&hdma_lcd);
+    RTOS_TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles DMA2 stream7 global interrupt (USART1 TX DMA).
+  */
+void DMA2_Stream7_IRQHandler(void)
+{
+    RTOS_TRACE_ISR_ENTER();
+    HAL_DMA_IRQHandler(&hdma_usart1_tx);
+    RTOS_TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles TIM2 global interrupt (high resolution time base overflow).
+  */
+void TIM2_IRQHandler(void)
+{
+    HighResTimer_IRQHandler();
+}
+
+/**
+  * @brief This function handles EXTI line1 interrupt (GT9xxx touch INT, PB1).
+  */
+void EXTI1_IRQHandler(void)
+{
+    RTOS_TRACE_ISR_ENTER();
+    touch_service_irq();
+    RTOS_TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles I2C1 event interrupt.
+  */
+void I2C1_EV_IRQHandler(void)
+{
+    RTOS_TRACE_ISR_ENTER();
+    HAL_I2C_EV_IRQHandler(&hi2c1);
+    RTOS_TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles I2C1 error interrupt.
+  */
+void I2C1_ER_IRQHandler(void)
+{
+    RTOS_TRACE_ISR_ENTER();
+    HAL_I2C_ER_IRQHandler(&hi2c1);
+    RTOS_TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles DMA1 stream0 global interrupt (I2C1 RX DMA).
+  */
+void DMA1_Stream0_IRQHandler(void)
+{
+    RTOS_TRACE_ISR_ENTER();
+    HAL_DMA_IRQHandler(&hdma_i2c1_rx);
+    RTOS_TRACE_ISR_EXIT();
+}
+
+/**
+  * @brief This function handles DMA1 stream6 global interrupt (I2C1 TX DMA).
+  */
+void DMA1_Stream6_IRQHandler(void)
+{
+    RTOS_TRACE_ISR_ENTER();
+    HAL_DMA_IRQHandler(&hdma_i2c1_tx);
+    RTOS_TRACE_ISR_EXIT();
 }
 
 /* USER CODE END 1 */
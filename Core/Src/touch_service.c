@@ -0,0 +1,202 @@
+/**
+ * @file touch_service.c
+ * @brief 触摸采集服务实现
+ *
+ * 只有采集任务访问触摸芯片（初始化在调度器启动前完成），I2C 不需要加锁。
+ * 队列由采集任务写入、LVGL 任务读出；队列满时丢最旧的样本，保证最新状态（尤其是松开）能送到。
+ */
+
+#include "touch_service.h"
+#define LOG_MODULE LOG_MOD_TOUCH
+#include "log.h"
+#include "touch.h"
+#include "gt9xxx.h"
+#include "high_res_timer.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/* 采集任务配置：高于 LVGL 任务，样本在 LVGL 下次读取前就绪 */
+#define TOUCH_SERVICE_TASK_PRIO     (tskIDLE_PRIORITY + 5)
+#define TOUCH_SERVICE_STK_SIZE      256                     /* 任务堆栈大小(字) */
+
+/* GT9XXX_INT_GPIO_PIN（PB1）对应的中断，优先级在 FreeRTOS 可管理范围内 */
+#define TOUCH_SERVICE_EXTI_IRQn     EXTI1_IRQn
+#define TOUCH_SERVICE_IRQ_PRIO      6
+
+/* 延迟滑动平均：每个样本向新值靠近 1/8 */
+#define TOUCH_SERVICE_AVG_SHIFT     3U
+
+static StaticTask_t touch_task_tcb;
+static StackType_t touch_task_stack[TOUCH_SERVICE_STK_SIZE];
+static TaskHandle_t touch_task_handle;
+
+static StaticQueue_t touch_queue_ctrl;
+static uint8_t touch_queue_buf[TOUCH_SERVICE_QUEUE_LEN * sizeof(touch_sample_t)];
+static QueueHandle_t touch_queue;
+
+static volatile uint32_t irq_time_us;           /* 最近一次 INT 中断的时刻 */
+static touch_sample_t last_sample;              /* 最近放入队列的样本（仅采集任务访问） */
+static touch_service_stats_t touch_stats;
+
+static TIME_STAT_DEFINE(touch_read_stat, "touch read");
+
+/**
+ * @brief 状态或坐标变化时放入队列
+ */
+static void touch_service_push(uint32_t time_us, uint16_t x, uint16_t y, bool pressed)
+{
+    touch_sample_t sample;
+    touch_sample_t old;
+
+    if (pressed == last_sample.pressed && (!pressed || (x == last_sample.x && y == last_sample.y))) {
+        return;
+    }
+    sample.time_us = time_us;
+    sample.x = pressed ? x : last_sample.x;
+    sample.y = pressed ? y : last_sample.y;
+    sample.pressed = pressed;
+
+    if (xQueueSend(touch_queue, &sample, 0) != pdPASS) {
+        (void)xQueueReceive(touch_queue, &old, 0);
+        touch_stats.dropped++;
+        (void)xQueueSend(touch_queue, &sample, 0);
+    }
+    touch_stats.samples++;
+    last_sample = sample;
+}
+
+/**
+ * @brief GT9xxx：读一帧
+ * @param time_us 样本时间戳
+ */
+static void touch_service_read_gt(uint32_t time_us)
+{
+    uint16_t x = last_sample.x;
+    uint16_t y = last_sample.y;
+    uint8_t num;
+
+    {
+        TIME_SCOPE(touch_read_stat);
+        num = gt9xxx_read_point(&x, &y);
+    }
+    touch_stats.reads++;
+    if (num != GT9XXX_NO_DATA) {
+        touch_service_push(time_us, x, y, num > 0U);
+    }
+}
+
+/**
+ * @brief 其他触摸芯片：轮询一次
+ */
+static void touch_service_read_poll(void)
+{
+    {
+        TIME_SCOPE(touch_read_stat);
+        tp_dev.scan(0);
+    }
+    touch_stats.reads++;
+    touch_service_push(HighResTimer_GetUs(), tp_dev.x[0], tp_dev.y[0], (tp_dev.sta & TP_PRES_DOWN) != 0U);
+}
+
+static void touch_service_task(void *argument)
+{
+    uint32_t timeout_ms;
+
+    (void)argument;
+
+    for (;;) {
+        if (!touch_stats.irq_mode) {
+            vTaskDelay(pdMS_TO_TICKS(TOUCH_SERVICE_POLL_MS));
+            touch_service_read_poll();
+            continue;
+        }
+        /* INT 两个沿都触发（触发沿由芯片配置决定），一帧内的多次通知在这里合并 */
+        timeout_ms = last_sample.pressed ? TOUCH_SERVICE_HOLD_MS : TOUCH_SERVICE_IDLE_MS;
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) != 0U) {
+            touch_service_read_gt(irq_time_us);
+        } else {
+            touch_service_read_gt(HighResTimer_GetUs());
+        }
+    }
+}
+
+void touch_service_irq(void)
+{
+    BaseType_t woken = pdFALSE;
+
+    if (__HAL_GPIO_EXTI_GET_IT(GT9XXX_INT_GPIO_PIN) == 0U) {
+        return;
+    }
+    __HAL_GPIO_EXTI_CLEAR_IT(GT9XXX_INT_GPIO_PIN);
+    irq_time_us = HighResTimer_GetUs();
+    touch_stats.irqs++;
+    if (touch_task_handle != NULL) {
+        vTaskNotifyGiveFromISR(touch_task_handle, &woken);
+        portYIELD_FROM_ISR(woken);
+    }
+}
+
+/**
+ * @brief INT 引脚改为 EXTI 输入（gt9xxx_init 复位芯片后已是浮空输入）
+ */
+static void touch_service_exti_init(void)
+{
+    GPIO_InitTypeDef gpio_init_struct = {0};
+
+    gpio_init_struct.Pin = GT9XXX_INT_GPIO_PIN;
+    gpio_init_struct.Mode = GPIO_MODE_IT_RISING_FALLING;
+    gpio_init_struct.Pull = GPIO_NOPULL;
+    gpio_init_struct.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(GT9XXX_INT_GPIO_PORT, &gpio_init_struct);
+
+    HAL_NVIC_SetPriority(TOUCH_SERVICE_EXTI_IRQn, TOUCH_SERVICE_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(TOUCH_SERVICE_EXTI_IRQn);
+}
+
+void touch_service_init(void)
+{
+    touch_queue = xQueueCreateStatic(TOUCH_SERVICE_QUEUE_LEN, sizeof(touch_sample_t),
+                                     touch_queue_buf, &touch_queue_ctrl);
+
+    touch_stats.irq_mode = ((tp_dev.touchtype & 0X80) != 0U && tp_dev.scan == gt9xxx_scan);
+    if (touch_stats.irq_mode) {
+        touch_service_exti_init();
+    }
+    LOG_INFO("touch: %s", touch_stats.irq_mode ? "GT9xxx INT" : "polling");
+
+    touch_task_handle = xTaskCreateStatic(touch_service_task, "touch", TOUCH_SERVICE_STK_SIZE, NULL,
+                                          TOUCH_SERVICE_TASK_PRIO, touch_task_stack, &touch_task_tcb);
+}
+
+bool touch_service_get(touch_sample_t *sample)
+{
+    uint32_t latency;
+
+    if (touch_queue == NULL || xQueueReceive(touch_queue, sample, 0) != pdPASS) {
+        return false;
+    }
+    latency = HighResTimer_GetUs() - sample->time_us;
+    if (latency > touch_stats.latency_max_us) {
+        touch_stats.latency_max_us = latency;
+    }
+    if (touch_stats.latency_avg_us == 0U) {
+        touch_stats.latency_avg_us = latency;
+    } else {
+        touch_stats.latency_avg_us = touch_stats.latency_avg_us
+            - (touch_stats.latency_avg_us >> TOUCH_SERVICE_AVG_SHIFT) + (latency >> TOUCH_SERVICE_AVG_SHIFT);
+    }
+    return true;
+}
+
+uint32_t touch_service_pending(void)
+{
+    return (touch_queue != NULL) ? (uint32_t)uxQueueMessagesWaiting(touch_queue) : 0U;
+}
+
+void touch_service_get_stats(touch_service_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = touch_stats;
+    taskEXIT_CRITICAL();
+}
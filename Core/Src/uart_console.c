@@ -0,0 +1,119 @@
+/**
+ * @file uart_console.c
+ * @brief 串口控制台接收任务实现
+ */
+
+#include "uart_console.h"
+#include "uart_drv.h"
+#include "uart_proto.h"
+#include "log.h"
+#include "rtos_trace.h"
+#include "cpu_load.h"
+#include "recorder.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+
+/* 接收任务优先级：高于 LVGL 任务，缓冲区被覆盖前一定能取走 */
+#define UART_CONSOLE_TASK_PRIO  (tskIDLE_PRIORITY + 5)
+
+/* 没有数据时的最长等待时间（毫秒），到时也解析一次，让不完整的帧能够超时 */
+#define UART_CONSOLE_POLL_MS    100U
+
+/* 接收任务栈（字），命令行输出用到 printf；静态分配，不占 FreeRTOS 堆 */
+#define UART_CONSOLE_STK_SIZE   512
+static StaticTask_t uart_console_task_tcb;
+static StackType_t uart_console_task_stack[UART_CONSOLE_STK_SIZE];
+
+/* 命令行缓冲区（接收数据按行拼接，遇到回车或换行执行） */
+#define UART_CMD_LINE_MAX 64
+static char uart_cmd_line[UART_CMD_LINE_MAX];
+static uint16_t uart_cmd_len = 0;
+
+/**
+ * @brief 把接收到的数据拼成命令行并执行
+ * @param data 数据
+ * @param len 长度
+ */
+static void UART_Cmd_Input(const uint8_t *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        if (data[i] == '\r' || data[i] == '\n')
+        {
+            if (uart_cmd_len > 0)
+            {
+                uart_cmd_line[uart_cmd_len] = '\0';
+                if (!log_command(uart_cmd_line)
+                    && !cpu_load_command(uart_cmd_line)
+                    && !uart_drv_command(uart_cmd_line)
+                    && !recorder_command(uart_cmd_line)
+#if RTOS_TRACE_ENABLE
+                    && !rtos_trace_command(uart_cmd_line)
+#endif
+                    )
+                {
+                    printf("unknown command: %s\r\n", uart_cmd_line);
+                }
+                uart_cmd_len = 0;
+            }
+        }
+        else if (uart_cmd_len < UART_CMD_LINE_MAX - 1)
+        {
+            uart_cmd_line[uart_cmd_len++] = (char)data[i];
+        }
+    }
+}
+
+/**
+ * @brief 处理一段文本
+ * @param data 数据
+ * @param len 长度
+ */
+static void uart_console_text(const uint8_t *data, uint16_t len)
+{
+    /* 回显 */
+    uart_drv_write(UART_PORT_CONSOLE, data, len);
+
+    /* 命令行（如 "log sd debug"） */
+    UART_Cmd_Input(data, len);
+}
+
+/**
+ * @brief 串口控制台接收任务
+ * @param argument 任务参数
+ * @retval None
+ */
+static void uart_console_task(void *argument)
+{
+    const uint8_t *ring;
+    uint32_t size;
+    uint32_t read;
+    uint32_t written;
+
+    (void)argument;
+
+    uart_proto_init(uart_console_text);
+
+    /* 任务循环：等待数据到达，二进制帧就地解析分发，不完整的帧留在缓冲区中 */
+    for(;;)
+    {
+        (void)uart_drv_wait(UART_PORT_CONSOLE, UART_CONSOLE_POLL_MS);
+        written = uart_drv_rx_peek(UART_PORT_CONSOLE, &ring, &size, &read);
+        uart_proto_input(ring, size, &read, written);
+        uart_drv_rx_consume(UART_PORT_CONSOLE, read);
+    }
+}
+
+void uart_console_init(void)
+{
+    xTaskCreateStatic(
+        uart_console_task,          // 任务函数
+        "uartConsole",              // 任务名称
+        UART_CONSOLE_STK_SIZE,      // 栈大小(单位是字，不是字节)
+        NULL,                       // 参数
+        UART_CONSOLE_TASK_PRIO,     // 优先级
+        uart_console_task_stack,    // 任务栈
+        &uart_console_task_tcb      // 任务控制块
+    );
+}
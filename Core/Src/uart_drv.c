@@ -0,0 +1,471 @@
+/**
+ * @file uart_drv.c
+ * @brief 串口驱动实现
+ *
+ * 接收：写入位置只在接收 DMA 中断中更新，取走位置只在读取任务中更新，两边各写各的，不需要加锁。
+ * 发送：串口与发送 DMA 中断优先级为 0，高于 FreeRTOS 可管理的范围，缓冲区用关中断保护（只做一次 memcpy），
+ * 发送完成回调里也不调用 FreeRTOS 接口；任务等待缓冲区空间时按节拍轮询。
+ * 累计字节数都用 32 位无符号数，相减得到缓冲区占用，回绕不影响。
+ */
+
+#include "uart_drv.h"
+#include "usart.h"
+#include "high_res_timer.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* 单次 DMA 传输的最大长度（NDTR 为16位） */
+#define UART_DRV_MAX_XFER       0xFFFFU
+
+#if (UART_DRV_CONSOLE_RX_SIZE & (UART_DRV_CONSOLE_RX_SIZE - 1U)) != 0U || \
+    (UART_DRV_CONSOLE_TX_SIZE & (UART_DRV_CONSOLE_TX_SIZE - 1U)) != 0U
+#error "UART_DRV_CONSOLE_RX_SIZE and UART_DRV_CONSOLE_TX_SIZE must be powers of 2"
+#endif
+#if UART_DRV_CONSOLE_RX_SIZE > UART_DRV_MAX_XFER
+#error "UART_DRV_CONSOLE_RX_SIZE must fit the 16-bit NDTR"
+#endif
+
+typedef struct {
+    /* 配置 */
+    const char *name;
+    UART_HandleTypeDef *huart;
+    DMA_HandleTypeDef *hdma_rx;
+    IRQn_Type rx_dma_irq;               /* IDLE 时挂起的接收 DMA 中断 */
+    uint8_t *rx_ring;
+    uint32_t rx_size;
+    uint8_t *tx_ring;
+    uint32_t tx_size;
+
+    /* 接收 */
+    uint32_t rx_dma_pos;                /* 上次发布时 DMA 的写入位置（仅接收 DMA 中断访问） */
+    volatile uint32_t rx_written;       /* 累计写入字节数（接收 DMA 中断发布） */
+    uint32_t rx_read;                   /* 累计取走字节数（仅读取任务访问） */
+    TaskHandle_t volatile rx_task;      /* 读取任务 */
+
+    /* 发送 */
+    volatile uint32_t tx_head;          /* 累计写入字节数 */
+    volatile uint32_t tx_tail;          /* 累计发出字节数 */
+    uint32_t tx_len;                    /* 正在发送的长度，0 表示 DMA 空闲 */
+    volatile uint32_t block_ms;
+
+    uart_drv_stats_t stats;
+} uart_drv_port_t;
+
+static uint8_t console_rx_ring[UART_DRV_CONSOLE_RX_SIZE];
+static uint8_t console_tx_ring[UART_DRV_CONSOLE_TX_SIZE];
+
+static uart_drv_port_t ports[UART_PORT_COUNT] = {
+    [UART_PORT_CONSOLE] = {
+        .name = "console",
+        .huart = &huart1,
+        .hdma_rx = &hdma_usart1_rx,
+        .rx_dma_irq = DMA2_Stream2_IRQn,
+        .rx_ring = console_rx_ring,
+        .rx_size = UART_DRV_CONSOLE_RX_SIZE,
+        .tx_ring = console_tx_ring,
+        .tx_size = UART_DRV_CONSOLE_TX_SIZE,
+        .block_ms = UART_DRV_BLOCK_MS,
+    },
+};
+
+/**
+ * @brief 启动循环接收（初始化和 DMA 出错后调用）
+ */
+static void uart_drv_rx_start(uart_drv_port_t *p)
+{
+    p->rx_dma_pos = 0;
+
+    /* 半满、全满和传输错误中断；不设 HAL 回调，处理在 uart_drv_rx_dma_irq 中 */
+    __HAL_DMA_ENABLE_IT(p->hdma_rx, DMA_IT_HT | DMA_IT_TC | DMA_IT_TE);
+    HAL_DMA_Start(p->hdma_rx, (uint32_t)&p->huart->Instance->DR, (uint32_t)p->rx_ring, p->rx_size);
+
+    /* 串口产生 DMA 请求，并打开 IDLE 中断 */
+    SET_BIT(p->huart->Instance->CR3, USART_CR3_DMAR);
+    __HAL_UART_ENABLE_IT(p->huart, UART_IT_IDLE);
+}
+
+void uart_drv_init(void)
+{
+    for (uint32_t i = 0; i < UART_PORT_COUNT; i++) {
+        uart_drv_rx_start(&ports[i]);
+    }
+}
+
+void uart_drv_usart_irq(uart_port_t port)
+{
+    uart_drv_port_t *p = &ports[port];
+    uint32_t sr = p->huart->Instance->SR;
+
+    if ((sr & USART_SR_IDLE) == 0U) {
+        return;
+    }
+    if ((sr & (USART_SR_ORE | USART_SR_FE | USART_SR_NE)) != 0U) {
+        p->stats.rx_line_errors++;
+    }
+    /* 读 SR 再读 DR 清除 IDLE；RXNE 置位时 DR 留给 DMA 读，DMA 的读取同样清除标志 */
+    if ((sr & USART_SR_RXNE) == 0U) {
+        (void)p->huart->Instance->DR;
+    }
+    /* 本中断不能调用 FreeRTOS 接口，由接收 DMA 中断发布位置并通知任务 */
+    NVIC_SetPendingIRQ(p->rx_dma_irq);
+}
+
+void uart_drv_rx_dma_irq(uart_port_t port)
+{
+    uart_drv_port_t *p = &ports[port];
+    uint32_t start = HighResTimer_GetCycles();
+    BaseType_t woken = pdFALSE;
+    TaskHandle_t task;
+    uint32_t pos;
+
+    pos = p->rx_size - __HAL_DMA_GET_COUNTER(p->hdma_rx);
+    p->rx_written += (pos - p->rx_dma_pos) & (p->rx_size - 1U);
+    p->rx_dma_pos = pos & (p->rx_size - 1U);
+    p->stats.rx_events++;
+
+    /* 传输错误时 HAL 已停止数据流，从缓冲区开头重新开始 */
+    if (p->hdma_rx->State != HAL_DMA_STATE_BUSY) {
+        p->stats.rx_dma_errors++;
+        uart_drv_rx_start(p);
+    }
+
+    task = p->rx_task;
+    if (task != NULL) {
+        vTaskNotifyGiveFromISR(task, &woken);
+    }
+    p->stats.rx_isr_cycles += HighResTimer_GetCycles() - start;
+    portYIELD_FROM_ISR(woken);
+}
+
+uint32_t uart_drv_rx_peek(uart_port_t port, const uint8_t **ring, uint32_t *size, uint32_t *read)
+{
+    uart_drv_port_t *p = &ports[port];
+    uint32_t written = p->rx_written;
+    uint32_t avail = written - p->rx_read;
+
+    if (avail > p->stats.rx_high_water) {
+        p->stats.rx_high_water = avail;
+    }
+    /* 被 DMA 追上一圈：这段数据已不完整，全部丢弃 */
+    if (avail > p->rx_size) {
+        p->stats.rx_overflows++;
+        p->stats.rx_lost += avail;
+        p->rx_read = written;
+    }
+    *ring = p->rx_ring;
+    *size = p->rx_size;
+    *read = p->rx_read;
+    return written;
+}
+
+void uart_drv_rx_consume(uart_port_t port, uint32_t read)
+{
+    ports[port].rx_read = read;
+}
+
+uint32_t uart_drv_readable(uart_port_t port)
+{
+    return ports[port].rx_written - ports[port].rx_read;
+}
+
+uint32_t uart_drv_wait(uart_port_t port, uint32_t timeout_ms)
+{
+    ports[port].rx_task = xTaskGetCurrentTaskHandle();
+    /* 检查与等待之间到达的数据留下通知计数，ulTaskNotifyTake 会立即返回 */
+    if (uart_drv_readable(port) == 0U) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    }
+    return uart_drv_readable(port);
+}
+
+uint32_t uart_drv_read(uart_port_t port, void *buf, uint32_t len)
+{
+    const uint8_t *ring;
+    uint32_t size;
+    uint32_t read;
+    uint32_t written = uart_drv_rx_peek(port, &ring, &size, &read);
+    uint32_t ofs = read & (size - 1U);
+    uint32_t first;
+
+    if (len > written - read) {
+        len = written - read;
+    }
+    first = size - ofs;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(buf, &ring[ofs], first);
+    memcpy((uint8_t *)buf + first, ring, len - first);
+    uart_drv_rx_consume(port, read + len);
+    return len;
+}
+
+/**
+ * @brief DMA 空闲时发送缓冲区中最长的连续一段（调用者已关中断）
+ */
+static void uart_drv_tx_kick(uart_drv_port_t *p)
+{
+    uint32_t avail;
+    uint32_t ofs;
+    uint32_t len;
+
+    if (p->tx_len != 0U) {
+        if (p->huart->gState != HAL_UART_STATE_READY) {
+            return;
+        }
+        /* 传输没有走到发送完成回调就结束了（DMA 错误），从原位置重发 */
+        p->stats.tx_dma_errors++;
+        p->tx_len = 0;
+    }
+
+    avail = p->tx_head - p->tx_tail;
+    if (avail == 0U) {
+        return;
+    }
+    ofs = p->tx_tail & (p->tx_size - 1U);
+    len = p->tx_size - ofs;
+    if (len > avail) {
+        len = avail;
+    }
+    if (len > UART_DRV_MAX_XFER) {
+        len = UART_DRV_MAX_XFER;
+    }
+    /* 串口未初始化时返回 HAL_BUSY，数据留到下一次写入或完成回调再发 */
+    if (HAL_UART_Transmit_DMA(p->huart, &p->tx_ring[ofs], (uint16_t)len) == HAL_OK) {
+        p->tx_len = len;
+    }
+}
+
+/**
+ * @brief 等待期间让出 CPU：调度器运行且未屏蔽中断时睡一个节拍，否则忙等
+ *        （串口、DMA 和 HAL 节拍中断优先级为 0，不受 BASEPRI 影响，忙等时照常推进）
+ */
+static void uart_drv_tx_yield(void)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING && __get_BASEPRI() == 0U) {
+        vTaskDelay(1);
+    }
+}
+
+/**
+ * @brief 把一段数据整体放入发送缓冲区，空间不足时按策略等待
+ * @retval false 空间不足，已丢弃
+ */
+static bool uart_drv_tx_put(uart_drv_port_t *p, const uint8_t *data, uint32_t len)
+{
+    uint32_t primask = __get_PRIMASK();
+    uint32_t start = 0;
+    bool waiting = false;
+    bool can_wait;
+    uint32_t ofs;
+    uint32_t first;
+    uint32_t used;
+
+    for (;;) {
+        __disable_irq();
+        if (p->tx_size - (p->tx_head - p->tx_tail) >= len) {
+            break;
+        }
+        uart_drv_tx_kick(p);
+        /* 中断中或调用者关了中断时等不到 DMA 完成 */
+        can_wait = (p->block_ms != 0U && primask == 0U && !xPortIsInsideInterrupt());
+        if (can_wait && !waiting) {
+            p->stats.tx_blocked++;
+        }
+        __set_PRIMASK(primask);
+
+        if (!can_wait) {
+            return false;
+        }
+        if (!waiting) {
+            waiting = true;
+            start = HAL_GetTick();
+        } else if (HAL_GetTick() - start >= p->block_ms) {
+            return false;
+        }
+        uart_drv_tx_yield();
+    }
+
+    ofs = p->tx_head & (p->tx_size - 1U);
+    first = p->tx_size - ofs;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(&p->tx_ring[ofs], data, first);
+    memcpy(p->tx_ring, data + first, len - first);
+    p->tx_head += len;
+    p->stats.tx_written += len;
+    used = p->tx_head - p->tx_tail;
+    if (used > p->stats.tx_high_water) {
+        p->stats.tx_high_water = used;
+    }
+    uart_drv_tx_kick(p);
+    __set_PRIMASK(primask);
+    return true;
+}
+
+uint32_t uart_drv_write(uart_port_t port, const void *data, uint32_t len)
+{
+    uart_drv_port_t *p = &ports[port];
+    uint32_t done = 0;
+    uint32_t chunk;
+    uint32_t primask;
+
+    while (done < len) {
+        chunk = len - done;
+        if (chunk > p->tx_size) {
+            chunk = p->tx_size;
+        }
+        if (!uart_drv_tx_put(p, (const uint8_t *)data + done, chunk)) {
+            primask = __get_PRIMASK();
+            __disable_irq();
+            p->stats.tx_dropped += len - done;
+            __set_PRIMASK(primask);
+            break;
+        }
+        done += chunk;
+    }
+    return done;
+}
+
+void uart_drv_set_block_ms(uart_port_t port, uint32_t ms)
+{
+    ports[port].block_ms = ms;
+}
+
+int uart_drv_flush(uart_port_t port, uint32_t timeout_ms)
+{
+    uart_drv_port_t *p = &ports[port];
+    uint32_t start = HAL_GetTick();
+    uint32_t primask;
+
+    while (p->tx_head != p->tx_tail) {
+        primask = __get_PRIMASK();
+        __disable_irq();
+        uart_drv_tx_kick(p);
+        __set_PRIMASK(primask);
+        if (HAL_GetTick() - start >= timeout_ms) {
+            return -1;
+        }
+        uart_drv_tx_yield();
+    }
+    return 0;
+}
+
+int uart_drv_set_baud(uart_port_t port, uint32_t baud)
+{
+    uart_drv_port_t *p = &ports[port];
+    USART_TypeDef *inst = p->huart->Instance;
+    uint32_t pclk = (inst == USART1 || inst == USART6) ? HAL_RCC_GetPCLK2Freq() : HAL_RCC_GetPCLK1Freq();
+    bool over8 = (p->huart->Init.OverSampling == UART_OVERSAMPLING_8);
+    uint32_t primask;
+
+    /* 分频系数整数部分 12 位，最小 1 */
+    if (baud == 0U || baud > pclk / (over8 ? 8U : 16U) || baud < pclk / ((over8 ? 8U : 16U) * 4096U)) {
+        return -1;
+    }
+    (void)uart_drv_flush(port, 1000);
+
+    /* 发送空闲（最后一个字节已移出）时换分频，接收 DMA 不受影响，换的瞬间正在收的字节可能出错 */
+    primask = __get_PRIMASK();
+    __disable_irq();
+    inst->BRR = over8 ? UART_BRR_SAMPLING8(pclk, baud) : UART_BRR_SAMPLING16(pclk, baud);
+    p->huart->Init.BaudRate = baud;
+    __set_PRIMASK(primask);
+    return 0;
+}
+
+void uart_drv_get_stats(uart_port_t port, uart_drv_stats_t *stats)
+{
+    uart_drv_port_t *p = &ports[port];
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *stats = p->stats;
+    stats->baud = p->huart->Init.BaudRate;
+    stats->rx_received = p->rx_written;
+    __set_PRIMASK(primask);
+}
+
+/**
+ * @brief 发送完成（串口 TC 中断）：接着发下一段
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    uint32_t primask;
+
+    for (uint32_t i = 0; i < UART_PORT_COUNT; i++) {
+        uart_drv_port_t *p = &ports[i];
+
+        if (p->huart != huart) {
+            continue;
+        }
+        primask = __get_PRIMASK();
+        __disable_irq();
+        p->tx_tail += p->tx_len;
+        p->stats.tx_sent += p->tx_len;
+        p->tx_len = 0;
+        uart_drv_tx_kick(p);
+        __set_PRIMASK(primask);
+        return;
+    }
+}
+
+/**
+ * @brief 打印各串口统计
+ */
+static void uart_drv_print(void)
+{
+    uart_drv_stats_t s;
+
+    for (uint32_t i = 0; i < UART_PORT_COUNT; i++) {
+        uart_drv_get_stats((uart_port_t)i, &s);
+        printf("%s: %lu baud\r\n", ports[i].name, (unsigned long)s.baud);
+        printf("  rx %lu B, %lu irqs, %lu cycles/irq, %lu cycles/KB, high water %lu\r\n",
+               (unsigned long)s.rx_received, (unsigned long)s.rx_events,
+               (unsigned long)(s.rx_events != 0U ? s.rx_isr_cycles / s.rx_events : 0U),
+               (unsigned long)(s.rx_received != 0U ? s.rx_isr_cycles * 1024U / s.rx_received : 0U),
+               (unsigned long)s.rx_high_water);
+        printf("     %lu overflows (%lu B lost), %lu line errors, %lu dma errors\r\n",
+               (unsigned long)s.rx_overflows, (unsigned long)s.rx_lost,
+               (unsigned long)s.rx_line_errors, (unsigned long)s.rx_dma_errors);
+        printf("  tx %lu B written, %lu sent, %lu dropped, %lu waits, high water %lu, %lu dma errors\r\n",
+               (unsigned long)s.tx_written, (unsigned long)s.tx_sent, (unsigned long)s.tx_dropped,
+               (unsigned long)s.tx_blocked, (unsigned long)s.tx_high_water, (unsigned long)s.tx_dma_errors);
+    }
+}
+
+int uart_drv_command(const char *line)
+{
+    char buf[32];
+    char *argv[3];
+    int argc = 0;
+    char *save;
+    char *p;
+    uint32_t baud;
+
+    strncpy(buf, line, sizeof(buf) - 1U);
+    buf[sizeof(buf) - 1U] = '\0';
+    for (p = strtok_r(buf, " \t", &save); p != NULL && argc < 3; p = strtok_r(NULL, " \t", &save)) {
+        argv[argc++] = p;
+    }
+    if (argc == 0 || strcmp(argv[0], "uart") != 0) {
+        return 0;
+    }
+
+    if (argc == 1) {
+        uart_drv_print();
+    } else if (argc == 3 && strcmp(argv[1], "baud") == 0) {
+        baud = (uint32_t)strtoul(argv[2], NULL, 10);
+        printf("uart baud %lu\r\n", (unsigned long)baud);
+        if (uart_drv_set_baud(UART_PORT_CONSOLE, baud) != 0) {
+            printf("baud out of range\r\n");
+        }
+    } else {
+        printf("usage: uart [baud <rate>]\r\n");
+    }
+    return 1;
+}
@@ -0,0 +1,377 @@
+/**
+ * @file uart_proto.c
+ * @brief 串口二进制命令协议实现
+ *
+ * 解析器只在接收任务中运行：逐段扫描环形缓冲区，非同步字开头的连续字节整段交给文本处理函数，
+ * 同步字开头时等到帧头和整帧到齐，校验通过后把缓冲区中的负载位置交给处理函数，全程不复制。
+ * 校验失败或帧头无效时只跳过一个字节重新找同步字。
+ */
+
+#include "uart_proto.h"
+#include "uart_drv.h"
+#include "recorder.h"
+#include "scene_manager.h"
+#include "cpu_load.h"
+#include "high_res_timer.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+typedef struct {
+    uint8_t cmd;
+    uart_proto_handler_t handler;
+} uart_proto_entry_t;
+
+static uart_proto_entry_t handlers[UART_PROTO_MAX_HANDLERS];
+static uint32_t handler_count;
+static uart_proto_text_t text_handler;
+static uart_proto_stats_t proto_stats;
+
+/* 正在等待的不完整帧的位置与开始等待的时刻 */
+static bool waiting;
+static uint32_t wait_pos;
+static TickType_t wait_start;
+
+/* 应答帧缓冲区（只在接收任务中使用） */
+static uint8_t tx_frame[UART_PROTO_HEADER_SIZE + UART_PROTO_MAX_PAYLOAD + UART_PROTO_CRC_SIZE];
+
+/* CRC-16/CCITT-FALSE 查表 */
+static const uint16_t crc16_table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6, 0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485, 0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4, 0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823, 0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12, 0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41, 0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70, 0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F, 0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E, 0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D, 0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C, 0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB, 0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A, 0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9, 0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8, 0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+static uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t len)
+{
+    while (len-- > 0U) {
+        crc = (uint16_t)((crc << 8) ^ crc16_table[((crc >> 8) ^ *data++) & 0xFFU]);
+    }
+    return crc;
+}
+
+/* 环形缓冲区中累计位置 pos 处的字节 */
+#define RING_AT(pos)    ring[(pos) & mask]
+
+/**
+ * @brief 对环形缓冲区中 [pos, pos + len) 计算 CRC（可能跨过末尾）
+ */
+static uint16_t crc16_ring(uint16_t crc, const uint8_t *ring, uint32_t mask, uint32_t pos, uint32_t len)
+{
+    uint32_t ofs = pos & mask;
+    uint32_t n = mask + 1U - ofs;
+
+    if (n > len) {
+        n = len;
+    }
+    crc = crc16_update(crc, &ring[ofs], n);
+    return crc16_update(crc, ring, len - n);
+}
+
+static uart_proto_handler_t find_handler(uint8_t cmd)
+{
+    uint32_t i;
+
+    for (i = 0; i < handler_count; i++) {
+        if (handlers[i].cmd == cmd) {
+            return handlers[i].handler;
+        }
+    }
+    return NULL;
+}
+
+bool uart_proto_register(uint8_t cmd, uart_proto_handler_t handler)
+{
+    if (handler_count >= UART_PROTO_MAX_HANDLERS || (cmd & UART_PROTO_REPLY) != 0U || find_handler(cmd) != NULL) {
+        return false;
+    }
+    handlers[handler_count].cmd = cmd;
+    handlers[handler_count].handler = handler;
+    handler_count++;
+    return true;
+}
+
+void uart_proto_reply(const uart_proto_frame_t *req, uint8_t status, const void *data, uint16_t len)
+{
+    uint16_t crc;
+
+    if ((req->flags & UART_PROTO_FLAG_NO_REPLY) != 0U) {
+        return;
+    }
+    if (len > UART_PROTO_MAX_PAYLOAD) {
+        len = UART_PROTO_MAX_PAYLOAD;
+    }
+    tx_frame[0] = UART_PROTO_SYNC0;
+    tx_frame[1] = UART_PROTO_SYNC1;
+    tx_frame[2] = (uint8_t)len;
+    tx_frame[3] = (uint8_t)(len >> 8);
+    tx_frame[4] = req->cmd | UART_PROTO_REPLY;
+    tx_frame[5] = req->seq;
+    tx_frame[6] = 0;
+    tx_frame[7] = status;
+    if (len > 0U) {
+        memcpy(&tx_frame[UART_PROTO_HEADER_SIZE], data, len);
+    }
+    crc = crc16_update(0xFFFFU, &tx_frame[2], UART_PROTO_HEADER_SIZE - 2U + len);
+    tx_frame[UART_PROTO_HEADER_SIZE + len] = (uint8_t)crc;
+    tx_frame[UART_PROTO_HEADER_SIZE + len + 1U] = (uint8_t)(crc >> 8);
+    uart_drv_write(UART_PORT_CONSOLE, tx_frame, UART_PROTO_HEADER_SIZE + len + UART_PROTO_CRC_SIZE);
+}
+
+uint16_t uart_proto_copy(const uart_proto_frame_t *frame, uint16_t offset, void *buf, uint16_t len)
+{
+    uint8_t *dst = buf;
+    uint16_t done = 0;
+    uint16_t n;
+    uint32_t i;
+
+    for (i = 0; i < 2U && done < len; i++) {
+        if (offset >= frame->seg_len[i]) {
+            offset -= frame->seg_len[i];
+            continue;
+        }
+        n = frame->seg_len[i] - offset;
+        if (n > len - done) {
+            n = len - done;
+        }
+        memcpy(&dst[done], frame->seg[i] + offset, n);
+        done += n;
+        offset = 0;
+    }
+    return done;
+}
+
+void uart_proto_get_stats(uart_proto_stats_t *stats)
+{
+    taskENTER_CRITICAL();
+    *stats = proto_stats;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief 校验并分发 pos 处长度为 len 的帧
+ * @retval false 校验失败
+ */
+static bool uart_proto_dispatch(const uint8_t *ring, uint32_t mask, uint32_t pos, uint16_t len)
+{
+    uart_proto_frame_t frame;
+    uart_proto_handler_t handler;
+    uint32_t ofs;
+    uint16_t crc;
+
+    crc = crc16_ring(0xFFFFU, ring, mask, pos + 2U, UART_PROTO_HEADER_SIZE - 2U + len);
+    if (crc != (uint16_t)(RING_AT(pos + UART_PROTO_HEADER_SIZE + len) |
+                          (RING_AT(pos + UART_PROTO_HEADER_SIZE + len + 1U) << 8))) {
+        return false;
+    }
+
+    frame.cmd = RING_AT(pos + 4U);
+    frame.seq = RING_AT(pos + 5U);
+    frame.flags = RING_AT(pos + 6U);
+    frame.len = len;
+    ofs = (pos + UART_PROTO_HEADER_SIZE) & mask;
+    frame.seg[0] = &ring[ofs];
+    frame.seg_len[0] = (uint16_t)((len < mask + 1U - ofs) ? len : (mask + 1U - ofs));
+    frame.seg[1] = ring;
+    frame.seg_len[1] = len - frame.seg_len[0];
+
+    proto_stats.frames++;
+    handler = find_handler(frame.cmd);
+    if (handler != NULL) {
+        handler(&frame);
+    } else {
+        proto_stats.unknown++;
+        uart_proto_reply(&frame, UART_PROTO_ERR_UNKNOWN_CMD, NULL, 0);
+    }
+    return true;
+}
+
+/**
+ * @brief 把 [*read, *read + len) 作为文本交出（可能跨过末尾，分两段）
+ */
+static void uart_proto_text(const uint8_t *ring, uint32_t mask, uint32_t *read, uint32_t len)
+{
+    uint32_t ofs;
+    uint32_t n;
+
+    proto_stats.text_bytes += len;
+    while (len > 0U) {
+        ofs = *read & mask;
+        n = mask + 1U - ofs;
+        if (n > len) {
+            n = len;
+        }
+        if (text_handler != NULL) {
+            text_handler(&ring[ofs], (uint16_t)n);
+        }
+        *read += n;
+        len -= n;
+    }
+}
+
+void uart_proto_input(const uint8_t *ring, uint32_t ring_size, uint32_t *read, uint32_t written)
+{
+    const uint32_t mask = ring_size - 1U;
+    uint32_t pos = *read;
+    uint32_t avail;
+    uint32_t n;
+    uint16_t len;
+
+    while (pos != written) {
+        avail = written - pos;
+
+        /* 文本：到下一个同步字为止 */
+        if (RING_AT(pos) != UART_PROTO_SYNC0) {
+            for (n = 1; n < avail && RING_AT(pos + n) != UART_PROTO_SYNC0; n++) {
+            }
+            uart_proto_text(ring, mask, &pos, n);
+            continue;
+        }
+
+        /* 帧头或整帧未到齐：超时前留在缓冲区中等下一批数据 */
+        len = 0;
+        if (avail >= UART_PROTO_HEADER_SIZE) {
+            len = (uint16_t)(RING_AT(pos + 2U) | (RING_AT(pos + 3U) << 8));
+        }
+        if (avail >= 2U && (RING_AT(pos + 1U) != UART_PROTO_SYNC1 || len > UART_PROTO_MAX_PAYLOAD)) {
+            uart_proto_text(ring, mask, &pos, 1);
+            continue;
+        }
+        if (avail < UART_PROTO_HEADER_SIZE || avail < UART_PROTO_HEADER_SIZE + len + UART_PROTO_CRC_SIZE) {
+            if (!waiting || wait_pos != pos) {
+                waiting = true;
+                wait_pos = pos;
+                wait_start = xTaskGetTickCount();
+                break;
+            }
+            if (xTaskGetTickCount() - wait_start < pdMS_TO_TICKS(UART_PROTO_TIMEOUT_MS)) {
+                break;
+            }
+            proto_stats.timeouts++;
+            waiting = false;
+            uart_proto_text(ring, mask, &pos, 1);
+            continue;
+        }
+        waiting = false;
+
+        if (uart_proto_dispatch(ring, mask, pos, len)) {
+            pos += UART_PROTO_HEADER_SIZE + len + UART_PROTO_CRC_SIZE;
+        } else {
+            proto_stats.crc_errors++;
+            uart_proto_text(ring, mask, &pos, 1);
+        }
+    }
+    *read = pos;
+}
+
+/* ---------------- 内置命令 ---------------- */
+
+static void cmd_ping(const uart_proto_frame_t *frame)
+{
+    /* 负载在接收缓冲区中可能分两段，应答需要连续的一份 */
+    static uint8_t buf[UART_PROTO_MAX_PAYLOAD];
+
+    uart_proto_reply(frame, UART_PROTO_OK, buf, uart_proto_copy(frame, 0, buf, frame->len));
+}
+
+static void cmd_info(const uart_proto_frame_t *frame)
+{
+    static const char build[] = __DATE__ " " __TIME__;
+    uint8_t buf[sizeof(uart_proto_info_t) + sizeof(build)];
+    uart_proto_info_t info;
+
+    info.version = UART_PROTO_VERSION;
+    info.max_payload = UART_PROTO_MAX_PAYLOAD;
+    info.rx_ring_size = UART_DRV_CONSOLE_RX_SIZE;
+    info.uptime_us = HighResTimer_GetUs64();
+    memcpy(buf, &info, sizeof(info));
+    memcpy(&buf[sizeof(info)], build, sizeof(build) - 1U);
+    uart_proto_reply(frame, UART_PROTO_OK, buf, sizeof(info) + sizeof(build) - 1U);
+}
+
+static void cmd_stats(const uart_proto_frame_t *frame)
+{
+    uart_proto_stats_reply_t reply;
+    uart_drv_stats_t uart;
+
+    uart_drv_get_stats(UART_PORT_CONSOLE, &uart);
+    memset(&reply, 0, sizeof(reply));
+    reply.rx_received = uart.rx_received;
+    reply.rx_overflows = uart.rx_overflows;
+    reply.rx_lost = uart.rx_lost;
+    reply.rx_line_errors = uart.rx_line_errors;
+    reply.rx_high_water = uart.rx_high_water;
+    reply.tx_written = uart.tx_written;
+    reply.tx_dropped = uart.tx_dropped;
+    uart_proto_get_stats(&reply.proto);
+    reply.cpu_load = cpu_load_total(&reply.cpu_avg);
+    reply.heap_free = (uint32_t)xPortGetFreeHeapSize();
+    uart_proto_reply(frame, UART_PROTO_OK, &reply, sizeof(reply));
+}
+
+static void cmd_scene(const uart_proto_frame_t *frame)
+{
+    uint8_t arg[4];
+
+    if (uart_proto_copy(frame, 0, arg, sizeof(arg)) != sizeof(arg)) {
+        uart_proto_reply(frame, UART_PROTO_ERR_BAD_ARG, NULL, 0);
+        return;
+    }
+    /* 场景在 LVGL 任务中切换，这里只登记 */
+    if (!scene_manager_request((scene_id_t)arg[0], (scene_anim_t)arg[1], (uint32_t)(arg[2] | (arg[3] << 8)))) {
+        uart_proto_reply(frame, UART_PROTO_ERR_BAD_ARG, NULL, 0);
+        return;
+    }
+    uart_proto_reply(frame, UART_PROTO_OK, NULL, 0);
+}
+
+static void cmd_stream(const uart_proto_frame_t *frame)
+{
+    uint8_t rec[RECORDER_PAYLOAD_SIZE];
+    uint16_t offset;
+    uint16_t n;
+    uint32_t total;
+    uint32_t dropped = 0;
+    uart_proto_status_t status = UART_PROTO_OK;
+
+    for (offset = 0; offset < frame->len; offset += n) {
+        n = uart_proto_copy(frame, offset, rec, sizeof(rec));
+        if (!recorder_put(UART_PROTO_RECORD_TYPE, rec, n)) {
+            dropped++;
+        }
+    }
+    proto_stats.stream_bytes += frame->len;
+    proto_stats.stream_dropped += dropped;
+    total = proto_stats.stream_bytes;
+    /* 有记录没写进记录器时不能回 OK，主机据此判断数据是否被保存 */
+    if (dropped != 0U) {
+        status = recorder_is_recording() ? UART_PROTO_ERR_BUSY : UART_PROTO_ERR_NOT_RECORDING;
+    }
+    uart_proto_reply(frame, status, &total, sizeof(total));
+}
+
+void uart_proto_init(uart_proto_text_t text)
+{
+    text_handler = text;
+    if (handler_count != 0U) {
+        return;
+    }
+    uart_proto_register(UART_PROTO_CMD_PING, cmd_ping);
+    uart_proto_register(UART_PROTO_CMD_INFO, cmd_info);
+    uart_proto_register(UART_PROTO_CMD_STATS, cmd_stats);
+    uart_proto_register(UART_PROTO_CMD_SCENE, cmd_scene);
+    uart_proto_register(UART_PROTO_CMD_STREAM, cmd_stream);
+}
@@ -24,18 +24,23 @@
 #include <string.h>
 #include <stdio.h>
 
+#include "uart_drv.h"
+
+/**
+ * @brief printf 重定向：写入异步发送缓冲区后立即返回
+ *        缓冲区满被丢弃的字节计入 uart_drv 统计，仍报告写入成功，避免 newlib 重试或置错误标志
+ */
 int _write(int file, char *ptr, int len)
 {
-
-    HAL_StatusTypeDef status = HAL_UART_Transmit(&huart1, (uint8_t *)ptr, len,HAL_MAX_DELAY );
-    
-    // 返回写入的字节数
-    return (status == HAL_OK) ? len : -1;
+    (void)file;
+    (void)uart_drv_write(UART_PORT_CONSOLE, ptr, (uint32_t)len);
+    return len;
 }
 /* USER CODE END 0 */
 
 UART_HandleTypeDef huart1;
 DMA_HandleTypeDef hdma_usart1_rx;
+DMA_HandleTypeDef hdma_usart1_tx;
 
 /* USART1 init function */
 
@@ -93,8 +98,8 @@ void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
     hdma_usart1_rx.Init.MemInc = DMA_MINC_ENABLE;
     hdma_usart1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
     hdma_usart1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
-    hdma_usart1_rx.Init.Mode = DMA_NORMAL;
-    hdma_usart1_rx.Init.Priority = DMA_PRIORITY_LOW;
+    hdma_usart1_rx.Init.Mode = DMA_CIRCULAR;           /* 循环接收，见 uart_drv.c */
+    hdma_usart1_rx.Init.Priority = DMA_PRIORITY_HIGH;  /* 高波特率下不能被其他数据流耽误 */
     hdma_usart1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
     if (HAL_DMA_Init(&hdma_usart1_rx) != HAL_OK)
     {
@@ -104,9 +109,30 @@ void HAL_UART_MspInit(UART_HandleTypeDef* uartHandle)
     /* 将DMA与USART1关联 */
     __HAL_LINKDMA(uartHandle, hdmarx, hdma_usart1_rx);
     
-    /* 启用DMA中断 */
-    HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 0, 0);
+    /* 启用DMA中断（优先级在 FreeRTOS 可管理范围内，中断中通知接收任务） */
+    HAL_NVIC_SetPriority(DMA2_Stream2_IRQn, 6, 0);
     HAL_NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+
+    /* 配置USART1 TX DMA（见 uart_drv.c） */
+    hdma_usart1_tx.Instance = DMA2_Stream7;
+    hdma_usart1_tx.Init.Channel = DMA_CHANNEL_4;
+    hdma_usart1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_usart1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_usart1_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_usart1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_usart1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_usart1_tx.Init.Mode = DMA_NORMAL;
+    hdma_usart1_tx.Init.Priority = DMA_PRIORITY_LOW;
+    hdma_usart1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_usart1_tx) != HAL_OK)
+    {
+      Error_Handler();
+    }
+
+    __HAL_LINKDMA(uartHandle, hdmatx, hdma_usart1_tx);
+
+    HAL_NVIC_SetPriority(DMA2_Stream7_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream7_IRQn);
   /* USER CODE END USART1_MspInit 1 */
   }
 }
@@ -131,6 +157,10 @@ void HAL_UART_MspDeInit(UART_HandleTypeDef* uartHandle)
     /* USART1 interrupt Deinit */
     HAL_NVIC_DisableIRQ(USART1_IRQn);
   /* USER CODE BEGIN USART1_MspDeInit 1 */
+    HAL_DMA_DeInit(uartHandle->hdmarx);
+    HAL_DMA_DeInit(uartHandle->hdmatx);
+    HAL_NVIC_DisableIRQ(DMA2_Stream2_IRQn);
+    HAL_NVIC_DisableIRQ(DMA2_Stream7_IRQn);
 
   /* USER CODE END USART1_MspDeInit 1 */
   }
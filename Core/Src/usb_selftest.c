@@ -0,0 +1,170 @@
+/**
+ * @file usb_selftest.c
+ * @brief USB 吞吐自测实现
+ *
+ * 每种方案：断开 -> 切换 FIFO 分配 -> 重新枚举 -> 等主机打开串口 -> 预热 -> 统计一个窗口内的字节数。
+ * 设备端只计完成的传输，数值即 FS 内核在该分配下实际交付给主机的速率（理论上限约 1.2MB/s）。
+ */
+
+#include "usb_selftest.h"
+
+#if USB_SELFTEST_ENABLE
+
+#include "usb_device.h"
+#include "usbd_core.h"
+#include "usbd_cdc_if.h"
+#include "high_res_timer.h"
+#define LOG_MODULE LOG_MOD_USB
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+#define SELFTEST_TASK_PRIO      (tskIDLE_PRIORITY + 2)
+#define SELFTEST_STK_SIZE       512
+#define SELFTEST_MAX_PROFILES   8U
+#define SELFTEST_WARMUP_MS      500U
+#define SELFTEST_DETACH_MS      500U    /* 断开后等待主机识别 */
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+static TaskHandle_t selftest_task_handle;
+static StaticTask_t selftest_task_tcb;
+static StackType_t selftest_task_stack[SELFTEST_STK_SIZE];
+
+static usb_selftest_result_t results[SELFTEST_MAX_PROFILES];
+static uint8_t result_count;
+static volatile bool running;
+
+/**
+ * @brief 以指定 FIFO 方案重新枚举
+ */
+static void usb_restart(uint8_t profile, uint8_t test)
+{
+    USBD_LL_Lock();
+    (void)USBD_DeInit(&hUsbDeviceFS);
+    USBD_LL_Unlock();
+    HAL_NVIC_DisableIRQ(OTG_FS_IRQn);   /* 内核已停止，重新初始化时再打开 */
+    (void)USBD_LL_SetFifoProfile(profile);
+    CDC_Test_Enable(test);
+    vTaskDelay(pdMS_TO_TICKS(SELFTEST_DETACH_MS));
+    MX_USB_DEVICE_Init();
+}
+
+static bool wait_port_open(uint32_t timeout_ms)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (!CDC_Log_IsOpen()) {
+        if ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(timeout_ms)) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+    return true;
+}
+
+/**
+ * @brief 字节数/微秒 换算为 KB/s（1KB = 1000B）
+ */
+static uint32_t rate_kbps(uint32_t bytes, uint32_t us)
+{
+    return us ? (uint32_t)(((uint64_t)bytes * 1000U) / us) : 0U;
+}
+
+static void measure(usb_selftest_result_t *r)
+{
+    const USBD_FifoProfileTypeDef *p = USBD_LL_GetFifoProfile(r->profile);
+    uint32_t in0, out0, in1, out1, t0, t1;
+
+    usb_restart(r->profile, 1U);
+    if (!wait_port_open(USB_SELFTEST_OPEN_TIMEOUT_MS)) {
+        LOG_WARNING("usb selftest: profile %s skipped, port not opened", p->name);
+        return;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(SELFTEST_WARMUP_MS));
+    CDC_Test_GetCounters(&in0, &out0);
+    t0 = HighResTimer_GetUs();
+    vTaskDelay(pdMS_TO_TICKS(USB_SELFTEST_WINDOW_MS));
+    CDC_Test_GetCounters(&in1, &out1);
+    t1 = HighResTimer_GetUs();
+
+    r->valid = 1;
+    r->in_kbps = rate_kbps(in1 - in0, t1 - t0);
+    r->out_kbps = rate_kbps(out1 - out0, t1 - t0);
+    LOG_INFO("usb selftest: profile %s (rx %u, tx %u/%u/%u/%u words): IN %lu KB/s, OUT %lu KB/s",
+             p->name, p->rx, p->tx[0], p->tx[1], p->tx[2], p->tx[3],
+             (unsigned long)r->in_kbps, (unsigned long)r->out_kbps);
+}
+
+static void usb_selftest_task(void *argument)
+{
+    uint8_t n = USBD_LL_GetFifoProfileCount();
+    uint8_t i, best = 0xFF;
+
+    (void)argument;
+
+    if (n > SELFTEST_MAX_PROFILES) {
+        n = SELFTEST_MAX_PROFILES;
+    }
+    LOG_INFO("usb selftest: %u FIFO profiles, %lu ms each, open the CDC port on the host",
+             n, (unsigned long)USB_SELFTEST_WINDOW_MS);
+
+    for (i = 0; i < n; i++) {
+        memset(&results[i], 0, sizeof(results[i]));
+        results[i].profile = i;
+        measure(&results[i]);
+        result_count = i + 1U;
+        if (results[i].valid && (best == 0xFF || results[i].in_kbps > results[best].in_kbps)) {
+            best = i;
+        }
+    }
+
+    usb_restart(USBD_FIFO_PROFILE, 0U);
+    if (best != 0xFF) {
+        LOG_INFO("usb selftest: done, best IN rate %lu KB/s with profile %s (default %s)",
+                 (unsigned long)results[best].in_kbps,
+                 USBD_LL_GetFifoProfile(best)->name,
+                 USBD_LL_GetFifoProfile(USBD_FIFO_PROFILE)->name);
+    } else {
+        LOG_WARNING("usb selftest: done, no profile measured");
+    }
+
+    running = false;
+    selftest_task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+void usb_selftest_start(void)
+{
+    if (running) {
+        return;
+    }
+    running = true;
+    result_count = 0;
+    selftest_task_handle = xTaskCreateStatic(usb_selftest_task,
+                                             "usb_test",
+                                             SELFTEST_STK_SIZE,
+                                             NULL,
+                                             SELFTEST_TASK_PRIO,
+                                             selftest_task_stack,
+                                             &selftest_task_tcb);
+}
+
+bool usb_selftest_running(void)
+{
+    return running;
+}
+
+uint8_t usb_selftest_get_results(usb_selftest_result_t *out, uint8_t max)
+{
+    uint8_t n = (result_count < max) ? result_count : max;
+
+    if (out != NULL && n > 0) {
+        memcpy(out, results, n * sizeof(*out));
+    }
+    return n;
+}
+
+#endif /* USB_SELFTEST_ENABLE */
@@ -28,6 +28,9 @@
 /* Includes ------------------------------------------------------------------*/
 #include "ff_gen_drv.h"
 #include "sd_diskio.h"
+#include "sd_stats.h"
+#include "sd_fastmount.h"
+#include "high_res_timer.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -132,6 +135,18 @@ const Diskio_drvTypeDef  SD_Driver =
 
 /* USER CODE BEGIN beforeFunctionSection */
 /* can be used to modify / undefine following code or add new code */
+
+/* 读写失败后的重试次数（重试前会重新等待卡就绪） */
+#define SD_RW_RETRIES 1
+
+/*
+ * 生成的读写实现改名为 *_once，SD_read()/SD_write() 在其外层包一层
+ * 重试和 I/O 统计（见 sd_stats.h）
+ */
+static DRESULT SD_read_once(BYTE lun, BYTE *buff, DWORD sector, UINT count);
+#if _USE_WRITE == 1
+static DRESULT SD_write_once(BYTE lun, const BYTE *buff, DWORD sector, UINT count);
+#endif /* _USE_WRITE == 1 */
 /* USER CODE END beforeFunctionSection */
 
 /* Private functions ---------------------------------------------------------*/
@@ -139,6 +154,15 @@ const Diskio_drvTypeDef  SD_Driver =
 static int SD_CheckStatusWithTimeout(uint32_t timeout)
 {
   uint32_t timer;
+  uint32_t t_start;
+
+  /* fast path: card already in transfer state, nothing to account */
+  if (BSP_SD_GetCardState() == SD_TRANSFER_OK)
+  {
+    return 0;
+  }
+  t_start = HighResTimer_GetUs();
+
   /* block until SDIO peripherial is ready again or a timeout occur */
 #if (osCMSIS <= 0x20000U)
   timer = osKernelSysTick();
@@ -150,10 +174,12 @@ static int SD_CheckStatusWithTimeout(uint32_t timeout)
   {
     if (BSP_SD_GetCardState() == SD_TRANSFER_OK)
     {
+      SD_Stats_Busy(HighResTimer_GetUs() - t_start);
       return 0;
     }
   }
 
+  SD_Stats_Busy(HighResTimer_GetUs() - t_start);
   return -1;
 }
 
@@ -214,6 +240,7 @@ Stat = STA_NOINIT;
 #else
       SDQueueID = osMessageQueueNew(QUEUE_SIZE, 2, NULL);
 #endif
+        SD_Stats_Init();
       }
 
       if (SDQueueID == NULL)
@@ -248,7 +275,7 @@ DSTATUS SD_status(BYTE lun)
   * @retval DRESULT: Operation result
   */
 
-DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+static DRESULT SD_read_once(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 {
   DRESULT res = RES_ERROR;
   uint32_t timer;
@@ -408,7 +435,7 @@ DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
   */
 #if _USE_WRITE == 1
 
-DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+static DRESULT SD_write_once(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
 {
   DRESULT res = RES_ERROR;
   uint32_t timer;
@@ -566,6 +593,62 @@ DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
 
 /* USER CODE BEGIN beforeIoctlSection */
 /* can be used to modify previous code / undefine following code / add new code */
+
+/**
+  * @brief  Reads Sector(s) with retry and I/O statistics
+  * @param  lun : not used
+  * @param  *buff: Data buffer to store read data
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to read (1..128)
+  * @retval DRESULT: Operation result
+  */
+DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
+{
+  uint32_t t_start = SD_Stats_Begin();
+  DRESULT res = SD_read_once(lun, buff, sector, count);
+  int retry;
+
+  for (retry = 0; res != RES_OK && retry < SD_RW_RETRIES; retry++)
+  {
+    SD_Stats_Retry(SD_STATS_READ);
+    res = SD_read_once(lun, buff, sector, count);
+  }
+
+  SD_Stats_End(SD_STATS_READ, count, t_start, res == RES_OK);
+  return res;
+}
+
+#if _USE_WRITE == 1
+/**
+  * @brief  Writes Sector(s) with retry and I/O statistics
+  * @param  lun : not used
+  * @param  *buff: Data to be written
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to write (1..128)
+  * @retval DRESULT: Operation result
+  */
+DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+  uint32_t t_start;
+  DRESULT res;
+  int retry;
+
+  /* invalidate the cached free-space record before the FAT changes on the card */
+  SD_FastMount_OnWrite(sector, count);
+
+  t_start = SD_Stats_Begin();
+  res = SD_write_once(lun, buff, sector, count);
+
+  for (retry = 0; res != RES_OK && retry < SD_RW_RETRIES; retry++)
+  {
+    SD_Stats_Retry(SD_STATS_WRITE);
+    res = SD_write_once(lun, buff, sector, count);
+  }
+
+  SD_Stats_End(SD_STATS_WRITE, count, t_start, res == RES_OK);
+  return res;
+}
+#endif /* _USE_WRITE == 1 */
 /* USER CODE END beforeIoctlSection */
 /**
   * @brief  I/O control operation
@@ -632,6 +715,7 @@ DRESULT SD_ioctl(BYTE lun, BYTE cmd, void *buff)
   */
 void BSP_SD_WriteCpltCallback(void)
 {
+  SD_Stats_XferDone();
 
   /*
    * No need to add an "osKernelRunning()" check here, as the SD_initialize()
@@ -652,6 +736,7 @@ void BSP_SD_WriteCpltCallback(void)
   */
 void BSP_SD_ReadCpltCallback(void)
 {
+  SD_Stats_XferDone();
   /*
    * No need to add an "osKernelRunning()" check here, as the SD_initialize()
    * is always called before any SD_Read()/SD_Write() call
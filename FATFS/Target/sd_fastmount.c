@@ -0,0 +1,270 @@
+/**
+ * @file sd_fastmount.c
+ * @brief SD卡快速挂载实现
+ *
+ * 记录有效性判定：magic/version/crc 正确、clean 置位、卷序列号与 FAT 几何参数一致，
+ * 且 FAT 抽样扇区（均匀分布的 SD_FASTMOUNT_SAMPLES 个扇区 + last_clst 所在扇区）的 CRC 一致。
+ * 校验只读取固定数量的扇区，与卡容量无关。
+ */
+
+#include "sd_fastmount.h"
+#include "diskio.h"
+#include "24cxx.h"
+#define LOG_MODULE LOG_MOD_SD
+#include "log.h"
+#include <stddef.h>
+#include <string.h>
+
+#define SD_FASTMOUNT_MAGIC      0x544E4D46U     /* "FMNT" */
+#define SD_FASTMOUNT_VERSION    1U
+
+#define FM_CLEAN_ADDR           (SD_FASTMOUNT_EE_ADDR + offsetof(sd_fastmount_record_t, clean))
+
+/* 扇区缓冲区（DMA 读，需4字节对齐） */
+static uint8_t fm_buf[512] __attribute__((aligned(4)));
+
+static FATFS *fm_fs;                    /* 当前跟踪的卷 */
+static sd_fastmount_record_t fm_ee;     /* EEPROM 中记录的镜像 */
+static uint32_t fm_vol_id;
+static uint32_t fm_fat_start;           /* FAT 区域 [start, end) */
+static uint32_t fm_fat_end;
+static volatile uint8_t fm_clean;       /* EEPROM 记录当前是否有效 */
+static volatile uint32_t fm_fat_writes; /* FAT 区域写入计数 */
+
+static uint32_t fm_crc32(uint32_t crc, const void *data, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t i;
+
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (i = 0; i < 8; i++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t fm_record_crc(const sd_fastmount_record_t *rec)
+{
+    sd_fastmount_record_t tmp = *rec;
+
+    tmp.clean = 0;
+    return fm_crc32(0, &tmp, offsetof(sd_fastmount_record_t, crc));
+}
+
+static int fm_lock(FATFS *fs)
+{
+#if _FS_REENTRANT
+    return ff_req_grant(fs->sobj);
+#else
+    (void)fs;
+    return 1;
+#endif
+}
+
+static void fm_unlock(FATFS *fs)
+{
+#if _FS_REENTRANT
+    ff_rel_grant(fs->sobj);
+#else
+    (void)fs;
+#endif
+}
+
+/**
+ * @brief 从引导扇区读取卷序列号（调用者持有卷锁）
+ */
+static uint8_t fm_read_vol_id(FATFS *fs, uint32_t *vol_id)
+{
+    uint32_t ofs = (fs->fs_type == FS_FAT32) ? 67U : 39U;   /* BS_VolID32 / BS_VolID */
+
+    if (disk_read(fs->drv, fm_buf, fs->volbase, 1) != RES_OK) {
+        return 0;
+    }
+    *vol_id = (uint32_t)fm_buf[ofs] | ((uint32_t)fm_buf[ofs + 1] << 8) |
+              ((uint32_t)fm_buf[ofs + 2] << 16) | ((uint32_t)fm_buf[ofs + 3] << 24);
+    return 1;
+}
+
+/**
+ * @brief 计算 FAT 抽样扇区的 CRC（调用者持有卷锁）
+ */
+static uint8_t fm_fat_crc(FATFS *fs, uint32_t last_clst, uint32_t *crc)
+{
+    uint32_t sect[SD_FASTMOUNT_SAMPLES + 1];
+    uint32_t n = 0;
+    uint32_t i;
+
+    for (i = 0; i < SD_FASTMOUNT_SAMPLES; i++) {
+        sect[n++] = fs->fatbase + (uint32_t)(((uint64_t)fs->fsize * i) / SD_FASTMOUNT_SAMPLES);
+    }
+    /* 分配指针附近最可能被其他主机改动 */
+    if (last_clst >= 2 && last_clst < fs->n_fatent) {
+        uint32_t ofs;
+
+        switch (fs->fs_type) {
+        case FS_FAT12: ofs = last_clst + last_clst / 2; break;
+        case FS_FAT16: ofs = last_clst * 2U; break;
+        default:       ofs = last_clst * 4U; break;
+        }
+        sect[n++] = fs->fatbase + ofs / 512U;
+    }
+
+    *crc = 0;
+    for (i = 0; i < n; i++) {
+        /* 窗口缓冲中有未落盘的同一扇区时以窗口为准 */
+        if (fs->winsect == sect[i]) {
+            memcpy(fm_buf, fs->win, sizeof(fm_buf));
+        } else if (disk_read(fs->drv, fm_buf, sect[i], 1) != RES_OK) {
+            return 0;
+        }
+        *crc = fm_crc32(*crc, fm_buf, sizeof(fm_buf));
+    }
+    return 1;
+}
+
+uint8_t SD_FastMount_Restore(FATFS *fs)
+{
+    sd_fastmount_record_t *rec = &fm_ee;
+    uint32_t fat_crc = 0;
+    uint8_t hit = 0;
+    uint8_t ok;
+
+    fm_fs = NULL;
+    fm_clean = 0;
+    if (fs == NULL || fs->fs_type == 0) {
+        return 0;
+    }
+
+    at24cxx_init();
+    at24cxx_read(SD_FASTMOUNT_EE_ADDR, (uint8_t *)rec, sizeof(*rec));
+
+    if (!fm_lock(fs)) {
+        return 0;
+    }
+    ok = fm_read_vol_id(fs, &fm_vol_id);
+    if (ok && rec->magic == SD_FASTMOUNT_MAGIC && rec->version == SD_FASTMOUNT_VERSION &&
+        rec->crc == fm_record_crc(rec) && rec->clean == 1 && rec->fs_type == fs->fs_type &&
+        rec->vol_id == fm_vol_id && rec->n_fatent == fs->n_fatent &&
+        rec->free_clst <= fs->n_fatent - 2) {
+        hit = fm_fat_crc(fs, rec->last_clst, &fat_crc) && fat_crc == rec->fat_crc;
+    }
+
+    if (hit) {
+        /* FSINFO 已给出有效值时保留 FatFs 自己的结果 */
+        if (fs->free_clst > fs->n_fatent - 2) {
+            fs->free_clst = rec->free_clst;
+        } else if (fs->free_clst != rec->free_clst) {
+            LOG_DEBUG("fastmount: FSINFO free %lu, cached %lu",
+                      (unsigned long)fs->free_clst, (unsigned long)rec->free_clst);
+        }
+        if (fs->last_clst < 2 || fs->last_clst >= fs->n_fatent) {
+            fs->last_clst = rec->last_clst;
+        }
+    }
+
+    fm_fat_start = fs->fatbase;
+    fm_fat_end = fs->fatbase + fs->fsize * fs->n_fats;
+    fm_clean = hit;
+    fm_fs = fs;
+    fm_unlock(fs);
+
+    if (hit) {
+        LOG_INFO("fastmount: cached free space valid, %lu free clusters", (unsigned long)fs->free_clst);
+    } else {
+        LOG_INFO("fastmount: no valid cache, free space will be scanned");
+    }
+    return hit;
+}
+
+void SD_FastMount_OnWrite(uint32_t sector, uint32_t count)
+{
+    if (fm_fs == NULL || sector >= fm_fat_end || sector + count <= fm_fat_start) {
+        return;
+    }
+    fm_fat_writes++;
+    if (fm_clean) {
+        /* 先作废记录再写卡，掉电后不会用到过期的空闲簇数 */
+        fm_clean = 0;
+        at24cxx_write_one_byte(FM_CLEAN_ADDR, 0);
+        fm_ee.clean = 0;
+    }
+}
+
+uint8_t SD_FastMount_Checkpoint(FATFS *fs)
+{
+    sd_fastmount_record_t rec;
+    const uint8_t *src = (const uint8_t *)&rec;
+    uint8_t *dst = (uint8_t *)&fm_ee;
+    uint32_t writes;
+    uint32_t i;
+    uint32_t n;
+    uint8_t ok;
+
+    if (fs == NULL || fs != fm_fs) {
+        return 0;
+    }
+    if (!fm_lock(fs)) {
+        return 0;
+    }
+    if (fs->wflag || fs->free_clst > fs->n_fatent - 2) {
+        fm_unlock(fs);
+        return 0;
+    }
+    if (fm_clean && fm_ee.free_clst == fs->free_clst && fm_ee.last_clst == fs->last_clst) {
+        fm_unlock(fs);
+        return 1;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.magic = SD_FASTMOUNT_MAGIC;
+    rec.version = SD_FASTMOUNT_VERSION;
+    rec.fs_type = fs->fs_type;
+    rec.vol_id = fm_vol_id;
+    rec.n_fatent = fs->n_fatent;
+    rec.free_clst = fs->free_clst;
+    rec.last_clst = fs->last_clst;
+    writes = fm_fat_writes;
+    ok = fm_fat_crc(fs, rec.last_clst, &rec.fat_crc);
+    fm_unlock(fs);
+    if (!ok) {
+        return 0;
+    }
+    rec.crc = fm_record_crc(&rec);
+
+    /* 先作废旧记录，再只改写变化的字节；连续变化的字节按页一次写入（每页约5ms） */
+    if (fm_ee.clean != 0) {
+        fm_clean = 0;
+        at24cxx_write_one_byte(FM_CLEAN_ADDR, 0);
+        fm_ee.clean = 0;
+    }
+    i = 0;
+    while (i < sizeof(rec)) {
+        if (i == offsetof(sd_fastmount_record_t, clean) || dst[i] == src[i]) {
+            i++;
+            continue;
+        }
+        n = i + 1U;
+        while (n < sizeof(rec) && n != offsetof(sd_fastmount_record_t, clean) && dst[n] != src[n]) {
+            n++;
+        }
+        at24cxx_write(SD_FASTMOUNT_EE_ADDR + i, &src[i], (uint16_t)(n - i));
+        memcpy(&dst[i], &src[i], n - i);
+        i = n;
+    }
+
+    /* 期间没有 FAT 写入才置 clean */
+    if (!fm_lock(fs)) {
+        return 0;
+    }
+    ok = (writes == fm_fat_writes);
+    if (ok) {
+        at24cxx_write_one_byte(FM_CLEAN_ADDR, 1);
+        fm_ee.clean = 1;
+        fm_clean = 1;
+    }
+    fm_unlock(fs);
+    return ok;
+}
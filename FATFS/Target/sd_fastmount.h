@@ -0,0 +1,75 @@
+/**
+ * @file sd_fastmount.h
+ * @brief SD卡快速挂载：在 AT24CXX EEPROM 中缓存空闲簇数
+ *
+ * FSINFO 不可信（或 FAT12/16 没有 FSINFO）时，f_getfree 需要扫描整张 FAT，
+ * 大容量卡上耗时数秒。本模块把空闲簇数、分配指针和 FAT 抽样校验保存在 EEPROM：
+ *   - 挂载后 SD_FastMount_Restore() 用卷序列号/几何参数和少量 FAT 抽样扇区校验记录，
+ *     有效则直接填入 FATFS 的 free_clst/last_clst，f_getfree 不再扫描；
+ *   - 记录生效期间，第一次写 FAT 区域前先把 EEPROM 中的 clean 标志清零（SD_write 钩子），
+ *     之后异常掉电只会退回到一次完整扫描，不会用到过期数据；
+ *   - SD_FastMount_Checkpoint() 在 FAT 已落盘时把 FatFs 增量维护的空闲簇数写回 EEPROM
+ *     （只改写变化的字节）并重新置 clean。启动挂载后、卷交给 USB 主机前，以及 sd_stream
+ *     预分配/关闭文件后调用；其他写 FAT 的操作之后记录保持失效，直到下一个检查点。
+ */
+
+#ifndef __SD_FASTMOUNT_H
+#define __SD_FASTMOUNT_H
+
+#include "ff.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 记录在 EEPROM 中的起始地址（24C02: 0~254 可用，40~52 为触摸屏校准参数） */
+#ifndef SD_FASTMOUNT_EE_ADDR
+#define SD_FASTMOUNT_EE_ADDR    128U
+#endif
+
+/* 挂载时校验的 FAT 抽样扇区数 */
+#define SD_FASTMOUNT_SAMPLES    8U
+
+/* EEPROM 记录（小端，32字节） */
+typedef struct {
+    uint32_t magic;         /* SD_FASTMOUNT_MAGIC */
+    uint8_t  version;
+    uint8_t  fs_type;       /* FS_FAT12/16/32 */
+    uint8_t  reserved;
+    uint8_t  clean;         /* 1: 记录与卡上 FAT 一致；不参与 crc，单独改写 */
+    uint32_t vol_id;        /* 引导扇区中的卷序列号 */
+    uint32_t n_fatent;      /* FAT 表项数 */
+    uint32_t free_clst;     /* 空闲簇数 */
+    uint32_t last_clst;     /* 最后分配的簇 */
+    uint32_t fat_crc;       /* FAT 抽样扇区的 CRC32 */
+    uint32_t crc;           /* 以上字段（clean 除外）的 CRC32 */
+} sd_fastmount_record_t;
+
+/**
+ * @brief 挂载后恢复缓存的空闲簇数（f_mount(..., 1) 成功后、任何写操作前调用）
+ * @param fs 已挂载的文件系统对象
+ * @retval 1 命中缓存；0 未命中，之后 f_getfree 会完整扫描 FAT
+ */
+uint8_t SD_FastMount_Restore(FATFS *fs);
+
+/**
+ * @brief 把当前空闲簇数写回 EEPROM
+ * @note  FAT 窗口缓冲有未落盘修改或空闲簇数未知时跳过；耗时与改写的 EEPROM 页数成正比（每页约5ms）
+ * @param fs 文件系统对象
+ * @retval 1 记录已是最新；0 本次跳过
+ */
+uint8_t SD_FastMount_Checkpoint(FATFS *fs);
+
+/**
+ * @brief 扇区写入钩子（sd_diskio.c 在写卡前调用）
+ * @param sector 起始扇区
+ * @param count 扇区数
+ */
+void SD_FastMount_OnWrite(uint32_t sector, uint32_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SD_FASTMOUNT_H */
@@ -0,0 +1,204 @@
+/**
+ * @file sd_stats.c
+ * @brief SD卡I/O统计实现
+ *
+ * 时间基准为 TIM2 微秒计数（HighResTimer_GetUs）。一次读/写请求被拆成：
+ *   传输前忙等待（SD_CheckStatusWithTimeout）-> DMA 传输 -> 传输完成中断 -> 传输后忙等待（卡内部编程/GC）
+ * 两段忙等待都计入 SD_STATS_BUSY 直方图和 card_busy_us，请求总耗时计入读/写直方图。
+ * SD 请求由 FatFs 卷锁串行化，统计更新不需要额外加锁；读取快照时进入临界区。
+ */
+
+#include "sd_stats.h"
+#include "high_res_timer.h"
+#define LOG_MODULE LOG_MOD_SD
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "timers.h"
+#include <string.h>
+#include <stdio.h>
+
+static sd_stats_t sd_stats;
+
+/* 最近一次DMA传输完成的时间戳（中断中写入） */
+static volatile uint32_t xfer_done_us;
+static volatile uint8_t xfer_done_valid;
+
+/* 周期日志定时器 */
+static TimerHandle_t sd_stats_timer;
+static StaticTimer_t sd_stats_timer_buf;
+static uint32_t last_logged_ops;
+
+static uint32_t lat_bucket(uint32_t us)
+{
+    uint32_t b = 0;
+
+    while (us > 1U && b < SD_STATS_LAT_BUCKETS - 1U) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static uint32_t sect_bucket(uint32_t n)
+{
+    uint32_t b = 0;
+
+    while (n > 1U && b < SD_STATS_SECT_BUCKETS - 1U) {
+        n >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void lat_add(sd_lat_stats_t *s, uint32_t us)
+{
+    if (s->count == 0 || us < s->min_us) {
+        s->min_us = us;
+    }
+    if (us > s->max_us) {
+        s->max_us = us;
+    }
+    s->count++;
+    s->total_us += us;
+    s->hist[lat_bucket(us)]++;
+}
+
+uint32_t SD_Stats_Begin(void)
+{
+    xfer_done_valid = 0;
+    return HighResTimer_GetUs();
+}
+
+void SD_Stats_XferDone(void)
+{
+    xfer_done_us = HighResTimer_GetUs();
+    xfer_done_valid = 1;
+}
+
+void SD_Stats_Busy(uint32_t us)
+{
+    lat_add(&sd_stats.lat[SD_STATS_BUSY], us);
+    sd_stats.card_busy_us += us;
+}
+
+void SD_Stats_Retry(sd_stats_op_t op)
+{
+    if (op <= SD_STATS_WRITE) {
+        sd_stats.retries[op]++;
+    }
+}
+
+void SD_Stats_End(sd_stats_op_t op, uint32_t sectors, uint32_t t_start, uint8_t ok)
+{
+    uint32_t now = HighResTimer_GetUs();
+
+    if (op > SD_STATS_WRITE) {
+        return;
+    }
+
+    lat_add(&sd_stats.lat[op], now - t_start);
+
+    /* 传输完成到卡回到 transfer 状态之间的时间即卡内部编程/忙时间 */
+    if (xfer_done_valid && (int32_t)(now - xfer_done_us) >= 0) {
+        SD_Stats_Busy(now - xfer_done_us);
+        xfer_done_valid = 0;
+    }
+
+    sd_stats.sect_hist[op][sect_bucket(sectors)]++;
+    sd_stats.sectors[op] += sectors;
+    if (!ok) {
+        sd_stats.errors[op]++;
+    }
+}
+
+void SD_Stats_Get(sd_stats_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    memcpy(out, &sd_stats, sizeof(*out));
+    taskEXIT_CRITICAL();
+}
+
+void SD_Stats_Reset(void)
+{
+    taskENTER_CRITICAL();
+    memset(&sd_stats, 0, sizeof(sd_stats));
+    last_logged_ops = 0;
+    taskEXIT_CRITICAL();
+}
+
+/**
+ * @brief 把直方图非零桶格式化为 "<上界:次数" 列表
+ */
+static void format_hist(char *buf, size_t size, const uint32_t *hist, uint32_t buckets)
+{
+    size_t len = 0;
+    uint32_t i;
+
+    buf[0] = '\0';
+    for (i = 0; i < buckets && len < size; i++) {
+        if (hist[i] == 0) {
+            continue;
+        }
+        if (i == buckets - 1U) {
+            len += snprintf(&buf[len], size - len, " >=%lu:%lu", 1UL << i, (unsigned long)hist[i]);
+        } else {
+            len += snprintf(&buf[len], size - len, " <%lu:%lu", 1UL << (i + 1U), (unsigned long)hist[i]);
+        }
+    }
+}
+
+void SD_Stats_Log(void)
+{
+    static const char *const op_name[SD_STATS_OP_NUM] = {"read", "write", "busy"};
+    static sd_stats_t snap;
+    char hist[160];
+    uint32_t i;
+
+    SD_Stats_Get(&snap);
+
+    for (i = 0; i < SD_STATS_OP_NUM; i++) {
+        const sd_lat_stats_t *s = &snap.lat[i];
+        uint32_t avg = s->count ? (uint32_t)(s->total_us / s->count) : 0;
+
+        format_hist(hist, sizeof(hist), s->hist, SD_STATS_LAT_BUCKETS);
+        LOG_INFO("SD %s: n=%lu avg=%luus min=%luus max=%luus hist(us):%s", op_name[i],
+                 (unsigned long)s->count, (unsigned long)avg,
+                 (unsigned long)s->min_us, (unsigned long)s->max_us, hist);
+    }
+    for (i = 0; i <= SD_STATS_WRITE; i++) {
+        format_hist(hist, sizeof(hist), snap.sect_hist[i], SD_STATS_SECT_BUCKETS);
+        LOG_INFO("SD %s: sectors=%lu errors=%lu retries=%lu sect/req:%s", op_name[i],
+                 (unsigned long)snap.sectors[i], (unsigned long)snap.errors[i],
+                 (unsigned long)snap.retries[i], hist);
+    }
+    LOG_INFO("SD card busy total: %lu ms", (unsigned long)(snap.card_busy_us / 1000U));
+}
+
+static void sd_stats_timer_cb(TimerHandle_t timer)
+{
+    uint32_t ops = sd_stats.lat[SD_STATS_READ].count + sd_stats.lat[SD_STATS_WRITE].count;
+
+    (void)timer;
+    /* 只在有新请求时输出，避免空闲时刷屏 */
+    if (ops != last_logged_ops) {
+        last_logged_ops = ops;
+        SD_Stats_Log();
+    }
+}
+
+void SD_Stats_Init(void)
+{
+#if SD_STATS_LOG_PERIOD_MS > 0
+    if (sd_stats_timer == NULL) {
+        sd_stats_timer = xTimerCreateStatic("sdstats", pdMS_TO_TICKS(SD_STATS_LOG_PERIOD_MS), pdTRUE,
+                                            NULL, sd_stats_timer_cb, &sd_stats_timer_buf);
+        if (sd_stats_timer != NULL) {
+            xTimerStart(sd_stats_timer, 0);
+        }
+    }
+#endif
+}
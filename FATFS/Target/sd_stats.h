@@ -0,0 +1,85 @@
+/**
+ * @file sd_stats.h
+ * @brief SD卡I/O统计：读/写/忙等待延迟直方图、每次请求扇区数、错误与重试计数
+ */
+
+#ifndef __SD_STATS_H
+#define __SD_STATS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 延迟直方图桶数：桶 i 覆盖 [2^i, 2^(i+1)) 微秒，桶0含0us，最后一桶为溢出桶（>=2^19us≈0.5s） */
+#define SD_STATS_LAT_BUCKETS    20U
+
+/* 扇区数直方图桶数：1, 2-3, 4-7, ..., 64-127, >=128 */
+#define SD_STATS_SECT_BUCKETS   8U
+
+/* 周期性日志间隔（毫秒），0 表示不周期输出 */
+#ifndef SD_STATS_LOG_PERIOD_MS
+#define SD_STATS_LOG_PERIOD_MS  10000U
+#endif
+
+/* 统计的操作类型 */
+typedef enum {
+    SD_STATS_READ = 0,      /* 读请求总耗时 */
+    SD_STATS_WRITE,         /* 写请求总耗时 */
+    SD_STATS_BUSY,          /* 等待卡退出忙状态的耗时（传输前 + 传输后编程） */
+    SD_STATS_OP_NUM
+} sd_stats_op_t;
+
+/* 单类操作的延迟统计 */
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t hist[SD_STATS_LAT_BUCKETS];
+} sd_lat_stats_t;
+
+/* SD卡I/O统计 */
+typedef struct {
+    sd_lat_stats_t lat[SD_STATS_OP_NUM];
+    uint32_t sect_hist[2][SD_STATS_SECT_BUCKETS];   /* [读/写][桶] 每次请求扇区数 */
+    uint64_t sectors[2];                            /* [读/写] 累计扇区数 */
+    uint32_t errors[2];                             /* [读/写] 最终失败次数 */
+    uint32_t retries[2];                            /* [读/写] 重试次数 */
+    uint64_t card_busy_us;                          /* 卡忙累计时间 */
+} sd_stats_t;
+
+/**
+ * @brief 初始化统计（创建周期日志定时器），需在调度器运行后调用
+ */
+void SD_Stats_Init(void);
+
+/**
+ * @brief 获取统计快照
+ * @param out 输出
+ */
+void SD_Stats_Get(sd_stats_t *out);
+
+/**
+ * @brief 清零统计
+ */
+void SD_Stats_Reset(void);
+
+/**
+ * @brief 通过日志输出统计摘要与直方图
+ */
+void SD_Stats_Log(void);
+
+/* 以下为 sd_diskio.c / bsp_driver_sd.c 内部使用的采样钩子 */
+uint32_t SD_Stats_Begin(void);
+void SD_Stats_End(sd_stats_op_t op, uint32_t sectors, uint32_t t_start, uint8_t ok);
+void SD_Stats_Busy(uint32_t us);
+void SD_Stats_Retry(sd_stats_op_t op);
+void SD_Stats_XferDone(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __SD_STATS_H */
@@ -0,0 +1,70 @@
+/**
+  ******************************************************************************
+  * @file    usbd_composite.h
+  * @brief   Header for the usbd_composite.c file (MSC + CDC composite class)
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_COMPOSITE_H
+#define __USBD_COMPOSITE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include  "usbd_msc.h"
+#include  "usbd_cdc.h"
+
+/** @addtogroup STM32_USB_DEVICE_LIBRARY
+  * @{
+  */
+
+/** @defgroup USBD_COMPOSITE
+  * @brief This file is the Header file for usbd_composite.c
+  * @{
+  */
+
+
+/** @defgroup USBD_COMPOSITE_Exported_Defines
+  * @{
+  */
+/* Interface numbers */
+#define COMPOSITE_MSC_ITF                 0x00U
+#define COMPOSITE_CDC_CMD_ITF             0x01U
+#define COMPOSITE_CDC_DATA_ITF            0x02U
+#define COMPOSITE_NUM_ITF                 0x03U
+
+#define USB_COMPOSITE_CONFIG_DESC_SIZ     98U
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_COMPOSITE_Exported_Variables
+  * @{
+  */
+
+/* MSC keeps pdev->pClassData / pdev->pUserData (register the storage with
+ * USBD_MSC_RegisterStorage), CDC keeps its state in static storage (register
+ * the interface with USBD_CDC_RegisterInterface). */
+extern USBD_ClassTypeDef  USBD_COMPOSITE;
+#define USBD_COMPOSITE_CLASS    &USBD_COMPOSITE
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __USBD_COMPOSITE_H */
+/**
+  * @}
+  */
+
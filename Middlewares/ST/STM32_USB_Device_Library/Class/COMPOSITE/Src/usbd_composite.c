@@ -0,0 +1,385 @@
+/**
+  ******************************************************************************
+  * @file    usbd_composite.c
+  * @brief   MSC + CDC composite class.
+  *
+  * @verbatim
+  *
+  *          ===================================================================
+  *                                Composite Class Description
+  *          ===================================================================
+  *           Interface 0      : Mass Storage (BOT, SCSI), EP 0x81 / 0x01
+  *           Interface 1 + 2  : CDC ACM grouped by an Interface Association
+  *                              Descriptor, data EP 0x82 / 0x02, command EP 0x83
+  *
+  *           Requests and endpoint events are routed to the class owning the
+  *           interface or endpoint. The MSC class owns pdev->pClassData and
+  *           pdev->pUserData, the CDC class keeps its state in static storage,
+  *           so no context switching is needed when dispatching.
+  *
+  *  @endverbatim
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_composite.h"
+#include "usbd_ctlreq.h"
+
+
+/** @addtogroup STM32_USB_DEVICE_LIBRARY
+  * @{
+  */
+
+
+/** @defgroup USBD_COMPOSITE
+  * @brief composite class module
+  * @{
+  */
+
+/** @defgroup USBD_COMPOSITE_Private_FunctionPrototypes
+  * @{
+  */
+static uint8_t USBD_COMPOSITE_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t USBD_COMPOSITE_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx);
+static uint8_t USBD_COMPOSITE_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req);
+static uint8_t USBD_COMPOSITE_EP0_RxReady(USBD_HandleTypeDef *pdev);
+static uint8_t USBD_COMPOSITE_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum);
+static uint8_t USBD_COMPOSITE_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum);
+
+static uint8_t *USBD_COMPOSITE_GetFSCfgDesc(uint16_t *length);
+static uint8_t *USBD_COMPOSITE_GetDeviceQualifierDescriptor(uint16_t *length);
+/**
+  * @}
+  */
+
+/** @defgroup USBD_COMPOSITE_Private_Variables
+  * @{
+  */
+USBD_ClassTypeDef  USBD_COMPOSITE =
+{
+  USBD_COMPOSITE_Init,
+  USBD_COMPOSITE_DeInit,
+  USBD_COMPOSITE_Setup,
+  NULL, /*EP0_TxSent*/
+  USBD_COMPOSITE_EP0_RxReady,
+  USBD_COMPOSITE_DataIn,
+  USBD_COMPOSITE_DataOut,
+  NULL, /*SOF */
+  NULL,
+  NULL,
+  NULL, /* Full speed only */
+  USBD_COMPOSITE_GetFSCfgDesc,
+  NULL,
+  USBD_COMPOSITE_GetDeviceQualifierDescriptor,
+};
+
+/* Configuration Descriptor */
+__ALIGN_BEGIN static uint8_t USBD_COMPOSITE_CfgFSDesc[USB_COMPOSITE_CONFIG_DESC_SIZ] __ALIGN_END =
+{
+  0x09,                                            /* bLength: Configuation Descriptor size */
+  USB_DESC_TYPE_CONFIGURATION,                     /* bDescriptorType: Configuration */
+  USB_COMPOSITE_CONFIG_DESC_SIZ,
+  0x00,
+  COMPOSITE_NUM_ITF,                               /* bNumInterfaces: 3 interfaces */
+  0x01,                                            /* bConfigurationValue: */
+  0x04,                                            /* iConfiguration: */
+  0xC0,                                            /* bmAttributes: */
+  0x32,                                            /* MaxPower 100 mA */
+
+  /********************  Mass Storage interface ********************/
+  0x09,                                            /* bLength: Interface Descriptor size */
+  USB_DESC_TYPE_INTERFACE,                         /* bDescriptorType: */
+  COMPOSITE_MSC_ITF,                               /* bInterfaceNumber: Number of Interface */
+  0x00,                                            /* bAlternateSetting: Alternate setting */
+  0x02,                                            /* bNumEndpoints*/
+  0x08,                                            /* bInterfaceClass: MSC Class */
+  0x06,                                            /* bInterfaceSubClass : SCSI transparent*/
+  0x50,                                            /* nInterfaceProtocol */
+  0x05,                                            /* iInterface: */
+  /********************  Mass Storage Endpoints ********************/
+  0x07,                                            /* Endpoint descriptor length = 7 */
+  USB_DESC_TYPE_ENDPOINT,                          /* Endpoint descriptor type */
+  MSC_EPIN_ADDR,                                   /* Endpoint address (IN, address 1) */
+  0x02,                                            /* Bulk endpoint type */
+  LOBYTE(MSC_MAX_FS_PACKET),
+  HIBYTE(MSC_MAX_FS_PACKET),
+  0x00,                                            /* Polling interval in milliseconds */
+
+  0x07,                                            /* Endpoint descriptor length = 7 */
+  USB_DESC_TYPE_ENDPOINT,                          /* Endpoint descriptor type */
+  MSC_EPOUT_ADDR,                                  /* Endpoint address (OUT, address 1) */
+  0x02,                                            /* Bulk endpoint type */
+  LOBYTE(MSC_MAX_FS_PACKET),
+  HIBYTE(MSC_MAX_FS_PACKET),
+  0x00,                                            /* Polling interval in milliseconds */
+
+  /********************  CDC Interface Association ********************/
+  0x08,                                            /* bLength */
+  0x0B,                                            /* bDescriptorType: IAD */
+  COMPOSITE_CDC_CMD_ITF,                           /* bFirstInterface */
+  0x02,                                            /* bInterfaceCount */
+  0x02,                                            /* bFunctionClass: CDC */
+  0x02,                                            /* bFunctionSubClass: ACM */
+  0x01,                                            /* bFunctionProtocol: AT commands */
+  0x00,                                            /* iFunction */
+
+  /********************  CDC Communication interface ********************/
+  0x09,                                            /* bLength: Interface Descriptor size */
+  USB_DESC_TYPE_INTERFACE,                         /* bDescriptorType: Interface */
+  COMPOSITE_CDC_CMD_ITF,                           /* bInterfaceNumber: Number of Interface */
+  0x00,                                            /* bAlternateSetting: Alternate setting */
+  0x01,                                            /* bNumEndpoints: One endpoints used */
+  0x02,                                            /* bInterfaceClass: Communication Interface Class */
+  0x02,                                            /* bInterfaceSubClass: Abstract Control Model */
+  0x01,                                            /* bInterfaceProtocol: Common AT commands */
+  0x00,                                            /* iInterface: */
+
+  /* Header Functional Descriptor */
+  0x05,                                            /* bLength: Endpoint Descriptor size */
+  0x24,                                            /* bDescriptorType: CS_INTERFACE */
+  0x00,                                            /* bDescriptorSubtype: Header Func Desc */
+  0x10,                                            /* bcdCDC: spec release number */
+  0x01,
+
+  /* Call Management Functional Descriptor */
+  0x05,                                            /* bFunctionLength */
+  0x24,                                            /* bDescriptorType: CS_INTERFACE */
+  0x01,                                            /* bDescriptorSubtype: Call Management Func Desc */
+  0x00,                                            /* bmCapabilities: D0+D1 */
+  COMPOSITE_CDC_DATA_ITF,                          /* bDataInterface */
+
+  /* ACM Functional Descriptor */
+  0x04,                                            /* bFunctionLength */
+  0x24,                                            /* bDescriptorType: CS_INTERFACE */
+  0x02,                                            /* bDescriptorSubtype: Abstract Control Management desc */
+  0x02,                                            /* bmCapabilities */
+
+  /* Union Functional Descriptor */
+  0x05,                                            /* bFunctionLength */
+  0x24,                                            /* bDescriptorType: CS_INTERFACE */
+  0x06,                                            /* bDescriptorSubtype: Union func desc */
+  COMPOSITE_CDC_CMD_ITF,                           /* bMasterInterface: Communication class interface */
+  COMPOSITE_CDC_DATA_ITF,                          /* bSlaveInterface0: Data Class Interface */
+
+  /* Command Endpoint Descriptor */
+  0x07,                                            /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,                          /* bDescriptorType: Endpoint */
+  CDC_CMD_EP,                                      /* bEndpointAddress */
+  0x03,                                            /* bmAttributes: Interrupt */
+  LOBYTE(CDC_CMD_PACKET_SIZE),                     /* wMaxPacketSize: */
+  HIBYTE(CDC_CMD_PACKET_SIZE),
+  CDC_FS_BINTERVAL,                                /* bInterval: */
+
+  /********************  CDC Data interface ********************/
+  0x09,                                            /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_INTERFACE,                         /* bDescriptorType: */
+  COMPOSITE_CDC_DATA_ITF,                          /* bInterfaceNumber: Number of Interface */
+  0x00,                                            /* bAlternateSetting: Alternate setting */
+  0x02,                                            /* bNumEndpoints: Two endpoints used */
+  0x0A,                                            /* bInterfaceClass: CDC */
+  0x00,                                            /* bInterfaceSubClass: */
+  0x00,                                            /* bInterfaceProtocol: */
+  0x00,                                            /* iInterface: */
+
+  /* Endpoint OUT Descriptor */
+  0x07,                                            /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,                          /* bDescriptorType: Endpoint */
+  CDC_OUT_EP,                                      /* bEndpointAddress */
+  0x02,                                            /* bmAttributes: Bulk */
+  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),             /* wMaxPacketSize: */
+  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+  0x00,                                            /* bInterval: ignore for Bulk transfer */
+
+  /* Endpoint IN Descriptor */
+  0x07,                                            /* bLength: Endpoint Descriptor size */
+  USB_DESC_TYPE_ENDPOINT,                          /* bDescriptorType: Endpoint */
+  CDC_IN_EP,                                       /* bEndpointAddress */
+  0x02,                                            /* bmAttributes: Bulk */
+  LOBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),             /* wMaxPacketSize: */
+  HIBYTE(CDC_DATA_FS_MAX_PACKET_SIZE),
+  0x00                                             /* bInterval: ignore for Bulk transfer */
+};
+/**
+  * @}
+  */
+
+
+/** @defgroup USBD_COMPOSITE_Private_Functions
+  * @{
+  */
+
+/**
+  * @brief  USBD_COMPOSITE_IsMscEp
+  *         Check whether an endpoint belongs to the MSC function
+  * @param  epnum: endpoint number or address
+  * @retval 1 for MSC endpoints
+  */
+static uint8_t USBD_COMPOSITE_IsMscEp(uint8_t epnum)
+{
+  return (uint8_t)(((epnum & 0xFU) == (MSC_EPIN_ADDR & 0xFU)) ||
+                   ((epnum & 0xFU) == (MSC_EPOUT_ADDR & 0xFU)));
+}
+
+/**
+  * @brief  USBD_COMPOSITE_Init
+  *         Initialize both functions
+  * @param  pdev: device instance
+  * @param  cfgidx: configuration index
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_Init(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  uint8_t ret;
+
+  ret = USBD_MSC.Init(pdev, cfgidx);
+  if (ret != (uint8_t)USBD_OK)
+  {
+    return ret;
+  }
+
+  ret = USBD_CDC.Init(pdev, cfgidx);
+  if (ret != (uint8_t)USBD_OK)
+  {
+    (void)USBD_MSC.DeInit(pdev, cfgidx);
+  }
+
+  return ret;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DeInit
+  *         DeInitialize both functions
+  * @param  pdev: device instance
+  * @param  cfgidx: configuration index
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_DeInit(USBD_HandleTypeDef *pdev, uint8_t cfgidx)
+{
+  (void)USBD_CDC.DeInit(pdev, cfgidx);
+  (void)USBD_MSC.DeInit(pdev, cfgidx);
+
+  return (uint8_t)USBD_OK;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_Setup
+  *         Route interface and endpoint requests to the owning function
+  * @param  pdev: device instance
+  * @param  req: USB request
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
+{
+  switch (req->bmRequest & USB_REQ_RECIPIENT_MASK)
+  {
+  case USB_REQ_RECIPIENT_INTERFACE:
+    if (LOBYTE(req->wIndex) == COMPOSITE_MSC_ITF)
+    {
+      return USBD_MSC.Setup(pdev, req);
+    }
+    if ((LOBYTE(req->wIndex) == COMPOSITE_CDC_CMD_ITF) ||
+        (LOBYTE(req->wIndex) == COMPOSITE_CDC_DATA_ITF))
+    {
+      return USBD_CDC.Setup(pdev, req);
+    }
+    break;
+
+  case USB_REQ_RECIPIENT_ENDPOINT:
+    if (USBD_COMPOSITE_IsMscEp(LOBYTE(req->wIndex)) != 0U)
+    {
+      return USBD_MSC.Setup(pdev, req);
+    }
+    return USBD_CDC.Setup(pdev, req);
+
+  default:
+    break;
+  }
+
+  USBD_CtlError(pdev, req);
+  return (uint8_t)USBD_FAIL;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_EP0_RxReady
+  *         Only the CDC function receives data on EP0
+  * @param  pdev: device instance
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_EP0_RxReady(USBD_HandleTypeDef *pdev)
+{
+  return USBD_CDC.EP0_RxReady(pdev);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DataIn
+  *         handle data IN Stage
+  * @param  pdev: device instance
+  * @param  epnum: endpoint index
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  if (USBD_COMPOSITE_IsMscEp(epnum) != 0U)
+  {
+    return USBD_MSC.DataIn(pdev, epnum);
+  }
+
+  return USBD_CDC.DataIn(pdev, epnum);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_DataOut
+  *         handle data OUT Stage
+  * @param  pdev: device instance
+  * @param  epnum: endpoint index
+  * @retval status
+  */
+static uint8_t USBD_COMPOSITE_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
+{
+  if (USBD_COMPOSITE_IsMscEp(epnum) != 0U)
+  {
+    return USBD_MSC.DataOut(pdev, epnum);
+  }
+
+  return USBD_CDC.DataOut(pdev, epnum);
+}
+
+/**
+  * @brief  USBD_COMPOSITE_GetFSCfgDesc
+  *         return configuration descriptor
+  * @param  length : pointer data length
+  * @retval pointer to descriptor buffer
+  */
+static uint8_t *USBD_COMPOSITE_GetFSCfgDesc(uint16_t *length)
+{
+  *length = (uint16_t)sizeof(USBD_COMPOSITE_CfgFSDesc);
+
+  return USBD_COMPOSITE_CfgFSDesc;
+}
+
+/**
+  * @brief  USBD_COMPOSITE_GetDeviceQualifierDescriptor
+  *         return Device Qualifier descriptor
+  * @param  length : pointer data length
+  * @retval pointer to descriptor buffer
+  */
+static uint8_t *USBD_COMPOSITE_GetDeviceQualifierDescriptor(uint16_t *length)
+{
+  return USBD_MSC.GetDeviceQualifierDescriptor(length);
+}
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
+
+/**
+  * @}
+  */
+
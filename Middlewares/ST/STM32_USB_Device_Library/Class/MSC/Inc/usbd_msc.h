@@ -48,6 +48,17 @@ extern "C" {
 #define MSC_MEDIA_PACKET             512U
 #endif /* MSC_MEDIA_PACKET */
 
+/* Size of the class data buffer. It only has to hold a full media packet
+ * when the storage interface does not provide the pipelined callbacks. */
+#ifndef MSC_BOT_DATA_SIZE
+#define MSC_BOT_DATA_SIZE            MSC_MEDIA_PACKET
+#endif /* MSC_BOT_DATA_SIZE */
+
+/* Number of logical units the class keeps state for */
+#ifndef MSC_BOT_MAX_LUN
+#define MSC_BOT_MAX_LUN              2U
+#endif /* MSC_BOT_MAX_LUN */
+
 #define MSC_MAX_FS_PACKET            0x40U
 #define MSC_MAX_HS_PACKET            0x200U
 
@@ -77,8 +88,28 @@ typedef struct _USBD_STORAGE
   int8_t (* GetMaxLun)(void);
   int8_t *pInquiry;
 
+  /* Optional pipelined interface, leave NULL to use Read/Write synchronously.
+   * A NULL buffer or a positive status means the operation is in flight; the
+   * storage layer calls SCSI_Resume() once it can make progress. */
+  uint8_t *(* ReadBuf)(uint8_t lun, uint32_t blk_addr, uint16_t blk_len, int8_t *status);
+  void (* ReadAhead)(uint8_t lun, uint32_t blk_addr, uint16_t blk_len);
+  uint8_t *(* WriteBuf)(uint8_t lun);
+  int8_t (* WriteSubmit)(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+  int8_t (* WriteFlush)(uint8_t lun);
+
+  /* Optional, may be NULL: the host is done with the medium, either ejected
+   * by START STOP UNIT (LoEj) or the configuration was dropped by a bus reset
+   * or disconnect. */
+  void (* Eject)(uint8_t lun);
+
 } USBD_StorageTypeDef;
 
+/* SCSI data phase waiting on the pipelined storage interface */
+#define MSC_IO_WAIT_NONE             0U
+#define MSC_IO_WAIT_READ             1U
+#define MSC_IO_WAIT_WRITE_BUF        2U
+#define MSC_IO_WAIT_FLUSH            3U
+
 
 typedef struct
 {
@@ -87,20 +118,23 @@ typedef struct
   uint8_t                  bot_state;
   uint8_t                  bot_status;
   uint32_t                 bot_data_length;
-  uint8_t                  bot_data[MSC_MEDIA_PACKET];
+  uint8_t                  bot_data[MSC_BOT_DATA_SIZE];
   USBD_MSC_BOT_CBWTypeDef  cbw;
   USBD_MSC_BOT_CSWTypeDef  csw;
 
   USBD_SCSI_SenseTypeDef   scsi_sense [SENSE_LIST_DEEPTH];
   uint8_t                  scsi_sense_head;
   uint8_t                  scsi_sense_tail;
-  uint8_t                  scsi_medium_state;
+  uint8_t                  scsi_medium_state[MSC_BOT_MAX_LUN];
 
   uint16_t                 scsi_blk_size;
   uint32_t                 scsi_blk_nbr;
 
   uint32_t                 scsi_blk_addr;
   uint32_t                 scsi_blk_len;
+
+  uint8_t                  io_wait;
+  uint8_t                  *io_buf;
 }
 USBD_MSC_BOT_HandleTypeDef;
 
@@ -372,7 +372,8 @@ uint8_t USBD_MSC_Setup(USBD_HandleTypeDef *pdev, USBD_SetupReqTypedef *req)
       if ((req->wValue  == 0U) && (req->wLength == 1U) &&
           ((req->bmRequest & 0x80U) == 0x80U))
       {
-        hmsc->max_lun = (uint32_t)((USBD_StorageTypeDef *)pdev->pUserData)->GetMaxLun();
+        hmsc->max_lun = MIN((uint32_t)((USBD_StorageTypeDef *)pdev->pUserData)->GetMaxLun(),
+                            MSC_BOT_MAX_LUN - 1U);
         (void)USBD_CtlSendData(pdev, (uint8_t *)&hmsc->max_lun, 1U);
       }
       else
@@ -98,15 +98,22 @@ static void MSC_BOT_Abort(USBD_HandleTypeDef *pdev);
 void MSC_BOT_Init(USBD_HandleTypeDef *pdev)
 {
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
+  USBD_StorageTypeDef *storage = (USBD_StorageTypeDef *)pdev->pUserData;
+  uint32_t lun;
 
   hmsc->bot_state = USBD_BOT_IDLE;
   hmsc->bot_status = USBD_BOT_STATUS_NORMAL;
+  hmsc->io_wait = MSC_IO_WAIT_NONE;
 
   hmsc->scsi_sense_tail = 0U;
   hmsc->scsi_sense_head = 0U;
-  hmsc->scsi_medium_state = SCSI_MEDIUM_UNLOCKED;
+  for (lun = 0U; lun < MSC_BOT_MAX_LUN; lun++)
+  {
+    hmsc->scsi_medium_state[lun] = SCSI_MEDIUM_UNLOCKED;
+  }
+  hmsc->max_lun = MIN((uint32_t)storage->GetMaxLun(), MSC_BOT_MAX_LUN - 1U);
 
-  ((USBD_StorageTypeDef *)pdev->pUserData)->Init(0U);
+  storage->Init(0U);
 
   (void)USBD_LL_FlushEP(pdev, MSC_EPOUT_ADDR);
   (void)USBD_LL_FlushEP(pdev, MSC_EPIN_ADDR);
@@ -128,6 +135,7 @@ void MSC_BOT_Reset(USBD_HandleTypeDef *pdev)
 
   hmsc->bot_state  = USBD_BOT_IDLE;
   hmsc->bot_status = USBD_BOT_STATUS_RECOVERY;
+  hmsc->io_wait    = MSC_IO_WAIT_NONE;
 
   (void)USBD_LL_ClearStallEP(pdev, MSC_EPIN_ADDR);
   (void)USBD_LL_ClearStallEP(pdev, MSC_EPOUT_ADDR);
@@ -146,7 +154,23 @@ void MSC_BOT_Reset(USBD_HandleTypeDef *pdev)
 void MSC_BOT_DeInit(USBD_HandleTypeDef  *pdev)
 {
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
+  USBD_StorageTypeDef *storage = (USBD_StorageTypeDef *)pdev->pUserData;
+  int8_t lun;
+
+  if (hmsc == NULL)
+  {
+    return;
+  }
   hmsc->bot_state = USBD_BOT_IDLE;
+
+  /* Configuration dropped: the host no longer has the media mounted */
+  if (storage->Eject != NULL)
+  {
+    for (lun = 0; lun <= storage->GetMaxLun(); lun++)
+    {
+      storage->Eject((uint8_t)lun);
+    }
+  }
 }
 
 /**
@@ -167,7 +191,7 @@ void MSC_BOT_DataIn(USBD_HandleTypeDef *pdev, uint8_t epnum)
   case USBD_BOT_DATA_IN:
     if (SCSI_ProcessCmd(pdev, hmsc->cbw.bLUN, &hmsc->cbw.CB[0]) < 0)
     {
-      MSC_BOT_SendCSW(pdev, USBD_CSW_CMD_FAILED);
+      MSC_BOT_DataPhaseError(pdev);
     }
     break;
 
@@ -202,7 +226,7 @@ void MSC_BOT_DataOut(USBD_HandleTypeDef *pdev, uint8_t epnum)
     case USBD_BOT_DATA_OUT:
       if (SCSI_ProcessCmd(pdev, hmsc->cbw.bLUN, &hmsc->cbw.CB[0]) < 0)
       {
-        MSC_BOT_SendCSW(pdev, USBD_CSW_CMD_FAILED);
+        MSC_BOT_DataPhaseError(pdev);
       }
       break;
 
@@ -226,7 +250,7 @@ static void  MSC_BOT_CBW_Decode(USBD_HandleTypeDef *pdev)
 
   if ((USBD_LL_GetRxDataSize(pdev, MSC_EPOUT_ADDR) != USBD_BOT_CBW_LENGTH) ||
       (hmsc->cbw.dSignature != USBD_BOT_CBW_SIGNATURE) ||
-      (hmsc->cbw.bLUN > 1U) || (hmsc->cbw.bCBLength < 1U) ||
+      (hmsc->cbw.bLUN > hmsc->max_lun) || (hmsc->cbw.bCBLength < 1U) ||
       (hmsc->cbw.bCBLength > 16U))
   {
     SCSI_SenseCode(pdev, hmsc->cbw.bLUN, ILLEGAL_REQUEST, INVALID_CDB);
@@ -236,9 +260,19 @@ static void  MSC_BOT_CBW_Decode(USBD_HandleTypeDef *pdev)
   }
   else
   {
+    /* A valid CBW ends a reset recovery: stall errors report their CSW again */
+    hmsc->bot_status = USBD_BOT_STATUS_NORMAL;
+
+    /* Sense data only describes the previous command */
+    if (hmsc->cbw.CB[0] != SCSI_REQUEST_SENSE)
+    {
+      hmsc->scsi_sense_head = hmsc->scsi_sense_tail;
+    }
+
     if (SCSI_ProcessCmd(pdev, hmsc->cbw.bLUN, &hmsc->cbw.CB[0]) < 0)
     {
-      if (hmsc->bot_state == USBD_BOT_NO_DATA)
+      /* case 1 : Hn = Dn, nothing to stall */
+      if ((hmsc->bot_state == USBD_BOT_NO_DATA) || (hmsc->cbw.dDataLength == 0U))
       {
         MSC_BOT_SendCSW(pdev, USBD_CSW_CMD_FAILED);
       }
@@ -316,6 +350,36 @@ void  MSC_BOT_SendCSW(USBD_HandleTypeDef *pdev, uint8_t CSW_Status)
                                USBD_BOT_CBW_LENGTH);
 }
 
+/**
+* @brief  MSC_BOT_DataPhaseError
+*         Fail a command after its data phase started. While the host still
+*         expects data the pipe in use is stalled: the CSW of a read follows
+*         the clear feature, the CSW of a write is queued right away. A write
+*         that already received all its data just gets the CSW.
+* @param  pdev: device instance
+* @retval None
+*/
+void  MSC_BOT_DataPhaseError(USBD_HandleTypeDef *pdev)
+{
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
+
+  if (hmsc->csw.dDataResidue == 0U)
+  {
+    MSC_BOT_SendCSW(pdev, USBD_CSW_CMD_FAILED);
+  }
+  else if ((hmsc->cbw.bmFlags & 0x80U) == 0x80U)
+  {
+    /* case 5 : Hi > Di */
+    (void)USBD_LL_StallEP(pdev, MSC_EPIN_ADDR);
+  }
+  else
+  {
+    /* case 9 : Ho > Do */
+    (void)USBD_LL_StallEP(pdev, MSC_EPOUT_ADDR);
+    MSC_BOT_SendCSW(pdev, USBD_CSW_CMD_FAILED);
+  }
+}
+
 /**
 * @brief  MSC_BOT_Abort
 *         Abort the current transfer
@@ -92,11 +92,11 @@ uint8_t MSC_Page80_Inquiry_Data[LENGTH_INQUIRY_PAGE80] =
 /* USB Mass storage sense 6 Data */
 uint8_t MSC_Mode_Sense6_data[MODE_SENSE6_LEN] =
 {
-  0x22,
+  MODE_SENSE6_LEN - 1U,     /* Mode data length */
   0x00,
   0x00,
   0x00,
-  0x08,
+  0x08,                     /* Caching page, write cache disabled */
   0x12,
   0x00,
   0x00,
@@ -114,6 +114,7 @@ uint8_t MSC_Mode_Sense6_data[MODE_SENSE6_LEN] =
   0x00,
   0x00,
   0x00,
+  0x00,
   0x00
 };
 
@@ -122,14 +123,14 @@ uint8_t MSC_Mode_Sense6_data[MODE_SENSE6_LEN] =
 uint8_t MSC_Mode_Sense10_data[MODE_SENSE10_LEN] =
 {
   0x00,
-  0x26,
+  MODE_SENSE10_LEN - 2U,    /* Mode data length */
   0x00,
   0x00,
   0x00,
   0x00,
   0x00,
   0x00,
-  0x08,
+  0x08,                     /* Caching page, write cache disabled */
   0x12,
   0x00,
   0x00,
@@ -147,6 +148,7 @@ uint8_t MSC_Mode_Sense10_data[MODE_SENSE10_LEN] =
   0x00,
   0x00,
   0x00,
+  0x00,
   0x00
 };
 /**
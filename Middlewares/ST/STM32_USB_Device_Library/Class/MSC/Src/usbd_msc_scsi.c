@@ -97,6 +97,9 @@ static int8_t SCSI_CheckAddressRange(USBD_HandleTypeDef *pdev, uint8_t lun,
 
 static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun);
 static int8_t SCSI_ProcessWrite(USBD_HandleTypeDef *pdev, uint8_t lun);
+static int8_t SCSI_ReceiveNext(USBD_HandleTypeDef *pdev, uint8_t lun);
+static int8_t SCSI_FinishWrite(USBD_HandleTypeDef *pdev, uint8_t lun);
+static uint32_t SCSI_PacketSize(USBD_HandleTypeDef *pdev);
 
 static int8_t SCSI_UpdateBotData(USBD_MSC_BOT_HandleTypeDef *hmsc,
                                  uint8_t *pBuff, uint16_t length);
@@ -121,7 +124,6 @@ static int8_t SCSI_UpdateBotData(USBD_MSC_BOT_HandleTypeDef *hmsc,
 int8_t SCSI_ProcessCmd(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *cmd)
 {
   int8_t ret;
-  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
 
   switch (cmd[0])
   {
@@ -186,8 +188,9 @@ int8_t SCSI_ProcessCmd(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *cmd)
     break;
 
   default:
+    /* A valid CBW carrying an unsupported command: fail it in the CSW, the
+     * host does not need a reset recovery */
     SCSI_SenseCode(pdev, lun, ILLEGAL_REQUEST, INVALID_CDB);
-    hmsc->bot_status = USBD_BOT_STATUS_ERROR;
     ret = -1;
     break;
   }
@@ -216,7 +219,7 @@ static int8_t SCSI_TestUnitReady(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t
     return -1;
   }
 
-  if (hmsc->scsi_medium_state == SCSI_MEDIUM_EJECTED)
+  if (hmsc->scsi_medium_state[lun] == SCSI_MEDIUM_EJECTED)
   {
     SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
     hmsc->bot_state = USBD_BOT_NO_DATA;
@@ -305,7 +308,7 @@ static int8_t SCSI_ReadCapacity10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t
 
   ret = ((USBD_StorageTypeDef *)pdev->pUserData)->GetCapacity(lun, &hmsc->scsi_blk_nbr, &hmsc->scsi_blk_size);
 
-  if ((ret != 0) || (hmsc->scsi_medium_state == SCSI_MEDIUM_EJECTED))
+  if ((ret != 0) || (hmsc->scsi_medium_state[lun] == SCSI_MEDIUM_EJECTED))
   {
     SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
     return -1;
@@ -344,7 +347,7 @@ static int8_t SCSI_ReadCapacity16(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t
 
   ret = ((USBD_StorageTypeDef *)pdev->pUserData)->GetCapacity(lun, &hmsc->scsi_blk_nbr, &hmsc->scsi_blk_size);
 
-  if ((ret != 0) || (hmsc->scsi_medium_state == SCSI_MEDIUM_EJECTED))
+  if ((ret != 0) || (hmsc->scsi_medium_state[lun] == SCSI_MEDIUM_EJECTED))
   {
     SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
     return -1;
@@ -397,7 +400,7 @@ static int8_t SCSI_ReadFormatCapacity(USBD_HandleTypeDef *pdev, uint8_t lun, uin
 
   ret = ((USBD_StorageTypeDef *)pdev->pUserData)->GetCapacity(lun, &blk_nbr, &blk_size);
 
-  if ((ret != 0) || (hmsc->scsi_medium_state == SCSI_MEDIUM_EJECTED))
+  if ((ret != 0) || (hmsc->scsi_medium_state[lun] == SCSI_MEDIUM_EJECTED))
   {
     SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
     return -1;
@@ -434,7 +437,6 @@ static int8_t SCSI_ReadFormatCapacity(USBD_HandleTypeDef *pdev, uint8_t lun, uin
 */
 static int8_t SCSI_ModeSense6(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
-  UNUSED(lun);
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
   uint16_t len = MODE_SENSE6_LEN;
 
@@ -445,6 +447,12 @@ static int8_t SCSI_ModeSense6(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *pa
 
   (void)SCSI_UpdateBotData(hmsc, MSC_Mode_Sense6_data, len);
 
+  /* WP bit of the device-specific parameter, hosts mount the unit read-only */
+  if ((len > 2U) && (((USBD_StorageTypeDef *)pdev->pUserData)->IsWriteProtected(lun) != 0))
+  {
+    hmsc->bot_data[2] |= 0x80U;
+  }
+
   return 0;
 }
 
@@ -458,7 +466,6 @@ static int8_t SCSI_ModeSense6(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *pa
 */
 static int8_t SCSI_ModeSense10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
-  UNUSED(lun);
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
   uint16_t len = MODE_SENSE10_LEN;
 
@@ -469,6 +476,12 @@ static int8_t SCSI_ModeSense10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *p
 
   (void)SCSI_UpdateBotData(hmsc, MSC_Mode_Sense10_data, len);
 
+  /* WP bit of the device-specific parameter, hosts mount the unit read-only */
+  if ((len > 3U) && (((USBD_StorageTypeDef *)pdev->pUserData)->IsWriteProtected(lun) != 0))
+  {
+    hmsc->bot_data[3] |= 0x80U;
+  }
+
   return 0;
 }
 
@@ -559,10 +572,9 @@ void SCSI_SenseCode(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t sKey, uint8_t
 */
 static int8_t SCSI_StartStopUnit(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
-  UNUSED(lun);
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
 
-  if ((hmsc->scsi_medium_state == SCSI_MEDIUM_LOCKED) && ((params[4] & 0x3U) == 2U))
+  if ((hmsc->scsi_medium_state[lun] == SCSI_MEDIUM_LOCKED) && ((params[4] & 0x3U) == 2U))
   {
     SCSI_SenseCode(pdev, lun, ILLEGAL_REQUEST, INVALID_FIELED_IN_COMMAND);
 
@@ -571,15 +583,19 @@ static int8_t SCSI_StartStopUnit(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t
 
   if ((params[4] & 0x3U) == 0x1U) /* START=1 */
   {
-    hmsc->scsi_medium_state = SCSI_MEDIUM_UNLOCKED;
+    hmsc->scsi_medium_state[lun] = SCSI_MEDIUM_UNLOCKED;
   }
   else if ((params[4] & 0x3U) == 0x2U) /* START=0 and LOEJ Load Eject=1 */
   {
-    hmsc->scsi_medium_state = SCSI_MEDIUM_EJECTED;
+    hmsc->scsi_medium_state[lun] = SCSI_MEDIUM_EJECTED;
+    if (((USBD_StorageTypeDef *)pdev->pUserData)->Eject != NULL)
+    {
+      ((USBD_StorageTypeDef *)pdev->pUserData)->Eject(lun);
+    }
   }
   else if ((params[4] & 0x3U) == 0x3U) /* START=1 and LOEJ Load Eject=1 */
   {
-    hmsc->scsi_medium_state = SCSI_MEDIUM_UNLOCKED;
+    hmsc->scsi_medium_state[lun] = SCSI_MEDIUM_UNLOCKED;
   }
   else
   {
@@ -600,16 +616,15 @@ static int8_t SCSI_StartStopUnit(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t
 */
 static int8_t SCSI_AllowPreventRemovable(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params)
 {
-  UNUSED(lun);
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
 
   if (params[4] == 0U)
   {
-    hmsc->scsi_medium_state = SCSI_MEDIUM_UNLOCKED;
+    hmsc->scsi_medium_state[lun] = SCSI_MEDIUM_UNLOCKED;
   }
   else
   {
-    hmsc->scsi_medium_state = SCSI_MEDIUM_LOCKED;
+    hmsc->scsi_medium_state[lun] = SCSI_MEDIUM_LOCKED;
   }
 
   hmsc->bot_data_length = 0U;
@@ -638,7 +653,7 @@ static int8_t SCSI_Read10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params
       return -1;
     }
 
-    if (hmsc->scsi_medium_state == SCSI_MEDIUM_EJECTED)
+    if (hmsc->scsi_medium_state[lun] == SCSI_MEDIUM_EJECTED)
     {
       SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
 
@@ -699,7 +714,7 @@ static int8_t SCSI_Read12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *params
       return -1;
     }
 
-    if (hmsc->scsi_medium_state == SCSI_MEDIUM_EJECTED)
+    if (hmsc->scsi_medium_state[lun] == SCSI_MEDIUM_EJECTED)
     {
       SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
       return -1;
@@ -807,11 +822,9 @@ static int8_t SCSI_Write10(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
       return -1;
     }
 
-    len = MIN(len, MSC_MEDIA_PACKET);
-
     /* Prepare EP to receive first data packet */
     hmsc->bot_state = USBD_BOT_DATA_OUT;
-    (void)USBD_LL_PrepareReceive(pdev, MSC_EPOUT_ADDR, hmsc->bot_data, len);
+    return SCSI_ReceiveNext(pdev, lun);
   }
   else /* Write Process ongoing */
   {
@@ -891,11 +904,9 @@ static int8_t SCSI_Write12(USBD_HandleTypeDef *pdev, uint8_t lun, uint8_t *param
       return -1;
     }
 
-    len = MIN(len, MSC_MEDIA_PACKET);
-
     /* Prepare EP to receive first data packet */
     hmsc->bot_state = USBD_BOT_DATA_OUT;
-    (void)USBD_LL_PrepareReceive(pdev, MSC_EPOUT_ADDR, hmsc->bot_data, len);
+    return SCSI_ReceiveNext(pdev, lun);
   }
   else /* Write Process ongoing */
   {
@@ -946,6 +957,15 @@ static int8_t SCSI_CheckAddressRange(USBD_HandleTypeDef *pdev, uint8_t lun,
 {
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
 
+  /* The units may differ in size: check against the addressed one rather than
+     whatever the last READ CAPACITY was issued for */
+  if (((USBD_StorageTypeDef *)pdev->pUserData)->GetCapacity(lun, &hmsc->scsi_blk_nbr,
+                                                            &hmsc->scsi_blk_size) != 0)
+  {
+    SCSI_SenseCode(pdev, lun, NOT_READY, MEDIUM_NOT_PRESENT);
+    return -1;
+  }
+
   if ((blk_offset + blk_nbr) > hmsc->scsi_blk_nbr)
   {
     SCSI_SenseCode(pdev, lun, ILLEGAL_REQUEST, ADDRESS_OUT_OF_RANGE);
@@ -966,17 +986,44 @@ static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun)
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
   uint32_t len = hmsc->scsi_blk_len * hmsc->scsi_blk_size;
 
-  len = MIN(len, MSC_MEDIA_PACKET);
+  USBD_StorageTypeDef *storage = (USBD_StorageTypeDef *)pdev->pUserData;
+  uint8_t *buf = hmsc->bot_data;
+  int8_t status = 0;
+
+  len = MIN(len, SCSI_PacketSize(pdev));
 
-  if (((USBD_StorageTypeDef *)pdev->pUserData)->Read(lun, hmsc->bot_data,
-                                                     hmsc->scsi_blk_addr,
-                                                     (len / hmsc->scsi_blk_size)) < 0)
+  if (storage->ReadBuf != NULL)
+  {
+    /* Pipelined: take the packet from the storage layer, possibly already prefetched */
+    buf = storage->ReadBuf(lun, hmsc->scsi_blk_addr, (uint16_t)(len / hmsc->scsi_blk_size), &status);
+    if (buf == NULL)
+    {
+      if (status > 0)
+      {
+        hmsc->io_wait = MSC_IO_WAIT_READ;
+        if ((storage->ReadAhead != NULL) && (hmsc->scsi_blk_len * hmsc->scsi_blk_size > len))
+        {
+          /* Queue the following packet behind the one being fetched */
+          storage->ReadAhead(lun, hmsc->scsi_blk_addr + (len / hmsc->scsi_blk_size),
+                             (uint16_t)(MIN(hmsc->scsi_blk_len * hmsc->scsi_blk_size - len,
+                                            SCSI_PacketSize(pdev)) / hmsc->scsi_blk_size));
+        }
+        return 0;
+      }
+      hmsc->io_wait = MSC_IO_WAIT_NONE;
+      SCSI_SenseCode(pdev, lun, HARDWARE_ERROR, UNRECOVERED_READ_ERROR);
+      return -1;
+    }
+    hmsc->io_wait = MSC_IO_WAIT_NONE;
+  }
+  else if (storage->Read(lun, hmsc->bot_data, hmsc->scsi_blk_addr,
+                         (len / hmsc->scsi_blk_size)) < 0)
   {
     SCSI_SenseCode(pdev, lun, HARDWARE_ERROR, UNRECOVERED_READ_ERROR);
     return -1;
   }
 
-  (void)USBD_LL_Transmit(pdev, MSC_EPIN_ADDR, hmsc->bot_data, len);
+  (void)USBD_LL_Transmit(pdev, MSC_EPIN_ADDR, buf, len);
 
   hmsc->scsi_blk_addr += (len / hmsc->scsi_blk_size);
   hmsc->scsi_blk_len -= (len / hmsc->scsi_blk_size);
@@ -988,6 +1035,12 @@ static int8_t SCSI_ProcessRead(USBD_HandleTypeDef *pdev, uint8_t lun)
   {
     hmsc->bot_state = USBD_BOT_LAST_DATA_IN;
   }
+  else if (storage->ReadAhead != NULL)
+  {
+    /* Start fetching the next packet while this one is on the bus */
+    len = MIN(hmsc->scsi_blk_len * hmsc->scsi_blk_size, SCSI_PacketSize(pdev));
+    storage->ReadAhead(lun, hmsc->scsi_blk_addr, (uint16_t)(len / hmsc->scsi_blk_size));
+  }
 
   return 0;
 }
@@ -1003,37 +1056,181 @@ static int8_t SCSI_ProcessWrite(USBD_HandleTypeDef *pdev, uint8_t lun)
   USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
   uint32_t len = hmsc->scsi_blk_len * hmsc->scsi_blk_size;
 
-  len = MIN(len, MSC_MEDIA_PACKET);
+  USBD_StorageTypeDef *storage = (USBD_StorageTypeDef *)pdev->pUserData;
+  uint32_t blk_addr = hmsc->scsi_blk_addr;
+  int8_t ret;
 
-  if (((USBD_StorageTypeDef *)pdev->pUserData)->Write(lun, hmsc->bot_data,
-                                                      hmsc->scsi_blk_addr,
-                                                      (len / hmsc->scsi_blk_size)) < 0)
-  {
-    SCSI_SenseCode(pdev, lun, HARDWARE_ERROR, WRITE_FAULT);
-    return -1;
-  }
+  len = MIN(len, SCSI_PacketSize(pdev));
 
+  /* The packet is off the bus: the residue only counts what the host still
+   * has to send, so a failed write knows whether to stall the OUT pipe */
   hmsc->scsi_blk_addr += (len / hmsc->scsi_blk_size);
   hmsc->scsi_blk_len -= (len / hmsc->scsi_blk_size);
 
   /* case 12 : Ho = Do */
   hmsc->csw.dDataResidue -= len;
 
-  if (hmsc->scsi_blk_len == 0U)
+  if (storage->WriteSubmit != NULL)
   {
-    MSC_BOT_SendCSW(pdev, USBD_CSW_CMD_PASSED);
+    /* Pipelined: hand the received packet over and keep receiving */
+    ret = storage->WriteSubmit(lun, hmsc->io_buf, blk_addr,
+                               (uint16_t)(len / hmsc->scsi_blk_size));
   }
   else
   {
-    len = MIN((hmsc->scsi_blk_len * hmsc->scsi_blk_size), MSC_MEDIA_PACKET);
+    ret = storage->Write(lun, hmsc->bot_data, blk_addr,
+                         (len / hmsc->scsi_blk_size));
+  }
 
-    /* Prepare EP to Receive next packet */
-    (void)USBD_LL_PrepareReceive(pdev, MSC_EPOUT_ADDR, hmsc->bot_data, len);
+  if (ret < 0)
+  {
+    SCSI_SenseCode(pdev, lun, HARDWARE_ERROR, WRITE_FAULT);
+    return -1;
   }
 
+  if (hmsc->scsi_blk_len == 0U)
+  {
+    return SCSI_FinishWrite(pdev, lun);
+  }
+
+  /* Prepare EP to Receive next packet */
+  return SCSI_ReceiveNext(pdev, lun);
+}
+
+/**
+* @brief  SCSI_PacketSize
+*         Data phase packet size. The pipelined storage interface supplies its
+*         own MSC_MEDIA_PACKET buffers, otherwise the class data buffer is used.
+* @param  pdev: device instance
+* @retval packet size in bytes
+*/
+static uint32_t SCSI_PacketSize(USBD_HandleTypeDef *pdev)
+{
+  if (((USBD_StorageTypeDef *)pdev->pUserData)->ReadBuf != NULL)
+  {
+    return MSC_MEDIA_PACKET;
+  }
+  return MIN(MSC_MEDIA_PACKET, MSC_BOT_DATA_SIZE);
+}
+
+/**
+* @brief  SCSI_ReceiveNext
+*         Prepare the OUT endpoint for the next data packet of a write
+* @param  lun: Logical unit number
+* @retval status
+*/
+static int8_t SCSI_ReceiveNext(USBD_HandleTypeDef *pdev, uint8_t lun)
+{
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
+  USBD_StorageTypeDef *storage = (USBD_StorageTypeDef *)pdev->pUserData;
+  uint32_t len = MIN((hmsc->scsi_blk_len * hmsc->scsi_blk_size), SCSI_PacketSize(pdev));
+  uint8_t *buf = hmsc->bot_data;
+
+  UNUSED(lun);
+
+  if (storage->WriteBuf != NULL)
+  {
+    buf = storage->WriteBuf(lun);
+    if (buf == NULL)
+    {
+      /* Both buffers still being written to the media */
+      hmsc->io_wait = MSC_IO_WAIT_WRITE_BUF;
+      return 0;
+    }
+  }
+
+  hmsc->io_wait = MSC_IO_WAIT_NONE;
+  hmsc->io_buf = buf;
+  (void)USBD_LL_PrepareReceive(pdev, MSC_EPOUT_ADDR, buf, len);
+
   return 0;
 }
 
+/**
+* @brief  SCSI_FinishWrite
+*         Send the CSW once all packets of a write reached the media
+* @param  lun: Logical unit number
+* @retval status
+*/
+static int8_t SCSI_FinishWrite(USBD_HandleTypeDef *pdev, uint8_t lun)
+{
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
+  USBD_StorageTypeDef *storage = (USBD_StorageTypeDef *)pdev->pUserData;
+  int8_t ret = 0;
+
+  if (storage->WriteFlush != NULL)
+  {
+    ret = storage->WriteFlush(lun);
+    if (ret > 0)
+    {
+      hmsc->io_wait = MSC_IO_WAIT_FLUSH;
+      return 0;
+    }
+  }
+
+  hmsc->io_wait = MSC_IO_WAIT_NONE;
+  if (ret < 0)
+  {
+    SCSI_SenseCode(pdev, lun, HARDWARE_ERROR, WRITE_FAULT);
+    return -1;
+  }
+
+  MSC_BOT_SendCSW(pdev, USBD_CSW_CMD_PASSED);
+  return 0;
+}
+
+/**
+* @brief  SCSI_Resume
+*         Continue a data phase that was waiting on the pipelined storage
+*         interface. Must be called with the USB interrupt masked.
+* @param  pdev: device instance
+* @retval None
+*/
+void SCSI_Resume(USBD_HandleTypeDef *pdev)
+{
+  USBD_MSC_BOT_HandleTypeDef *hmsc = (USBD_MSC_BOT_HandleTypeDef *)pdev->pClassData;
+  uint8_t lun;
+  int8_t ret = 0;
+
+  if (hmsc == NULL)
+  {
+    return;
+  }
+  lun = hmsc->cbw.bLUN;
+
+  switch (hmsc->io_wait)
+  {
+  case MSC_IO_WAIT_READ:
+    if (hmsc->bot_state == USBD_BOT_DATA_IN)
+    {
+      ret = SCSI_ProcessRead(pdev, lun);
+    }
+    break;
+
+  case MSC_IO_WAIT_WRITE_BUF:
+    if (hmsc->bot_state == USBD_BOT_DATA_OUT)
+    {
+      ret = SCSI_ReceiveNext(pdev, lun);
+    }
+    break;
+
+  case MSC_IO_WAIT_FLUSH:
+    if (hmsc->bot_state == USBD_BOT_DATA_OUT)
+    {
+      ret = SCSI_FinishWrite(pdev, lun);
+    }
+    break;
+
+  default:
+    break;
+  }
+
+  if (ret < 0)
+  {
+    MSC_BOT_DataPhaseError(pdev);
+  }
+}
+
 
 /**
 * @brief  SCSI_UpdateBotData
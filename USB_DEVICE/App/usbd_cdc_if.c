@@ -0,0 +1,477 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : usbd_cdc_if.c
+  * @version        : v1.0_Cube
+  * @brief          : Usb device for Virtual Com Port.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2025 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc_if.h"
+
+/* USER CODE BEGIN INCLUDE */
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+/* USER CODE END INCLUDE */
+
+/* Private typedef -----------------------------------------------------------*/
+/* Private define ------------------------------------------------------------*/
+/* Private macro -------------------------------------------------------------*/
+
+/* USER CODE BEGIN PV */
+/* Private variables ---------------------------------------------------------*/
+
+/* USER CODE END PV */
+
+/** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
+  * @brief Usb device library.
+  * @{
+  */
+
+/** @addtogroup USBD_CDC_IF
+  * @{
+  */
+
+/** @defgroup USBD_CDC_IF_Private_TypesDefinitions USBD_CDC_IF_Private_TypesDefinitions
+  * @brief Private types.
+  * @{
+  */
+
+/* USER CODE BEGIN PRIVATE_TYPES */
+
+/* USER CODE END PRIVATE_TYPES */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_CDC_IF_Private_Defines USBD_CDC_IF_Private_Defines
+  * @brief Private defines.
+  * @{
+  */
+
+/* USER CODE BEGIN PRIVATE_DEFINES */
+/* 自测每次传输的长度：末包不满64字节，不需要额外的零长度包 */
+#define CDC_TEST_XFER              (CDC_LOG_MAX_XFER - 1U)
+
+#if (CDC_LOG_RING_SIZE & (CDC_LOG_RING_SIZE - 1U)) != 0U
+#error "CDC_LOG_RING_SIZE must be a power of two"
+#endif
+#if (CDC_LOG_MAX_XFER % CDC_DATA_FS_MAX_PACKET_SIZE) != 0U
+#error "CDC_LOG_MAX_XFER must be a multiple of the bulk packet size"
+#endif
+/* USER CODE END PRIVATE_DEFINES */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_CDC_IF_Private_Macros USBD_CDC_IF_Private_Macros
+  * @brief Private macros.
+  * @{
+  */
+
+/* USER CODE BEGIN PRIVATE_MACRO */
+
+/* USER CODE END PRIVATE_MACRO */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_CDC_IF_Private_Variables USBD_CDC_IF_Private_Variables
+  * @brief Private variables.
+  * @{
+  */
+
+/* USER CODE BEGIN PRIVATE_VARIABLES */
+/* 主机发来的数据（目前丢弃） */
+static uint8_t cdc_rx_buf[CDC_DATA_FS_MAX_PACKET_SIZE] __attribute__((aligned(4)));
+
+/* 日志环形缓冲区，末尾多留4字节：发送时按字读取 FIFO，传输结尾可能越过缓冲区 */
+static uint8_t log_ring[CDC_LOG_RING_SIZE + 4U] __attribute__((aligned(4)));
+static volatile uint32_t log_head;          /* 写入位置（自由计数） */
+static volatile uint32_t log_tail;          /* 已发送位置（自由计数） */
+static uint32_t log_tx_len;                 /* 正在发送的字节数，0 表示端点空闲 */
+static volatile uint8_t port_open;          /* 主机已打开串口（DTR） */
+static CDC_Log_StatsTypeDef log_stats;
+
+/* 吞吐自测：环形缓冲区改为测试数据源 */
+static volatile uint8_t test_mode;
+static volatile uint32_t test_in_bytes;
+static volatile uint32_t test_out_bytes;
+
+/* 虚拟串口没有物理波特率，只保存主机设置的值 */
+static USBD_CDC_LineCodingTypeDef line_coding = {115200U, 0U, 0U, 8U};
+/* USER CODE END PRIVATE_VARIABLES */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_CDC_IF_Exported_Variables USBD_CDC_IF_Exported_Variables
+  * @brief Public variables.
+  * @{
+  */
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+/* USER CODE BEGIN EXPORTED_VARIABLES */
+
+/* USER CODE END EXPORTED_VARIABLES */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_CDC_IF_Private_FunctionPrototypes USBD_CDC_IF_Private_FunctionPrototypes
+  * @brief Private functions declaration.
+  * @{
+  */
+
+static int8_t CDC_Init_FS(void);
+static int8_t CDC_DeInit_FS(void);
+static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length);
+static int8_t CDC_Receive_FS(uint8_t* pbuf, uint32_t *Len);
+static int8_t CDC_TransmitCplt_FS(uint8_t *pbuf, uint32_t *Len, uint8_t epnum);
+
+/* USER CODE BEGIN PRIVATE_FUNCTIONS_DECLARATION */
+static void CDC_Log_Kick(void);
+static uint8_t CDC_Log_Sink(const char *line, size_t len);
+/* USER CODE END PRIVATE_FUNCTIONS_DECLARATION */
+
+/**
+  * @}
+  */
+
+USBD_CDC_ItfTypeDef USBD_Interface_fops_FS =
+{
+  CDC_Init_FS,
+  CDC_DeInit_FS,
+  CDC_Control_FS,
+  CDC_Receive_FS,
+  CDC_TransmitCplt_FS
+};
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Initializes the CDC media low layer over the FS USB IP
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_Init_FS(void)
+{
+  /* USER CODE BEGIN 3 */
+  UBaseType_t mask;
+
+  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, NULL, 0U);
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, cdc_rx_buf);
+
+  mask = taskENTER_CRITICAL_FROM_ISR();
+  log_tx_len = 0U;
+  port_open = 0U;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+
+  log_set_sink(CDC_Log_Sink);
+  return (USBD_OK);
+  /* USER CODE END 3 */
+}
+
+/**
+  * @brief  DeInitializes the CDC media low layer
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_DeInit_FS(void)
+{
+  /* USER CODE BEGIN 4 */
+  UBaseType_t mask;
+
+  /* 总线复位/断开：未完成的传输作废，数据留在缓冲区里等下次打开再发 */
+  mask = taskENTER_CRITICAL_FROM_ISR();
+  log_tx_len = 0U;
+  port_open = 0U;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  return (USBD_OK);
+  /* USER CODE END 4 */
+}
+
+/**
+  * @brief  Manage the CDC class requests
+  * @param  cmd: Command code
+  * @param  pbuf: Buffer containing command data (request parameters)
+  * @param  length: Number of data to be sent (in bytes)
+  * @retval Result of the operation: USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
+{
+  /* USER CODE BEGIN 5 */
+  UBaseType_t mask;
+
+  switch(cmd)
+  {
+    case CDC_SET_LINE_CODING:
+      if (length >= 7U)
+      {
+        line_coding.bitrate = (uint32_t)pbuf[0] | ((uint32_t)pbuf[1] << 8) |
+                              ((uint32_t)pbuf[2] << 16) | ((uint32_t)pbuf[3] << 24);
+        line_coding.format = pbuf[4];
+        line_coding.paritytype = pbuf[5];
+        line_coding.datatype = pbuf[6];
+      }
+    break;
+
+    case CDC_GET_LINE_CODING:
+      if (length >= 7U)
+      {
+        pbuf[0] = (uint8_t)(line_coding.bitrate);
+        pbuf[1] = (uint8_t)(line_coding.bitrate >> 8);
+        pbuf[2] = (uint8_t)(line_coding.bitrate >> 16);
+        pbuf[3] = (uint8_t)(line_coding.bitrate >> 24);
+        pbuf[4] = line_coding.format;
+        pbuf[5] = line_coding.paritytype;
+        pbuf[6] = line_coding.datatype;
+      }
+    break;
+
+    case CDC_SET_CONTROL_LINE_STATE:
+      /* 终端程序打开串口时置 DTR，此后日志改走 USB */
+      mask = taskENTER_CRITICAL_FROM_ISR();
+      port_open = ((((USBD_SetupReqTypedef *)pbuf)->wValue & CDC_CONTROL_LINE_DTR) != 0U) ? 1U : 0U;
+      CDC_Log_Kick();
+      taskEXIT_CRITICAL_FROM_ISR(mask);
+    break;
+
+    default:
+    break;
+  }
+
+  return (USBD_OK);
+  /* USER CODE END 5 */
+}
+
+/**
+  * @brief  Data received over USB OUT endpoint are sent over CDC interface
+  *         through this function.
+  * @param  Buf: Buffer of data to be received
+  * @param  Len: Number of data received (in bytes)
+  * @retval Result of the operation: USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
+{
+  /* USER CODE BEGIN 6 */
+  (void)Buf;
+
+  if (test_mode != 0U)
+  {
+    test_out_bytes += *Len;
+  }
+  USBD_CDC_SetRxBuffer(&hUsbDeviceFS, cdc_rx_buf);
+  USBD_CDC_ReceivePacket(&hUsbDeviceFS);
+  return (USBD_OK);
+  /* USER CODE END 6 */
+}
+
+/**
+  * @brief  CDC_TransmitCplt_FS
+  *         Data transmited callback
+  * @param  Buf: Buffer of data that was transmitted
+  * @param  Len: Number of data transmitted (in bytes)
+  * @param  epnum: endpoint number
+  * @retval Result of the operation: USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t CDC_TransmitCplt_FS(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
+{
+  /* USER CODE BEGIN 13 */
+  UBaseType_t mask;
+
+  (void)Buf;
+  (void)Len;
+  (void)epnum;
+
+  /* 在协议栈中直接接着发下一段，吞吐不依赖日志任务的调度 */
+  mask = taskENTER_CRITICAL_FROM_ISR();
+  if (test_mode != 0U)
+  {
+    test_in_bytes += log_tx_len;
+  }
+  else
+  {
+    log_tail += log_tx_len;
+    log_stats.sent += log_tx_len;
+  }
+  log_tx_len = 0U;
+  CDC_Log_Kick();
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+  return (USBD_OK);
+  /* USER CODE END 13 */
+}
+
+/* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+/**
+  * @brief  端点空闲时发送环形缓冲区中最长的连续一段（调用者在协议栈上下文中或持有协议栈锁，并已进入临界区）
+  */
+static void CDC_Log_Kick(void)
+{
+  uint32_t avail = log_head - log_tail;
+  uint32_t ofs = log_tail & (CDC_LOG_RING_SIZE - 1U);
+  uint32_t len;
+
+  if (test_mode != 0U)
+  {
+    avail = CDC_TEST_XFER;
+    ofs = 0U;
+  }
+  if (log_tx_len != 0U || avail == 0U || port_open == 0U ||
+      hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED)
+  {
+    return;
+  }
+
+  len = MIN(avail, CDC_LOG_RING_SIZE - ofs);
+  len = MIN(len, CDC_LOG_MAX_XFER);
+  USBD_CDC_SetTxBuffer(&hUsbDeviceFS, &log_ring[ofs], len);
+  if (USBD_CDC_TransmitPacket(&hUsbDeviceFS) == USBD_OK)
+  {
+    log_tx_len = len;
+  }
+}
+
+/**
+  * @brief  log_output 的输出钩子：串口打开时日志只写入 USB 环形缓冲区
+  */
+static uint8_t CDC_Log_Sink(const char *line, size_t len)
+{
+  if (port_open == 0U || test_mode != 0U)
+  {
+    return 0U;
+  }
+  (void)CDC_Log_Write((const uint8_t *)line, (uint32_t)len);
+  return 1U;
+}
+
+uint8_t CDC_Log_IsOpen(void)
+{
+  return port_open;
+}
+
+uint32_t CDC_Log_Write(const uint8_t *data, uint32_t len)
+{
+  UBaseType_t mask;
+  uint32_t ofs, first;
+
+  if (port_open == 0U || test_mode != 0U || data == NULL || len == 0U)
+  {
+    return 0U;
+  }
+
+  mask = taskENTER_CRITICAL_FROM_ISR();
+  if (len > CDC_LOG_RING_SIZE - (log_head - log_tail))
+  {
+    log_stats.dropped += len;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    return 0U;
+  }
+
+  ofs = log_head & (CDC_LOG_RING_SIZE - 1U);
+  first = MIN(len, CDC_LOG_RING_SIZE - ofs);
+  memcpy(&log_ring[ofs], data, first);
+  memcpy(log_ring, data + first, len - first);
+  log_head += len;
+  log_stats.written += len;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+
+  /* 其他中断可能打断正在操作端点寄存器的协议栈，只在任务中持协议栈锁启动传输；
+   * 中断中写入的数据由下一次发送完成或任务中的写入带出 */
+  if (xPortIsInsideInterrupt() == pdFALSE && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+  {
+    USBD_LL_Lock();
+    mask = taskENTER_CRITICAL_FROM_ISR();
+    CDC_Log_Kick();
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    USBD_LL_Unlock();
+  }
+  return len;
+}
+
+void CDC_Log_GetStats(CDC_Log_StatsTypeDef *stats)
+{
+  UBaseType_t mask;
+
+  if (stats == NULL)
+  {
+    return;
+  }
+  mask = taskENTER_CRITICAL_FROM_ISR();
+  *stats = log_stats;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+void CDC_Test_Enable(uint8_t enable)
+{
+  UBaseType_t mask;
+  uint32_t i;
+
+  mask = taskENTER_CRITICAL_FROM_ISR();
+  test_mode = 0U;
+  log_head = 0U;
+  log_tail = 0U;
+  test_in_bytes = 0U;
+  test_out_bytes = 0U;
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+
+  if (enable != 0U)
+  {
+    /* 测试数据：每次传输都从环形缓冲区开头发送同一段递增字节序列 */
+    for (i = 0; i < CDC_TEST_XFER; i++)
+    {
+      log_ring[i] = (uint8_t)i;
+    }
+    USBD_LL_Lock();
+    mask = taskENTER_CRITICAL_FROM_ISR();
+    test_mode = 1U;
+    CDC_Log_Kick();
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+    USBD_LL_Unlock();
+  }
+}
+
+void CDC_Test_GetCounters(uint32_t *in_bytes, uint32_t *out_bytes)
+{
+  UBaseType_t mask;
+
+  mask = taskENTER_CRITICAL_FROM_ISR();
+  if (in_bytes != NULL)
+  {
+    *in_bytes = test_in_bytes;
+  }
+  if (out_bytes != NULL)
+  {
+    *out_bytes = test_out_bytes;
+  }
+  taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+/* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
@@ -0,0 +1,174 @@
+/* USER CODE BEGIN Header */
+/**
+  ******************************************************************************
+  * @file           : usbd_cdc_if.h
+  * @version        : v1.0_Cube
+  * @brief          : Header for usbd_cdc_if.c file.
+  ******************************************************************************
+  * @attention
+  *
+  * <h2><center>&copy; Copyright (c) 2025 STMicroelectronics.
+  * All rights reserved.</center></h2>
+  *
+  * This software component is licensed by ST under Ultimate Liberty license
+  * SLA0044, the "License"; You may not use this file except in compliance with
+  * the License. You may obtain a copy of the License at:
+  *                             www.st.com/SLA0044
+  *
+  ******************************************************************************
+  */
+/* USER CODE END Header */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __USBD_CDC_IF_H__
+#define __USBD_CDC_IF_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbd_cdc.h"
+
+/* USER CODE BEGIN INCLUDE */
+
+/* USER CODE END INCLUDE */
+
+/** @addtogroup STM32_USB_OTG_DEVICE_LIBRARY
+  * @brief For Usb device.
+  * @{
+  */
+
+/** @defgroup USBD_CDC_IF USBD_CDC_IF
+  * @brief Usb VCP device module
+  * @{
+  */
+
+/** @defgroup USBD_CDC_IF_Exported_Defines USBD_CDC_IF_Exported_Defines
+  * @brief Defines.
+  * @{
+  */
+/* USER CODE BEGIN EXPORTED_DEFINES */
+/* 日志环形缓冲区大小（2的幂） */
+#ifndef CDC_LOG_RING_SIZE
+#define CDC_LOG_RING_SIZE          4096U
+#endif
+
+/* 单次 bulk IN 传输的最大字节数（64的整数倍） */
+#ifndef CDC_LOG_MAX_XFER
+#define CDC_LOG_MAX_XFER           2048U
+#endif
+/* USER CODE END EXPORTED_DEFINES */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_CDC_IF_Exported_Types USBD_CDC_IF_Exported_Types
+  * @brief Types.
+  * @{
+  */
+
+/* USER CODE BEGIN EXPORTED_TYPES */
+/* 日志通道统计 */
+typedef struct
+{
+  uint32_t written;         /* 写入环形缓冲区的字节数 */
+  uint32_t sent;            /* 已发送给主机的字节数 */
+  uint32_t dropped;         /* 缓冲区满丢弃的字节数 */
+} CDC_Log_StatsTypeDef;
+/* USER CODE END EXPORTED_TYPES */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_CDC_IF_Exported_Macros USBD_CDC_IF_Exported_Macros
+  * @brief Aliases.
+  * @{
+  */
+
+/* USER CODE BEGIN EXPORTED_MACRO */
+
+/* USER CODE END EXPORTED_MACRO */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_CDC_IF_Exported_Variables USBD_CDC_IF_Exported_Variables
+  * @brief Public variables.
+  * @{
+  */
+
+/** CDC Interface callback. */
+extern USBD_CDC_ItfTypeDef USBD_Interface_fops_FS;
+
+/* USER CODE BEGIN EXPORTED_VARIABLES */
+
+/* USER CODE END EXPORTED_VARIABLES */
+
+/**
+  * @}
+  */
+
+/** @defgroup USBD_CDC_IF_Exported_FunctionsPrototype USBD_CDC_IF_Exported_FunctionsPrototype
+  * @brief Public functions declaration.
+  * @{
+  */
+
+/* USER CODE BEGIN EXPORTED_FUNCTIONS */
+/**
+  * @brief  主机是否已打开虚拟串口（DTR 置位）
+  */
+uint8_t CDC_Log_IsOpen(void);
+
+/**
+  * @brief  写入日志环形缓冲区，不阻塞
+  * @note   任务和中断中均可调用；缓冲区放不下时整条丢弃并计数。
+  *         任务中调用时若端点空闲立即启动传输，中断中写入的数据由下一次传输完成或任务写入带出。
+  * @param  data: 数据
+  * @param  len: 长度
+  * @retval 写入的字节数（端口未打开或缓冲区满时为0）
+  */
+uint32_t CDC_Log_Write(const uint8_t *data, uint32_t len);
+
+/**
+  * @brief  获取日志通道统计
+  */
+void CDC_Log_GetStats(CDC_Log_StatsTypeDef *stats);
+
+/**
+  * @brief  吞吐自测模式：不再发送日志，端点空闲时连续发送测试数据，统计收发字节数
+  * @note   应在USB重新初始化之前切换；自测期间日志仍从串口输出
+  * @param  enable: 1 进入，0 退出
+  */
+void CDC_Test_Enable(uint8_t enable);
+
+/**
+  * @brief  自测模式下累计的收发字节数
+  * @param  in_bytes: 设备发往主机的字节数，可为 NULL
+  * @param  out_bytes: 主机发往设备的字节数，可为 NULL
+  */
+void CDC_Test_GetCounters(uint32_t *in_bytes, uint32_t *out_bytes);
+/* USER CODE END EXPORTED_FUNCTIONS */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CDC_IF_H__ */
+
+/************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
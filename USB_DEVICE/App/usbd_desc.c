@@ -66,8 +66,9 @@
 #define USBD_VID     1155
 #define USBD_LANGID_STRING     1033
 #define USBD_MANUFACTURER_STRING     "STMicroelectronics"
-#define USBD_PID_FS     22314
-#define USBD_PRODUCT_STRING_FS     "STM32 Mass Storage"
+/* 复合设备（MSC + CDC）使用独立的 PID，避免主机沿用单 MSC 设备缓存的驱动配置 */
+#define USBD_PID_FS     22315
+#define USBD_PRODUCT_STRING_FS     "STM32 Storage + Log Port"
 #define USBD_CONFIGURATION_STRING_FS     "MSC Config"
 #define USBD_INTERFACE_STRING_FS     "MSC Interface"
 
@@ -165,9 +166,9 @@ __ALIGN_BEGIN uint8_t USBD_FS_DeviceDesc[USB_LEN_DEV_DESC] __ALIGN_END =
   0x00,                       /*bcdUSB */
 #endif /* (USBD_LPM_ENABLED == 1) */
   0x02,
-  0x00,                       /*bDeviceClass*/
-  0x00,                       /*bDeviceSubClass*/
-  0x00,                       /*bDeviceProtocol*/
+  0xEF,                       /*bDeviceClass: Miscellaneous (IAD) */
+  0x02,                       /*bDeviceSubClass: Common Class */
+  0x01,                       /*bDeviceProtocol: Interface Association Descriptor */
   USB_MAX_EP0_SIZE,           /*bMaxPacketSize*/
   LOBYTE(USBD_VID),           /*idVendor*/
   HIBYTE(USBD_VID),           /*idVendor*/
@@ -23,7 +23,17 @@
 #include "usbd_storage_if.h"
 
 /* USER CODE BEGIN INCLUDE */
-
+#include "usbd_msc_scsi.h"
+#include "bsp_driver_sd.h"
+#include "diskio.h"
+#include "sd_io_sched.h"
+#include "sd_owner.h"
+#include "diag_disk.h"
+#define LOG_MODULE LOG_MOD_USB
+#include "log.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
 /* USER CODE END INCLUDE */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -51,7 +61,26 @@
   */
 
 /* USER CODE BEGIN PRIVATE_TYPES */
-
+/* 流水线缓冲区状态 */
+typedef enum
+{
+  MSC_SLOT_FREE = 0,        /* 空闲 */
+  MSC_SLOT_READING,         /* 正在从SD卡读入（工作任务持有） */
+  MSC_SLOT_READY,           /* 读完成，等待 SCSI 层取走 */
+  MSC_SLOT_IN_USE,          /* 正在通过USB发送 */
+  MSC_SLOT_RECEIVING,       /* 正在从USB接收写数据 */
+  MSC_SLOT_WRITING          /* 正在写入SD卡（工作任务持有） */
+} msc_slot_state_t;
+
+typedef struct
+{
+  uint8_t *buf;
+  uint8_t lun;
+  uint32_t blk_addr;
+  uint16_t blk_len;
+  volatile uint8_t state;
+  int8_t status;            /* 读结果：0 成功，-1 失败 */
+} msc_slot_t;
 /* USER CODE END PRIVATE_TYPES */
 
 /**
@@ -63,12 +92,24 @@
   * @{
   */
 
-#define STORAGE_LUN_NBR                  1
+#define STORAGE_LUN_NBR                  2
 #define STORAGE_BLK_NBR                  0x10000
 #define STORAGE_BLK_SIZ                  0x200
 
 /* USER CODE BEGIN PRIVATE_DEFINES */
-
+/* 双缓冲：一个包在USB上传输时，另一个包的SD DMA已经在进行 */
+#define MSC_IO_SLOTS                     2U
+#define MSC_IO_TASK_PRIO                 (tskIDLE_PRIORITY + 5)
+#define MSC_IO_STK_SIZE                  768    /* 诊断盘快照在本任务中格式化 */
+#define MSC_IO_READY_POLL_MS             500U
+
+/* LUN 0 是SD卡，LUN 1 是只读诊断盘（见 diag_disk.h） */
+#define STORAGE_LUN_SD                   0U
+#define STORAGE_LUN_DIAG                 1U
+
+#if (MSC_MEDIA_PACKET < 512U) || (MSC_MEDIA_PACKET > 32768U) || ((MSC_MEDIA_PACKET % 512U) != 0U)
+#error "MSC_MEDIA_PACKET must be a multiple of 512 between 512 and 32768"
+#endif
 /* USER CODE END PRIVATE_DEFINES */
 
 /**
@@ -109,12 +150,39 @@ const int8_t STORAGE_Inquirydata_FS[] = {/* 36 */
   'S', 'T', 'M', ' ', ' ', ' ', ' ', ' ', /* Manufacturer : 8 bytes */
   'P', 'r', 'o', 'd', 'u', 'c', 't', ' ', /* Product      : 16 Bytes */
   ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ',
+  '0', '.', '0' ,'1',                     /* Version      : 4 Bytes */
+
+  /* LUN 1 */
+  0x00,
+  0x80,
+  0x02,
+  0x02,
+  (STANDARD_INQUIRY_DATA_LEN - 5),
+  0x00,
+  0x00,
+  0x00,
+  'S', 'T', 'M', ' ', ' ', ' ', ' ', ' ', /* Manufacturer : 8 bytes */
+  'D', 'i', 'a', 'g', 'n', 'o', 's', 't', /* Product      : 16 Bytes */
+  'i', 'c', 's', ' ', ' ', ' ', ' ', ' ',
   '0', '.', '0' ,'1'                      /* Version      : 4 Bytes */
 };
 /* USER CODE END INQUIRY_DATA_FS */
 
 /* USER CODE BEGIN PRIVATE_VARIABLES */
-
+/* 包缓冲区，每个包对应一次SD多块DMA传输；必须位于内部SRAM（CCM不能DMA，放在 .bss 即 RAM 段） */
+static uint8_t msc_io_buf[MSC_IO_SLOTS][MSC_MEDIA_PACKET] __attribute__((aligned(4)));
+static msc_slot_t msc_slot[MSC_IO_SLOTS];
+
+static volatile uint8_t msc_ready;          /* SD卡已初始化，可以提供给主机 */
+static volatile uint8_t msc_io_wait;        /* SCSI 层在等待工作任务 */
+static volatile int8_t msc_write_status;    /* 当前写命令中是否有包写入失败 */
+
+static QueueHandle_t msc_io_queue;
+static StaticQueue_t msc_io_queue_buf;
+static uint8_t msc_io_queue_storage[MSC_IO_SLOTS];
+static TaskHandle_t msc_io_task_handle;
+static StaticTask_t msc_io_task_tcb;
+static StackType_t msc_io_task_stack[MSC_IO_STK_SIZE];
 /* USER CODE END PRIVATE_VARIABLES */
 
 /**
@@ -150,7 +218,12 @@ static int8_t STORAGE_Write_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uin
 static int8_t STORAGE_GetMaxLun_FS(void);
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_DECLARATION */
-
+static uint8_t *STORAGE_ReadBuf_FS(uint8_t lun, uint32_t blk_addr, uint16_t blk_len, int8_t *status);
+static void STORAGE_ReadAhead_FS(uint8_t lun, uint32_t blk_addr, uint16_t blk_len);
+static uint8_t *STORAGE_WriteBuf_FS(uint8_t lun);
+static int8_t STORAGE_WriteSubmit_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len);
+static int8_t STORAGE_WriteFlush_FS(uint8_t lun);
+static void STORAGE_Eject_FS(uint8_t lun);
 /* USER CODE END PRIVATE_FUNCTIONS_DECLARATION */
 
 /**
@@ -166,7 +239,13 @@ USBD_StorageTypeDef USBD_Storage_Interface_fops_FS =
   STORAGE_Read_FS,
   STORAGE_Write_FS,
   STORAGE_GetMaxLun_FS,
-  (int8_t *)STORAGE_Inquirydata_FS
+  (int8_t *)STORAGE_Inquirydata_FS,
+  STORAGE_ReadBuf_FS,
+  STORAGE_ReadAhead_FS,
+  STORAGE_WriteBuf_FS,
+  STORAGE_WriteSubmit_FS,
+  STORAGE_WriteFlush_FS,
+  STORAGE_Eject_FS
 };
 
 /* Private functions ---------------------------------------------------------*/
@@ -178,7 +257,24 @@ USBD_StorageTypeDef USBD_Storage_Interface_fops_FS =
 int8_t STORAGE_Init_FS(uint8_t lun)
 {
   /* USER CODE BEGIN 2 */
-  printf("STORAGE_Init_FS\n");
+  uint32_t i;
+
+  /* USB复位/重新枚举：丢弃未被取走的缓冲区，工作任务手中的缓冲区完成后自然作废 */
+  for (i = 0; i < MSC_IO_SLOTS; i++)
+  {
+    if (msc_slot[i].state != MSC_SLOT_READING && msc_slot[i].state != MSC_SLOT_WRITING)
+    {
+      msc_slot[i].state = MSC_SLOT_FREE;
+    }
+  }
+  msc_io_wait = 0;
+  msc_write_status = 0;
+
+  /* 诊断盘在主机装入介质后的第一次读取时生成快照 */
+  diag_disk_reload();
+
+  /* 主机完成配置，请求独占介质；卷卸载完成前 IsReady 报告介质不在位 */
+  sd_owner_usb_attach();
   return (USBD_OK);
   /* USER CODE END 2 */
 }
@@ -193,8 +289,21 @@ int8_t STORAGE_Init_FS(uint8_t lun)
 int8_t STORAGE_GetCapacity_FS(uint8_t lun, uint32_t *block_num, uint16_t *block_size)
 {
   /* USER CODE BEGIN 3 */
-  *block_num  = STORAGE_BLK_NBR;
-  *block_size = STORAGE_BLK_SIZ;
+  HAL_SD_CardInfoTypeDef info;
+
+  if (lun == STORAGE_LUN_DIAG)
+  {
+    *block_num  = DIAG_DISK_SECTORS;
+    *block_size = DIAG_DISK_SECTOR_SIZE;
+    return (USBD_OK);
+  }
+  if (!msc_ready || !sd_owner_usb_active())
+  {
+    return (USBD_FAIL);
+  }
+  BSP_SD_GetCardInfo(&info);
+  *block_num  = info.LogBlockNbr;
+  *block_size = (uint16_t)info.LogBlockSize;
   return (USBD_OK);
   /* USER CODE END 3 */
 }
@@ -207,7 +316,11 @@ int8_t STORAGE_GetCapacity_FS(uint8_t lun, uint32_t *block_num, uint16_t *block_
 int8_t STORAGE_IsReady_FS(uint8_t lun)
 {
   /* USER CODE BEGIN 4 */
-  return (USBD_OK);
+  if (lun == STORAGE_LUN_DIAG)
+  {
+    return (USBD_OK);
+  }
+  return (msc_ready && sd_owner_usb_active()) ? (USBD_OK) : (USBD_FAIL);
   /* USER CODE END 4 */
 }
 
@@ -219,7 +332,7 @@ int8_t STORAGE_IsReady_FS(uint8_t lun)
 int8_t STORAGE_IsWriteProtected_FS(uint8_t lun)
 {
   /* USER CODE BEGIN 5 */
-  return (USBD_OK);
+  return (lun == STORAGE_LUN_DIAG) ? 1 : (USBD_OK);
   /* USER CODE END 5 */
 }
 
@@ -231,7 +344,12 @@ int8_t STORAGE_IsWriteProtected_FS(uint8_t lun)
 int8_t STORAGE_Read_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
 {
   /* USER CODE BEGIN 6 */
-  return (USBD_OK);
+  /* 同步接口仅在未注册流水线接口时使用 */
+  UNUSED(lun);
+  UNUSED(buf);
+  UNUSED(blk_addr);
+  UNUSED(blk_len);
+  return (USBD_FAIL);
   /* USER CODE END 6 */
 }
 
@@ -243,7 +361,11 @@ int8_t STORAGE_Read_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t bl
 int8_t STORAGE_Write_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
 {
   /* USER CODE BEGIN 7 */
-  return (USBD_OK);
+  UNUSED(lun);
+  UNUSED(buf);
+  UNUSED(blk_addr);
+  UNUSED(blk_len);
+  return (USBD_FAIL);
   /* USER CODE END 7 */
 }
 
@@ -260,7 +382,379 @@ int8_t STORAGE_GetMaxLun_FS(void)
 }
 
 /* USER CODE BEGIN PRIVATE_FUNCTIONS_IMPLEMENTATION */
+/*
+ * 流水线实现
+ * SCSI 层的回调运行在协议栈上下文中（OTG 中断或 USB 任务，见 USBD_DEFER_TO_TASK，以及持有协议栈锁的
+ * SCSI_Resume），只改变缓冲区状态并把缓冲区序号交给工作任务；工作任务经 sd_io 调度器完成 SD 读写，
+ * 完成后在协议栈锁（USBD_LL_Lock）内更新状态，并在 SCSI 层等待时调用 SCSI_Resume() 继续数据阶段。
+ */
+
+/**
+  * @brief  把缓冲区交给工作任务（中断或任务上下文均可调用）
+  */
+static void msc_io_post(uint8_t idx)
+{
+  BaseType_t woken = pdFALSE;
+
+  if (xPortIsInsideInterrupt())
+  {
+    xQueueSendFromISR(msc_io_queue, &idx, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+  else
+  {
+    xQueueSend(msc_io_queue, &idx, 0);
+  }
+}
+
+static void msc_io_start(uint8_t idx, uint8_t state, uint8_t lun, uint32_t blk_addr, uint16_t blk_len)
+{
+  msc_slot[idx].lun = lun;
+  msc_slot[idx].blk_addr = blk_addr;
+  msc_slot[idx].blk_len = blk_len;
+  msc_slot[idx].status = 0;
+  msc_slot[idx].state = state;
+  msc_io_post(idx);
+}
+
+/**
+  * @brief  找一个可以重新使用的缓冲区，优先空闲的，其次未被取走的过期预读
+  */
+static int msc_slot_alloc(void)
+{
+  int ready = -1;
+  uint32_t i;
+
+  for (i = 0; i < MSC_IO_SLOTS; i++)
+  {
+    if (msc_slot[i].state == MSC_SLOT_FREE)
+    {
+      return (int)i;
+    }
+    if (msc_slot[i].state == MSC_SLOT_READY && ready < 0)
+    {
+      ready = (int)i;
+    }
+  }
+  return ready;
+}
+
+static int msc_slot_find_read(uint8_t lun, uint32_t blk_addr, uint16_t blk_len)
+{
+  uint32_t i;
+
+  for (i = 0; i < MSC_IO_SLOTS; i++)
+  {
+    if ((msc_slot[i].state == MSC_SLOT_READING || msc_slot[i].state == MSC_SLOT_READY) &&
+        msc_slot[i].lun == lun && msc_slot[i].blk_addr == blk_addr && msc_slot[i].blk_len == blk_len)
+    {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+/**
+  * @brief  回收 USB 侧的缓冲区：SCSI 层再次取缓冲区时，上一个发送或接收中的包已经结束，
+  *         或者所在的命令已失败、被主机复位放弃
+  */
+static void msc_slot_reclaim(void)
+{
+  uint32_t i;
+
+  for (i = 0; i < MSC_IO_SLOTS; i++)
+  {
+    if (msc_slot[i].state == MSC_SLOT_IN_USE || msc_slot[i].state == MSC_SLOT_RECEIVING)
+    {
+      msc_slot[i].state = MSC_SLOT_FREE;
+    }
+  }
+}
+
+/**
+  * @brief  作废与写入范围重叠的预读（未取走的或正在读的），避免之后命中旧数据
+  */
+static void msc_slot_invalidate(uint32_t blk_addr, uint16_t blk_len)
+{
+  uint32_t i;
+
+  for (i = 0; i < MSC_IO_SLOTS; i++)
+  {
+    if ((msc_slot[i].state == MSC_SLOT_READING || msc_slot[i].state == MSC_SLOT_READY) &&
+        msc_slot[i].lun == STORAGE_LUN_SD &&
+        msc_slot[i].blk_addr < blk_addr + blk_len &&
+        blk_addr < msc_slot[i].blk_addr + msc_slot[i].blk_len)
+    {
+      /* 长度为0的包不会被 msc_slot_find_read 命中，读完后按普通 READY 回收 */
+      msc_slot[i].blk_len = 0;
+    }
+  }
+}
+
+/**
+  * @brief  取一个已读好的包；未就绪时发起读取并返回 NULL（status = 1）
+  */
+static uint8_t *STORAGE_ReadBuf_FS(uint8_t lun, uint32_t blk_addr, uint16_t blk_len, int8_t *status)
+{
+  int idx;
+
+  msc_slot_reclaim();
+
+  if (lun == STORAGE_LUN_SD && !sd_owner_usb_active())
+  {
+    /* 介质正在交回固件，不再发起新的读 */
+    *status = -1;
+    return NULL;
+  }
+
+  idx = msc_slot_find_read(lun, blk_addr, blk_len);
+  if (idx >= 0 && msc_slot[idx].state == MSC_SLOT_READY)
+  {
+    if (msc_slot[idx].status < 0)
+    {
+      msc_slot[idx].state = MSC_SLOT_FREE;
+      *status = -1;
+      return NULL;
+    }
+    msc_slot[idx].state = MSC_SLOT_IN_USE;
+    *status = 0;
+    return msc_slot[idx].buf;
+  }
+
+  if (idx < 0)
+  {
+    /* 未命中预读（新命令或随机访问），立即发起；没有空闲缓冲区时等过期的读完成后重试 */
+    idx = msc_slot_alloc();
+    if (idx >= 0)
+    {
+      msc_io_start((uint8_t)idx, MSC_SLOT_READING, lun, blk_addr, blk_len);
+    }
+  }
+
+  msc_io_wait = 1;
+  *status = 1;
+  return NULL;
+}
+
+/**
+  * @brief  预读下一个包
+  */
+static void STORAGE_ReadAhead_FS(uint8_t lun, uint32_t blk_addr, uint16_t blk_len)
+{
+  int idx;
+
+  if ((lun == STORAGE_LUN_SD && !sd_owner_usb_active()) || msc_slot_find_read(lun, blk_addr, blk_len) >= 0)
+  {
+    return;
+  }
+  idx = msc_slot_alloc();
+  if (idx >= 0)
+  {
+    msc_io_start((uint8_t)idx, MSC_SLOT_READING, lun, blk_addr, blk_len);
+  }
+}
+
+/**
+  * @brief  取一个空闲缓冲区接收下一个写数据包；两个缓冲区都在写卡时返回 NULL
+  */
+static uint8_t *STORAGE_WriteBuf_FS(uint8_t lun)
+{
+  int idx;
+
+  UNUSED(lun);
+
+  msc_slot_reclaim();
+  idx = msc_slot_alloc();
+  if (idx < 0)
+  {
+    msc_io_wait = 1;
+    return NULL;
+  }
+  msc_slot[idx].state = MSC_SLOT_RECEIVING;
+  return msc_slot[idx].buf;
+}
+
+/**
+  * @brief  提交已接收的写数据包
+  */
+static int8_t STORAGE_WriteSubmit_FS(uint8_t lun, uint8_t *buf, uint32_t blk_addr, uint16_t blk_len)
+{
+  uint32_t i;
+
+  if (msc_write_status < 0)
+  {
+    /* 之前的包已写入失败，整条命令失败 */
+    msc_write_status = 0;
+    return -1;
+  }
+  if (lun != STORAGE_LUN_SD || !sd_owner_usb_active())
+  {
+    /* 介质正在交回固件，丢弃剩余的写数据；诊断盘只读 */
+    return -1;
+  }
+  msc_slot_invalidate(blk_addr, blk_len);
+  for (i = 0; i < MSC_IO_SLOTS; i++)
+  {
+    if (msc_slot[i].buf == buf && msc_slot[i].state == MSC_SLOT_RECEIVING)
+    {
+      msc_io_start((uint8_t)i, MSC_SLOT_WRITING, lun, blk_addr, blk_len);
+      return 0;
+    }
+  }
+  return -1;
+}
+
+/**
+  * @brief  等待当前写命令的所有包写入完成
+  * @retval 1 仍在写入；0 全部成功；-1 有包写入失败
+  */
+static int8_t STORAGE_WriteFlush_FS(uint8_t lun)
+{
+  int8_t ret;
+  uint32_t i;
+
+  UNUSED(lun);
+
+  for (i = 0; i < MSC_IO_SLOTS; i++)
+  {
+    if (msc_slot[i].state == MSC_SLOT_WRITING)
+    {
+      msc_io_wait = 1;
+      return 1;
+    }
+  }
+  ret = msc_write_status;
+  msc_write_status = 0;
+  return (ret < 0) ? -1 : 0;
+}
+
+/**
+  * @brief  主机弹出介质
+  */
+static void STORAGE_Eject_FS(uint8_t lun)
+{
+  if (lun == STORAGE_LUN_DIAG)
+  {
+    /* 重新装入（START STOP UNIT 装入或重新配置）时生成新的快照 */
+    diag_disk_reload();
+    return;
+  }
+  sd_owner_usb_detach();
+}
+
+static DRESULT msc_disk_io(const msc_slot_t *slot)
+{
+  uint8_t write = (slot->state == MSC_SLOT_WRITING);
+  uint8_t *buf = slot->buf;
+  uint32_t blk_addr = slot->blk_addr;
+  uint16_t blk_len = slot->blk_len;
+
+  if (slot->lun == STORAGE_LUN_DIAG)
+  {
+    return (!write && diag_disk_read(buf, blk_addr, blk_len) == 0) ? RES_OK : RES_ERROR;
+  }
+  /* 卷已挂载时经调度器排队，否则（卡上没有文件系统）直接访问 */
+  if (sd_io_running())
+  {
+    return write ? sd_io_write(SD_IO_PRIO_NORMAL, buf, blk_addr, blk_len)
+                 : sd_io_read(SD_IO_PRIO_NORMAL, buf, blk_addr, blk_len);
+  }
+  return write ? disk_write(0, buf, blk_addr, blk_len)
+               : disk_read(0, buf, blk_addr, blk_len);
+}
 
+static void msc_io_task(void *argument)
+{
+  msc_slot_t *slot;
+  DRESULT res;
+  uint8_t idx;
+
+  UNUSED(argument);
+
+  for (;;)
+  {
+    /* 等待SD卡初始化（挂载流程会先初始化，这里只在没有挂载时兜底）；期间照常处理诊断盘的读 */
+    if (!msc_ready &&
+        (disk_initialize(0) & STA_NOINIT) == 0U && (disk_status(0) & STA_NOINIT) == 0U)
+    {
+      msc_ready = 1;
+      LOG_INFO("usb msc: SD card ready");
+    }
+    if (xQueueReceive(msc_io_queue, &idx,
+                      msc_ready ? portMAX_DELAY : pdMS_TO_TICKS(MSC_IO_READY_POLL_MS)) != pdPASS)
+    {
+      continue;
+    }
+    slot = &msc_slot[idx];
+
+    res = msc_disk_io(slot);
+
+    USBD_LL_Lock();
+    if (slot->state == MSC_SLOT_WRITING)
+    {
+      if (res != RES_OK)
+      {
+        msc_write_status = -1;
+      }
+      slot->state = MSC_SLOT_FREE;
+    }
+    else
+    {
+      slot->status = (res == RES_OK) ? 0 : -1;
+      slot->state = MSC_SLOT_READY;
+    }
+    if (msc_io_wait)
+    {
+      msc_io_wait = 0;
+      SCSI_Resume(&hUsbDeviceFS);
+    }
+    USBD_LL_Unlock();
+  }
+}
+
+/**
+  * @brief  是否有缓冲区正在读写SD卡（含已排队未执行的，不含诊断盘）
+  */
+uint8_t STORAGE_Busy_FS(void)
+{
+  uint32_t i;
+
+  for (i = 0; i < MSC_IO_SLOTS; i++)
+  {
+    if ((msc_slot[i].state == MSC_SLOT_READING || msc_slot[i].state == MSC_SLOT_WRITING) &&
+        msc_slot[i].lun == STORAGE_LUN_SD)
+    {
+      return 1U;
+    }
+  }
+  return 0U;
+}
+
+/**
+  * @brief  创建MSC工作任务，需在调度器运行后调用一次
+  */
+void STORAGE_Start_FS(void)
+{
+  uint32_t i;
+
+  if (msc_io_task_handle != NULL)
+  {
+    return;
+  }
+  for (i = 0; i < MSC_IO_SLOTS; i++)
+  {
+    msc_slot[i].buf = msc_io_buf[i];
+    msc_slot[i].state = MSC_SLOT_FREE;
+  }
+  msc_io_queue = xQueueCreateStatic(MSC_IO_SLOTS, sizeof(uint8_t), msc_io_queue_storage, &msc_io_queue_buf);
+  msc_io_task_handle = xTaskCreateStatic(msc_io_task,
+                                         "usb_msc",
+                                         MSC_IO_STK_SIZE,
+                                         NULL,
+                                         MSC_IO_TASK_PRIO,
+                                         msc_io_task_stack,
+                                         &msc_io_task_tcb);
+}
 /* USER CODE END PRIVATE_FUNCTIONS_IMPLEMENTATION */
 
 /**
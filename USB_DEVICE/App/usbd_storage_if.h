@@ -105,7 +105,8 @@ extern USBD_StorageTypeDef USBD_Storage_Interface_fops_FS;
   */
 
 /* USER CODE BEGIN EXPORTED_FUNCTIONS */
-
+void STORAGE_Start_FS(void);
+uint8_t STORAGE_Busy_FS(void);
 /* USER CODE END EXPORTED_FUNCTIONS */
 
 /**
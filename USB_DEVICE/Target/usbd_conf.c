@@ -26,7 +26,12 @@
 #include "usbd_core.h"
 
 /* USER CODE BEGIN Includes */
-
+#include "usbd_composite.h"
+#include "sd_owner.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -35,7 +40,42 @@
 
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
-
+/* FS 内核共 1.25KB（320字）FIFO；发送 FIFO 至少16字（一个64字节包），
+ * 接收 FIFO 至少 10 + 2*(64/4+1) = 44 字。EP1 为 MSC IN，EP2 为 CDC IN，EP3 为 CDC 命令 */
+static const USBD_FifoProfileTypeDef fifo_profiles[] =
+{
+  /* name        rx     EP0    EP1    EP2    EP3 */
+  { "balanced", 0x80, { 0x20, 0x50, 0x40, 0x10 } },
+  { "msc-in",   0x80, { 0x10, 0x80, 0x20, 0x10 } },
+  { "cdc-in",   0x80, { 0x10, 0x20, 0x80, 0x10 } },
+  { "rx-heavy", 0xA0, { 0x10, 0x30, 0x30, 0x10 } },
+  { "minimal",  0x40, { 0x10, 0x10, 0x10, 0x10 } },
+};
+
+#define FIFO_PROFILE_NUM    (sizeof(fifo_profiles) / sizeof(fifo_profiles[0]))
+
+static uint8_t fifo_profile = USBD_FIFO_PROFILE;
+
+/* 协议栈锁：任务上下文进入协议栈（USB 任务、MSC 工作任务、CDC 日志）时持有 */
+static SemaphoreHandle_t usbd_lock;
+static StaticSemaphore_t usbd_lock_buf;
+static uint32_t usbd_lock_depth;
+
+#if USBD_DEFER_TO_TASK
+/* 每个端点方向同时最多一个未处理的完成事件（重新装载前端点回 NAK），
+ * 再加上 SETUP、复位、挂起/恢复，16 项足够 */
+#define USBD_EVENT_QUEUE_LEN    16U
+#define USBD_TASK_PRIO          (tskIDLE_PRIORITY + 7)  /* 高于 sd_io，控制传输不被SD读写拖慢 */
+#define USBD_TASK_STK_SIZE      512
+
+static QueueHandle_t usbd_event_queue;
+static StaticQueue_t usbd_event_queue_buf;
+static uint8_t usbd_event_queue_storage[USBD_EVENT_QUEUE_LEN * sizeof(USBD_EventTypeDef)];
+static TaskHandle_t usbd_task_handle;
+static StaticTask_t usbd_task_tcb;
+static StackType_t usbd_task_stack[USBD_TASK_STK_SIZE];
+static USBD_EventStatsTypeDef usbd_event_stats;
+#endif
 /* USER CODE END PV */
 
 PCD_HandleTypeDef hpcd_USB_OTG_FS;
@@ -57,7 +97,149 @@ USBD_StatusTypeDef USBD_Get_USB_Status(HAL_StatusTypeDef hal_status);
 /* Private functions ---------------------------------------------------------*/
 
 /* USER CODE BEGIN 1 */
+/**
+  * @brief  按当前方案配置端点 FIFO
+  */
+static void USBD_LL_ApplyFifoProfile(PCD_HandleTypeDef *hpcd)
+{
+  const USBD_FifoProfileTypeDef *p = &fifo_profiles[fifo_profile];
+  uint8_t i;
+
+  HAL_PCDEx_SetRxFiFo(hpcd, p->rx);
+  for (i = 0; i < 4U; i++)
+  {
+    HAL_PCDEx_SetTxFiFo(hpcd, i, p->tx[i]);
+  }
+}
+
+/**
+  * @brief  把一个 PCD 事件交给协议栈（持有协议栈锁或在 OTG 中断中）
+  */
+static void USBD_LL_Process(PCD_HandleTypeDef *hpcd, const USBD_EventTypeDef *ev)
+{
+  USBD_HandleTypeDef *pdev = (USBD_HandleTypeDef *)hpcd->pData;
+  USBD_SpeedTypeDef speed = USBD_SPEED_FULL;
 
+  switch (ev->type)
+  {
+    case USBD_EVT_SETUP:
+      USBD_LL_SetupStage(pdev, (uint8_t *)ev->setup);
+    break;
+
+    case USBD_EVT_DATA_OUT:
+      USBD_LL_DataOutStage(pdev, ev->epnum, hpcd->OUT_ep[ev->epnum].xfer_buff);
+    break;
+
+    case USBD_EVT_DATA_IN:
+      USBD_LL_DataInStage(pdev, ev->epnum, hpcd->IN_ep[ev->epnum].xfer_buff);
+    break;
+
+    case USBD_EVT_SOF:
+      USBD_LL_SOF(pdev);
+    break;
+
+    case USBD_EVT_RESET:
+      if (hpcd->Init.speed == PCD_SPEED_HIGH)
+      {
+        speed = USBD_SPEED_HIGH;
+      }
+      else if (hpcd->Init.speed != PCD_SPEED_FULL)
+      {
+        Error_Handler();
+      }
+      USBD_LL_SetSpeed(pdev, speed);
+      USBD_LL_Reset(pdev);
+    break;
+
+    case USBD_EVT_SUSPEND:
+      USBD_LL_Suspend(pdev);
+    break;
+
+    case USBD_EVT_RESUME:
+      USBD_LL_Resume(pdev);
+    break;
+
+    case USBD_EVT_ISO_OUT_INCOMPLETE:
+      USBD_LL_IsoOUTIncomplete(pdev, ev->epnum);
+    break;
+
+    case USBD_EVT_ISO_IN_INCOMPLETE:
+      USBD_LL_IsoINIncomplete(pdev, ev->epnum);
+    break;
+
+    case USBD_EVT_CONNECT:
+      USBD_LL_DevConnected(pdev);
+    break;
+
+    case USBD_EVT_DISCONNECT:
+      USBD_LL_DevDisconnected(pdev);
+    break;
+
+    default:
+    break;
+  }
+}
+
+/**
+  * @brief  PCD 回调（OTG 中断中）：直接处理，或放入队列由 USB 任务处理
+  */
+static void USBD_LL_Post(PCD_HandleTypeDef *hpcd, uint8_t type, uint8_t epnum)
+{
+  USBD_EventTypeDef ev;
+#if USBD_DEFER_TO_TASK
+  BaseType_t woken = pdFALSE;
+  UBaseType_t depth;
+#endif
+
+  ev.type = type;
+  ev.epnum = epnum;
+  if (type == USBD_EVT_SETUP)
+  {
+    /* 下一个 SETUP 包会覆盖 hpcd->Setup，随事件复制一份 */
+    memcpy(ev.setup, hpcd->Setup, sizeof(ev.setup));
+  }
+
+#if USBD_DEFER_TO_TASK
+  if (xQueueSendFromISR(usbd_event_queue, &ev, &woken) != pdPASS)
+  {
+    usbd_event_stats.overflows++;
+    return;
+  }
+  usbd_event_stats.events++;
+  depth = uxQueueMessagesWaitingFromISR(usbd_event_queue);
+  if (depth > usbd_event_stats.high_water)
+  {
+    usbd_event_stats.high_water = (uint16_t)depth;
+  }
+  portYIELD_FROM_ISR(woken);
+#else
+  USBD_LL_Process(hpcd, &ev);
+#endif
+}
+
+#if USBD_DEFER_TO_TASK
+/**
+  * @brief  USB 任务：在协议栈锁内依次处理排队的事件
+  */
+static void USBD_LL_Task(void *argument)
+{
+  USBD_EventTypeDef ev;
+
+  UNUSED(argument);
+
+  for (;;)
+  {
+    /* 只在持锁时取出事件，USBD_LL_DeInit 清空队列后不会再处理旧事件 */
+    (void)xQueuePeek(usbd_event_queue, &ev, portMAX_DELAY);
+    USBD_LL_Lock();
+    while (xQueueReceive(usbd_event_queue, &ev, 0) == pdPASS)
+    {
+      USBD_LL_Process(&hpcd_USB_OTG_FS, &ev);
+    }
+    USBD_LL_Unlock();
+  }
+}
+#endif
 /* USER CODE END 1 */
 
 /*******************************************************************************
@@ -134,7 +316,7 @@ static void PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_SetupStage((USBD_HandleTypeDef*)hpcd->pData, (uint8_t *)hpcd->Setup);
+  USBD_LL_Post(hpcd, USBD_EVT_SETUP, 0U);
 }
 
 /**
@@ -149,7 +331,7 @@ static void PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_DataOutStage((USBD_HandleTypeDef*)hpcd->pData, epnum, hpcd->OUT_ep[epnum].xfer_buff);
+  USBD_LL_Post(hpcd, USBD_EVT_DATA_OUT, epnum);
 }
 
 /**
@@ -164,7 +346,7 @@ static void PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_DataInStage((USBD_HandleTypeDef*)hpcd->pData, epnum, hpcd->IN_ep[epnum].xfer_buff);
+  USBD_LL_Post(hpcd, USBD_EVT_DATA_IN, epnum);
 }
 
 /**
@@ -178,7 +360,7 @@ static void PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_SOFCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_SOF((USBD_HandleTypeDef*)hpcd->pData);
+  USBD_LL_Post(hpcd, USBD_EVT_SOF, 0U);
 }
 
 /**
@@ -192,25 +374,8 @@ static void PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_ResetCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_SpeedTypeDef speed = USBD_SPEED_FULL;
-
-  if ( hpcd->Init.speed == PCD_SPEED_HIGH)
-  {
-    speed = USBD_SPEED_HIGH;
-  }
-  else if ( hpcd->Init.speed == PCD_SPEED_FULL)
-  {
-    speed = USBD_SPEED_FULL;
-  }
-  else
-  {
-    Error_Handler();
-  }
-    /* Set Speed. */
-  USBD_LL_SetSpeed((USBD_HandleTypeDef*)hpcd->pData, speed);
-
-  /* Reset Device. */
-  USBD_LL_Reset((USBD_HandleTypeDef*)hpcd->pData);
+  /* Set Speed and reset Device. */
+  USBD_LL_Post(hpcd, USBD_EVT_RESET, 0U);
 }
 
 /**
@@ -226,10 +391,12 @@ void HAL_PCD_SuspendCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
   /* Inform USB library that core enters in suspend Mode. */
-  USBD_LL_Suspend((USBD_HandleTypeDef*)hpcd->pData);
+  USBD_LL_Post(hpcd, USBD_EVT_SUSPEND, 0U);
   __HAL_PCD_GATE_PHYCLOCK(hpcd);
   /* Enter in STOP mode. */
   /* USER CODE BEGIN 2 */
+  /* 未使用 VBUS 检测，拔线只表现为挂起，持续挂起时交回SD卡 */
+  sd_owner_usb_suspend(true);
   if (hpcd->Init.low_power_enable)
   {
     /* Set SLEEPDEEP bit and SleepOnExit of Cortex System Control Register. */
@@ -251,9 +418,9 @@ void HAL_PCD_ResumeCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
   /* USER CODE BEGIN 3 */
-
+  sd_owner_usb_suspend(false);
   /* USER CODE END 3 */
-  USBD_LL_Resume((USBD_HandleTypeDef*)hpcd->pData);
+  USBD_LL_Post(hpcd, USBD_EVT_RESUME, 0U);
 }
 
 /**
@@ -268,7 +435,7 @@ static void PCD_ISOOUTIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_ISOOUTIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_IsoOUTIncomplete((USBD_HandleTypeDef*)hpcd->pData, epnum);
+  USBD_LL_Post(hpcd, USBD_EVT_ISO_OUT_INCOMPLETE, epnum);
 }
 
 /**
@@ -283,7 +450,7 @@ static void PCD_ISOINIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 void HAL_PCD_ISOINIncompleteCallback(PCD_HandleTypeDef *hpcd, uint8_t epnum)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_IsoINIncomplete((USBD_HandleTypeDef*)hpcd->pData, epnum);
+  USBD_LL_Post(hpcd, USBD_EVT_ISO_IN_INCOMPLETE, epnum);
 }
 
 /**
@@ -297,7 +464,7 @@ static void PCD_ConnectCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_ConnectCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_DevConnected((USBD_HandleTypeDef*)hpcd->pData);
+  USBD_LL_Post(hpcd, USBD_EVT_CONNECT, 0U);
 }
 
 /**
@@ -311,7 +478,7 @@ static void PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
 void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef *hpcd)
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
 {
-  USBD_LL_DevDisconnected((USBD_HandleTypeDef*)hpcd->pData);
+  USBD_LL_Post(hpcd, USBD_EVT_DISCONNECT, 0U);
 }
 
 /*******************************************************************************
@@ -361,9 +528,27 @@ USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
   HAL_PCD_RegisterIsoOutIncpltCallback(&hpcd_USB_OTG_FS, PCD_ISOOUTIncompleteCallback);
   HAL_PCD_RegisterIsoInIncpltCallback(&hpcd_USB_OTG_FS, PCD_ISOINIncompleteCallback);
 #endif /* USE_HAL_PCD_REGISTER_CALLBACKS */
-  HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_FS, 0x80);
-  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, 0x40);
-  HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 1, 0x80);
+  USBD_LL_ApplyFifoProfile(&hpcd_USB_OTG_FS);
+  /* USER CODE BEGIN USBD_LL_Init */
+  if (usbd_lock == NULL)
+  {
+    usbd_lock = xSemaphoreCreateRecursiveMutexStatic(&usbd_lock_buf);
+  }
+#if USBD_DEFER_TO_TASK
+  if (usbd_task_handle == NULL)
+  {
+    usbd_event_queue = xQueueCreateStatic(USBD_EVENT_QUEUE_LEN, sizeof(USBD_EventTypeDef),
+                                          usbd_event_queue_storage, &usbd_event_queue_buf);
+    usbd_task_handle = xTaskCreateStatic(USBD_LL_Task,
+                                         "usb_dev",
+                                         USBD_TASK_STK_SIZE,
+                                         NULL,
+                                         USBD_TASK_PRIO,
+                                         usbd_task_stack,
+                                         &usbd_task_tcb);
+  }
+#endif
+  /* USER CODE END USBD_LL_Init */
   }
   return USBD_OK;
 }
@@ -380,6 +565,13 @@ USBD_StatusTypeDef USBD_LL_DeInit(USBD_HandleTypeDef *pdev)
 
   hal_status = HAL_PCD_DeInit(pdev->pData);
 
+  /* USER CODE BEGIN USBD_LL_DeInit */
+#if USBD_DEFER_TO_TASK
+  /* 调用者持有协议栈锁，尚未处理的事件属于已经停止的内核 */
+  (void)xQueueReset(usbd_event_queue);
+#endif
+  /* USER CODE END USBD_LL_DeInit */
+
   usb_status =  USBD_Get_USB_Status(hal_status);
 
   return usb_status;
@@ -610,6 +802,85 @@ void USBD_LL_Delay(uint32_t Delay)
   HAL_Delay(Delay);
 }
 
+/**
+  * @brief  Static single allocation.
+  * @param  size: Size of allocated memory
+  * @retval None
+  */
+void *USBD_static_malloc(uint32_t size)
+{
+  /* 只有 MSC 从这里分配类状态（CDC 使用自己的静态存储），按4字节对齐 */
+  static uint32_t mem[(sizeof(USBD_MSC_BOT_HandleTypeDef) / 4U) + 1U];
+
+  if (size > sizeof(mem))
+  {
+    return NULL;
+  }
+  return mem;
+}
+
+/**
+  * @brief  Dummy memory free
+  * @param  p: Pointer to allocated  memory address
+  * @retval None
+  */
+void USBD_static_free(void *p)
+{
+  (void)p;
+}
+
+int8_t USBD_LL_SetFifoProfile(uint8_t idx)
+{
+  if (idx >= FIFO_PROFILE_NUM)
+  {
+    return -1;
+  }
+  fifo_profile = idx;
+  return 0;
+}
+
+const USBD_FifoProfileTypeDef *USBD_LL_GetFifoProfile(uint8_t idx)
+{
+  return (idx < FIFO_PROFILE_NUM) ? &fifo_profiles[idx] : NULL;
+}
+
+uint8_t USBD_LL_GetFifoProfileCount(void)
+{
+  return (uint8_t)FIFO_PROFILE_NUM;
+}
+
+void USBD_LL_Lock(void)
+{
+  (void)xSemaphoreTakeRecursive(usbd_lock, portMAX_DELAY);
+  if (usbd_lock_depth++ == 0U)
+  {
+    /* OTG 中断里的端点寄存器读改写不能与任务中的协议栈交错 */
+    HAL_NVIC_DisableIRQ(OTG_FS_IRQn);
+    __DSB();
+    __ISB();
+  }
+}
+
+void USBD_LL_Unlock(void)
+{
+  if (--usbd_lock_depth == 0U)
+  {
+    HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+  }
+  (void)xSemaphoreGiveRecursive(usbd_lock);
+}
+
+void USBD_LL_GetEventStats(USBD_EventStatsTypeDef *stats)
+{
+#if USBD_DEFER_TO_TASK
+  taskENTER_CRITICAL();
+  *stats = usbd_event_stats;
+  taskEXIT_CRITICAL();
+#else
+  memset(stats, 0, sizeof(*stats));
+#endif
+}
+
 /**
   * @brief  Retuns the USB status depending on the HAL status:
   * @param  hal_status: HAL status
@@ -64,7 +64,7 @@
   */
 
 /*---------- -----------*/
-#define USBD_MAX_NUM_INTERFACES     1U
+#define USBD_MAX_NUM_INTERFACES     3U
 /*---------- -----------*/
 #define USBD_MAX_NUM_CONFIGURATION     1U
 /*---------- -----------*/
@@ -76,7 +76,18 @@
 /*---------- -----------*/
 #define USBD_SELF_POWERED     1U
 /*---------- -----------*/
-#define MSC_MEDIA_PACKET     512U
+/* 一次数据阶段分片的大小，也是一次SD多块传输的大小（4~32KB，512的整数倍） */
+#define MSC_MEDIA_PACKET     8192U
+/*---------- -----------*/
+/* BOT命令响应缓冲区，读写数据使用存储层的流水线缓冲区 */
+#define MSC_BOT_DATA_SIZE     512U
+/*---------- -----------*/
+/* 默认的端点 FIFO 分配方案（USBD_FIFO_PROFILE_xxx，见 usbd_conf.c） */
+#define USBD_FIFO_PROFILE     0U
+/*---------- -----------*/
+/* 1：OTG 中断只把端点事件放入队列，由 USB 任务（usb_dev）运行协议栈，包括 BOT/SCSI 和存储回调；
+ * 0：协议栈直接在 OTG 中断中运行 */
+#define USBD_DEFER_TO_TASK     1U
 
 /****************************************/
 /* #define for FS and HS identification */
@@ -95,10 +106,10 @@
 /* Memory management macros */
 
 /** Alias for memory allocation. */
-#define USBD_malloc         malloc
+#define USBD_malloc         USBD_static_malloc
 
 /** Alias for memory release. */
-#define USBD_free           free
+#define USBD_free           USBD_static_free
 
 /** Alias for memory set. */
 #define USBD_memset         memset
@@ -144,6 +155,45 @@
   * @{
   */
 
+/* 端点 FIFO 分配方案（单位：32位字，总量不超过 320） */
+typedef struct
+{
+  const char *name;
+  uint16_t rx;              /* 共享接收 FIFO */
+  uint16_t tx[4];           /* EP0~EP3 发送 FIFO */
+} USBD_FifoProfileTypeDef;
+
+/* PCD 事件（OTG 中断 -> 协议栈） */
+enum
+{
+  USBD_EVT_SETUP = 0U,
+  USBD_EVT_DATA_OUT,
+  USBD_EVT_DATA_IN,
+  USBD_EVT_SOF,
+  USBD_EVT_RESET,
+  USBD_EVT_SUSPEND,
+  USBD_EVT_RESUME,
+  USBD_EVT_ISO_OUT_INCOMPLETE,
+  USBD_EVT_ISO_IN_INCOMPLETE,
+  USBD_EVT_CONNECT,
+  USBD_EVT_DISCONNECT
+};
+
+typedef struct
+{
+  uint8_t type;             /* USBD_EVT_xxx */
+  uint8_t epnum;
+  uint8_t setup[8];         /* SETUP 包 */
+} USBD_EventTypeDef;
+
+/* 事件队列统计（USBD_DEFER_TO_TASK 为 0 时全为 0） */
+typedef struct
+{
+  uint32_t events;          /* 入队的事件数 */
+  uint32_t overflows;       /* 队列满丢弃的事件数，非零说明 USB 任务长时间得不到运行 */
+  uint16_t high_water;      /* 队列最大深度 */
+} USBD_EventStatsTypeDef;
+
 /**
   * @}
   */
@@ -155,6 +205,41 @@
 
 /* Exported functions -------------------------------------------------------*/
 
+/* Memory management: class state comes from a static pool */
+void *USBD_static_malloc(uint32_t size);
+void USBD_static_free(void *p);
+
+/**
+  * @brief  选择端点 FIFO 分配方案，下一次 USBD_LL_Init（重新初始化USB）时生效
+  * @param  idx: 方案编号
+  * @retval 0 成功；-1 编号无效
+  */
+int8_t USBD_LL_SetFifoProfile(uint8_t idx);
+
+/**
+  * @brief  获取 FIFO 分配方案
+  * @param  idx: 方案编号
+  * @retval 方案，编号无效时为 NULL
+  */
+const USBD_FifoProfileTypeDef *USBD_LL_GetFifoProfile(uint8_t idx);
+
+/**
+  * @brief  FIFO 分配方案数量
+  */
+uint8_t USBD_LL_GetFifoProfileCount(void);
+
+/**
+  * @brief  任务中进入协议栈前加锁（可嵌套）：与 USB 任务及其他任务互斥，并屏蔽 OTG 中断。
+  *         存储层的 SCSI_Resume、CDC 启动发送、重新初始化 USB 都要在锁内进行，不能在中断中调用
+  */
+void USBD_LL_Lock(void);
+void USBD_LL_Unlock(void);
+
+/**
+  * @brief  获取事件队列统计
+  */
+void USBD_LL_GetEventStats(USBD_EventStatsTypeDef *stats);
+
 /**
   * @}
   */
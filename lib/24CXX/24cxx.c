@@ -22,121 +22,125 @@
  ****************************************************************************************************
  */
 
-#include "myiic.h"
 #include "24cxx.h"
-// #include "./SYSTEM/delay/delay.h"
+#include "i2c_bus.h"
+#include <string.h>
+
+/* 器件地址（写）。24C16 及以下型号只有 1 字节存储地址，高位地址 a8~a10 占用器件地址的 bit1~bit3：
+ *   24C01/02: 1 0 1 0 A2  A1 A0 R/W
+ *   24C04   : 1 0 1 0 A2  A1 a8 R/W
+ *   24C08   : 1 0 1 0 A2  a9 a8 R/W
+ *   24C16   : 1 0 1 0 a10 a9 a8 R/W
+ * 24C32 及以上型号用 2 字节存储地址 */
+#define AT24CXX_DEV_ADDR    0xA0
+
+#if EE_TYPE > AT24C16
+#define AT24CXX_REG_SIZE    I2C_BUS_REG_16BIT
+#define AT24CXX_REG(addr)   ((addr) & EE_TYPE)
+#else
+#define AT24CXX_REG_SIZE    I2C_BUS_REG_8BIT
+#define AT24CXX_REG(addr)   ((addr) & 0xFF)
+#endif
+
+/* 页大小：一次写入不能跨页，否则在页内回卷 */
+#if EE_TYPE <= AT24C02
+#define AT24CXX_PAGE_SIZE   8U
+#elif EE_TYPE <= AT24C16
+#define AT24CXX_PAGE_SIZE   16U
+#elif EE_TYPE <= AT24C64
+#define AT24CXX_PAGE_SIZE   32U
+#else
+#define AT24CXX_PAGE_SIZE   64U
+#endif
+
+/* 单次传输超时（毫秒），400kHz 下 256 字节约 6ms */
+#define AT24CXX_XFER_MS     20U
+
+/* 内部写周期的最长时间（毫秒），数据手册 tWR 为 5ms */
+#define AT24CXX_WRITE_MS    10U
 
 /**
- * @brief       ��ʼ��IIC�ӿ�
- * @param       ��
- * @retval      ��
+ * @brief       存储地址对应的器件地址
+ */
+static uint16_t at24cxx_dev_addr(uint16_t addr)
+{
+#if EE_TYPE > AT24C16
+    (void)addr;
+    return AT24CXX_DEV_ADDR;
+#else
+    return AT24CXX_DEV_ADDR | ((addr >> 8) << 1);
+#endif
+}
+
+/**
+ * @brief       从 addr 开始一次传输最多能访问的字节数
+ *   @note      24C16 及以下型号不跨 256 字节块（块号在器件地址中）；写入不跨页
+ */
+static uint16_t at24cxx_span(uint16_t addr, uint16_t datalen, uint16_t block)
+{
+    uint16_t n = block - (addr % block);
+
+    return (datalen < n) ? datalen : n;
+}
+
+/**
+ * @brief       初始化
+ *   @note      I2C1 由 MX_I2C1_Init() 和 i2c_bus_init() 初始化，这里只保留接口
+ * @param       无
+ * @retval      无
  */
 void at24cxx_init(void)
 {
-    iic_init();
 }
 
 /**
- * @brief       ��AT24CXXָ����ַ����һ������
- * @param       readaddr: ��ʼ�����ĵ�ַ
- * @retval      ����������
+ * @brief       在AT24CXX指定地址读出一个数据
+ * @param       addr: 开始读数的地址
+ * @retval      读到的数据
  */
 uint8_t at24cxx_read_one_byte(uint16_t addr)
 {
-    uint8_t temp = 0;
-    iic_start();    /* ������ʼ�ź� */
-
-    /* ���ݲ�ͬ��24CXX�ͺ�, ���͸�λ��ַ
-     * 1, 24C16���ϵ��ͺ�, ��2���ֽڷ��͵�ַ
-     * 2, 24C16�����µ��ͺ�, ��1�����ֽڵ�ַ + ռ��������ַ��bit1~bit3λ ���ڱ�ʾ��λ��ַ, ���11λ��ַ
-     *    ����24C01/02, ��������ַ��ʽ(8bit)Ϊ: 1  0  1  0  A2  A1  A0  R/W
-     *    ����24C04,    ��������ַ��ʽ(8bit)Ϊ: 1  0  1  0  A2  A1  a8  R/W
-     *    ����24C08,    ��������ַ��ʽ(8bit)Ϊ: 1  0  1  0  A2  a9  a8  R/W
-     *    ����24C16,    ��������ַ��ʽ(8bit)Ϊ: 1  0  1  0  a10 a9  a8  R/W
-     *    R/W      : ��/д����λ 0,��ʾд; 1,��ʾ��;
-     *    A0/A1/A2 : ��Ӧ������1,2,3����(ֻ��24C01/02/04/8����Щ��)
-     *    a8/a9/a10: ��Ӧ�洢���еĸ�λ��ַ, 11bit��ַ�����Ա�ʾ2048��λ��, ����Ѱַ24C16�����ڵ��ͺ�
-     */    
-    if (EE_TYPE > AT24C16)      /* 24C16���ϵ��ͺ�, ��2���ֽڷ��͵�ַ */
-    {
-        iic_send_byte(0xA0);    /* ����д����, IIC�涨���λ��0, ��ʾд�� */
-        iic_wait_ack();         /* ÿ�η�����һ���ֽ�,��Ҫ�ȴ�ACK */
-        iic_send_byte(addr >> 8);   /* ���͸��ֽڵ�ַ */
-    }
-    else 
-    {
-        iic_send_byte(0xA0 + ((addr >> 8) << 1));   /* �������� 0xA0 + ��λa8/a9/a10��ַ,д���� */
-    }
-    
-    iic_wait_ack();             /* ÿ�η�����һ���ֽ�,��Ҫ�ȴ�ACK */
-    iic_send_byte(addr % 256);  /* ���͵�λ��ַ */
-    iic_wait_ack();             /* �ȴ�ACK, ��ʱ��ַ��������� */
-    
-    iic_start();                /* ���·�����ʼ�ź� */ 
-    iic_send_byte(0xA1);        /* �������ģʽ, IIC�涨���λ��1, ��ʾ��ȡ */
-    iic_wait_ack();             /* ÿ�η�����һ���ֽ�,��Ҫ�ȴ�ACK */
-    temp = iic_read_byte(0);    /* ����һ���ֽ����� */
-    iic_stop();                 /* ����һ��ֹͣ���� */
+    uint8_t temp;
+
+    at24cxx_read(addr, &temp, 1);
     return temp;
 }
 
 /**
- * @brief       ��AT24CXXָ����ַд��һ������
- * @param       addr: д�����ݵ�Ŀ�ĵ�ַ
- * @param       data: Ҫд�������
- * @retval      ��
+ * @brief       在AT24CXX指定地址写入一个数据
+ * @param       addr: 写入数据的目的地址
+ * @param       data: 要写入的数据
+ * @retval      无
  */
 void at24cxx_write_one_byte(uint16_t addr, uint8_t data)
 {
-    /* ԭ��˵����:at24cxx_read_one_byte����, ��������ȫ���� */
-    iic_start();    /* ������ʼ�ź� */
-
-    if (EE_TYPE > AT24C16)      /* 24C16���ϵ��ͺ�, ��2���ֽڷ��͵�ַ */
-    {
-        iic_send_byte(0xA0);    /* ����д����, IIC�涨���λ��0, ��ʾд�� */
-        iic_wait_ack();         /* ÿ�η�����һ���ֽ�,��Ҫ�ȴ�ACK */
-        iic_send_byte(addr >> 8);   /* ���͸��ֽڵ�ַ */
-    }
-    else
-    {
-        iic_send_byte(0xA0 + ((addr >> 8) << 1));   /* �������� 0xA0 + ��λa8/a9/a10��ַ,д���� */
-    }
-    
-    iic_wait_ack();             /* ÿ�η�����һ���ֽ�,��Ҫ�ȴ�ACK */
-    iic_send_byte(addr % 256);  /* ���͵�λ��ַ */
-    iic_wait_ack();             /* �ȴ�ACK, ��ʱ��ַ��������� */
-    
-    /* ��Ϊд���ݵ�ʱ��,����Ҫ�������ģʽ��,�������ﲻ�����·�����ʼ�ź��� */
-    iic_send_byte(data);        /* ����1�ֽ� */
-    iic_wait_ack();             /* �ȴ�ACK */
-    iic_stop();                 /* ����һ��ֹͣ���� */
-    HAL_Delay(10);               /* ע��: EEPROM д��Ƚ���,����ȵ�10ms����д��һ���ֽ� */
+    at24cxx_write(addr, &data, 1);
 }
- 
+
 /**
- * @brief       ���AT24CXX�Ƿ�����
- *   @note      ���ԭ��: ��������ĩ��ַд��0X55, Ȼ���ٶ�ȡ, �����ȡֵΪ0X55
- *              ���ʾ�������. ����,���ʾ���ʧ��.
+ * @brief       检查AT24CXX是否正常
+ *   @note      检测原理: 在器件的末地址写入0X55, 然后再读取, 如果读取值为0X55
+ *              则表示检测正常. 否则,则表示检测失败.
  *
- * @param       ��
- * @retval      �����
- *              0: ���ɹ�
- *              1: ���ʧ��
+ * @param       无
+ * @retval      检测结果
+ *              0: 检测成功
+ *              1: 检测失败
  */
 uint8_t at24cxx_check(void)
 {
     uint8_t temp;
     uint16_t addr = EE_TYPE;
-    temp = at24cxx_read_one_byte(addr);     /* ����ÿ�ο�����дAT24CXX */
+    temp = at24cxx_read_one_byte(addr);     /* 避免每次开机都写AT24CXX */
 
-    if (temp == 0x55)   /* ��ȡ�������� */
+    if (temp == 0x55)   /* 读取数据正常 */
     {
         return 0;
     }
-    else    /* �ų���һ�γ�ʼ������� */
+    else    /* 排除第一次初始化的情况 */
     {
-        at24cxx_write_one_byte(addr, 0x55); /* ��д������ */
-        temp = at24cxx_read_one_byte(255);  /* �ٶ�ȡ���� */
+        at24cxx_write_one_byte(addr, 0x55); /* 先写入数据 */
+        temp = at24cxx_read_one_byte(addr); /* 再读取数据 */
 
         if (temp == 0x55)return 0;
     }
@@ -145,39 +149,58 @@ uint8_t at24cxx_check(void)
 }
 
 /**
- * @brief       ��AT24CXX�����ָ����ַ��ʼ����ָ������������
- * @param       addr    : ��ʼ�����ĵ�ַ ��24c02Ϊ0~255
- * @param       pbuf    : ���������׵�ַ
- * @param       datalen : Ҫ�������ݵĸ���
- * @retval      ��
+ * @brief       在AT24CXX里面的指定地址开始读出指定个数的数据
+ *   @note      每个 256 字节块一次随机读，多字节时由 DMA 接收；读取失败的部分填 0xFF
+ * @param       addr    : 开始读出的地址 对24c02为0~255
+ * @param       pbuf    : 数据数组首地址
+ * @param       datalen : 要读出数据的个数
+ * @retval      无
  */
 void at24cxx_read(uint16_t addr, uint8_t *pbuf, uint16_t datalen)
 {
-    while (datalen--)
+    uint16_t n;
+
+    while (datalen > 0)
     {
-        *pbuf++ = at24cxx_read_one_byte(addr++);
+#if EE_TYPE > AT24C16
+        n = datalen;
+#else
+        n = at24cxx_span(addr, datalen, 256);
+#endif
+        if (i2c_bus_mem_read(at24cxx_dev_addr(addr), AT24CXX_REG(addr), AT24CXX_REG_SIZE,
+                             pbuf, n, AT24CXX_XFER_MS) != 0)
+        {
+            memset(pbuf, 0xFF, n);
+        }
+        addr += n;
+        pbuf += n;
+        datalen -= n;
     }
 }
 
 /**
- * @brief       ��AT24CXX�����ָ����ַ��ʼд��ָ������������
- * @param       addr    : ��ʼд��ĵ�ַ ��24c02Ϊ0~255
- * @param       pbuf    : ���������׵�ַ
- * @param       datalen : Ҫд�����ݵĸ���
- * @retval      ��
+ * @brief       在AT24CXX里面的指定地址开始写入指定个数的数据
+ *   @note      按页写入，每页写完后查询应答等待内部写周期结束（通常不到 5ms）
+ * @param       addr    : 开始写入的地址 对24c02为0~255
+ * @param       pbuf    : 数据数组首地址
+ * @param       datalen : 要写入数据的个数
+ * @retval      无
  */
-void at24cxx_write(uint16_t addr, uint8_t *pbuf, uint16_t datalen)
+void at24cxx_write(uint16_t addr, const uint8_t *pbuf, uint16_t datalen)
 {
-    while (datalen--)
+    uint16_t dev;
+    uint16_t n;
+
+    while (datalen > 0)
     {
-        at24cxx_write_one_byte(addr, *pbuf);
-        addr++;
-        pbuf++;
+        n = at24cxx_span(addr, datalen, AT24CXX_PAGE_SIZE);
+        dev = at24cxx_dev_addr(addr);
+        if (i2c_bus_mem_write(dev, AT24CXX_REG(addr), AT24CXX_REG_SIZE, pbuf, n, AT24CXX_XFER_MS) == 0)
+        {
+            (void)i2c_bus_wait_ready(dev, AT24CXX_WRITE_MS);
+        }
+        addr += n;
+        pbuf += n;
+        datalen -= n;
     }
 }
-
-
-
-
-
-
@@ -45,7 +45,7 @@ void at24cxx_init(void);        /* ��ʼ��IIC */
 uint8_t at24cxx_check(void);    /* ������� */
 uint8_t at24cxx_read_one_byte(uint16_t addr);                       /* ָ����ַ��ȡһ���ֽ� */
 void at24cxx_write_one_byte(uint16_t addr,uint8_t data);            /* ָ����ַд��һ���ֽ� */
-void at24cxx_write(uint16_t addr, uint8_t *pbuf, uint16_t datalen); /* ��ָ����ַ��ʼд��ָ�����ȵ����� */
+void at24cxx_write(uint16_t addr, const uint8_t *pbuf, uint16_t datalen); /* ��ָ����ַ��ʼд��ָ�����ȵ����� */
 void at24cxx_read(uint16_t addr, uint8_t *pbuf, uint16_t datalen);  /* ��ָ����ַ��ʼ����ָ�����ȵ����� */
 
 #endif
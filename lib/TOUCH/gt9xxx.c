@@ -174,6 +174,42 @@ const uint16_t GT9XXX_TPX_TBL[10] =
     GT9XXX_TP6_REG, GT9XXX_TP7_REG, GT9XXX_TP8_REG, GT9XXX_TP9_REG, GT9XXX_TP10_REG,
 };
 
+/**
+ * @brief       把 GT9XXX 的坐标数据转换为 LCD 坐标
+ * @param       buf : 触摸点数据(X低, X高, Y低, Y高)
+ * @param       x, y : 返回的 LCD 坐标
+ * @retval      无
+ */
+static void gt9xxx_to_lcd(const uint8_t *buf, uint16_t *x, uint16_t *y)
+{
+    if (lcddev.id == 0X5510 || lcddev.id == 0X9806 || lcddev.id == 0X7796)     /* 4.3��800*480 �� 3.5��480*320 MCU�� */
+    {
+        if (tp_dev.touchtype & 0X01)    /* ���� */
+        {
+            *x = lcddev.width - (((uint16_t)buf[3] << 8) + buf[2]);
+            *y = ((uint16_t)buf[1] << 8) + buf[0];
+        }
+        else
+        {
+            *x = ((uint16_t)buf[1] << 8) + buf[0];
+            *y = ((uint16_t)buf[3] << 8) + buf[2];
+        }
+    }
+    else    /* �����ͺ� */
+    {
+        if (tp_dev.touchtype & 0X01)    /* ���� */
+        {
+            *x = ((uint16_t)buf[1] << 8) + buf[0];
+            *y = ((uint16_t)buf[3] << 8) + buf[2];
+        }
+        else
+        {
+            *x = lcddev.width - (((uint16_t)buf[3] << 8) + buf[2]);
+            *y = ((uint16_t)buf[1] << 8) + buf[0];
+        }
+    }
+}
+
 /**
  * @brief       ɨ�败����(���ò�ѯ��ʽ)
  * @param       mode : ������δ�õ��β���, Ϊ�˼��ݵ�����
@@ -215,32 +251,7 @@ uint8_t gt9xxx_scan(uint8_t mode)
                 {
                     gt9xxx_rd_reg(GT9XXX_TPX_TBL[i], buf, 4);   /* ��ȡXY����ֵ */
 
-                    if (lcddev.id == 0X5510 || lcddev.id == 0X9806 || lcddev.id == 0X7796)     /* 4.3��800*480 �� 3.5��480*320 MCU�� */
-                    {
-                        if (tp_dev.touchtype & 0X01)    /* ���� */
-                        {
-                            tp_dev.x[i] = lcddev.width - (((uint16_t)buf[3] << 8) + buf[2]);
-                            tp_dev.y[i] = ((uint16_t)buf[1] << 8) + buf[0];
-                        }
-                        else
-                        {
-                            tp_dev.x[i] = ((uint16_t)buf[1] << 8) + buf[0];
-                            tp_dev.y[i] = ((uint16_t)buf[3] << 8) + buf[2];
-                        }
-                    }
-                    else    /* �����ͺ� */
-                    {
-                        if (tp_dev.touchtype & 0X01)    /* ���� */
-                        {
-                            tp_dev.x[i] = ((uint16_t)buf[1] << 8) + buf[0];
-                            tp_dev.y[i] = ((uint16_t)buf[3] << 8) + buf[2];
-                        }
-                        else
-                        {
-                            tp_dev.x[i] = lcddev.width - (((uint16_t)buf[3] << 8) + buf[2]);
-                            tp_dev.y[i] = ((uint16_t)buf[1] << 8) + buf[0];
-                        }
-                    }
+                    gt9xxx_to_lcd(buf, &tp_dev.x[i], &tp_dev.y[i]);
 
                     //printf("x[%d]:%d,y[%d]:%d\r\n", i, tp_dev.x[i], i, tp_dev.y[i]);
                 }
@@ -290,6 +301,52 @@ uint8_t gt9xxx_scan(uint8_t mode)
     return res;
 }
 
+/**
+ * @brief       读取一帧触摸数据(中断方式, 由触摸服务任务在 INT 触发后调用)
+ *   @note      一次读出状态和第一个触摸点(0X814E~0X8153), 有新数据时清状态,
+ *              芯片在状态清零后才会更新下一帧
+ * @param       x, y : 返回第一个触摸点的 LCD 坐标(触摸点数为 0 时不修改)
+ * @retval      触摸点数(0 表示已松开); GT9XXX_NO_DATA: 没有新数据或数据无效
+ */
+uint8_t gt9xxx_read_point(uint16_t *x, uint16_t *y)
+{
+    uint8_t buf[6];
+    uint8_t num;
+    uint8_t clr = 0;
+    uint16_t tx;
+    uint16_t ty;
+
+    gt9xxx_rd_reg(GT9XXX_GSTID_REG, buf, 6);
+
+    if ((buf[0] & 0X80) == 0)
+    {
+        return GT9XXX_NO_DATA;
+    }
+
+    gt9xxx_wr_reg(GT9XXX_GSTID_REG, &clr, 1);
+    num = buf[0] & 0X0F;
+
+    if (num > g_gt_tnum)
+    {
+        return GT9XXX_NO_DATA;
+    }
+
+    if (num > 0)
+    {
+        gt9xxx_to_lcd(&buf[2], &tx, &ty);
+
+        if (tx > lcddev.width || ty > lcddev.height)    /* 非法坐标, 丢弃这一帧 */
+        {
+            return GT9XXX_NO_DATA;
+        }
+
+        *x = tx;
+        *y = ty;
+    }
+
+    return num;
+}
+
 
 
 
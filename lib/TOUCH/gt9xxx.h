@@ -77,6 +77,8 @@
 #define GT9XXX_TP8_REG      0X8188      /* �ڰ˸����������ݵ�ַ */
 #define GT9XXX_TP9_REG      0X8190      /* �ھŸ����������ݵ�ַ */
 #define GT9XXX_TP10_REG     0X8198      /* ��ʮ�����������ݵ�ַ */
+
+#define GT9XXX_NO_DATA      0XFF        /* gt9xxx_read_point: 没有新数据 */
  
 /******************************************************************************************/
 /* �������� */
@@ -85,6 +87,7 @@ uint8_t gt9xxx_wr_reg(uint16_t reg,uint8_t *buf,uint8_t len);   /* ��gt9xxд
 void gt9xxx_rd_reg(uint16_t reg,uint8_t *buf,uint8_t len);      /* ��gt9xx��ȡ���� */
 uint8_t gt9xxx_init(void);                                      /* ��ʼ��gt9xxx������ */
 uint8_t gt9xxx_scan(uint8_t mode);                              /* ɨ�败���� */
+uint8_t gt9xxx_read_point(uint16_t *x, uint16_t *y);           /* 读取一帧触摸数据(中断方式) */
 
 #endif
 
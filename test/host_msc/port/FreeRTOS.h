@@ -0,0 +1,53 @@
+/**
+ * @file FreeRTOS.h
+ * @brief 主机仿真用的 FreeRTOS 子集（pthread 实现，见 rtos_host.c）
+ *
+ * 只提供存储层用到的静态任务、静态队列和延时。
+ * 仿真 USB 中断的线程调用 host_usb_enter_isr() 后 xPortIsInsideInterrupt() 返回真。
+ */
+
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uintptr_t StackType_t;
+
+#define pdFALSE                 ((BaseType_t)0)
+#define pdTRUE                  ((BaseType_t)1)
+#define pdPASS                  pdTRUE
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFFUL)
+#define tskIDLE_PRIORITY        ((UBaseType_t)0U)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+
+typedef void (*TaskFunction_t)(void *);
+
+typedef struct
+{
+  pthread_t thread;
+  TaskFunction_t fn;
+  void *arg;
+} StaticTask_t;
+typedef StaticTask_t *TaskHandle_t;
+
+typedef struct
+{
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint8_t *storage;
+  UBaseType_t length;
+  UBaseType_t item_size;
+  UBaseType_t head;
+  UBaseType_t count;
+} StaticQueue_t;
+typedef StaticQueue_t *QueueHandle_t;
+
+BaseType_t xPortIsInsideInterrupt(void);
+#define portYIELD_FROM_ISR(x)   ((void)(x))
+
+#endif /* INC_FREERTOS_H */
@@ -0,0 +1,25 @@
+/**
+ * @file bsp_driver_sd.h
+ * @brief 主机仿真用的 SD 卡 BSP 接口，由 disk_file.c 以镜像文件实现
+ */
+
+#ifndef __STM32F4_SD_H
+#define __STM32F4_SD_H
+
+#include <stdint.h>
+
+typedef struct
+{
+  uint32_t CardType;
+  uint32_t CardVersion;
+  uint32_t Class;
+  uint32_t RelCardAdd;
+  uint32_t BlockNbr;
+  uint32_t BlockSize;
+  uint32_t LogBlockNbr;
+  uint32_t LogBlockSize;
+} HAL_SD_CardInfoTypeDef;
+
+void BSP_SD_GetCardInfo(HAL_SD_CardInfoTypeDef *CardInfo);
+
+#endif /* __STM32F4_SD_H */
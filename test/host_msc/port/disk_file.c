@@ -0,0 +1,136 @@
+/**
+ * @file disk_file.c
+ * @brief 以镜像文件模拟 SD 卡
+ */
+
+#include "disk_file.h"
+#include "diskio.h"
+#include "sd_io_sched.h"
+#include "bsp_driver_sd.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+static int disk_fd = -1;
+static uint32_t disk_sectors;
+static volatile uint32_t disk_bad_sector = 0xFFFFFFFFU;
+
+int disk_file_open(const char *path, uint32_t sectors)
+{
+  disk_fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (disk_fd < 0)
+  {
+    return -1;
+  }
+  if (ftruncate(disk_fd, (off_t)sectors * DISK_FILE_SECTOR) != 0)
+  {
+    close(disk_fd);
+    disk_fd = -1;
+    return -1;
+  }
+  disk_sectors = sectors;
+  return 0;
+}
+
+void disk_file_close(void)
+{
+  if (disk_fd >= 0)
+  {
+    close(disk_fd);
+    disk_fd = -1;
+  }
+}
+
+void disk_file_inject_error(uint32_t sector)
+{
+  disk_bad_sector = sector;
+}
+
+int disk_file_peek(uint32_t sector, uint8_t *buf, uint32_t count)
+{
+  size_t len = (size_t)count * DISK_FILE_SECTOR;
+
+  return (pread(disk_fd, buf, len, (off_t)sector * DISK_FILE_SECTOR) == (ssize_t)len) ? 0 : -1;
+}
+
+int disk_file_poke(uint32_t sector, const uint8_t *buf, uint32_t count)
+{
+  size_t len = (size_t)count * DISK_FILE_SECTOR;
+
+  return (pwrite(disk_fd, buf, len, (off_t)sector * DISK_FILE_SECTOR) == (ssize_t)len) ? 0 : -1;
+}
+
+static int disk_range_ok(DWORD sector, UINT count)
+{
+  uint32_t bad = disk_bad_sector;
+
+  if (disk_fd < 0 || (uint64_t)sector + count > disk_sectors)
+  {
+    return 0;
+  }
+  return !(bad >= sector && bad < sector + count);
+}
+
+DSTATUS disk_initialize(BYTE pdrv)
+{
+  return disk_status(pdrv);
+}
+
+DSTATUS disk_status(BYTE pdrv)
+{
+  return (pdrv == 0U && disk_fd >= 0) ? 0U : STA_NOINIT;
+}
+
+DRESULT disk_read(BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
+{
+  if (pdrv != 0U || !disk_range_ok(sector, count))
+  {
+    return RES_ERROR;
+  }
+  return (disk_file_peek(sector, buff, count) == 0) ? RES_OK : RES_ERROR;
+}
+
+DRESULT disk_write(BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
+{
+  if (pdrv != 0U || !disk_range_ok(sector, count))
+  {
+    return RES_ERROR;
+  }
+  return (disk_file_poke(sector, buff, count) == 0) ? RES_OK : RES_ERROR;
+}
+
+DRESULT disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+  (void)pdrv;
+  (void)cmd;
+  (void)buff;
+  return RES_PARERR;
+}
+
+bool sd_io_running(void)
+{
+  return false;
+}
+
+DRESULT sd_io_read(sd_io_prio_t prio, BYTE *buf, DWORD sector, UINT count)
+{
+  (void)prio;
+  return disk_read(0, buf, sector, count);
+}
+
+DRESULT sd_io_write(sd_io_prio_t prio, const BYTE *buf, DWORD sector, UINT count)
+{
+  (void)prio;
+  return disk_write(0, buf, sector, count);
+}
+
+void BSP_SD_GetCardInfo(HAL_SD_CardInfoTypeDef *CardInfo)
+{
+  CardInfo->CardType = 1U;
+  CardInfo->CardVersion = 1U;
+  CardInfo->Class = 0U;
+  CardInfo->RelCardAdd = 0U;
+  CardInfo->BlockNbr = disk_sectors;
+  CardInfo->BlockSize = DISK_FILE_SECTOR;
+  CardInfo->LogBlockNbr = disk_sectors;
+  CardInfo->LogBlockSize = DISK_FILE_SECTOR;
+}
@@ -0,0 +1,30 @@
+/**
+ * @file disk_file.h
+ * @brief 以镜像文件模拟 SD 卡（实现 diskio 和 BSP_SD_GetCardInfo）
+ */
+
+#ifndef __DISK_FILE_H
+#define __DISK_FILE_H
+
+#include <stdint.h>
+
+#define DISK_FILE_SECTOR    512U
+
+/**
+ * @brief 打开（不存在则创建）镜像文件并设置为指定扇区数
+ * @retval 0 成功；-1 失败
+ */
+int disk_file_open(const char *path, uint32_t sectors);
+void disk_file_close(void);
+
+/**
+ * @brief 访问到指定扇区时返回 RES_ERROR，用于错误路径测试
+ * @param sector 故障扇区，0xFFFFFFFF 取消
+ */
+void disk_file_inject_error(uint32_t sector);
+
+/* 镜像文件直接读写，绕过被测代码校验数据 */
+int disk_file_peek(uint32_t sector, uint8_t *buf, uint32_t count);
+int disk_file_poke(uint32_t sector, const uint8_t *buf, uint32_t count);
+
+#endif /* __DISK_FILE_H */
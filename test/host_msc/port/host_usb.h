@@ -0,0 +1,60 @@
+/**
+ * @file host_usb.h
+ * @brief 仿真 PCD 的主机侧接口
+ *
+ * 测试线程扮演协议栈上下文：持有 host_usb_lock() 期间调用 USBD_LL_xxxStage，相当于在 OTG 中断里，
+ * 或者（host_usb_set_task_context(1)）在持有协议栈锁的 USB 任务里（USBD_DEFER_TO_TASK）；
+ * 存储层工作任务用 USBD_LL_Lock() 进入协议栈，两者互斥，与目标板一致。
+ * 测试线程只在 host_usb_wait() 中释放锁，让工作任务推进。
+ */
+
+#ifndef __HOST_USB_H
+#define __HOST_USB_H
+
+#include "usbd_def.h"
+#include <stdint.h>
+
+/* 单个端点方向的状态 */
+typedef struct
+{
+  uint8_t *buf;             /* 设备提供的缓冲区 */
+  uint32_t len;             /* 设备要发送的长度 / 准备接收的长度 */
+  uint32_t rx_size;         /* 最近一次完成的接收长度 */
+  uint8_t busy;             /* 已提交传输，等待主机完成 */
+  uint8_t stalled;
+  uint8_t open;
+} host_ep_t;
+
+void host_usb_lock(void);
+void host_usb_unlock(void);
+
+/**
+ * @brief 协议栈上下文：0 为 OTG 中断（默认），1 为 USB 任务
+ */
+void host_usb_set_task_context(int task);
+
+/**
+ * @brief 释放锁等待条件成立（其它线程在释放 USB 中断屏蔽时唤醒）
+ * @retval 0 条件成立；-1 超时
+ */
+int host_usb_wait(int (*cond)(void), uint32_t timeout_ms);
+
+host_ep_t *host_usb_ep(uint8_t ep_addr);
+
+/* 以"中断"身份进入协议栈，并累计类层耗时 */
+USBD_StatusTypeDef host_usb_setup(USBD_HandleTypeDef *pdev, const uint8_t setup[8]);
+USBD_StatusTypeDef host_usb_in_done(USBD_HandleTypeDef *pdev, uint8_t ep_addr);
+USBD_StatusTypeDef host_usb_out_done(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint32_t len);
+
+/* 类层（协议栈回调 + SCSI_Resume）累计耗时，单位见 host_cycles() */
+uint64_t host_usb_class_cycles(void);
+uint32_t host_usb_class_calls(void);
+void host_usb_reset_stats(void);
+
+/**
+ * @brief 周期计数：x86 上为 TSC，其它平台为纳秒
+ */
+uint64_t host_cycles(void);
+const char *host_cycles_unit(void);
+
+#endif /* __HOST_USB_H */
@@ -0,0 +1,16 @@
+/**
+ * @file log.h
+ * @brief 主机仿真用的日志宏，输出到 stderr
+ */
+
+#ifndef __LOG_H
+#define __LOG_H
+
+#include <stdio.h>
+
+#define LOG_DEBUG(format, ...)      ((void)0)
+#define LOG_INFO(format, ...)       fprintf(stderr, "[I] " format "\n", ##__VA_ARGS__)
+#define LOG_WARNING(format, ...)    fprintf(stderr, "[W] " format "\n", ##__VA_ARGS__)
+#define LOG_ERROR(format, ...)      fprintf(stderr, "[E] " format "\n", ##__VA_ARGS__)
+
+#endif /* __LOG_H */
@@ -0,0 +1,110 @@
+/**
+ * @file rtos_host.c
+ * @brief FreeRTOS 子集的 pthread 实现，仅供主机仿真
+ */
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+static void *task_entry(void *arg)
+{
+  StaticTask_t *tcb = (StaticTask_t *)arg;
+
+  tcb->fn(tcb->arg);
+  return NULL;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t fn, const char *name, uint32_t depth, void *arg,
+                               UBaseType_t prio, StackType_t *stack, StaticTask_t *tcb)
+{
+  (void)name;
+  (void)depth;
+  (void)prio;
+  (void)stack;
+
+  tcb->fn = fn;
+  tcb->arg = arg;
+  if (pthread_create(&tcb->thread, NULL, task_entry, tcb) != 0)
+  {
+    return NULL;
+  }
+  pthread_detach(tcb->thread);
+  return tcb;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  struct timespec ts;
+
+  ts.tv_sec = ticks / 1000U;
+  ts.tv_nsec = (long)(ticks % 1000U) * 1000000L;
+  while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+  {
+  }
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (TickType_t)(ts.tv_sec * 1000U + ts.tv_nsec / 1000000L);
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size,
+                                 uint8_t *storage, StaticQueue_t *buf)
+{
+  pthread_mutex_init(&buf->lock, NULL);
+  pthread_cond_init(&buf->cond, NULL);
+  buf->storage = storage;
+  buf->length = length;
+  buf->item_size = item_size;
+  buf->head = 0;
+  buf->count = 0;
+  return buf;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+  BaseType_t ret = pdFALSE;
+
+  (void)wait;
+  pthread_mutex_lock(&q->lock);
+  if (q->count < q->length)
+  {
+    memcpy(q->storage + ((q->head + q->count) % q->length) * q->item_size, item, q->item_size);
+    q->count++;
+    pthread_cond_signal(&q->cond);
+    ret = pdTRUE;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return ret;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken)
+{
+  if (woken != NULL)
+  {
+    *woken = pdFALSE;
+  }
+  return xQueueSend(q, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+  (void)wait;
+  pthread_mutex_lock(&q->lock);
+  while (q->count == 0U)
+  {
+    pthread_cond_wait(&q->cond, &q->lock);
+  }
+  memcpy(item, q->storage + q->head * q->item_size, q->item_size);
+  q->head = (q->head + 1U) % q->length;
+  q->count--;
+  pthread_mutex_unlock(&q->lock);
+  return pdTRUE;
+}
@@ -0,0 +1,24 @@
+/**
+ * @file sd_io_sched.h
+ * @brief 主机仿真用的 SD 调度器接口：调度器不运行，存储层直接走 disk_read/disk_write
+ */
+
+#ifndef __SD_IO_SCHED_H
+#define __SD_IO_SCHED_H
+
+#include "diskio.h"
+#include <stdbool.h>
+
+typedef enum
+{
+  SD_IO_PRIO_UI = 0,
+  SD_IO_PRIO_NORMAL,
+  SD_IO_PRIO_BACKGROUND,
+  SD_IO_PRIO_NUM
+} sd_io_prio_t;
+
+bool sd_io_running(void);
+DRESULT sd_io_read(sd_io_prio_t prio, BYTE *buf, DWORD sector, UINT count);
+DRESULT sd_io_write(sd_io_prio_t prio, const BYTE *buf, DWORD sector, UINT count);
+
+#endif /* __SD_IO_SCHED_H */
@@ -0,0 +1,23 @@
+/**
+ * @file sd_owner.c
+ * @brief 主机仿真用的卷所有权实现
+ */
+
+#include "sd_owner.h"
+
+static volatile bool usb_active;
+
+void sd_owner_usb_attach(void)
+{
+  usb_active = true;
+}
+
+void sd_owner_usb_detach(void)
+{
+  usb_active = false;
+}
+
+bool sd_owner_usb_active(void)
+{
+  return usb_active;
+}
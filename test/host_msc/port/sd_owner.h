@@ -0,0 +1,15 @@
+/**
+ * @file sd_owner.h
+ * @brief 主机仿真用的卷所有权接口：没有固件侧文件系统，USB 请求/放弃介质立即生效
+ */
+
+#ifndef __SD_OWNER_H
+#define __SD_OWNER_H
+
+#include <stdbool.h>
+
+void sd_owner_usb_attach(void);
+void sd_owner_usb_detach(void);
+bool sd_owner_usb_active(void);
+
+#endif /* __SD_OWNER_H */
@@ -0,0 +1,343 @@
+/**
+ * @file usbd_conf.c
+ * @brief 仿真 PCD：实现 USBD_LL_xxx，记录设备提交的传输，由测试线程按主机时序完成
+ */
+
+#include "usbd_core.h"
+#include "host_usb.h"
+#include "FreeRTOS.h"
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+
+#define HOST_EP_NUM     4U
+
+static pthread_mutex_t usb_irq_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t usb_irq_cond = PTHREAD_COND_INITIALIZER;
+static __thread int usb_in_isr;
+static int usb_task_context;
+
+static host_ep_t ep_in[HOST_EP_NUM];
+static host_ep_t ep_out[HOST_EP_NUM];
+
+static uint64_t class_cycles;
+static uint32_t class_calls;
+static uint64_t task_enter;
+
+uint64_t host_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __builtin_ia32_rdtsc();
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+const char *host_cycles_unit(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return "TSC cycles";
+#else
+  return "ns";
+#endif
+}
+
+/* ---------------- 中断屏蔽 ---------------- */
+
+void host_usb_lock(void)
+{
+  pthread_mutex_lock(&usb_irq_lock);
+  usb_in_isr = !usb_task_context;
+}
+
+void host_usb_unlock(void)
+{
+  usb_in_isr = 0;
+  pthread_mutex_unlock(&usb_irq_lock);
+}
+
+void host_usb_set_task_context(int task)
+{
+  usb_task_context = task;
+  usb_in_isr = !task;
+}
+
+BaseType_t xPortIsInsideInterrupt(void)
+{
+  return usb_in_isr ? pdTRUE : pdFALSE;
+}
+
+void USBD_LL_Lock(void)
+{
+  pthread_mutex_lock(&usb_irq_lock);
+  task_enter = host_cycles();
+}
+
+void USBD_LL_Unlock(void)
+{
+  class_cycles += host_cycles() - task_enter;
+  class_calls++;
+  pthread_cond_broadcast(&usb_irq_cond);
+  pthread_mutex_unlock(&usb_irq_lock);
+}
+
+int host_usb_wait(int (*cond)(void), uint32_t timeout_ms)
+{
+  struct timespec deadline;
+  int ret = 0;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeout_ms / 1000U;
+  deadline.tv_nsec += (long)(timeout_ms % 1000U) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  usb_in_isr = 0;
+  while (!cond() && ret != ETIMEDOUT)
+  {
+    ret = pthread_cond_timedwait(&usb_irq_cond, &usb_irq_lock, &deadline);
+  }
+  usb_in_isr = !usb_task_context;
+  return cond() ? 0 : -1;
+}
+
+host_ep_t *host_usb_ep(uint8_t ep_addr)
+{
+  uint8_t num = ep_addr & 0x7FU;
+
+  if (num >= HOST_EP_NUM)
+  {
+    return NULL;
+  }
+  return ((ep_addr & 0x80U) != 0U) ? &ep_in[num] : &ep_out[num];
+}
+
+/* ---------------- 以"中断"身份进入协议栈 ---------------- */
+
+USBD_StatusTypeDef host_usb_setup(USBD_HandleTypeDef *pdev, const uint8_t setup[8])
+{
+  USBD_StatusTypeDef ret;
+  uint64_t t0;
+
+  /* SETUP 包清除 EP0 的 STALL */
+  ep_in[0].stalled = 0;
+  ep_out[0].stalled = 0;
+  ep_in[0].busy = 0;
+  ep_out[0].busy = 0;
+  t0 = host_cycles();
+  ret = USBD_LL_SetupStage(pdev, (uint8_t *)setup);
+  class_cycles += host_cycles() - t0;
+  class_calls++;
+  return ret;
+}
+
+USBD_StatusTypeDef host_usb_in_done(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr);
+  USBD_StatusTypeDef ret;
+  uint64_t t0;
+
+  ep->busy = 0;
+  t0 = host_cycles();
+  ret = USBD_LL_DataInStage(pdev, ep_addr & 0x7FU, ep->buf);
+  class_cycles += host_cycles() - t0;
+  class_calls++;
+  return ret;
+}
+
+USBD_StatusTypeDef host_usb_out_done(USBD_HandleTypeDef *pdev, uint8_t ep_addr, uint32_t len)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr);
+  USBD_StatusTypeDef ret;
+  uint64_t t0;
+
+  ep->busy = 0;
+  ep->rx_size = len;
+  t0 = host_cycles();
+  ret = USBD_LL_DataOutStage(pdev, ep_addr & 0x7FU, ep->buf);
+  class_cycles += host_cycles() - t0;
+  class_calls++;
+  return ret;
+}
+
+uint64_t host_usb_class_cycles(void)
+{
+  return class_cycles;
+}
+
+uint32_t host_usb_class_calls(void)
+{
+  return class_calls;
+}
+
+void host_usb_reset_stats(void)
+{
+  class_cycles = 0;
+  class_calls = 0;
+}
+
+/* ---------------- USBD_LL_xxx ---------------- */
+
+USBD_StatusTypeDef USBD_LL_Init(USBD_HandleTypeDef *pdev)
+{
+  (void)pdev;
+  memset(ep_in, 0, sizeof(ep_in));
+  memset(ep_out, 0, sizeof(ep_out));
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_DeInit(USBD_HandleTypeDef *pdev)
+{
+  (void)pdev;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_Start(USBD_HandleTypeDef *pdev)
+{
+  (void)pdev;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_Stop(USBD_HandleTypeDef *pdev)
+{
+  (void)pdev;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_OpenEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                  uint8_t ep_type, uint16_t ep_mps)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr);
+
+  (void)pdev;
+  (void)ep_type;
+  (void)ep_mps;
+  if (ep == NULL)
+  {
+    return USBD_FAIL;
+  }
+  ep->open = 1;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_CloseEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr);
+
+  (void)pdev;
+  if (ep == NULL)
+  {
+    return USBD_FAIL;
+  }
+  ep->open = 0;
+  ep->busy = 0;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_FlushEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr);
+
+  (void)pdev;
+  if (ep == NULL)
+  {
+    return USBD_FAIL;
+  }
+  if ((ep_addr & 0x80U) != 0U)
+  {
+    ep->busy = 0;
+  }
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_StallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr);
+
+  (void)pdev;
+  if (ep == NULL)
+  {
+    return USBD_FAIL;
+  }
+  ep->stalled = 1;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_ClearStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr);
+
+  (void)pdev;
+  if (ep == NULL)
+  {
+    return USBD_FAIL;
+  }
+  ep->stalled = 0;
+  return USBD_OK;
+}
+
+uint8_t USBD_LL_IsStallEP(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr);
+
+  (void)pdev;
+  return (ep != NULL) ? ep->stalled : 0U;
+}
+
+USBD_StatusTypeDef USBD_LL_SetUSBAddress(USBD_HandleTypeDef *pdev, uint8_t dev_addr)
+{
+  (void)pdev;
+  (void)dev_addr;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_Transmit(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                    uint8_t *pbuf, uint32_t size)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr | 0x80U);
+
+  (void)pdev;
+  if (ep == NULL)
+  {
+    return USBD_FAIL;
+  }
+  ep->buf = pbuf;
+  ep->len = size;
+  ep->busy = 1;
+  return USBD_OK;
+}
+
+USBD_StatusTypeDef USBD_LL_PrepareReceive(USBD_HandleTypeDef *pdev, uint8_t ep_addr,
+                                          uint8_t *pbuf, uint32_t size)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr & 0x7FU);
+
+  (void)pdev;
+  if (ep == NULL)
+  {
+    return USBD_FAIL;
+  }
+  ep->buf = pbuf;
+  ep->len = size;
+  ep->busy = 1;
+  return USBD_OK;
+}
+
+uint32_t USBD_LL_GetRxDataSize(USBD_HandleTypeDef *pdev, uint8_t ep_addr)
+{
+  host_ep_t *ep = host_usb_ep(ep_addr & 0x7FU);
+
+  (void)pdev;
+  return (ep != NULL) ? ep->rx_size : 0U;
+}
+
+void USBD_LL_Delay(uint32_t Delay)
+{
+  (void)Delay;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file usbd_conf.h
+ * @brief 主机仿真用的 USB Device 库配置（替代 USB_DEVICE/Target/usbd_conf.h）
+ *
+ * 类层参数与目标板保持一致；底层驱动由 usbd_conf.c 中的仿真 PCD 实现，
+ * 协议栈锁（USBD_LL_Lock）映射为一把互斥锁，见 host_usb.h。
+ */
+
+#ifndef __USBD_CONF__H__
+#define __USBD_CONF__H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define USBD_MAX_NUM_INTERFACES     3U
+#define USBD_MAX_NUM_CONFIGURATION  1U
+#define USBD_MAX_STR_DESC_SIZ       512U
+#define USBD_DEBUG_LEVEL            0U
+#define USBD_LPM_ENABLED            0U
+#define USBD_SELF_POWERED           1U
+#define MSC_MEDIA_PACKET            8192U
+#define MSC_BOT_DATA_SIZE           512U
+
+#define DEVICE_FS                   0
+#define DEVICE_HS                   1
+
+#define USBD_malloc                 malloc
+#define USBD_free                   free
+#define USBD_memset                 memset
+#define USBD_memcpy                 memcpy
+#define USBD_Delay(ms)              ((void)(ms))
+
+#define USBD_UsrLog(...)
+#define USBD_ErrLog(...)
+#define USBD_DbgLog(...)
+
+/* 目标板 HAL 中被类层和存储层用到的少量定义 */
+#ifndef UNUSED
+#define UNUSED(X)                   (void)X
+#endif
+#define __STATIC_INLINE             static inline
+#define __DSB()                     __sync_synchronize()
+#define __ISB()                     __sync_synchronize()
+
+void USBD_LL_Lock(void);
+void USBD_LL_Unlock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __USBD_CONF__H__ */
@@ -0,0 +1,1005 @@
+/**
+ * @file test_msc.c
+ * @brief USB MSC 类层主机仿真测试
+ *
+ * 把 usbd_msc*.c、usbd_storage_if.c 和 USB 设备库内核编译到主机上，底层换成仿真 PCD（port/usbd_conf.c），
+ * SD 卡换成镜像文件（port/disk_file.c）。测试线程按 BOT 协议扮演主机：发送 CBW、完成数据阶段、
+ * 处理 STALL 和复位恢复、检查 CSW，覆盖 INQUIRY / READ CAPACITY / READ(10) / WRITE(10) 等命令的
+ * 正常与错误路径、介质弹出与所有权切换、只读诊断盘（LUN 1）的 FAT 镜像、协议栈在 USB 任务中运行（USBD_DEFER_TO_TASK）时存储层的任务上下文分支，并统计类层（协议栈回调 + SCSI_Resume）每扇区的 CPU 开销。
+ *
+ * 用法: test_msc [镜像文件]        默认在 /tmp 下创建临时镜像，结束后删除
+ */
+
+#include "usbd_core.h"
+#include "usbd_msc.h"
+#include "usbd_storage_if.h"
+#include "host_usb.h"
+#include "disk_file.h"
+#include "sd_owner.h"
+#include "diag_disk.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DISK_SECTORS        32768U          /* 16 MB */
+#define WAIT_MS             2000U
+#define PERF_BYTES          (16U * 1024U * 1024U)
+#define PERF_CMD_SECTORS    128U            /* 64 KB，与主机驱动常见的单命令长度一致 */
+
+#define CBW_SIGNATURE       0x43425355U
+#define CSW_SIGNATURE       0x53425355U
+
+enum
+{
+  DIR_NONE = 0,
+  DIR_IN,
+  DIR_OUT
+};
+
+typedef struct
+{
+  uint32_t signature;
+  uint32_t tag;
+  uint32_t residue;
+  uint8_t status;
+  uint8_t stalled_in;       /* 数据阶段 IN 端点被 STALL */
+  uint8_t stalled_out;      /* 数据阶段 OUT 端点被 STALL */
+  uint32_t xferred;         /* 数据阶段实际传输的字节数 */
+} csw_t;
+
+USBD_HandleTypeDef hUsbDeviceFS;
+
+static int failures;
+static int checks;
+static uint32_t cbw_tag = 0x1000U;
+static uint8_t cbw_lun;
+static uint8_t io_buf[PERF_CMD_SECTORS * DISK_FILE_SECTOR];
+static uint8_t ref_buf[PERF_CMD_SECTORS * DISK_FILE_SECTOR];
+
+#define CHECK(cond, ...)                                              \
+  do                                                                  \
+  {                                                                   \
+    checks++;                                                         \
+    if (!(cond))                                                      \
+    {                                                                 \
+      failures++;                                                     \
+      printf("    FAIL %s:%d: ", __FILE__, __LINE__);                 \
+      printf(__VA_ARGS__);                                            \
+      printf("\n");                                                   \
+    }                                                                 \
+  } while (0)
+
+/* ---------------- 主机侧传输 ---------------- */
+
+static int ep_in1_event(void)
+{
+  host_ep_t *in = host_usb_ep(0x81U);
+
+  return in->busy || in->stalled;
+}
+
+static int ep_out1_event(void)
+{
+  host_ep_t *in = host_usb_ep(0x81U);
+  host_ep_t *out = host_usb_ep(0x01U);
+
+  return out->busy || out->stalled || in->busy || in->stalled;
+}
+
+/**
+ * @brief 控制传输
+ * @retval 数据阶段收到的字节数；EP0 STALL 时为 -1
+ */
+static int control(uint8_t bm, uint8_t req, uint16_t value, uint16_t index,
+                   uint16_t length, uint8_t *data)
+{
+  uint8_t setup[8] = {bm, req, (uint8_t)value, (uint8_t)(value >> 8),
+                      (uint8_t)index, (uint8_t)(index >> 8),
+                      (uint8_t)length, (uint8_t)(length >> 8)};
+  host_ep_t *in0 = host_usb_ep(0x80U);
+  host_ep_t *out0 = host_usb_ep(0x00U);
+  int got = 0;
+
+  host_usb_setup(&hUsbDeviceFS, setup);
+  if ((bm & 0x80U) != 0U && length > 0U)
+  {
+    while (in0->busy && !in0->stalled)
+    {
+      uint32_t n = in0->len;
+
+      if (data != NULL && n > 0U && (uint32_t)got + n <= length)
+      {
+        memcpy(data + got, in0->buf, n);
+      }
+      got += (int)n;
+      host_usb_in_done(&hUsbDeviceFS, 0x80U);
+      if (n < 64U)
+      {
+        break;
+      }
+    }
+    if (out0->busy)
+    {
+      host_usb_out_done(&hUsbDeviceFS, 0x00U, 0U);
+    }
+  }
+  else if (in0->busy)
+  {
+    host_usb_in_done(&hUsbDeviceFS, 0x80U);
+  }
+  if (got == 0 && (in0->stalled || out0->stalled))
+  {
+    return -1;
+  }
+  return got;
+}
+
+static void clear_halt(uint8_t ep)
+{
+  control(0x02U, USB_REQ_CLEAR_FEATURE, USB_FEATURE_EP_HALT, ep, 0U, NULL);
+}
+
+/**
+ * @brief BOT 复位恢复：Bulk-Only Mass Storage Reset + 清除两个端点的 HALT
+ */
+static void reset_recovery(void)
+{
+  control(0x21U, BOT_RESET, 0U, 0U, 0U, NULL);
+  clear_halt(0x81U);
+  clear_halt(0x01U);
+}
+
+/**
+ * @brief 执行一条 SCSI 命令
+ * @retval 0 得到有效 CSW；-1 传输层违反 BOT 协议（已打印原因）
+ */
+static int bot_cmd(const uint8_t *cdb, uint8_t cdb_len, int dir, uint8_t *data, uint32_t len, csw_t *csw)
+{
+  host_ep_t *in = host_usb_ep(0x81U);
+  host_ep_t *out = host_usb_ep(0x01U);
+  uint8_t *cbw;
+  uint32_t done = 0;
+  uint32_t n;
+
+  memset(csw, 0, sizeof(*csw));
+
+  /* CBW */
+  if (host_usb_wait(ep_out1_event, WAIT_MS) != 0 || !out->busy || out->stalled || in->busy)
+  {
+    printf("    device not ready for a CBW (out busy %u stalled %u, in busy %u stalled %u)\n",
+           out->busy, out->stalled, in->busy, in->stalled);
+    return -1;
+  }
+  if (out->len < 31U)
+  {
+    printf("    CBW receive armed with %u bytes\n", out->len);
+    return -1;
+  }
+  cbw = out->buf;
+  memset(cbw, 0, 31);
+  cbw_tag++;
+  memcpy(cbw + 0, &(uint32_t){CBW_SIGNATURE}, 4);
+  memcpy(cbw + 4, &cbw_tag, 4);
+  memcpy(cbw + 8, &len, 4);
+  cbw[12] = (dir == DIR_IN) ? 0x80U : 0x00U;
+  cbw[13] = cbw_lun;
+  cbw[14] = cdb_len;
+  memcpy(cbw + 15, cdb, cdb_len);
+  host_usb_out_done(&hUsbDeviceFS, 0x01U, 31U);
+
+  /* 数据阶段 */
+  if (dir == DIR_IN)
+  {
+    while (done < len)
+    {
+      if (host_usb_wait(ep_in1_event, WAIT_MS) != 0)
+      {
+        printf("    timeout in data-in phase after %u/%u bytes\n", done, len);
+        return -1;
+      }
+      if (in->stalled)
+      {
+        csw->stalled_in = 1;
+        break;
+      }
+      n = in->len;
+      if (n > len - done)
+      {
+        printf("    device sent %u bytes with %u expected (babble)\n", n, len - done);
+        return -1;
+      }
+      memcpy(data + done, in->buf, n);
+      done += n;
+      host_usb_in_done(&hUsbDeviceFS, 0x81U);
+      if ((n % 64U) != 0U)
+      {
+        break;      /* 短包结束数据阶段 */
+      }
+    }
+  }
+  else if (dir == DIR_OUT)
+  {
+    while (done < len)
+    {
+      if (host_usb_wait(ep_out1_event, WAIT_MS) != 0)
+      {
+        printf("    timeout in data-out phase after %u/%u bytes\n", done, len);
+        return -1;
+      }
+      if (out->stalled)
+      {
+        csw->stalled_out = 1;
+        break;
+      }
+      if (in->busy || in->stalled)
+      {
+        /* 主机还有数据要发，设备却已经进入状态阶段：剩余数据会被当成下一个 CBW */
+        printf("    device entered the status phase with %u/%u bytes still to send\n", done, len);
+        return -1;
+      }
+      n = (out->len < len - done) ? out->len : (len - done);
+      memcpy(out->buf, data + done, n);
+      done += n;
+      host_usb_out_done(&hUsbDeviceFS, 0x01U, n);
+    }
+  }
+  csw->xferred = done;
+
+  /* 状态阶段 */
+  if (out->stalled)
+  {
+    csw->stalled_out = 1;
+    clear_halt(0x01U);
+  }
+  if (in->stalled)
+  {
+    csw->stalled_in = 1;
+    clear_halt(0x81U);
+  }
+  if (host_usb_wait(ep_in1_event, WAIT_MS) != 0)
+  {
+    printf("    timeout waiting for the CSW\n");
+    return -1;
+  }
+  if (in->stalled)
+  {
+    printf("    CSW pipe stalled again, reset recovery required\n");
+    return -1;
+  }
+  if (in->len != 13U)
+  {
+    printf("    status transfer of %u bytes instead of a 13-byte CSW\n", in->len);
+    host_usb_in_done(&hUsbDeviceFS, 0x81U);
+    return -1;
+  }
+  memcpy(&csw->signature, in->buf + 0, 4);
+  memcpy(&csw->tag, in->buf + 4, 4);
+  memcpy(&csw->residue, in->buf + 8, 4);
+  csw->status = in->buf[12];
+  host_usb_in_done(&hUsbDeviceFS, 0x81U);
+
+  if (csw->signature != CSW_SIGNATURE || csw->tag != cbw_tag)
+  {
+    printf("    bad CSW signature 0x%08x / tag 0x%x (expected 0x%x)\n",
+           csw->signature, csw->tag, cbw_tag);
+    return -1;
+  }
+  return 0;
+}
+
+/* ---------------- SCSI 命令 ---------------- */
+
+static int scsi_simple(uint8_t op, csw_t *csw)
+{
+  uint8_t cdb[6] = {op, 0, 0, 0, 0, 0};
+
+  return bot_cmd(cdb, 6, DIR_NONE, NULL, 0, csw);
+}
+
+static int scsi_rw10(uint8_t op, uint32_t lba, uint16_t blocks, uint8_t *data, uint32_t len, csw_t *csw)
+{
+  uint8_t cdb[10] = {op, 0, (uint8_t)(lba >> 24), (uint8_t)(lba >> 16), (uint8_t)(lba >> 8), (uint8_t)lba,
+                     0, (uint8_t)(blocks >> 8), (uint8_t)blocks, 0};
+
+  return bot_cmd(cdb, 10, (op == SCSI_READ10) ? DIR_IN : DIR_OUT, data, len, csw);
+}
+
+static int scsi_read10(uint32_t lba, uint16_t blocks, uint8_t *data, csw_t *csw)
+{
+  return scsi_rw10(SCSI_READ10, lba, blocks, data, (uint32_t)blocks * DISK_FILE_SECTOR, csw);
+}
+
+static int scsi_write10(uint32_t lba, uint16_t blocks, uint8_t *data, csw_t *csw)
+{
+  return scsi_rw10(SCSI_WRITE10, lba, blocks, data, (uint32_t)blocks * DISK_FILE_SECTOR, csw);
+}
+
+/**
+ * @brief REQUEST SENSE，返回 (sense key << 8) | ASC，失败返回 -1
+ */
+static int scsi_sense(void)
+{
+  uint8_t cdb[6] = {SCSI_REQUEST_SENSE, 0, 0, 0, 18, 0};
+  uint8_t sense[18];
+  csw_t csw;
+
+  if (bot_cmd(cdb, 6, DIR_IN, sense, sizeof(sense), &csw) != 0 || csw.status != 0U)
+  {
+    return -1;
+  }
+  return ((sense[2] & 0x0FU) << 8) | sense[12];
+}
+
+static void fill_pattern(uint8_t *buf, uint32_t lba, uint32_t blocks, uint8_t seed)
+{
+  uint32_t i;
+
+  for (i = 0; i < blocks * DISK_FILE_SECTOR; i++)
+  {
+    buf[i] = (uint8_t)((lba + i / DISK_FILE_SECTOR) * 7U + i * 13U + seed);
+  }
+}
+
+/* ---------------- 设备初始化 ---------------- */
+
+static void device_attach(void)
+{
+  USBD_Init(&hUsbDeviceFS, NULL, DEVICE_FS);
+  USBD_RegisterClass(&hUsbDeviceFS, &USBD_MSC);
+  USBD_MSC_RegisterStorage(&hUsbDeviceFS, &USBD_Storage_Interface_fops_FS);
+  USBD_Start(&hUsbDeviceFS);
+
+  USBD_LL_Reset(&hUsbDeviceFS);
+  USBD_LL_SetSpeed(&hUsbDeviceFS, USBD_SPEED_FULL);
+  control(0x00U, USB_REQ_SET_ADDRESS, 5U, 0U, 0U, NULL);
+  control(0x00U, USB_REQ_SET_CONFIGURATION, 1U, 0U, 0U, NULL);
+}
+
+/* ---------------- 测试 ---------------- */
+
+static void test_enumeration(void)
+{
+  uint8_t max_lun = 0xFF;
+
+  CHECK(hUsbDeviceFS.dev_state == USBD_STATE_CONFIGURED, "device not configured (state %u)",
+        hUsbDeviceFS.dev_state);
+  CHECK(host_usb_ep(0x01U)->busy && host_usb_ep(0x01U)->len == 31U, "CBW receive not armed");
+  CHECK(control(0xA1U, BOT_GET_MAX_LUN, 0U, 0U, 1U, &max_lun) == 1, "GET MAX LUN failed");
+  CHECK(max_lun == 1U, "max LUN %u", max_lun);
+}
+
+static void test_not_ready(void)
+{
+  csw_t csw;
+
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0, "TEST UNIT READY transport");
+  CHECK(csw.status == 1U, "TEST UNIT READY passed before the medium was ready");
+  CHECK(scsi_sense() == ((NOT_READY << 8) | MEDIUM_NOT_PRESENT), "sense after not ready 0x%x", scsi_sense());
+}
+
+static void test_becomes_ready(void)
+{
+  TickType_t start = xTaskGetTickCount();
+  csw_t csw;
+  int ok = 0;
+
+  STORAGE_Start_FS();
+  while (!ok && (xTaskGetTickCount() - start) < 3000U)
+  {
+    if (scsi_simple(SCSI_TEST_UNIT_READY, &csw) != 0)
+    {
+      break;
+    }
+    if (csw.status == 0U)
+    {
+      ok = 1;
+    }
+    else
+    {
+      (void)scsi_sense();
+      host_usb_unlock();
+      vTaskDelay(20);
+      host_usb_lock();
+    }
+  }
+  CHECK(ok, "medium did not become ready");
+}
+
+static void test_inquiry(void)
+{
+  uint8_t cdb[6] = {SCSI_INQUIRY, 0, 0, 0, 96, 0};
+  uint8_t data[96];
+  csw_t csw;
+
+  CHECK(bot_cmd(cdb, 6, DIR_IN, data, 36, &csw) == 0 && csw.status == 0U, "INQUIRY(36) failed");
+  CHECK(csw.xferred == 36U && csw.residue == 0U, "INQUIRY(36) xferred %u residue %u", csw.xferred, csw.residue);
+  CHECK(data[0] == 0x00U && data[1] == 0x80U, "INQUIRY device type 0x%02x rmb 0x%02x", data[0], data[1]);
+  CHECK(memcmp(&data[8], "STM", 3) == 0, "INQUIRY vendor");
+
+  /* 主机分配的长度大于数据：短包结束，残留量为差值 */
+  CHECK(bot_cmd(cdb, 6, DIR_IN, data, 96, &csw) == 0 && csw.status == 0U, "INQUIRY(96) failed");
+  CHECK(csw.xferred == 36U && csw.residue == 60U, "INQUIRY(96) xferred %u residue %u", csw.xferred, csw.residue);
+}
+
+static void test_capacity(void)
+{
+  uint8_t cdb10[10] = {SCSI_READ_CAPACITY10, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  uint8_t cdbfmt[10] = {SCSI_READ_FORMAT_CAPACITIES, 0, 0, 0, 0, 0, 0, 0, 12, 0};
+  uint8_t cdbms[6] = {SCSI_MODE_SENSE6, 0, 0x3F, 0, 192, 0};
+  uint8_t cdbms10[10] = {SCSI_MODE_SENSE10, 0, 0x3F, 0, 0, 0, 0, 0, 192, 0};
+  uint8_t data[192];
+  uint32_t last, size;
+  csw_t csw;
+
+  CHECK(bot_cmd(cdb10, 10, DIR_IN, data, 8, &csw) == 0 && csw.status == 0U, "READ CAPACITY(10) failed");
+  last = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+  size = ((uint32_t)data[4] << 24) | ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 8) | data[7];
+  CHECK(last == DISK_SECTORS - 1U && size == DISK_FILE_SECTOR, "capacity last LBA %u block %u", last, size);
+
+  CHECK(bot_cmd(cdbfmt, 10, DIR_IN, data, 12, &csw) == 0 && csw.status == 0U, "READ FORMAT CAPACITIES failed");
+  CHECK(csw.xferred == 12U && data[3] == 8U, "format capacity list length %u", data[3]);
+
+  CHECK(bot_cmd(cdbms, 6, DIR_IN, data, 192, &csw) == 0 && csw.status == 0U, "MODE SENSE(6) failed");
+  CHECK(csw.xferred >= 4U && csw.xferred == (uint32_t)data[0] + 1U, "MODE SENSE(6) length %u header %u",
+        csw.xferred, data[0]);
+  CHECK(csw.residue == 192U - csw.xferred, "MODE SENSE(6) residue %u", csw.residue);
+
+  CHECK(bot_cmd(cdbms10, 10, DIR_IN, data, 192, &csw) == 0 && csw.status == 0U, "MODE SENSE(10) failed");
+  CHECK(csw.xferred >= 8U && csw.xferred == (((uint32_t)data[0] << 8) | data[1]) + 2U,
+        "MODE SENSE(10) length %u header %u", csw.xferred, ((uint32_t)data[0] << 8) | data[1]);
+}
+
+static void test_write_read(void)
+{
+  static const uint16_t lengths[] = {1, 15, 16, 17, 40, 64};
+  uint32_t lba = 100;
+  uint32_t i;
+  csw_t csw;
+
+  for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++)
+  {
+    uint16_t blocks = lengths[i];
+    uint32_t len = (uint32_t)blocks * DISK_FILE_SECTOR;
+
+    fill_pattern(ref_buf, lba, blocks, (uint8_t)i);
+    CHECK(scsi_write10(lba, blocks, ref_buf, &csw) == 0 && csw.status == 0U && csw.residue == 0U,
+          "WRITE(10) %u blocks at %u: status %u residue %u", blocks, lba, csw.status, csw.residue);
+    CHECK(disk_file_peek(lba, io_buf, blocks) == 0 && memcmp(io_buf, ref_buf, len) == 0,
+          "WRITE(10) %u blocks at %u: media content differs", blocks, lba);
+
+    memset(io_buf, 0, len);
+    CHECK(scsi_read10(lba, blocks, io_buf, &csw) == 0 && csw.status == 0U && csw.residue == 0U,
+          "READ(10) %u blocks at %u: status %u residue %u", blocks, lba, csw.status, csw.residue);
+    CHECK(csw.xferred == len && memcmp(io_buf, ref_buf, len) == 0,
+          "READ(10) %u blocks at %u: data differs", blocks, lba);
+    lba += blocks + 3U;
+  }
+}
+
+static void test_read_sequential(void)
+{
+  uint32_t lba = 4096;
+  uint32_t cmd;
+  csw_t csw;
+
+  for (cmd = 0; cmd < 8U; cmd++)
+  {
+    fill_pattern(ref_buf, lba, PERF_CMD_SECTORS, 0x5A);
+    disk_file_poke(lba, ref_buf, PERF_CMD_SECTORS);
+    CHECK(scsi_read10(lba, PERF_CMD_SECTORS, io_buf, &csw) == 0 && csw.status == 0U,
+          "READ(10) at %u failed", lba);
+    CHECK(memcmp(io_buf, ref_buf, sizeof(ref_buf)) == 0, "READ(10) at %u: data differs", lba);
+    lba += PERF_CMD_SECTORS;
+  }
+}
+
+static void test_invalid_commands(void)
+{
+  uint8_t cdb[10] = {SCSI_READ10, 0, 0, 0, 0, 0, 0, 0, 1, 0};
+  csw_t csw;
+
+  /* 越界读：IN 端点 STALL，清除后 CSW 报告失败，残留量为全部长度 */
+  CHECK(scsi_read10(DISK_SECTORS - 1U, 2, io_buf, &csw) == 0, "out-of-range READ(10) transport");
+  CHECK(csw.status == 1U && csw.stalled_in && csw.residue == 1024U,
+        "out-of-range READ(10): status %u stalled %u residue %u", csw.status, csw.stalled_in, csw.residue);
+  CHECK(scsi_sense() == ((ILLEGAL_REQUEST << 8) | ADDRESS_OUT_OF_RANGE), "sense after out-of-range read");
+
+  /* 越界写：OUT 端点 STALL */
+  CHECK(scsi_write10(DISK_SECTORS, 1, io_buf, &csw) == 0, "out-of-range WRITE(10) transport");
+  CHECK(csw.status == 1U && csw.stalled_out && csw.residue == 512U,
+        "out-of-range WRITE(10): status %u stalled %u residue %u", csw.status, csw.stalled_out, csw.residue);
+  CHECK(scsi_sense() == ((ILLEGAL_REQUEST << 8) | ADDRESS_OUT_OF_RANGE), "sense after out-of-range write");
+
+  /* 主机长度与命令块长度不一致（BOT 第 5 种情况 Hi > Di） */
+  CHECK(bot_cmd(cdb, 10, DIR_IN, io_buf, 1024, &csw) == 0 && csw.status != 0U,
+        "READ(10) with mismatched length accepted");
+  CHECK(scsi_sense() == ((ILLEGAL_REQUEST << 8) | INVALID_CDB), "sense after length mismatch");
+
+  /* 不支持的命令：失败但不需要复位恢复 */
+  CHECK(scsi_simple(0x35U, &csw) == 0 && csw.status == 1U, "unsupported opcode: status %u", csw.status);
+  CHECK(scsi_sense() == ((ILLEGAL_REQUEST << 8) | INVALID_CDB), "sense after unsupported opcode");
+
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0 && csw.status == 0U, "device not usable after errors");
+}
+
+static void test_bad_cbw(void)
+{
+  host_ep_t *out = host_usb_ep(0x01U);
+  host_ep_t *in = host_usb_ep(0x81U);
+  csw_t csw;
+
+  /* 签名错误的 CBW：两个端点都 STALL，直到复位恢复 */
+  memset(out->buf, 0xA5, 31);
+  host_usb_out_done(&hUsbDeviceFS, 0x01U, 31U);
+  CHECK(in->stalled && out->stalled, "invalid CBW: in stalled %u out stalled %u", in->stalled, out->stalled);
+
+  /* 单独清除 HALT 不能解除 */
+  clear_halt(0x81U);
+  CHECK(in->stalled, "invalid CBW: IN stall cleared without reset recovery");
+
+  reset_recovery();
+  CHECK(!in->stalled && !out->stalled, "stall persists after reset recovery");
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0 && csw.status == 0U, "device not usable after reset recovery");
+
+  /* CBW 长度错误 */
+  memset(out->buf, 0, 31);
+  memcpy(out->buf, &(uint32_t){CBW_SIGNATURE}, 4);
+  host_usb_out_done(&hUsbDeviceFS, 0x01U, 30U);
+  CHECK(in->stalled && out->stalled, "short CBW accepted");
+  reset_recovery();
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0 && csw.status == 0U, "device not usable after short CBW");
+}
+
+static void test_media_errors(void)
+{
+  uint32_t lba = 8192;
+  uint32_t blocks = 48;
+  csw_t csw;
+
+  /* 第二个包读失败：已发送第一个包，IN 端点 STALL，CSW 失败，残留量为未发送的部分 */
+  fill_pattern(ref_buf, lba, blocks, 0x11);
+  disk_file_poke(lba, ref_buf, blocks);
+  disk_file_inject_error(lba + 20U);
+  CHECK(scsi_read10(lba, (uint16_t)blocks, io_buf, &csw) == 0, "READ(10) with media error: transport");
+  CHECK(csw.status == 1U && csw.stalled_in, "READ(10) with media error: status %u stalled %u",
+        csw.status, csw.stalled_in);
+  CHECK(csw.residue == blocks * DISK_FILE_SECTOR - csw.xferred, "READ(10) with media error: residue %u xferred %u",
+        csw.residue, csw.xferred);
+  CHECK(memcmp(io_buf, ref_buf, csw.xferred) == 0, "READ(10) with media error: delivered data differs");
+  CHECK(scsi_sense() == ((HARDWARE_ERROR << 8) | UNRECOVERED_READ_ERROR), "sense after read error");
+
+  /* 写失败 */
+  fill_pattern(ref_buf, lba, blocks, 0x22);
+  CHECK(scsi_write10(lba, (uint16_t)blocks, ref_buf, &csw) == 0, "WRITE(10) with media error: transport");
+  CHECK(csw.status == 1U, "WRITE(10) with media error: status %u", csw.status);
+  CHECK(scsi_sense() == ((HARDWARE_ERROR << 8) | WRITE_FAULT), "sense after write error");
+
+  disk_file_inject_error(0xFFFFFFFFU);
+  CHECK(scsi_write10(lba, (uint16_t)blocks, ref_buf, &csw) == 0 && csw.status == 0U, "WRITE(10) after error");
+  CHECK(scsi_read10(lba, (uint16_t)blocks, io_buf, &csw) == 0 && csw.status == 0U &&
+        memcmp(io_buf, ref_buf, blocks * DISK_FILE_SECTOR) == 0, "READ(10) after error");
+}
+
+static void test_prefetch_coherency(void)
+{
+  host_ep_t *in = host_usb_ep(0x81U);
+  uint32_t lba = 12288;
+  uint8_t cdb[10] = {SCSI_READ10, 0, (uint8_t)(lba >> 24), (uint8_t)(lba >> 16), (uint8_t)(lba >> 8),
+                     (uint8_t)lba, 0, 0, 48, 0};
+  uint8_t *cbw;
+  uint32_t len = 48U * DISK_FILE_SECTOR;
+  csw_t csw;
+
+  fill_pattern(ref_buf, lba, 48, 0x33);
+  disk_file_poke(lba, ref_buf, 48);
+
+  /* 主机读完第一个包后放弃命令（复位恢复），存储层留下预读的包 */
+  cbw = host_usb_ep(0x01U)->buf;
+  memset(cbw, 0, 31);
+  cbw_tag++;
+  memcpy(cbw + 0, &(uint32_t){CBW_SIGNATURE}, 4);
+  memcpy(cbw + 4, &cbw_tag, 4);
+  memcpy(cbw + 8, &len, 4);
+  cbw[12] = 0x80U;
+  cbw[14] = 10U;
+  memcpy(cbw + 15, cdb, 10);
+  host_usb_out_done(&hUsbDeviceFS, 0x01U, 31U);
+  CHECK(host_usb_wait(ep_in1_event, WAIT_MS) == 0 && in->busy, "first packet not sent");
+  host_usb_in_done(&hUsbDeviceFS, 0x81U);
+  host_usb_unlock();
+  vTaskDelay(50);           /* 让预读完成 */
+  host_usb_lock();
+  reset_recovery();
+
+  /* 改写预读过、尚未取走的包（第三个包）后再读，必须得到新数据 */
+  fill_pattern(ref_buf, lba + 32U, 16, 0x44);
+  CHECK(scsi_write10(lba + 32U, 16, ref_buf, &csw) == 0 && csw.status == 0U, "WRITE(10) over prefetched data");
+  CHECK(scsi_read10(lba + 32U, 16, io_buf, &csw) == 0 && csw.status == 0U, "READ(10) of rewritten data");
+  CHECK(memcmp(io_buf, ref_buf, 16U * DISK_FILE_SECTOR) == 0, "stale prefetched data returned after a write");
+}
+
+static void reconfigure(void)
+{
+  control(0x00U, USB_REQ_SET_CONFIGURATION, 0U, 0U, 0U, NULL);
+  CHECK(!sd_owner_usb_active(), "medium still owned by USB after the configuration was dropped");
+  control(0x00U, USB_REQ_SET_CONFIGURATION, 1U, 0U, 0U, NULL);
+  CHECK(sd_owner_usb_active(), "medium not requested after reconfiguration");
+}
+
+static void test_eject(void)
+{
+  host_ep_t *in = host_usb_ep(0x81U);
+  uint8_t eject[6] = {SCSI_START_STOP_UNIT, 0, 0, 0, 0x02U, 0};
+  uint32_t len = 48U * DISK_FILE_SECTOR;
+  uint8_t *cbw;
+  csw_t csw;
+  int i;
+
+  /* 主机弹出介质：所有权交回固件，之后的命令报告介质不在位 */
+  CHECK(bot_cmd(eject, 6, DIR_NONE, NULL, 0, &csw) == 0 && csw.status == 0U, "START STOP UNIT (eject)");
+  CHECK(!sd_owner_usb_active(), "medium still owned by USB after eject");
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0 && csw.status == 1U, "TEST UNIT READY passed after eject");
+  CHECK(scsi_sense() == ((NOT_READY << 8) | MEDIUM_NOT_PRESENT), "sense after eject");
+  CHECK(scsi_read10(0, 1, io_buf, &csw) == 0 && csw.status == 1U, "READ(10) passed after eject");
+  (void)scsi_sense();
+
+  reconfigure();
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0 && csw.status == 0U, "TEST UNIT READY after reconfiguration");
+
+  /* 读命令进行中介质被交回固件：不再发起新的读，数据阶段以 STALL 结束 */
+  cbw = host_usb_ep(0x01U)->buf;
+  memset(cbw, 0, 31);
+  cbw_tag++;
+  memcpy(cbw + 0, &(uint32_t){CBW_SIGNATURE}, 4);
+  memcpy(cbw + 4, &cbw_tag, 4);
+  memcpy(cbw + 8, &len, 4);
+  cbw[12] = 0x80U;
+  cbw[14] = 10U;
+  cbw[15] = SCSI_READ10;
+  cbw[23] = 48U;
+  host_usb_out_done(&hUsbDeviceFS, 0x01U, 31U);
+  CHECK(host_usb_wait(ep_in1_event, WAIT_MS) == 0 && in->busy, "first packet not sent");
+  sd_owner_usb_detach();
+  host_usb_in_done(&hUsbDeviceFS, 0x81U);
+  CHECK(in->stalled, "data phase continued after the medium was released");
+
+  /* 已发起的预读完成后存储层空闲，固件才能重新挂载 */
+  for (i = 0; i < 100 && STORAGE_Busy_FS(); i++)
+  {
+    host_usb_unlock();
+    vTaskDelay(10);
+    host_usb_lock();
+  }
+  CHECK(!STORAGE_Busy_FS(), "storage still busy after the medium was released");
+  reset_recovery();
+
+  reconfigure();
+  fill_pattern(ref_buf, 100, 16, 0x55);
+  CHECK(scsi_write10(100, 16, ref_buf, &csw) == 0 && csw.status == 0U, "WRITE(10) after handover");
+  CHECK(scsi_read10(100, 16, io_buf, &csw) == 0 && csw.status == 0U &&
+        memcmp(io_buf, ref_buf, 16U * DISK_FILE_SECTOR) == 0, "READ(10) after handover");
+}
+
+/* 协议栈在 USB 任务中运行（USBD_DEFER_TO_TASK）：存储层回调走任务上下文的分支 */
+static void test_task_context(void)
+{
+  host_usb_set_task_context(1);
+  test_write_read();
+  test_read_sequential();
+  test_prefetch_coherency();
+  host_usb_set_task_context(0);
+}
+
+/* ---------------- 诊断盘 ---------------- */
+
+#define DIAG_PATTERN_SIZE   20000U
+
+static uint32_t diag_updates;
+static char diag_text[2048];
+static uint32_t diag_text_len;
+static uint8_t diag_root[16384];
+static uint8_t diag_fat[64 * DISK_FILE_SECTOR];
+
+static uint32_t diag_text_update(void)
+{
+  uint32_t k;
+
+  diag_updates++;
+  diag_text_len = 0;
+  for (k = 0; k < diag_updates * 30U; k++)
+  {
+    diag_text_len += (uint32_t)snprintf(&diag_text[diag_text_len], sizeof(diag_text) - diag_text_len,
+                                        "snapshot %u line %u\r\n", diag_updates, k);
+  }
+  return diag_text_len;
+}
+
+static void diag_text_read(uint32_t offset, uint8_t *buf, uint32_t len)
+{
+  memcpy(buf, &diag_text[offset], len);
+}
+
+static uint32_t diag_pattern_update(void)
+{
+  return DIAG_PATTERN_SIZE;
+}
+
+static void diag_pattern_read(uint32_t offset, uint8_t *buf, uint32_t len)
+{
+  uint32_t i;
+
+  for (i = 0; i < len; i++)
+  {
+    buf[i] = (uint8_t)((offset + i) * 7U + 3U);
+  }
+}
+
+static const diag_file_t diag_text_file = {"stats.txt", sizeof(diag_text), diag_text_update, diag_text_read};
+static const diag_file_t diag_pattern_file = {"pattern.bin", DIAG_PATTERN_SIZE, diag_pattern_update, diag_pattern_read};
+
+static uint16_t le16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief 像主机文件系统驱动一样解析 FAT16 镜像读出一个文件
+ * @retval 文件长度；-1 读取失败或找不到
+ */
+static int diag_read_file(const char *name83, uint8_t *out, uint32_t max)
+{
+  uint8_t boot[DISK_FILE_SECTOR];
+  uint32_t root_start, data_start, fat_secs, size, done, cluster, i;
+  uint8_t *d = NULL;
+  csw_t csw;
+
+  if (scsi_read10(0, 1, boot, &csw) != 0 || csw.status != 0U)
+  {
+    return -1;
+  }
+  fat_secs = le16(&boot[22]);
+  root_start = le16(&boot[14]) + boot[16] * fat_secs;
+  data_start = root_start + le16(&boot[17]) * 32U / DISK_FILE_SECTOR;
+  if (boot[13] != 1U || fat_secs > sizeof(diag_fat) / DISK_FILE_SECTOR ||
+      data_start - root_start > sizeof(diag_root) / DISK_FILE_SECTOR)
+  {
+    return -1;
+  }
+  if (scsi_read10(root_start, (uint16_t)(data_start - root_start), diag_root, &csw) != 0 || csw.status != 0U ||
+      scsi_read10(le16(&boot[14]), (uint16_t)fat_secs, diag_fat, &csw) != 0 || csw.status != 0U)
+  {
+    return -1;
+  }
+  for (i = 0; i < (data_start - root_start) * DISK_FILE_SECTOR / 32U; i++)
+  {
+    if (memcmp(&diag_root[i * 32U], name83, 11) == 0)
+    {
+      d = &diag_root[i * 32U];
+      break;
+    }
+  }
+  if (d == NULL || (d[11] & 0x01U) == 0U)
+  {
+    return -1;
+  }
+  size = le32(&d[28]);
+  cluster = le16(&d[26]);
+  for (done = 0; done < size; done += DISK_FILE_SECTOR)
+  {
+    if (cluster < 2U || cluster >= 0xFFF8U || done + DISK_FILE_SECTOR > max + DISK_FILE_SECTOR - 1U ||
+        scsi_read10(data_start + cluster - 2U, 1, out + done, &csw) != 0 || csw.status != 0U)
+    {
+      return -1;
+    }
+    cluster = le16(&diag_fat[cluster * 2U]);
+  }
+  if (cluster < 0xFFF8U)
+  {
+    return -1;      /* 链长与文件长度不符 */
+  }
+  return (int)size;
+}
+
+static void test_diag_lun(void)
+{
+  uint8_t inquiry[6] = {SCSI_INQUIRY, 0, 0, 0, 36, 0};
+  uint8_t cap[10] = {SCSI_READ_CAPACITY10, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  uint8_t ms6[6] = {SCSI_MODE_SENSE6, 0, 0x3F, 0, 192, 0};
+  uint8_t eject[6] = {SCSI_START_STOP_UNIT, 0, 0, 0, 0x02U, 0};
+  uint8_t load[6] = {SCSI_START_STOP_UNIT, 0, 0, 0, 0x03U, 0};
+  uint8_t data[192];
+  uint32_t i;
+  int size;
+  csw_t csw;
+
+  cbw_lun = 1U;
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0 && csw.status == 0U, "diag TEST UNIT READY");
+  CHECK(bot_cmd(inquiry, 6, DIR_IN, data, 36, &csw) == 0 && csw.status == 0U &&
+        memcmp(&data[16], "Diagnostics", 11) == 0, "diag INQUIRY product");
+  CHECK(bot_cmd(cap, 10, DIR_IN, data, 8, &csw) == 0 && csw.status == 0U, "diag READ CAPACITY(10)");
+  CHECK(((uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3]) ==
+        DIAG_DISK_SECTORS - 1U, "diag capacity");
+  CHECK(bot_cmd(ms6, 6, DIR_IN, data, 192, &csw) == 0 && csw.status == 0U && (data[2] & 0x80U) != 0U,
+        "diag MODE SENSE(6) without the write-protect bit");
+
+  /* 目录和文件内容来自同一次快照 */
+  CHECK(scsi_read10(0, 1, io_buf, &csw) == 0 && csw.status == 0U &&
+        io_buf[510] == 0x55U && io_buf[511] == 0xAAU && memcmp(&io_buf[54], "FAT16", 5) == 0, "diag boot sector");
+  size = diag_read_file("STATS   TXT", io_buf, sizeof(io_buf));
+  CHECK(size == (int)diag_text_len && memcmp(io_buf, diag_text, diag_text_len) == 0 &&
+        memcmp(io_buf, "snapshot 1 ", 11) == 0, "stats.txt content (size %d)", size);
+  size = diag_read_file("PATTERN BIN", io_buf, sizeof(io_buf));
+  for (i = 0; size == (int)DIAG_PATTERN_SIZE && i < DIAG_PATTERN_SIZE; i++)
+  {
+    if (io_buf[i] != (uint8_t)(i * 7U + 3U))
+    {
+      break;
+    }
+  }
+  CHECK(size == (int)DIAG_PATTERN_SIZE && i == DIAG_PATTERN_SIZE, "pattern.bin content (size %d, first bad byte %u)",
+        size, i);
+  CHECK(diag_updates == 1U, "%u snapshots while the medium stayed loaded", diag_updates);
+
+  /* 只读，写命令在数据阶段前被拒绝 */
+  CHECK(scsi_write10(100, 1, ref_buf, &csw) == 0 && csw.status == 1U, "WRITE(10) to the diag LUN passed");
+  CHECK(scsi_sense() == ((NOT_READY << 8) | WRITE_PROTECTED), "sense after write to the diag LUN");
+
+  /* 容量按 LUN 检查：诊断盘越界，SD 卡同一地址仍然有效 */
+  CHECK(scsi_read10(DIAG_DISK_SECTORS, 1, io_buf, &csw) == 0 && csw.status == 1U, "diag READ(10) past the end");
+  CHECK(scsi_sense() == ((ILLEGAL_REQUEST << 8) | ADDRESS_OUT_OF_RANGE), "sense after diag read past the end");
+  cbw_lun = 0U;
+  CHECK(scsi_read10(DIAG_DISK_SECTORS + 16U, 8, io_buf, &csw) == 0 && csw.status == 0U,
+        "SD READ(10) beyond the diag capacity");
+  CHECK(bot_cmd(ms6, 6, DIR_IN, data, 192, &csw) == 0 && csw.status == 0U && (data[2] & 0x80U) == 0U,
+        "SD MODE SENSE(6) reports write protect");
+
+  /* 两个 LUN 交替读：预读缓冲区不能串到另一个 LUN */
+  fill_pattern(ref_buf, 100, 16, 0x55);
+  cbw_lun = 1U;
+  CHECK(scsi_read10(0, 16, io_buf, &csw) == 0 && csw.status == 0U && io_buf[510] == 0x55U, "diag READ(10) lba 0");
+  cbw_lun = 0U;
+  CHECK(scsi_read10(100, 16, io_buf, &csw) == 0 && csw.status == 0U &&
+        memcmp(io_buf, ref_buf, 16U * DISK_FILE_SECTOR) == 0, "SD READ(10) after a diag read");
+  cbw_lun = 1U;
+  CHECK(scsi_read10(0, 16, io_buf, &csw) == 0 && csw.status == 0U && io_buf[510] == 0x55U && io_buf[511] == 0xAAU,
+        "diag READ(10) after an SD read");
+
+  /* 弹出只影响诊断盘；重新装入后生成新的快照 */
+  CHECK(bot_cmd(eject, 6, DIR_NONE, NULL, 0, &csw) == 0 && csw.status == 0U, "diag eject");
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0 && csw.status == 1U, "diag ready after eject");
+  (void)scsi_sense();
+  cbw_lun = 0U;
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0 && csw.status == 0U, "SD not ready after the diag eject");
+  CHECK(sd_owner_usb_active(), "SD medium released by the diag eject");
+  cbw_lun = 1U;
+  CHECK(bot_cmd(load, 6, DIR_NONE, NULL, 0, &csw) == 0 && csw.status == 0U, "diag load");
+  CHECK(scsi_simple(SCSI_TEST_UNIT_READY, &csw) == 0 && csw.status == 0U, "diag not ready after load");
+  size = diag_read_file("STATS   TXT", io_buf, sizeof(io_buf));
+  CHECK(diag_updates == 2U && size == (int)diag_text_len && memcmp(io_buf, "snapshot 2 ", 11) == 0 &&
+        memcmp(io_buf, diag_text, diag_text_len) == 0, "stats.txt after reload (size %d, %u snapshots)",
+        size, diag_updates);
+  cbw_lun = 0U;
+}
+
+static void test_perf(void)
+{
+  uint32_t sectors = PERF_BYTES / DISK_FILE_SECTOR;
+  uint32_t lba;
+  uint64_t rd_cycles, wr_cycles;
+  uint32_t rd_calls, wr_calls;
+  csw_t csw;
+
+  host_usb_reset_stats();
+  for (lba = 0; lba < sectors; lba += PERF_CMD_SECTORS)
+  {
+    if (scsi_read10(lba, PERF_CMD_SECTORS, io_buf, &csw) != 0 || csw.status != 0U)
+    {
+      CHECK(0, "perf READ(10) at %u failed", lba);
+      return;
+    }
+  }
+  rd_cycles = host_usb_class_cycles();
+  rd_calls = host_usb_class_calls();
+
+  host_usb_reset_stats();
+  for (lba = 0; lba < sectors; lba += PERF_CMD_SECTORS)
+  {
+    if (scsi_write10(lba, PERF_CMD_SECTORS, io_buf, &csw) != 0 || csw.status != 0U)
+    {
+      CHECK(0, "perf WRITE(10) at %u failed", lba);
+      return;
+    }
+  }
+  wr_cycles = host_usb_class_cycles();
+  wr_calls = host_usb_class_calls();
+
+  printf("    class layer, %u KB per command, MSC_MEDIA_PACKET %u:\n",
+         PERF_CMD_SECTORS * DISK_FILE_SECTOR / 1024U, MSC_MEDIA_PACKET);
+  printf("      READ(10):  %6.1f %s/sector, %.3f entries/sector\n",
+         (double)rd_cycles / sectors, host_cycles_unit(), (double)rd_calls / sectors);
+  printf("      WRITE(10): %6.1f %s/sector, %.3f entries/sector\n",
+         (double)wr_cycles / sectors, host_cycles_unit(), (double)wr_calls / sectors);
+}
+
+typedef struct
+{
+  const char *name;
+  void (*fn)(void);
+} test_case_t;
+
+static const test_case_t tests[] =
+{
+  {"enumeration", test_enumeration},
+  {"not ready", test_not_ready},
+  {"becomes ready", test_becomes_ready},
+  {"inquiry", test_inquiry},
+  {"capacity", test_capacity},
+  {"write/read", test_write_read},
+  {"sequential read", test_read_sequential},
+  {"invalid commands", test_invalid_commands},
+  {"invalid CBW", test_bad_cbw},
+  {"media errors", test_media_errors},
+  {"prefetch coherency", test_prefetch_coherency},
+  {"eject", test_eject},
+  {"diagnostics LUN", test_diag_lun},
+  {"task context", test_task_context},
+  {"class layer cost", test_perf},
+};
+
+int main(int argc, char **argv)
+{
+  char tmp_path[] = "/tmp/test_msc_XXXXXX";
+  const char *path = tmp_path;
+  uint32_t i;
+  int fd;
+
+  if (argc > 1)
+  {
+    path = argv[1];
+  }
+  else
+  {
+    fd = mkstemp(tmp_path);
+    if (fd < 0)
+    {
+      perror("mkstemp");
+      return 2;
+    }
+    close(fd);
+  }
+  if (disk_file_open(path, DISK_SECTORS) != 0)
+  {
+    perror(path);
+    return 2;
+  }
+
+  diag_disk_register(&diag_text_file);
+  diag_disk_register(&diag_pattern_file);
+
+  host_usb_lock();
+  device_attach();
+  for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+  {
+    int before = failures;
+
+    printf("%-20s\n", tests[i].name);
+    tests[i].fn();
+    printf("  %s\n", (failures == before) ? "ok" : "FAILED");
+  }
+  host_usb_unlock();
+
+  disk_file_close();
+  if (path == tmp_path)
+  {
+    unlink(tmp_path);
+  }
+  printf("%d checks, %d failed\n", checks, failures);
+  return failures ? 1 : 0;
+}
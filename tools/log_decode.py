@@ -0,0 +1,278 @@
+#!/usr/bin/env python3
+"""Decode tokenized firmware logs (Core/Inc/log.h, LOG_TOKENIZED=1).
+
+The firmware writes binary records instead of formatted text:
+
+    uint8 0xA5, uint8 total_length, uint16 id, uint32 timestamp_us, args...
+
+The id is the offset of a dictionary entry in the .log_dict section of the
+firmware ELF. Each entry is "level\\x1ffile\\x1fline\\x1fformat\\0". Arguments
+are packed in call order: integers as 4 bytes (8 for long long), floating
+point as an 8-byte double, strings as a 1-byte length plus the bytes.
+The decoder walks the format string to know which argument comes next.
+
+Timestamps are the low 32 bits of the microsecond clock and wrap every ~71
+minutes. Anchor records (id 0xFFFF) carry the high 32 bits and the RTC time
+of day. The decoder uses them, plus wrap detection, to rebuild the full
+count. With --wall, each record is printed in RTC time, measured from the
+latest anchor.
+
+Plain text on the same stream, such as printf output or a boot banner, is
+passed through unchanged. A byte sequence is taken as a record only if its
+length, id and arguments are consistent. Otherwise the decoder emits the
+0xA5 byte as text and resynchronises on the next one.
+
+Usage:
+    log_decode.py --elf firmware.elf capture.bin      # raw UART capture or log.bin
+    log_decode.py --elf firmware.elf --port /dev/ttyUSB0 [--baud 115200]
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+SYNC = 0xA5
+ANCHOR_ID = 0xFFFF
+HEAD = struct.Struct("<BBHI")
+
+# %[flags][width][.precision][length]conversion
+CONV = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXcsfFeEgGaAp%])")
+
+
+def read_dict(path):
+    """Return the raw bytes of the .log_dict section of an ELF file."""
+    with open(path, "rb") as f:
+        elf = f.read()
+    if elf[:4] != b"\x7fELF":
+        sys.exit(f"{path}: not an ELF file")
+    is64 = elf[4] == 2
+    endian = "<" if elf[5] == 1 else ">"
+    if is64:
+        shoff, = struct.unpack_from(endian + "Q", elf, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x3A)
+        sh = struct.Struct(endian + "IIQQQQIIQQ")
+    else:
+        shoff, = struct.unpack_from(endian + "I", elf, 0x20)
+        shentsize, shnum, shstrndx = struct.unpack_from(endian + "HHH", elf, 0x2E)
+        sh = struct.Struct(endian + "IIIIIIIIII")
+    sections = [sh.unpack_from(elf, shoff + i * shentsize) for i in range(shnum)]
+    names_off, names_size = sections[shstrndx][4], sections[shstrndx][5]
+    names = elf[names_off:names_off + names_size]
+    for sec in sections:
+        name = names[sec[0]:names.index(b"\0", sec[0])].decode()
+        if name == ".log_dict":
+            return elf[sec[4]:sec[4] + sec[5]]
+    sys.exit(f"{path}: no .log_dict section (built without LOG_TOKENIZED?)")
+
+
+def parse_dict(data):
+    """Map entry offset -> (level, file, line, format)."""
+    entries = {}
+    pos = 0
+    while pos < len(data):
+        if data[pos] == 0:          # alignment padding between entries
+            pos += 1
+            continue
+        end = data.index(b"\0", pos)
+        fields = data[pos:end].decode("utf-8", "replace").split("\x1f", 3)
+        if len(fields) == 4:
+            level, path, line, fmt = fields
+            entries[pos] = (level, path.replace("\\", "/").rsplit("/", 1)[-1], line, fmt)
+        pos = end + 1
+    return entries
+
+
+def format_args(fmt, args):
+    """Consume packed arguments according to fmt. Returns (text, bytes used, truncated)."""
+    out = []
+    pos = 0
+    last = 0
+    truncated = False
+
+    def take(size, code):
+        nonlocal pos
+        if pos + size > len(args):
+            raise EOFError
+        value = struct.unpack_from(code, args, pos)[0]
+        pos += size
+        return value
+
+    for m in CONV.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.end()
+        flags, width, prec, length, conv = m.groups()
+        if conv == "%":
+            out.append("%")
+            continue
+        try:
+            if width == "*":
+                width = str(take(4, "<i"))
+            if prec == "*":
+                prec = str(take(4, "<i"))
+            spec = "%" + flags + (width or "") + ("." + prec if prec else "")
+            if conv == "s":
+                if pos >= len(args):
+                    raise EOFError
+                n = args[pos]
+                if pos + 1 + n > len(args):
+                    raise EOFError
+                text = args[pos + 1:pos + 1 + n].decode("utf-8", "replace")
+                pos += 1 + n
+                out.append((spec + "s") % text)
+            elif conv in "fFeEgGaA":
+                value = take(8, "<d")
+                out.append((spec + ("e" if conv in "aA" else conv)) % value)
+            elif conv == "p":
+                out.append("0x%08x" % take(4, "<I"))
+            else:
+                wide = length in ("ll", "j")
+                if conv in "di":
+                    value = take(8, "<q") if wide else take(4, "<i")
+                    out.append((spec + "d") % value)
+                elif conv == "c":
+                    out.append((spec + "c") % chr(take(4, "<I") & 0xFF))
+                else:
+                    value = take(8, "<Q") if wide else take(4, "<I")
+                    out.append((spec + ("d" if conv == "u" else conv)) % value)
+        except EOFError:
+            truncated = True
+            break
+    if truncated:
+        out.append(" <truncated>")
+    else:
+        out.append(fmt[last:])
+    return "".join(out), pos, truncated
+
+
+class Clock:
+    """Extends 32-bit record timestamps and converts them to RTC time."""
+
+    def __init__(self, wall):
+        self.wall = wall
+        self.high = 0
+        self.last = None
+        self.anchor = None          # (us, seconds of day)
+
+    def extend(self, low):
+        if self.last is not None and low < self.last:
+            self.high += 1
+        self.last = low
+        return (self.high << 32) | low
+
+    def set_anchor(self, low, high, rtc):
+        self.high = high
+        self.last = low
+        us = (high << 32) | low
+        try:
+            h, m, rest = rtc.split(":")
+            self.anchor = (us, int(h) * 3600 + int(m) * 60 + float(rest))
+        except ValueError:
+            self.anchor = None
+        return us
+
+    def stamp(self, us):
+        if self.wall and self.anchor is not None:
+            t = (self.anchor[1] + (us - self.anchor[0]) / 1e6) % 86400
+            return "%02d:%02d:%09.6f" % (t // 3600, t % 3600 // 60, t % 60)
+        return "%6d.%06d" % (us // 1000000, us % 1000000)
+
+
+def try_anchor(buf, pos, length, clock):
+    """Decode an anchor record: uint32 high word, length-prefixed RTC string."""
+    if length < HEAD.size + 5:
+        return None
+    low, = struct.unpack_from("<I", buf, pos + 4)
+    high, n = struct.unpack_from("<IB", buf, pos + HEAD.size)
+    if HEAD.size + 5 + n != length:
+        return None
+    rtc = buf[pos + HEAD.size + 5:pos + length].decode("ascii", "replace")
+    us = clock.set_anchor(low, high, rtc)
+    return "[%s][T] rtc %s" % (clock.stamp(us), rtc), length
+
+
+def try_record(buf, pos, entries, clock):
+    """Decode one record at pos. Returns (line, length) or None."""
+    if pos + HEAD.size > len(buf):
+        return None
+    sync, length, rid, ts = HEAD.unpack_from(buf, pos)
+    if sync != SYNC or length < HEAD.size or pos + length > len(buf):
+        return None
+    if rid == ANCHOR_ID:
+        return try_anchor(buf, pos, length, clock)
+    if rid not in entries:
+        return None
+    level, path, line, fmt = entries[rid]
+    text, used, truncated = format_args(fmt, buf[pos + HEAD.size:pos + length])
+    if used != length - HEAD.size and not truncated:
+        return None
+    text = text.rstrip("\r\n")
+    return "[%s][%s][%s:%s] %s" % (clock.stamp(clock.extend(ts)), level, path, line, text), length
+
+
+def decode(buf, entries, clock, emit, final):
+    """Decode as much of buf as possible. Returns the number of bytes consumed."""
+    pos = 0
+    text_start = 0
+    while True:
+        nxt = buf.find(bytes([SYNC]), pos)
+        if nxt < 0:
+            pos = len(buf)
+            break
+        # An incomplete record at the end waits for more data unless this is the end of the input
+        if not final and nxt + max(HEAD.size, buf[nxt + 1] if nxt + 1 < len(buf) else 0xFF) > len(buf):
+            pos = nxt
+            break
+        rec = try_record(buf, nxt, entries, clock)
+        if rec is None:
+            pos = nxt + 1
+            continue
+        if nxt > text_start:
+            emit(buf[text_start:nxt].decode("utf-8", "replace"))
+        emit(rec[0] + "\n")
+        pos = text_start = nxt + rec[1]
+    if pos > text_start:
+        emit(buf[text_start:pos].decode("utf-8", "replace"))
+    return pos
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--elf", required=True, help="firmware ELF built with LOG_TOKENIZED=1")
+    ap.add_argument("--port", help="read from this serial port instead of a file")
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--wall", action="store_true", help="print RTC time of day instead of time since boot")
+    ap.add_argument("input", nargs="?", help="capture file ('-' for stdin)")
+    args = ap.parse_args(argv)
+
+    entries = parse_dict(read_dict(args.elf))
+    clock = Clock(args.wall)
+
+    def emit(text):
+        sys.stdout.write(text)
+        sys.stdout.flush()
+
+    if args.port:
+        try:
+            import serial
+        except ImportError:
+            sys.exit("pyserial is required for --port: pip install pyserial")
+        port = serial.Serial(args.port, args.baud, timeout=0.1)
+        pending = b""
+        try:
+            while True:
+                pending += port.read(4096)
+                pending = pending[decode(pending, entries, clock, emit, False):]
+        except KeyboardInterrupt:
+            pass
+        return 0
+
+    if not args.input:
+        ap.error("give a capture file or --port")
+    src = sys.stdin.buffer if args.input == "-" else open(args.input, "rb")
+    decode(src.read(), entries, clock, emit, True)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Decode binary capture files written by the firmware recorder (Core/Src/recorder.c).
+
+Each file is a sequence of fixed-size blocks. Every block starts with a
+32-byte header whose first word is the sync marker "REC1", followed by
+record_count fixed-size records:
+
+    uint32 timestamp_us, uint16 type, uint16 length, uint8 payload[N]
+
+Blocks that fail validation (stale pre-allocated space after a power cut,
+torn writes) are skipped by scanning forward sector by sector for the
+next sync marker.
+
+Usage:
+    recorder_decode.py [--csv out.csv] [--summary] rec_0000.bin [rec_0001.bin ...]
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+SYNC_WORD = 0x31434552
+FORMAT_VERSION = 1
+SECTOR_SIZE = 512
+HEADER = struct.Struct("<IHHHHIIIII")
+RECORD_HEAD = struct.Struct("<IHH")
+
+
+def iter_blocks(data):
+    """Yield (offset, header dict, block bytes) for every valid block."""
+    pos = 0
+    while pos + HEADER.size <= len(data):
+        fields = HEADER.unpack_from(data, pos)
+        (sync, version, header_size, record_size, record_count,
+         block_size, block_seq, file_index, dropped, _reserved) = fields
+        valid = (sync == SYNC_WORD and version == FORMAT_VERSION
+                 and header_size == HEADER.size
+                 and record_size > RECORD_HEAD.size
+                 and block_size % SECTOR_SIZE == 0
+                 and header_size + record_count * record_size <= block_size
+                 and pos + block_size <= len(data))
+        if not valid:
+            pos += SECTOR_SIZE
+            continue
+        yield pos, {
+            "record_size": record_size,
+            "record_count": record_count,
+            "block_size": block_size,
+            "block_seq": block_seq,
+            "file_index": file_index,
+            "dropped": dropped,
+        }, data[pos:pos + block_size]
+        pos += block_size
+
+
+def iter_records(hdr, block):
+    size = hdr["record_size"]
+    base = HEADER.size
+    for i in range(hdr["record_count"]):
+        off = base + i * size
+        ts, rtype, length = RECORD_HEAD.unpack_from(block, off)
+        payload = block[off + RECORD_HEAD.size:off + size]
+        yield ts, rtype, payload[:min(length, len(payload))]
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("files", nargs="+", help="capture files in order")
+    ap.add_argument("--csv", help="write records to this CSV file ('-' for stdout)")
+    ap.add_argument("--summary", action="store_true", help="print block/record statistics")
+    args = ap.parse_args(argv)
+
+    out = None
+    writer = None
+    if args.csv:
+        out = sys.stdout if args.csv == "-" else open(args.csv, "w", newline="")
+        writer = csv.writer(out)
+        writer.writerow(["file_index", "block_seq", "timestamp_us", "type", "payload_hex"])
+
+    blocks = records = gaps = 0
+    last_seq = None
+    last_dropped = 0
+    for path in args.files:
+        with open(path, "rb") as f:
+            data = f.read()
+        for _off, hdr, block in iter_blocks(data):
+            if last_seq is not None and hdr["block_seq"] != last_seq + 1:
+                gaps += 1
+                print("%s: block sequence gap %d -> %d" % (path, last_seq, hdr["block_seq"]),
+                      file=sys.stderr)
+            last_seq = hdr["block_seq"]
+            last_dropped = hdr["dropped"]
+            blocks += 1
+            for ts, rtype, payload in iter_records(hdr, block):
+                records += 1
+                if writer:
+                    writer.writerow([hdr["file_index"], hdr["block_seq"], ts, rtype, payload.hex()])
+
+    if out and out is not sys.stdout:
+        out.close()
+    if args.summary or not writer:
+        print("blocks: %d  records: %d  sequence gaps: %d  dropped (device): %d"
+              % (blocks, records, gaps, last_dropped))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""Convert a FreeRTOS scheduling trace (Core/Inc/rtos_trace.h) to a timeline.
+
+The firmware exports the trace as trace.bin on the diagnostics disk, writes it
+to the SD card with the "trace save" command, or prints it with "trace dump"
+as hex lines between "trace begin <bytes>" and "trace end". This script reads
+either form (a UART capture may contain other log lines around the dump) and
+writes Chrome trace-event JSON. Open it in https://ui.perfetto.dev or
+chrome://tracing.
+
+File layout, little endian:
+
+    header   magic "RTRC", version, header_size, timer_hz, event_count,
+             dropped, task_count, task_entry_size, marker_count,
+             marker_entry_size
+    tasks    uint16 number, uint8 priority, uint8 reserved, char name[16]
+    markers  uint8 id, char name[15]
+    events   uint32 timestamp_us, uint8 type, uint8 arg8, uint16 arg16
+
+Timestamps are the low 32 bits of the microsecond clock. They are extended
+across wraps and shown relative to the first event.
+
+Timeline rows: one per task (run slices from switch-in to switch-out), one
+per interrupt, and instant events for queue operations, delays and user
+marks. User begin/end pairs become async slices, one track per marker, since
+a span can end in a different context than it began (the LCD flush ends in
+the DMA interrupt).
+
+Usage:
+    trace_export.py trace.bin -o trace.json
+    trace_export.py uart_capture.log -o trace.json
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+MAGIC = 0x43525452
+HEADER = struct.Struct("<IHHIIIHHHH")
+EVENT = struct.Struct("<IBBH")
+
+TASK_IN, TASK_OUT, TASK_READY, TASK_DELAY = 1, 2, 3, 4
+ISR_ENTER, ISR_EXIT = 5, 6
+QUEUE_EVENTS = {
+    7: "send",
+    8: "receive",
+    9: "send (ISR)",
+    10: "receive (ISR)",
+    11: "block on send",
+    12: "block on receive",
+}
+USER_BEGIN, USER_END, USER_MARK = 13, 14, 15
+
+QUEUE_TYPES = {
+    0: "queue",
+    1: "mutex",
+    2: "counting semaphore",
+    3: "binary semaphore",
+    4: "recursive mutex",
+}
+
+# Cortex-M4 system exceptions; interrupts are 16 + IRQn
+EXCEPTIONS = {
+    2: "NMI", 3: "HardFault", 4: "MemManage", 5: "BusFault", 6: "UsageFault",
+    11: "SVCall", 12: "DebugMon", 14: "PendSV", 15: "SysTick",
+}
+# IRQn of the interrupts the firmware instruments
+IRQ_NAMES = {
+    37: "USART1", 49: "SDIO", 28: "TIM2", 25: "TIM1_UP_TIM10",
+    56: "DMA2_Stream0", 58: "DMA2_Stream2", 59: "DMA2_Stream3",
+    67: "OTG_FS", 69: "DMA2_Stream6", 70: "DMA2_Stream7",
+}
+
+PID = 1
+ISR_TID_BASE = 1000
+
+
+def load(path):
+    """Return the raw trace bytes from a trace.bin or a UART capture."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == MAGIC:
+        return data
+    text = data.decode("ascii", "replace")
+    m = re.search(r"trace begin (\d+)\r?\n(.*?)trace end", text, re.S)
+    if m is None:
+        sys.exit(f"{path}: neither a trace.bin nor a capture with a 'trace dump'")
+    out = bytearray()
+    for line in m.group(2).splitlines():
+        line = line.strip()
+        # Log lines from other tasks can interleave with the dump
+        if re.fullmatch(r"(?:[0-9a-f]{2})+", line):
+            out += bytes.fromhex(line)
+    if len(out) != int(m.group(1)):
+        print(f"warning: dump has {len(out)} bytes, expected {m.group(1)}", file=sys.stderr)
+    return bytes(out)
+
+
+def cstr(raw):
+    return raw.split(b"\0", 1)[0].decode("utf-8", "replace")
+
+
+def parse(data):
+    """Return (header dict, {task number: (name, priority)}, {marker id: name}, events)."""
+    if len(data) < HEADER.size:
+        sys.exit("trace is shorter than its header")
+    (magic, version, header_size, timer_hz, event_count, dropped,
+     task_count, task_size, marker_count, marker_size) = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        sys.exit("bad trace magic")
+    if version != 1:
+        sys.exit(f"unsupported trace version {version}")
+    header = {"timer_hz": timer_hz, "events": event_count, "dropped": dropped}
+
+    pos = header_size
+    tasks = {}
+    for _ in range(task_count):
+        number, priority = struct.unpack_from("<HB", data, pos)
+        tasks[number] = (cstr(data[pos + 4:pos + task_size]), priority)
+        pos += task_size
+    markers = {}
+    for _ in range(marker_count):
+        markers[data[pos]] = cstr(data[pos + 1:pos + marker_size])
+        pos += marker_size
+
+    events = []
+    high = 0
+    last = None
+    for _ in range(event_count):
+        if pos + EVENT.size > len(data):
+            print("warning: trace is truncated", file=sys.stderr)
+            break
+        ts, etype, arg8, arg16 = EVENT.unpack_from(data, pos)
+        pos += EVENT.size
+        if last is not None and ts < last:
+            high += 1
+        last = ts
+        events.append(((high << 32) | ts, etype, arg8, arg16))
+    return header, tasks, markers, events
+
+
+def isr_name(exc):
+    if exc in EXCEPTIONS:
+        return EXCEPTIONS[exc]
+    if exc >= 16:
+        return IRQ_NAMES.get(exc - 16, "IRQ %d" % (exc - 16))
+    return "exception %d" % exc
+
+
+def convert(header, tasks, markers, events):
+    """Build the list of Chrome trace events."""
+    scale = 1e6 / header["timer_hz"]
+    t0 = events[0][0] if events else 0
+    out = []
+    running = None              # task number currently switched in
+    run_start = {}
+    isr_seen = set()
+    task_seen = set()
+
+    def ts(t):
+        return (t - t0) * scale
+
+    def task_tid(number):
+        task_seen.add(number)
+        return number
+
+    def isr_tid(exc):
+        isr_seen.add(exc)
+        return ISR_TID_BASE + exc
+
+    def task_label(number):
+        return tasks.get(number, ("task %d" % number, 0))[0]
+
+    for t, etype, arg8, arg16 in events:
+        if etype == TASK_IN:
+            running = arg16
+            run_start[arg16] = t
+        elif etype == TASK_OUT:
+            start = run_start.pop(arg16, t0)
+            out.append({"name": task_label(arg16), "ph": "X", "pid": PID, "tid": task_tid(arg16),
+                        "ts": ts(start), "dur": ts(t) - ts(start)})
+            if running == arg16:
+                running = None
+        elif etype in (TASK_READY, TASK_DELAY):
+            out.append({"name": "ready" if etype == TASK_READY else "delay", "ph": "i", "s": "t",
+                        "pid": PID, "tid": task_tid(arg16), "ts": ts(t)})
+        elif etype == ISR_ENTER:
+            out.append({"name": isr_name(arg8), "ph": "B", "pid": PID, "tid": isr_tid(arg8), "ts": ts(t)})
+        elif etype == ISR_EXIT:
+            out.append({"name": isr_name(arg8), "ph": "E", "pid": PID, "tid": isr_tid(arg8), "ts": ts(t)})
+        elif etype in QUEUE_EVENTS:
+            kind = QUEUE_TYPES.get(arg8, "queue type %d" % arg8)
+            tid = task_tid(running) if running is not None and etype not in (9, 10) else 0
+            out.append({"name": "%s %s" % (kind, QUEUE_EVENTS[etype]), "ph": "i", "s": "t",
+                        "pid": PID, "tid": tid, "ts": ts(t),
+                        "args": {"object": "0x%08x" % (0x20000000 + arg16 * 4)}})
+        elif etype in (USER_BEGIN, USER_END, USER_MARK):
+            name = markers.get(arg8, "marker %d" % arg8)
+            ev = {"name": name, "cat": "user", "pid": PID, "ts": ts(t)}
+            if etype == USER_MARK:
+                tid = task_tid(running) if running is not None else 0
+                ev.update(ph="i", s="t", tid=tid, args={"value": arg16})
+            else:
+                ev.update(ph="b" if etype == USER_BEGIN else "e", tid=0, id=arg8)
+                if etype == USER_BEGIN:
+                    ev["args"] = {"value": arg16}
+            out.append(ev)
+
+    # Tasks still running at the end of the capture
+    if events:
+        for number, start in run_start.items():
+            out.append({"name": task_label(number), "ph": "X", "pid": PID, "tid": task_tid(number),
+                        "ts": ts(start), "dur": ts(events[-1][0]) - ts(start)})
+
+    meta = [{"name": "process_name", "ph": "M", "pid": PID, "args": {"name": "STM32F407"}}]
+    for number in sorted(task_seen):
+        name, priority = tasks.get(number, ("task %d" % number, 0))
+        meta.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": number,
+                     "args": {"name": "%s (prio %d)" % (name, priority)}})
+        meta.append({"name": "thread_sort_index", "ph": "M", "pid": PID, "tid": number,
+                     "args": {"sort_index": 100 - priority}})
+    for exc in sorted(isr_seen):
+        meta.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": ISR_TID_BASE + exc,
+                     "args": {"name": "ISR " + isr_name(exc)}})
+        meta.append({"name": "thread_sort_index", "ph": "M", "pid": PID, "tid": ISR_TID_BASE + exc,
+                     "args": {"sort_index": exc - 1000}})
+    meta.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": 0, "args": {"name": "ISR / unknown"}})
+    return meta + out
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("input", help="trace.bin or a UART capture containing 'trace dump' output")
+    ap.add_argument("-o", "--output", help="JSON file to write (default: stdout)")
+    args = ap.parse_args(argv)
+
+    header, tasks, markers, events = parse(load(args.input))
+    span = (events[-1][0] - events[0][0]) / header["timer_hz"] if events else 0
+    print("%d events over %.3f s, %d dropped, %d tasks, %d markers"
+          % (len(events), span, header["dropped"], len(tasks), len(markers)), file=sys.stderr)
+
+    doc = {"traceEvents": convert(header, tasks, markers, events), "displayTimeUnit": "ms"}
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(doc, f)
+    else:
+        json.dump(doc, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
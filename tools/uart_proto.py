@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+"""Drive the firmware over its binary UART protocol (Core/Inc/uart_proto.h).
+
+Frame layout, little endian:
+
+    uint8 0xC3, uint8 0x3C, uint16 len, uint8 cmd, uint8 seq, uint8 flags,
+    uint8 status, payload[len], uint16 crc
+
+The crc is CRC-16/CCITT-FALSE over len through the end of the payload.
+A reply carries cmd | 0x80, the request's seq and a status byte. Requests
+with flags bit 0 set get no reply. Replies share the UART with log output.
+Bytes outside frames are log text; they are printed with --show-log.
+
+Commands:
+    uart_proto.py --port /dev/ttyUSB0 ping [--count N] [--size B]
+    uart_proto.py --port /dev/ttyUSB0 info
+    uart_proto.py --port /dev/ttyUSB0 stats
+    uart_proto.py --port /dev/ttyUSB0 scene ID [--anim A] [--time MS]
+    uart_proto.py --port /dev/ttyUSB0 stream [--seconds S] [--size B]
+
+"stream" sends STREAM frames without replies as fast as the link allows.
+It then reads the device counters to report throughput and loss. The
+firmware writes the payload to the recorder if it is running.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+SYNC = b"\xC3\x3C"
+HEAD = struct.Struct("<2sHBBBB")
+REPLY = 0x80
+NO_REPLY = 0x01
+
+CMD_PING, CMD_INFO, CMD_STATS, CMD_SCENE, CMD_STREAM = 0x01, 0x02, 0x03, 0x10, 0x20
+STATUS = {0: "ok", 1: "unknown command", 2: "bad argument", 3: "busy", 4: "not recording"}
+
+INFO = struct.Struct("<HHIQ")
+STATS = struct.Struct("<7I7IHHI")
+STATS_FIELDS = (
+    "rx_received", "rx_overflows", "rx_lost", "rx_line_errors", "rx_high_water",
+    "tx_written", "tx_dropped",
+    "frames", "crc_errors", "timeouts", "unknown", "text_bytes", "stream_bytes", "stream_dropped",
+    "cpu_load_permille", "cpu_avg_permille", "heap_free",
+)
+
+
+def crc16(data, crc=0xFFFF):
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def encode(cmd, seq, payload=b"", flags=0):
+    body = HEAD.pack(SYNC, len(payload), cmd, seq, flags, 0)[2:] + payload
+    return SYNC + body + struct.pack("<H", crc16(body))
+
+
+class Link:
+    """Serial port with a frame parser that passes other bytes through as log text."""
+
+    def __init__(self, port, baud, show_log):
+        import serial
+        self.port = serial.Serial(port, baud, timeout=0.05)
+        self.show_log = show_log
+        self.buf = b""
+        self.seq = 0
+
+    def send(self, cmd, payload=b"", flags=0):
+        self.seq = (self.seq + 1) & 0xFF
+        self.port.write(encode(cmd, self.seq, payload, flags))
+        return self.seq
+
+    def _text(self, data):
+        if self.show_log and data:
+            sys.stdout.write(data.decode("utf-8", "replace"))
+            sys.stdout.flush()
+
+    def _frame(self):
+        """Return (cmd, seq, status, payload) from the buffer, or None if more data is needed."""
+        while True:
+            pos = self.buf.find(SYNC)
+            if pos < 0:
+                keep = 1 if self.buf.endswith(SYNC[:1]) else 0
+                self._text(self.buf[:len(self.buf) - keep])
+                self.buf = self.buf[len(self.buf) - keep:]
+                return None
+            self._text(self.buf[:pos])
+            self.buf = self.buf[pos:]
+            if len(self.buf) < HEAD.size:
+                return None
+            _, length, cmd, seq, _, status = HEAD.unpack_from(self.buf)
+            if len(self.buf) < HEAD.size + length + 2:
+                return None
+            body = self.buf[2:HEAD.size + length]
+            crc, = struct.unpack_from("<H", self.buf, HEAD.size + length)
+            if crc != crc16(body):
+                self._text(self.buf[:1])
+                self.buf = self.buf[1:]
+                continue
+            payload = self.buf[HEAD.size:HEAD.size + length]
+            self.buf = self.buf[HEAD.size + length + 2:]
+            return cmd, seq, status, payload
+
+    def wait_reply(self, cmd, seq, timeout=1.0):
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            self.buf += self.port.read(4096)
+            while True:
+                frame = self._frame()
+                if frame is None:
+                    break
+                if frame[0] == cmd | REPLY and frame[1] == seq:
+                    return frame[2], frame[3]
+        raise TimeoutError("no reply to command 0x%02x" % cmd)
+
+    def call(self, cmd, payload=b"", timeout=1.0):
+        status, data = self.wait_reply(cmd, self.send(cmd, payload), timeout)
+        if status != 0:
+            raise RuntimeError("command 0x%02x failed: %s" % (cmd, STATUS.get(status, status)))
+        return data
+
+
+def get_stats(link):
+    return dict(zip(STATS_FIELDS, STATS.unpack(link.call(CMD_STATS)[:STATS.size])))
+
+
+def do_ping(link, args):
+    payload = bytes(i & 0xFF for i in range(args.size))
+    times = []
+    for _ in range(args.count):
+        start = time.perf_counter()
+        if link.call(CMD_PING, payload) != payload:
+            sys.exit("ping: payload mismatch")
+        times.append((time.perf_counter() - start) * 1000)
+    print("%d pings, %d bytes: min %.2f ms, avg %.2f ms, max %.2f ms"
+          % (len(times), args.size, min(times), sum(times) / len(times), max(times)))
+
+
+def do_info(link, args):
+    data = link.call(CMD_INFO)
+    version, max_payload, ring, uptime = INFO.unpack_from(data)
+    print("protocol %d, max payload %d B, rx ring %d B" % (version, max_payload, ring))
+    print("uptime %.3f s, built %s" % (uptime / 1e6, data[INFO.size:].decode("ascii", "replace")))
+
+
+def do_stats(link, args):
+    for name, value in get_stats(link).items():
+        print("%-18s %d" % (name, value))
+
+
+def do_scene(link, args):
+    link.call(CMD_SCENE, struct.pack("<BBH", args.id, args.anim, args.time))
+    print("scene %d requested" % args.id)
+
+
+def do_stream(link, args):
+    before = get_stats(link)
+    payload = bytes(i & 0xFF for i in range(args.size))
+    frames = 0
+    start = time.monotonic()
+    while time.monotonic() - start < args.seconds:
+        link.send(CMD_STREAM, payload, NO_REPLY)
+        frames += 1
+    link.port.flush()
+    elapsed = time.monotonic() - start
+    time.sleep(0.2)
+    after = get_stats(link)
+    received = after["stream_bytes"] - before["stream_bytes"]
+    sent = frames * args.size
+    print("sent %d frames, %d B in %.2f s (%.1f kB/s payload)" % (frames, sent, elapsed, sent / elapsed / 1e3))
+    print("device received %d B (%d B missing), crc errors %d, rx overflows %d, line errors %d"
+          % (received, sent - received, after["crc_errors"] - before["crc_errors"],
+             after["rx_overflows"] - before["rx_overflows"],
+             after["rx_line_errors"] - before["rx_line_errors"]))
+    print("recorder dropped %d records" % (after["stream_dropped"] - before["stream_dropped"]))
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--port", required=True)
+    ap.add_argument("--baud", type=int, default=115200)
+    ap.add_argument("--show-log", action="store_true", help="print log text received between frames")
+    sub = ap.add_subparsers(dest="command", required=True)
+    p = sub.add_parser("ping")
+    p.add_argument("--count", type=int, default=10)
+    p.add_argument("--size", type=int, default=16)
+    sub.add_parser("info")
+    sub.add_parser("stats")
+    p = sub.add_parser("scene")
+    p.add_argument("id", type=int)
+    p.add_argument("--anim", type=int, default=0)
+    p.add_argument("--time", type=int, default=0)
+    p = sub.add_parser("stream")
+    p.add_argument("--seconds", type=float, default=5.0)
+    p.add_argument("--size", type=int, default=1024)
+    args = ap.parse_args(argv)
+
+    try:
+        import serial  # noqa: F401
+    except ImportError:
+        sys.exit("pyserial is required: pip install pyserial")
+    link = Link(args.port, args.baud, args.show_log)
+    {"ping": do_ping, "info": do_info, "stats": do_stats, "scene": do_scene, "stream": do_stream}[args.command](link, args)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""Host side of the USB throughput self-test (Core/Src/usb_selftest.c).
+
+With USB_SELFTEST_ENABLE set, the firmware re-enumerates once per endpoint
+FIFO profile and streams a fixed pattern on the CDC bulk IN endpoint while
+the port is open. This script keeps the CDC port open across the
+re-enumerations, drains it as fast as possible and prints the observed rate
+once per second. With --write it also pushes data to the bulk OUT endpoint
+so the firmware can measure the receive path. The device-side numbers are
+reported in the firmware log (UART).
+
+Usage:
+    usb_selftest.py [--write] [--chunk 4096] /dev/ttyACM0
+"""
+
+import argparse
+import sys
+import time
+
+try:
+    import serial
+except ImportError:
+    sys.exit("pyserial is required: pip install pyserial")
+
+
+def open_port(path, timeout):
+    """Wait until the port shows up again after a re-enumeration."""
+    while True:
+        try:
+            port = serial.Serial(path, timeout=timeout, write_timeout=timeout)
+            port.dtr = True
+            return port
+        except (serial.SerialException, OSError):
+            time.sleep(0.2)
+
+
+def run(path, write, chunk):
+    payload = bytes(range(256)) * (chunk // 256 + 1)
+    payload = payload[:chunk]
+    session = 0
+    while True:
+        port = open_port(path, 0.1)
+        session += 1
+        print("session %d: %s open" % (session, path), flush=True)
+        rx = tx = 0
+        t0 = time.monotonic()
+        try:
+            while True:
+                rx += len(port.read(chunk))
+                if write:
+                    tx += port.write(payload) or 0
+                now = time.monotonic()
+                if now - t0 >= 1.0:
+                    print("  IN %7.1f KB/s  OUT %7.1f KB/s"
+                          % (rx / (now - t0) / 1000.0, tx / (now - t0) / 1000.0),
+                          flush=True)
+                    rx = tx = 0
+                    t0 = now
+        except (serial.SerialException, OSError):
+            print("session %d: device detached" % session, flush=True)
+        finally:
+            try:
+                port.close()
+            except (serial.SerialException, OSError):
+                pass
+
+
+def main(argv=None):
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("port", help="CDC device, e.g. /dev/ttyACM0 or COM5")
+    ap.add_argument("--write", action="store_true",
+                    help="also stream data to the device (bulk OUT)")
+    ap.add_argument("--chunk", type=int, default=4096,
+                    help="read/write size per call (default 4096)")
+    args = ap.parse_args(argv)
+    try:
+        run(args.port, args.write, max(64, args.chunk))
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())